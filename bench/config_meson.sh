@@ -0,0 +1,2 @@
+rm -rf ./buildDir
+meson setup buildDir
@@ -0,0 +1,103 @@
+#ifndef BENCH_BENCH_UTILS_H
+#define BENCH_BENCH_UTILS_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+namespace Bench {
+    /**
+     * Prevents the compiler from optimizing away the computation of the given value.
+     */
+    template <class T>
+    inline void doNotOptimize(const T &value) {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    /**
+     * Forces the compiler to assume that all memory was read and written.
+     */
+    inline void clobberMemory() {
+        asm volatile("" : : : "memory");
+    }
+
+    /**
+     * Reads the time-stamp counter. It's serialized with lfence on both sides, so it's only suitable for measuring
+     * whole loops, not single instructions.
+     */
+    inline uint64_t readTsc() {
+        uint32_t low, high;
+        asm volatile("lfence; rdtsc; lfence" : "=a"(low), "=d"(high) : : "memory");
+        return (static_cast<uint64_t>(high) << 32) | low;
+    }
+
+    class Stopwatch {
+        std::chrono::steady_clock::time_point start;
+
+    public:
+        Stopwatch() : start(std::chrono::steady_clock::now()) {}
+
+        [[nodiscard]] double elapsedNs() const {
+            return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        }
+    };
+
+    struct Measurement {
+        double nsPerOp;
+        /**
+         * In TSC (reference) cycles, which tick at a constant rate regardless of turbo/power states.
+         */
+        double cyclesPerOp;
+    };
+
+    /**
+     * Runs op repeatedly for at least minDurationNs (after a calibration phase that also warms up the caches) and
+     * returns the average cost of one call.
+     */
+    template <class Op>
+    Measurement measureOp(Op &&op, const double minDurationNs = 50e6) {
+        size_t iterations = 1;
+        for (;;) {
+            const Stopwatch stopwatch;
+            for (size_t i = 0; i < iterations; i++) {
+                op();
+                clobberMemory();
+            }
+
+            //a tenth of the target is enough to extrapolate the iteration count
+            if (stopwatch.elapsedNs() * 10 >= minDurationNs) {
+                break;
+            }
+            iterations *= 2;
+        }
+        iterations *= 10;
+
+        const Stopwatch stopwatch;
+        const uint64_t startTsc = readTsc();
+        for (size_t i = 0; i < iterations; i++) {
+            op();
+            clobberMemory();
+        }
+        const uint64_t elapsedTsc = readTsc() - startTsc;
+        const double elapsedNs = stopwatch.elapsedNs();
+
+        return {elapsedNs / static_cast<double>(iterations),
+                static_cast<double>(elapsedTsc) / static_cast<double>(iterations)};
+    }
+
+    /**
+     * Writes a human-readable size (e.g. "4 KiB") into the given buffer.
+     */
+    inline void formatSize(const size_t size, char *buffer, const size_t bufferSize) {
+        if (size >= 1024 * 1024 && size % (1024 * 1024) == 0) {
+            std::snprintf(buffer, bufferSize, "%zu MiB", size / (1024 * 1024));
+        } else if (size >= 1024 && size % 1024 == 0) {
+            std::snprintf(buffer, bufferSize, "%zu KiB", size / 1024);
+        } else {
+            std::snprintf(buffer, bufferSize, "%zu B", size);
+        }
+    }
+} //namespace Bench
+
+#endif //BENCH_BENCH_UTILS_H
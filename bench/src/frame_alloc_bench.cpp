@@ -0,0 +1,437 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "frame_allocator/buddy_allocator.h"
+#include "frame_allocator/frame_bitmap.h"
+#include "frame_allocator/memory_map.h"
+
+#include "bench_utils.h"
+
+/**
+ * Stress-tests the buddy frame allocator from several threads (each one standing in for a CPU with its own frame cache),
+ * checking that no frame is handed out twice and that everything coalesces back once freed. Then compares the cost of
+ * single-frame allocations through the buddy lists and through the per-CPU caches, with 1 to 8 threads. Finally,
+ * normalizes a synthetic 512 GiB memory map and measures the two-level frame bitmap built from it.
+ */
+
+using FrameAllocator::BuddyAllocator;
+using FrameAllocator::FRAME_SIZE;
+using FrameAllocator::FrameBitmap;
+using FrameAllocator::MemoryRegion;
+using FrameAllocator::RegionKind;
+
+//the simulated physical memory: 256 MiB at 1 GiB, backed by a host buffer
+static constexpr size_t ARENA_SIZE = 256ULL * 1024 * 1024;
+static constexpr size_t ARENA_FRAMES = ARENA_SIZE / FRAME_SIZE;
+static constexpr uint64_t ARENA_PHYS_BASE = 0x40000000ULL;
+
+static constexpr unsigned MAX_THREADS = 8;
+static constexpr size_t STRESS_ITERATIONS = 200000;
+static constexpr size_t STRESS_HELD_BLOCKS = 256;
+static constexpr int STRESS_MAX_ORDER = 9;
+
+static constexpr size_t SCALING_OPS_PER_THREAD = 4ULL * 1024 * 1024;
+static constexpr size_t SCALING_HELD_FRAMES = 16;
+
+//the bitmap never touches the frames, so it can track a machine much larger than the host
+static constexpr uint64_t BITMAP_RAM_SIZE = 512ULL * 1024 * 1024 * 1024;
+static constexpr uint64_t GIB = 1024 * 1024 * 1024;
+static constexpr uint64_t MIB = 1024 * 1024;
+static constexpr uint64_t KIB = 1024;
+
+static char *arena = nullptr;
+static BuddyAllocator allocator;
+
+static thread_local unsigned currentCpu = 0;
+
+static unsigned getCurrentCpu() {
+    return currentCpu;
+}
+
+static uint64_t *toHost(const uint64_t physAddress) {
+    return reinterpret_cast<uint64_t *>(arena + (physAddress - ARENA_PHYS_BASE));
+}
+
+static bool resetAllocator(uint8_t *metadata) {
+    if (!allocator.init(
+        metadata,
+        BuddyAllocator::getMetadataSize(ARENA_FRAMES),
+        ARENA_PHYS_BASE,
+        ARENA_FRAMES,
+        reinterpret_cast<uint64_t>(arena) - ARENA_PHYS_BASE)) {
+        return false;
+    }
+
+    allocator.setCpuIndexFunction(getCurrentCpu);
+    allocator.addFreeRange(ARENA_PHYS_BASE, ARENA_FRAMES);
+    return true;
+}
+
+/**
+ * A small xorshift generator, so every thread gets its own reproducible sequence.
+ */
+struct Random {
+    uint64_t state;
+
+    uint64_t next() {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+};
+
+struct HeldBlock {
+    uint64_t physAddress;
+    int order;
+};
+
+/**
+ * Tags the first and last word of a block with its owner, so a block given to two owners at once is caught on free.
+ */
+static void tagBlock(const HeldBlock &block, const uint64_t owner) {
+    const size_t words = (FRAME_SIZE << block.order) / sizeof(uint64_t);
+    toHost(block.physAddress)[0] = owner ^ block.physAddress;
+    toHost(block.physAddress)[words - 1] = owner ^ block.physAddress;
+}
+
+static bool checkTag(const HeldBlock &block, const uint64_t owner) {
+    const size_t words = (FRAME_SIZE << block.order) / sizeof(uint64_t);
+    return toHost(block.physAddress)[0] == (owner ^ block.physAddress) &&
+           toHost(block.physAddress)[words - 1] == (owner ^ block.physAddress);
+}
+
+static void releaseBlock(const HeldBlock &block) {
+    if (block.order == 0) {
+        allocator.freeFrame(block.physAddress);
+    } else {
+        allocator.free(block.physAddress, block.order);
+    }
+}
+
+static void stressThread(const unsigned cpu, std::atomic<bool> *failed) {
+    currentCpu = cpu;
+    Random random{0x9E3779B97F4A7C15ULL * (cpu + 1)};
+    std::vector<HeldBlock> held;
+
+    for (size_t i = 0; i < STRESS_ITERATIONS && !failed->load(std::memory_order_relaxed); i++) {
+        if (held.size() == STRESS_HELD_BLOCKS || (!held.empty() && random.next() % 2 == 0)) {
+            const size_t victim = random.next() % held.size();
+            if (!checkTag(held[victim], cpu)) {
+                std::fprintf(stderr, "CPU %u: block 0x%llx was overwritten by another owner\n", cpu,
+                             static_cast<unsigned long long>(held[victim].physAddress));
+                failed->store(true);
+                return;
+            }
+            releaseBlock(held[victim]);
+            held[victim] = held.back();
+            held.pop_back();
+            continue;
+        }
+
+        //mostly single frames, like the page tables and the page cache would ask for
+        const int order = random.next() % 4 != 0 ? 0 : static_cast<int>(random.next() % (STRESS_MAX_ORDER + 1));
+        const uint64_t physAddress = order == 0 ? allocator.allocateFrame() : allocator.allocate(order);
+        if (physAddress == 0) {
+            continue;
+        }
+        if ((physAddress & ((FRAME_SIZE << order) - 1)) != 0) {
+            std::fprintf(stderr, "CPU %u: order %d block 0x%llx is misaligned\n", cpu, order,
+                         static_cast<unsigned long long>(physAddress));
+            failed->store(true);
+            return;
+        }
+
+        held.push_back({physAddress, order});
+        tagBlock(held.back(), cpu);
+    }
+
+    for (const HeldBlock &block : held) {
+        releaseBlock(block);
+    }
+}
+
+static bool runStress(const unsigned threadCount) {
+    std::atomic<bool> failed{false};
+    std::vector<std::thread> threads;
+    for (unsigned cpu = 0; cpu < threadCount; cpu++) {
+        threads.emplace_back(stressThread, cpu, &failed);
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    if (failed.load()) {
+        return false;
+    }
+
+    allocator.drainCaches();
+    if (allocator.getFreeFrameCount() != ARENA_FRAMES) {
+        std::fprintf(stderr, "%zu frames are free after the stress test instead of %zu\n",
+                     allocator.getFreeFrameCount(), ARENA_FRAMES);
+        return false;
+    }
+
+    //everything has to be merged back into the largest blocks the arena can hold
+    const int topOrder = __builtin_ctzll(ARENA_FRAMES);
+    for (int order = 0; order <= FrameAllocator::MAX_ORDER; order++) {
+        const size_t expected = order == topOrder ? 1 : 0;
+        if (allocator.getFreeBlockCount(order) != expected) {
+            std::fprintf(stderr, "%zu free blocks of order %d after the stress test instead of %zu\n",
+                         allocator.getFreeBlockCount(order), order, expected);
+            return false;
+        }
+    }
+
+    std::printf("stress test with %u threads: ok\n", threadCount);
+    return true;
+}
+
+static void scalingThread(const unsigned cpu, const bool cached, std::atomic<bool> *start) {
+    currentCpu = cpu;
+    uint64_t frames[SCALING_HELD_FRAMES];
+
+    while (!start->load(std::memory_order_acquire)) {}
+
+    for (size_t i = 0; i < SCALING_OPS_PER_THREAD / SCALING_HELD_FRAMES; i++) {
+        for (uint64_t &frame : frames) {
+            frame = cached ? allocator.allocateFrame() : allocator.allocate(0);
+        }
+        Bench::clobberMemory();
+        for (const uint64_t frame : frames) {
+            if (cached) {
+                allocator.freeFrame(frame);
+            } else {
+                allocator.free(frame, 0);
+            }
+        }
+    }
+}
+
+/**
+ * Returns the wall-clock time divided by the number of allocation/free pairs done by all the threads together: it halves
+ * every time the thread count doubles if the allocator scales perfectly.
+ */
+static double measureScaling(const unsigned threadCount, const bool cached) {
+    std::atomic<bool> start{false};
+    std::vector<std::thread> threads;
+    for (unsigned cpu = 0; cpu < threadCount; cpu++) {
+        threads.emplace_back(scalingThread, cpu, cached, &start);
+    }
+
+    const Bench::Stopwatch stopwatch;
+    start.store(true, std::memory_order_release);
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    const double elapsedNs = stopwatch.elapsedNs();
+
+    allocator.drainCaches();
+    return elapsedNs / static_cast<double>(SCALING_OPS_PER_THREAD * threadCount);
+}
+
+/**
+ * Same layout as MemoryMapEntry_t (boot_params.h is part of the bootloader), with the 8 bytes of padding firmwares
+ * usually add after each descriptor.
+ */
+struct MapEntry {
+    uint32_t type;
+    uint64_t physical_start;
+    uint64_t virtual_start;
+    uint64_t page_count;
+    uint64_t flags;
+    uint64_t padding;
+};
+
+struct MemoryMap {
+    size_t mem_map_size;
+    MapEntry *entries;
+    size_t mem_map_key;
+    size_t entry_size;
+    uint32_t entry_version;
+};
+
+static void addMapEntries(std::vector<MapEntry> &entries, const uint32_t type, const uint64_t start, const uint64_t end,
+                          const uint64_t chunkSize) {
+    for (uint64_t address = start; address < end; address += chunkSize) {
+        const uint64_t size = std::min(chunkSize, end - address);
+        entries.push_back({type, address, 0, size / FRAME_SIZE, 0, 0});
+    }
+}
+
+/**
+ * Builds a shuffled, fragmented map like a real firmware would (boot services and loader memory scattered through the
+ * conventional memory, plus one overlapping descriptor), and checks that it normalizes to the 7 regions it describes.
+ */
+static bool buildBitmapRegions(std::vector<MemoryRegion> &regions) {
+    using namespace FrameAllocator::EfiMemoryType;
+    constexpr uint32_t RESERVED_MEMORY_TYPE = 0;
+
+    std::vector<MapEntry> entries;
+    addMapEntries(entries, ConventionalMemory, 0, 640 * KIB, 64 * KIB);
+    addMapEntries(entries, RESERVED_MEMORY_TYPE, 640 * KIB, MIB, 384 * KIB);
+    addMapEntries(entries, ConventionalMemory, MIB, 256 * MIB, 3 * MIB);
+    addMapEntries(entries, LoaderData, 256 * MIB, 512 * MIB, 5 * MIB);
+    addMapEntries(entries, BootServicesData, 512 * MIB, GIB, 7 * MIB);
+    addMapEntries(entries, BootServicesCode, GIB, 2 * GIB, 11 * MIB);
+    addMapEntries(entries, AcpiReclaimMemory, 2 * GIB, 2 * GIB + MIB, MIB);
+    addMapEntries(entries, ConventionalMemory, 4 * GIB, BITMAP_RAM_SIZE, 3 * GIB);
+    //a reserved descriptor the firmware also reports as the end of a conventional one
+    addMapEntries(entries, RESERVED_MEMORY_TYPE, 10 * GIB - 64 * KIB, 10 * GIB, 64 * KIB);
+
+    Random random{12345};
+    for (size_t i = entries.size() - 1; i > 0; i--) {
+        std::swap(entries[i], entries[random.next() % (i + 1)]);
+    }
+
+    const MemoryMap map = {entries.size() * sizeof(MapEntry), entries.data(), 0, sizeof(MapEntry), 1};
+    regions.resize(entries.size());
+    const size_t count = FrameAllocator::collectRegions(map, regions.data(), regions.size(), true);
+    regions.resize(count);
+
+    const MemoryRegion expected[] = {
+        {0, 640 * KIB / FRAME_SIZE, RegionKind::Usable},
+        {640 * KIB, 384 * KIB / FRAME_SIZE, RegionKind::Reserved},
+        {MIB, (2 * GIB - MIB) / FRAME_SIZE, RegionKind::Usable},
+        {2 * GIB, MIB / FRAME_SIZE, RegionKind::AcpiReclaimable},
+        {4 * GIB, (6 * GIB - 64 * KIB) / FRAME_SIZE, RegionKind::Usable},
+        {10 * GIB - 64 * KIB, 64 * KIB / FRAME_SIZE, RegionKind::Reserved},
+        {10 * GIB, (BITMAP_RAM_SIZE - 10 * GIB) / FRAME_SIZE, RegionKind::Usable},
+    };
+    std::printf("\nmemory map: %zu descriptors normalized into %zu regions\n", entries.size(), count);
+    if (count != sizeof(expected) / sizeof(expected[0])) {
+        std::fprintf(stderr, "Expected %zu regions\n", sizeof(expected) / sizeof(expected[0]));
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (regions[i].physStart != expected[i].physStart || regions[i].frameCount != expected[i].frameCount ||
+            regions[i].kind != expected[i].kind) {
+            std::fprintf(stderr, "Region %zu is wrong: 0x%llx, %llu frames\n", i,
+                         static_cast<unsigned long long>(regions[i].physStart),
+                         static_cast<unsigned long long>(regions[i].frameCount));
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool runBitmapCases() {
+    std::vector<MemoryRegion> regions;
+    if (!buildBitmapRegions(regions)) {
+        return false;
+    }
+
+    const size_t frameCount = BITMAP_RAM_SIZE / FRAME_SIZE;
+    const size_t storageSize = FrameBitmap::getStorageSize(frameCount);
+    void *storage = std::aligned_alloc(FRAME_SIZE, storageSize);
+    if (storage == nullptr) {
+        std::fprintf(stderr, "Failed to allocate the bitmap.\n");
+        return false;
+    }
+
+    FrameBitmap bitmap;
+    const Bench::Stopwatch seedStopwatch;
+    bitmap.init(storage, storageSize, 0, frameCount);
+    bitmap.addUsableRegions(regions.data(), regions.size());
+    const double seedNs = seedStopwatch.elapsedNs();
+
+    //frame 0 is never handed out
+    const size_t expectedFree = (640 * KIB + 2 * GIB - MIB + BITMAP_RAM_SIZE - 4 * GIB - 64 * KIB) / FRAME_SIZE - 1;
+    std::printf("%zu free frames (%zu KiB of bitmap), seeded in %.2f ms\n", bitmap.getFreeFrameCount(),
+                storageSize / 1024, seedNs / 1e6);
+    if (bitmap.getFreeFrameCount() != expectedFree || bitmap.isFree(0) || bitmap.isFree(10 * GIB - FRAME_SIZE)) {
+        std::fprintf(stderr, "The bitmap doesn't match the regions.\n");
+        return false;
+    }
+
+    std::printf("\nframe bitmap, ns per operation\n");
+
+    const Bench::Measurement pair = Bench::measureOp([&bitmap] {
+        const uint64_t frame = bitmap.allocate();
+        Bench::doNotOptimize(frame);
+        bitmap.free(frame);
+    });
+    std::printf("%24s%10.2f\n", "allocation/free pair", pair.nsPerOp);
+
+    //draining the first 4 GiB, then the next allocation has to skip all of it
+    const size_t lowFrames = (640 * KIB + 2 * GIB - MIB) / FRAME_SIZE - 1;
+    const Bench::Stopwatch drainStopwatch;
+    for (size_t i = 0; i < lowFrames; i++) {
+        Bench::doNotOptimize(bitmap.allocate());
+    }
+    const double drainNs = drainStopwatch.elapsedNs();
+    std::printf("%24s%10.2f\n", "sequential allocation", drainNs / static_cast<double>(lowFrames));
+
+    const uint64_t nextFrame = bitmap.allocate();
+    if (nextFrame != 4 * GIB) {
+        std::fprintf(stderr, "The first frame above the hole is 0x%llx\n", static_cast<unsigned long long>(nextFrame));
+        return false;
+    }
+
+    std::free(storage);
+    return true;
+}
+
+int main() {
+    arena = static_cast<char *>(std::aligned_alloc(FRAME_SIZE, ARENA_SIZE));
+    auto *metadata = static_cast<uint8_t *>(std::malloc(BuddyAllocator::getMetadataSize(ARENA_FRAMES)));
+    if (arena == nullptr || metadata == nullptr) {
+        std::fprintf(stderr, "Failed to allocate the physical memory arena.\n");
+        return 1;
+    }
+
+    const unsigned threadCount = std::clamp(std::thread::hardware_concurrency(), 1U, MAX_THREADS);
+
+    for (const unsigned threads : {1U, threadCount}) {
+        if (!resetAllocator(metadata) || !runStress(threads)) {
+            return 1;
+        }
+    }
+
+    std::printf("\nsingle thread, ns per allocation/free pair\n");
+
+    const Bench::Measurement direct = Bench::measureOp([] {
+        const uint64_t frame = allocator.allocate(0);
+        Bench::doNotOptimize(frame);
+        allocator.free(frame, 0);
+    });
+    std::printf("%24s%10.2f\n", "order 0, buddy lists", direct.nsPerOp);
+
+    const Bench::Measurement cached = Bench::measureOp([] {
+        const uint64_t frame = allocator.allocateFrame();
+        Bench::doNotOptimize(frame);
+        allocator.freeFrame(frame);
+    });
+    std::printf("%24s%10.2f\n", "order 0, per-CPU cache", cached.nsPerOp);
+
+    const Bench::Measurement hugePage = Bench::measureOp([] {
+        const uint64_t block = allocator.allocate(9);
+        Bench::doNotOptimize(block);
+        allocator.free(block, 9);
+    });
+    std::printf("%24s%10.2f\n", "order 9 (2 MiB)", hugePage.nsPerOp);
+    allocator.drainCaches();
+
+    std::printf("\nscaling, wall-clock ns per allocation/free pair (all threads together)\n");
+    std::printf("%10s%16s%16s\n", "threads", "buddy lists", "per-CPU cache");
+    for (unsigned threads = 1; threads <= threadCount; threads *= 2) {
+        const double directNs = measureScaling(threads, false);
+        const double cachedNs = measureScaling(threads, true);
+        std::printf("%10u%16.2f%16.2f\n", threads, directNs, cachedNs);
+        std::fflush(stdout);
+    }
+
+    if (!runBitmapCases()) {
+        return 1;
+    }
+
+    std::free(metadata);
+    std::free(arena);
+    return 0;
+}
@@ -0,0 +1,133 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "c_husky/cpu_features.h"
+#include "c_husky/mem_copy.h"
+
+#include "bench_utils.h"
+
+/**
+ * Compares the c_husky copy strategies and variants (and the host's memcpy) for every power of two from 1 B to 64 MiB.
+ * Usage: mem_copy_bench [misalignment]. The optional misalignment (in bytes) is applied to the destination.
+ */
+
+typedef void *(*CopyFunction)(void *dest, const void *src, size_t n);
+
+struct CopyVariant {
+    const char *name;
+    CopyFunction function;
+    bool needsAvx2;
+};
+
+static void *hostMemcpy(void *dest, const void *src, const size_t n) {
+    return memcpy(dest, src, n);
+}
+
+static constexpr CopyVariant VARIANTS[] = {
+    {"bytes", CHusky::Mem::copyBytes, false},
+    {"words", CHusky::Mem::copyWords, false},
+    {"movsq", CHusky::Mem::copyRepMovsq, false},
+    {"movsb", CHusky::Mem::copyRepMovsb, false},
+    {"baseline", CHusky::Mem::copyBaseline, false},
+    {"erms", CHusky::Mem::copyErms, false},
+    {"fsrm", CHusky::Mem::copyFsrm, false},
+    {"avx2", CHusky::Mem::copyAvx2, true},
+    {"host", hostMemcpy, false},
+};
+
+static constexpr size_t MIN_SIZE = 1;
+static constexpr size_t MAX_SIZE = 64ULL * 1024 * 1024;
+
+//every measurement copies at least this many bytes in total (and does at least MIN_ITERATIONS copies)
+static constexpr size_t BYTES_PER_MEASUREMENT = 256ULL * 1024 * 1024;
+static constexpr size_t MIN_ITERATIONS = 4;
+static constexpr size_t MAX_ITERATIONS = 4ULL * 1024 * 1024;
+
+/**
+ * Returns the throughput in GiB/s.
+ */
+static double measure(const CopyFunction function, void *dest, const void *src, const size_t size) {
+    size_t iterations = BYTES_PER_MEASUREMENT / size;
+    if (iterations < MIN_ITERATIONS) {
+        iterations = MIN_ITERATIONS;
+    }
+    if (iterations > MAX_ITERATIONS) {
+        iterations = MAX_ITERATIONS;
+    }
+
+    //warm up the caches and the page tables
+    function(dest, src, size);
+
+    const Bench::Stopwatch stopwatch;
+    for (size_t i = 0; i < iterations; i++) {
+        Bench::doNotOptimize(function(dest, src, size));
+        Bench::clobberMemory();
+    }
+    const double elapsedNs = stopwatch.elapsedNs();
+
+    return static_cast<double>(size) * static_cast<double>(iterations) / elapsedNs
+           * 1e9 / (1024.0 * 1024.0 * 1024.0);
+}
+
+int main(const int argc, char **argv) {
+    const size_t misalignment = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 0;
+
+    auto *src = static_cast<unsigned char *>(std::aligned_alloc(4096, MAX_SIZE));
+    auto *dest = static_cast<unsigned char *>(std::aligned_alloc(4096, MAX_SIZE + 4096));
+    if (src == nullptr || dest == nullptr) {
+        std::fprintf(stderr, "Failed to allocate the buffers.\n");
+        return 1;
+    }
+
+    for (size_t i = 0; i < MAX_SIZE; i++) {
+        src[i] = static_cast<unsigned char>(i * 31);
+    }
+    std::memset(dest, 0, MAX_SIZE + 4096);
+
+    const CHusky::Cpu::CpuFeatures &features = CHusky::Cpu::getCpuFeatures();
+    const bool hasAvx2 = features.hasAvx2 && CHusky::Cpu::isAvxStateEnabled();
+    std::printf(
+        "ERMS: %s, FSRM: %s, AVX2: %s, destination misalignment: %zu\n",
+        features.hasErms ? "yes" : "no",
+        features.hasFsrm ? "yes" : "no",
+        hasAvx2 ? "yes" : "no",
+        misalignment);
+    std::printf("Throughput in GiB/s\n\n");
+
+    std::printf("%10s", "size");
+    for (const CopyVariant &variant : VARIANTS) {
+        std::printf("%10s", variant.name);
+    }
+    std::printf("\n");
+
+    for (size_t size = MIN_SIZE; size <= MAX_SIZE; size *= 2) {
+        char sizeText[32];
+        Bench::formatSize(size, sizeText, sizeof(sizeText));
+        std::printf("%10s", sizeText);
+
+        for (const CopyVariant &variant : VARIANTS) {
+            if (variant.needsAvx2 && !hasAvx2) {
+                std::printf("%10s", "-");
+                continue;
+            }
+
+            std::memset(dest + misalignment, 0, size);
+            const double throughput = measure(variant.function, dest + misalignment, src, size);
+
+            if (std::memcmp(dest + misalignment, src, size) != 0) {
+                std::fprintf(stderr, "\n'%s' produced a wrong copy for size %zu\n", variant.name, size);
+                return 1;
+            }
+
+            std::printf("%10.2f", throughput);
+            std::fflush(stdout);
+        }
+        std::printf("\n");
+    }
+
+    std::free(src);
+    std::free(dest);
+    return 0;
+}
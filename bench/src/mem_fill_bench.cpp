@@ -0,0 +1,161 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "c_husky/cpu_features.h"
+#include "c_husky/mem_fill.h"
+#include "c_husky/mem_routines.h"
+
+#include "bench_utils.h"
+
+/**
+ * Compares the c_husky fill strategies and variants (and the host's memset) for every power of two from 1 B to 64 MiB,
+ * then measures how many cycles it takes to zero a single page table with each page-zeroing routine.
+ */
+
+typedef void *(*FillFunction)(void *dest, int c, size_t n);
+
+struct FillVariant {
+    const char *name;
+    FillFunction function;
+    bool needsAvx2;
+};
+
+static void *hostMemset(void *dest, const int c, const size_t n) {
+    return memset(dest, c, n);
+}
+
+static constexpr FillVariant VARIANTS[] = {
+    {"bytes", CHusky::Mem::fillBytes, false},
+    {"words", CHusky::Mem::fillWords, false},
+    {"stosq", CHusky::Mem::fillRepStosq, false},
+    {"stosb", CHusky::Mem::fillRepStosb, false},
+    {"baseline", CHusky::Mem::fillBaseline, false},
+    {"erms", CHusky::Mem::fillErms, false},
+    {"avx2", CHusky::Mem::fillAvx2, true},
+    {"host", hostMemset, false},
+};
+
+struct PageZeroVariant {
+    const char *name;
+    CHusky::Mem::ZeroPagesFunction function;
+};
+
+static constexpr PageZeroVariant PAGE_ZERO_VARIANTS[] = {
+    {"stosq", CHusky::Mem::zeroPagesRepStosq},
+    {"stosb", CHusky::Mem::zeroPagesRepStosb},
+};
+
+static constexpr size_t MIN_SIZE = 1;
+static constexpr size_t MAX_SIZE = 64ULL * 1024 * 1024;
+
+static constexpr size_t BYTES_PER_MEASUREMENT = 256ULL * 1024 * 1024;
+static constexpr size_t MIN_ITERATIONS = 4;
+static constexpr size_t MAX_ITERATIONS = 4ULL * 1024 * 1024;
+
+//the page tables are spread over this many pages, like freshly allocated frames would be
+static constexpr size_t PAGE_TABLE_POOL = 256;
+static constexpr size_t PAGE_TABLE_ROUNDS = 4096;
+
+/**
+ * Returns the throughput in GiB/s.
+ */
+static double measure(const FillFunction function, void *dest, const size_t size) {
+    size_t iterations = BYTES_PER_MEASUREMENT / size;
+    if (iterations < MIN_ITERATIONS) {
+        iterations = MIN_ITERATIONS;
+    }
+    if (iterations > MAX_ITERATIONS) {
+        iterations = MAX_ITERATIONS;
+    }
+
+    function(dest, 0x5A, size);
+
+    const Bench::Stopwatch stopwatch;
+    for (size_t i = 0; i < iterations; i++) {
+        Bench::doNotOptimize(function(dest, 0x5A, size));
+        Bench::clobberMemory();
+    }
+    const double elapsedNs = stopwatch.elapsedNs();
+
+    return static_cast<double>(size) * static_cast<double>(iterations) / elapsedNs
+           * 1e9 / (1024.0 * 1024.0 * 1024.0);
+}
+
+static bool isFilledWith(const unsigned char *buffer, const unsigned char value, const size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        if (buffer[i] != value) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main() {
+    auto *buffer = static_cast<unsigned char *>(std::aligned_alloc(4096, MAX_SIZE));
+    if (buffer == nullptr) {
+        std::fprintf(stderr, "Failed to allocate the buffer.\n");
+        return 1;
+    }
+
+    const CHusky::Cpu::CpuFeatures &features = CHusky::Cpu::getCpuFeatures();
+    const bool hasAvx2 = features.hasAvx2 && CHusky::Cpu::isAvxStateEnabled();
+    std::printf("ERMS: %s, AVX2: %s\n", features.hasErms ? "yes" : "no", hasAvx2 ? "yes" : "no");
+    std::printf("Throughput in GiB/s\n\n");
+
+    std::printf("%10s", "size");
+    for (const FillVariant &variant : VARIANTS) {
+        std::printf("%10s", variant.name);
+    }
+    std::printf("\n");
+
+    for (size_t size = MIN_SIZE; size <= MAX_SIZE; size *= 2) {
+        char sizeText[32];
+        Bench::formatSize(size, sizeText, sizeof(sizeText));
+        std::printf("%10s", sizeText);
+
+        for (const FillVariant &variant : VARIANTS) {
+            if (variant.needsAvx2 && !hasAvx2) {
+                std::printf("%10s", "-");
+                continue;
+            }
+
+            std::memset(buffer, 0, size);
+            const double throughput = measure(variant.function, buffer, size);
+
+            if (!isFilledWith(buffer, 0x5A, size)) {
+                std::fprintf(stderr, "\n'%s' produced a wrong fill for size %zu\n", variant.name, size);
+                return 1;
+            }
+
+            std::printf("%10.2f", throughput);
+            std::fflush(stdout);
+        }
+        std::printf("\n");
+    }
+
+    //page-table zeroing: the destination is usually cold, so rotate through a pool of pages
+    std::printf("\nReference cycles per 4 KiB page\n");
+    for (const PageZeroVariant &variant : PAGE_ZERO_VARIANTS) {
+        std::memset(buffer, 0xFF, PAGE_TABLE_POOL * CHusky::Mem::ZERO_PAGE_SIZE);
+
+        const uint64_t startTsc = Bench::readTsc();
+        for (size_t i = 0; i < PAGE_TABLE_ROUNDS; i++) {
+            variant.function(buffer + (i % PAGE_TABLE_POOL) * CHusky::Mem::ZERO_PAGE_SIZE, 1);
+            Bench::clobberMemory();
+        }
+        const uint64_t elapsedTsc = Bench::readTsc() - startTsc;
+
+        if (!isFilledWith(buffer, 0, PAGE_TABLE_POOL * CHusky::Mem::ZERO_PAGE_SIZE)) {
+            std::fprintf(stderr, "'%s' left non-zero bytes\n", variant.name);
+            return 1;
+        }
+
+        std::printf("%10s%10.1f\n", variant.name, static_cast<double>(elapsedTsc) / PAGE_TABLE_ROUNDS);
+    }
+
+    std::free(buffer);
+    return 0;
+}
@@ -0,0 +1,383 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "scheduler/context.h"
+#include "scheduler/scheduler.h"
+#include "scheduler/work_stealing_deque.h"
+
+#include "bench_utils.h"
+
+/**
+ * Runs the kernel's scheduler with host threads as the CPUs: every host thread calls Scheduler::run, and the kernel
+ * threads are switched in and out of it with the same switchContext. There are no interrupts, so the threads that
+ * stand for preemptible work call Scheduler::onTick themselves, once per unit of work.
+ *
+ * Measures the cost of a context switch (bare, through yield, and through block/wake on one and two CPUs), then how
+ * evenly a skewed workload spawned on a single CPU spreads over all of them by stealing.
+ */
+
+static constexpr unsigned MAX_CPUS = 8;
+static constexpr size_t STACK_SIZE = 64 * 1024;
+static constexpr uint64_t SWITCH_ROUNDS = 1000000;
+static constexpr uint64_t DEQUE_ELEMENTS = 4 * 1024 * 1024;
+
+/**
+ * The skewed workload: every eighth thread has HEAVY_UNITS units of work, the others LIGHT_UNITS.
+ */
+static constexpr unsigned SKEWED_THREADS = 512;
+static constexpr unsigned HEAVY_UNITS = 64;
+static constexpr unsigned LIGHT_UNITS = 4;
+static constexpr unsigned UNIT_ITERATIONS = 20000;
+
+static thread_local unsigned currentCpu = 0;
+
+struct alignas(64) WakeFlag {
+    std::atomic<bool> isSet;
+};
+
+static WakeFlag wakeFlags[MAX_CPUS];
+static std::atomic<unsigned> exitedCount(0);
+static unsigned expectedExits = 0;
+
+//not inlined: a kernel thread can move to another host thread at every switch, so its TLS address can't be cached
+__attribute__((noinline)) static unsigned getCpuIndex() {
+    return currentCpu;
+}
+
+static bool disableInterrupts() {
+    return false;
+}
+
+static void restoreInterrupts(bool) {}
+
+/**
+ * Spins until another CPU hands this one something, or for a few microseconds (run looks again either way).
+ */
+static void waitForWork() {
+    WakeFlag &flag = wakeFlags[getCpuIndex()];
+    for (unsigned i = 0; i < 4096 && !flag.isSet.load(std::memory_order_acquire); i++) {
+        asm volatile("pause");
+    }
+    flag.isSet.store(false, std::memory_order_relaxed);
+}
+
+static void wakeCpu(const unsigned cpuIndex) {
+    wakeFlags[cpuIndex].isSet.store(true, std::memory_order_release);
+}
+
+static void threadExited(Scheduler::Thread *) {
+    if (exitedCount.fetch_add(1) + 1 == expectedExits) {
+        Scheduler::stop();
+    }
+}
+
+/**
+ * Kernel threads with their stacks, freed when the run is over.
+ */
+struct ThreadPool {
+    std::vector<Scheduler::Thread> threads;
+    std::vector<std::unique_ptr<uint8_t[]>> stacks;
+
+    explicit ThreadPool(const size_t count) : threads(count) {
+        for (size_t i = 0; i < count; i++) {
+            stacks.emplace_back(new uint8_t[STACK_SIZE]);
+        }
+    }
+
+    Scheduler::Thread *create(const size_t index, const Scheduler::ThreadFunction function, void *argument) {
+        Scheduler::initThread(&threads[index], stacks[index].get(), STACK_SIZE, function, argument, "bench");
+        return &threads[index];
+    }
+};
+
+/**
+ * Runs the scheduler on cpuCount host threads until threadCount kernel threads have exited. The threads must be
+ * started (on CPU 0) by setUp, which runs before the CPUs do.
+ * @return The time the run took, in nanoseconds.
+ */
+template <class SetUp>
+static double runScheduler(const unsigned cpuCount, const unsigned threadCount, SetUp &&setUp) {
+    const Scheduler::Hooks hooks = {
+        getCpuIndex, disableInterrupts, restoreInterrupts, waitForWork, wakeCpu, threadExited, nullptr,
+    };
+    Scheduler::init(hooks);
+    exitedCount = 0;
+    expectedExits = threadCount;
+    currentCpu = 0;
+    setUp();
+
+    const Bench::Stopwatch stopwatch;
+    std::vector<std::thread> cpus;
+    for (unsigned cpu = 0; cpu < cpuCount; cpu++) {
+        cpus.emplace_back([cpu] {
+            currentCpu = cpu;
+            Scheduler::run();
+        });
+    }
+    for (std::thread &cpu : cpus) {
+        cpu.join();
+    }
+    return stopwatch.elapsedNs();
+}
+
+static void *mainContext = nullptr;
+static void *benchContext = nullptr;
+
+[[noreturn]] static void bounceBack(void *) {
+    while (true) {
+        Scheduler::switchContext(&benchContext, mainContext);
+    }
+}
+
+/**
+ * switchContext alone, back and forth between two stacks: the floor under every other number.
+ */
+static double measureBareSwitch() {
+    const std::unique_ptr<uint8_t[]> stack(new uint8_t[STACK_SIZE]);
+    benchContext = Scheduler::prepareContext(stack.get() + STACK_SIZE, bounceBack, nullptr);
+
+    const Bench::Measurement measurement = Bench::measureOp([] {
+        Scheduler::switchContext(&mainContext, benchContext);
+    });
+    return measurement.nsPerOp / 2;
+}
+
+static void yieldLoop(void *) {
+    for (uint64_t i = 0; i < SWITCH_ROUNDS; i++) {
+        Scheduler::yield();
+    }
+}
+
+/**
+ * Two threads on one CPU yielding to each other.
+ */
+static double measureYield() {
+    ThreadPool pool(2);
+    const double elapsedNs = runScheduler(1, 2, [&] {
+        Scheduler::start(pool.create(0, yieldLoop, nullptr), 0);
+        Scheduler::start(pool.create(1, yieldLoop, nullptr), 0);
+    });
+    return elapsedNs / static_cast<double>(Scheduler::getStatistics(0).switchCount);
+}
+
+struct PingPong {
+    std::atomic<unsigned> turn;
+    Scheduler::Thread *threads[2];
+};
+
+struct PingPongSide {
+    PingPong *pingPong;
+    unsigned side;
+};
+
+/**
+ * Waits for its turn blocked, then hands the turn to the other side and wakes it.
+ */
+static void pingPongLoop(void *argument) {
+    const auto *side = static_cast<const PingPongSide *>(argument);
+    PingPong *pingPong = side->pingPong;
+    for (uint64_t i = 0; i < SWITCH_ROUNDS; i++) {
+        while (pingPong->turn.load(std::memory_order_acquire) != side->side) {
+            Scheduler::prepareToBlock();
+            if (pingPong->turn.load(std::memory_order_acquire) != side->side) {
+                Scheduler::block();
+            } else {
+                Scheduler::cancelBlock();
+            }
+        }
+        pingPong->turn.store(1 - side->side, std::memory_order_release);
+        Scheduler::wake(pingPong->threads[1 - side->side]);
+    }
+}
+
+/**
+ * Two threads handing a turn to each other with block and wake, both started on CPU 0.
+ * @return The time of one hand-over, in nanoseconds.
+ */
+static double measureBlockWake(const unsigned cpuCount) {
+    ThreadPool pool(2);
+    PingPong pingPong = {};
+    PingPongSide sides[2] = {{&pingPong, 0}, {&pingPong, 1}};
+    const double elapsedNs = runScheduler(cpuCount, 2, [&] {
+        pingPong.threads[0] = pool.create(0, pingPongLoop, &sides[0]);
+        pingPong.threads[1] = pool.create(1, pingPongLoop, &sides[1]);
+        //the second one goes to the other CPU, if there's one, and stays there since that's where it gets woken
+        Scheduler::start(pingPong.threads[0], 0);
+        Scheduler::start(pingPong.threads[1], cpuCount - 1);
+    });
+    return elapsedNs / static_cast<double>(2 * SWITCH_ROUNDS);
+}
+
+struct alignas(64) UnitCounter {
+    std::atomic<uint64_t> units;
+};
+
+static UnitCounter unitsByCpu[MAX_CPUS];
+
+/**
+ * Works for the given number of units, and lets the scheduler preempt it between them.
+ */
+static void skewedWorker(void *argument) {
+    const auto units = static_cast<unsigned>(reinterpret_cast<uintptr_t>(argument));
+    for (unsigned unit = 0; unit < units; unit++) {
+        uint64_t value = unit;
+        for (unsigned i = 0; i < UNIT_ITERATIONS; i++) {
+            value = value * 6364136223846793005 + 1442695040888963407;
+            Bench::doNotOptimize(value);
+        }
+        unitsByCpu[getCpuIndex()].units.fetch_add(1, std::memory_order_relaxed);
+        Scheduler::onTick();
+    }
+}
+
+struct SkewedResult {
+    double elapsedNs;
+    double minShare;
+    double maxShare;
+    uint64_t steals;
+    uint64_t preemptions;
+};
+
+/**
+ * All the skewed threads are started on CPU 0, which leaves the other CPUs nothing but stealing.
+ */
+static SkewedResult measureSkewed(const unsigned cpuCount) {
+    ThreadPool pool(SKEWED_THREADS);
+    for (UnitCounter &counter : unitsByCpu) {
+        counter.units = 0;
+    }
+
+    const double elapsedNs = runScheduler(cpuCount, SKEWED_THREADS, [&] {
+        for (unsigned i = 0; i < SKEWED_THREADS; i++) {
+            const uintptr_t units = i % 8 == 0 ? HEAVY_UNITS : LIGHT_UNITS;
+            Scheduler::start(pool.create(i, skewedWorker, reinterpret_cast<void *>(units)), 0);
+        }
+    });
+
+    SkewedResult result = {elapsedNs, 1, 0, 0, 0};
+    uint64_t totalUnits = 0;
+    for (unsigned cpu = 0; cpu < cpuCount; cpu++) {
+        totalUnits += unitsByCpu[cpu].units;
+    }
+    for (unsigned cpu = 0; cpu < cpuCount; cpu++) {
+        const double share = static_cast<double>(unitsByCpu[cpu].units) / static_cast<double>(totalUnits);
+        result.minShare = std::min(result.minShare, share);
+        result.maxShare = std::max(result.maxShare, share);
+
+        const Scheduler::Statistics statistics = Scheduler::getStatistics(cpu);
+        result.steals += statistics.stealCount;
+        result.preemptions += statistics.preemptionCount;
+    }
+    return result;
+}
+
+/**
+ * The deque alone: one owner pushing and taking, the other threads stealing. Checks every element comes out exactly
+ * once.
+ * @return The time per element, in nanoseconds, or a negative value if an element was lost or taken twice.
+ */
+static double measureDeque(const unsigned thiefCount) {
+    static Scheduler::WorkStealingDeque<uint64_t *, 256> deque;
+    const std::unique_ptr<std::atomic<uint8_t>[]> taken(new std::atomic<uint8_t>[DEQUE_ELEMENTS]());
+    std::atomic<bool> isDone(false);
+    std::atomic<uint64_t> takenCount(0);
+
+    auto take = [&](uint64_t *element) {
+        const auto index = reinterpret_cast<uintptr_t>(element) - 1;
+        taken[index].fetch_add(1, std::memory_order_relaxed);
+        takenCount.fetch_add(1, std::memory_order_relaxed);
+    };
+
+    const Bench::Stopwatch stopwatch;
+    std::vector<std::thread> thieves;
+    for (unsigned i = 0; i < thiefCount; i++) {
+        thieves.emplace_back([&] {
+            while (!isDone.load(std::memory_order_acquire)) {
+                uint64_t *element = deque.steal();
+                if (element != nullptr) {
+                    take(element);
+                }
+            }
+        });
+    }
+
+    //the owner alternates like a scheduler does: push a few, take one back from the bottom
+    for (uintptr_t i = 1; i <= DEQUE_ELEMENTS; i++) {
+        while (!deque.push(reinterpret_cast<uint64_t *>(i))) {
+            uint64_t *element = deque.pop();
+            if (element != nullptr) {
+                take(element);
+            }
+        }
+        if (i % 4 == 0) {
+            uint64_t *element = deque.pop();
+            if (element != nullptr) {
+                take(element);
+            }
+        }
+    }
+    for (uint64_t *element = deque.pop(); element != nullptr; element = deque.pop()) {
+        take(element);
+    }
+    //a thief may still be between its compare-and-swap and counting what it took
+    while (takenCount.load(std::memory_order_acquire) < DEQUE_ELEMENTS && stopwatch.elapsedNs() < 10e9) {
+        asm volatile("pause");
+    }
+    isDone = true;
+    for (std::thread &thief : thieves) {
+        thief.join();
+    }
+    const double elapsedNs = stopwatch.elapsedNs();
+
+    for (uint64_t i = 0; i < DEQUE_ELEMENTS; i++) {
+        if (taken[i].load() != 1) {
+            return -1;
+        }
+    }
+    return elapsedNs / static_cast<double>(DEQUE_ELEMENTS);
+}
+
+int main() {
+    const unsigned cpuCount = std::clamp(std::thread::hardware_concurrency(), 1U, MAX_CPUS);
+
+    std::printf("Work-stealing deque, ns per element (1 owner + thieves)\n");
+    for (unsigned thieves = 0; thieves < cpuCount; thieves = thieves == 0 ? 1 : thieves * 2) {
+        const double nsPerElement = measureDeque(thieves);
+        if (nsPerElement < 0) {
+            std::fprintf(stderr, "the deque lost or duplicated elements with %u thieves\n", thieves);
+            return 1;
+        }
+        std::printf("%10u thieves%12.2f\n", thieves, nsPerElement);
+    }
+
+    std::printf("\nContext switch, ns\n");
+    std::printf("%-30s%12.2f\n", "switchContext", measureBareSwitch());
+    std::printf("%-30s%12.2f\n", "yield, 1 CPU", measureYield());
+    std::printf("%-30s%12.2f\n", "block/wake, 1 CPU", measureBlockWake(1));
+    if (cpuCount >= 2) {
+        std::printf("%-30s%12.2f\n", "block/wake, 2 CPUs", measureBlockWake(2));
+    }
+
+    std::printf("\nSkewed load (%u threads, 1/8 of them %ux heavier), all started on CPU 0\n", SKEWED_THREADS,
+                HEAVY_UNITS / LIGHT_UNITS);
+    std::printf("%6s%12s%10s%14s%10s%14s\n", "CPUs", "ms", "speedup", "work share", "steals", "preemptions");
+    double singleCpuNs = 0;
+    for (unsigned cpus = 1; cpus <= cpuCount; cpus *= 2) {
+        const SkewedResult result = measureSkewed(cpus);
+        if (cpus == 1) {
+            singleCpuNs = result.elapsedNs;
+        }
+        char share[32];
+        std::snprintf(share, sizeof(share), "%.0f-%.0f%%", result.minShare * 100, result.maxShare * 100);
+        std::printf("%6u%12.1f%10.2f%14s%10llu%14llu\n", cpus, result.elapsedNs / 1e6, singleCpuNs / result.elapsedNs,
+                    share, static_cast<unsigned long long>(result.steals),
+                    static_cast<unsigned long long>(result.preemptions));
+    }
+
+    return 0;
+}
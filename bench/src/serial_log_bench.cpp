@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "serial_log/log_ring.h"
+
+#include "bench_utils.h"
+
+/**
+ * The cost of appending a log line to the ring, from one thread and from several at once, against the same ring
+ * behind a spinlock (what a plain locked buffer would cost). A drainer thread empties the ring all along into a sink
+ * that takes everything, and checks that every line arrives whole and in order for its producer.
+ */
+
+static constexpr unsigned MAX_THREADS = 8;
+static constexpr size_t LINES_PER_THREAD = 512 * 1024;
+static constexpr size_t RING_SIZE = 64 * 1024;
+
+alignas(64) static uint64_t ringStorage[RING_SIZE / sizeof(uint64_t)];
+
+struct Sink {
+    /**
+     * The next line number expected from each producer.
+     */
+    uint64_t expected[MAX_THREADS];
+    uint64_t lineCount;
+    bool isCorrupt;
+    /**
+     * A line can arrive over several transmits, so it's put back together here.
+     */
+    char line[64];
+    size_t lineSize;
+};
+
+static size_t transmitToSink(const char *data, const size_t size, void *context) {
+    auto *sink = static_cast<Sink *>(context);
+    for (size_t i = 0; i < size; i++) {
+        if (sink->lineSize == sizeof(sink->line)) {
+            sink->isCorrupt = true;
+            return size;
+        }
+        sink->line[sink->lineSize++] = data[i];
+        if (data[i] != '\n') {
+            continue;
+        }
+
+        unsigned thread;
+        unsigned long long number;
+        sink->line[sink->lineSize - 1] = '\0';
+        if (std::sscanf(sink->line, "cpu %u: line %llu", &thread, &number) != 2 || thread >= MAX_THREADS
+            || number < sink->expected[thread]) {
+            sink->isCorrupt = true;
+        } else {
+            sink->expected[thread] = number + 1;
+        }
+        sink->lineCount++;
+        sink->lineSize = 0;
+    }
+    return size;
+}
+
+static void lock(std::atomic_flag *flag) {
+    while (flag->test_and_set(std::memory_order_acquire)) {
+        asm volatile("pause");
+    }
+}
+
+static void unlock(std::atomic_flag *flag) {
+    flag->clear(std::memory_order_release);
+}
+
+struct Result {
+    double nsPerLine;
+    uint64_t dropped;
+    bool isCorrect;
+};
+
+/**
+ * @param useLock Whether the producers take a spinlock around append (the ring doesn't need it).
+ */
+static Result measureAppends(const unsigned threadCount, const bool useLock) {
+    std::memset(ringStorage, 0, sizeof(ringStorage));
+    SerialLog::LogRing ring(ringStorage, RING_SIZE);
+    std::atomic_flag appendLock = ATOMIC_FLAG_INIT;
+    std::atomic<unsigned> runningProducers(threadCount);
+    std::atomic<uint64_t> appendNs(0);
+
+    Sink sink = {};
+    std::thread drainer([&] {
+        while (runningProducers.load(std::memory_order_acquire) != 0 || !ring.isEmpty()) {
+            ring.drain(transmitToSink, &sink);
+        }
+    });
+
+    std::vector<std::thread> producers;
+    for (unsigned thread = 0; thread < threadCount; thread++) {
+        producers.emplace_back([&, thread] {
+            char line[64];
+            const Bench::Stopwatch stopwatch;
+            for (size_t i = 0; i < LINES_PER_THREAD; i++) {
+                const int size = std::snprintf(line, sizeof(line), "cpu %u: line %zu\n", thread, i);
+                if (useLock) {
+                    lock(&appendLock);
+                }
+                ring.append(line, static_cast<size_t>(size));
+                if (useLock) {
+                    unlock(&appendLock);
+                }
+            }
+            appendNs += static_cast<uint64_t>(stopwatch.elapsedNs());
+            runningProducers--;
+        });
+    }
+    for (std::thread &producer : producers) {
+        producer.join();
+    }
+    drainer.join();
+
+    const uint64_t totalLines = LINES_PER_THREAD * threadCount;
+    const uint64_t dropped = ring.getDroppedCount();
+    return {static_cast<double>(appendNs.load()) / static_cast<double>(totalLines), dropped,
+            !sink.isCorrupt && sink.lineCount + dropped == totalLines};
+}
+
+int main() {
+    const unsigned threadCount = std::clamp(std::thread::hardware_concurrency(), 1U, MAX_THREADS);
+
+    std::printf("ns per appended line, per producer (dropped lines)\n");
+    std::printf("%10s%24s%24s\n", "threads", "lock-free", "spinlock");
+    for (unsigned threads = 1; threads <= threadCount; threads *= 2) {
+        std::printf("%10u", threads);
+        for (const bool useLock : {false, true}) {
+            const Result result = measureAppends(threads, useLock);
+            if (!result.isCorrect) {
+                std::fprintf(stderr, "\nlines were lost or corrupted with %u threads\n", threads);
+                return 1;
+            }
+            char cell[32];
+            std::snprintf(cell, sizeof(cell), "%.2f (%llu)", result.nsPerLine,
+                          static_cast<unsigned long long>(result.dropped));
+            std::printf("%24s", cell);
+            std::fflush(stdout);
+        }
+        std::printf("\n");
+    }
+
+    return 0;
+}
@@ -0,0 +1,235 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "slab/heap.h"
+#include "slab/object_cache.h"
+
+#include "bench_utils.h"
+
+/**
+ * Allocation churn on the slab heap against the host's malloc: every thread (standing in for a CPU with its own
+ * magazines) keeps a working set of live allocations with kernel-like sizes, and keeps replacing random ones. Every
+ * allocation is tagged, so an object handed out twice is caught. Then measures a named cache on its own.
+ */
+
+static constexpr unsigned MAX_THREADS = 8;
+static constexpr size_t WORKING_SET = 4096;
+static constexpr size_t CHURN_OPS_PER_THREAD = 2ULL * 1024 * 1024;
+
+static thread_local unsigned currentCpu = 0;
+
+static unsigned getCurrentCpu() {
+    return currentCpu;
+}
+
+static void *allocateSlabPages(const size_t size) {
+    return std::aligned_alloc(Slab::SLAB_SIZE, size);
+}
+
+static void releaseSlabPages(void *pages, size_t) {
+    std::free(pages);
+}
+
+static void *hostAllocate(const size_t size) {
+    return std::malloc(size);
+}
+
+static void hostFree(void *memory) {
+    std::free(memory);
+}
+
+struct HeapVariant {
+    const char *name;
+    void *(*allocate)(size_t size);
+    void (*free)(void *memory);
+};
+
+static constexpr HeapVariant VARIANTS[] = {
+    {"slab", Slab::allocate, Slab::free},
+    {"host", hostAllocate, hostFree},
+};
+
+/**
+ * A small xorshift generator, so every thread gets its own reproducible sequence.
+ */
+struct Random {
+    uint64_t state;
+
+    uint64_t next() {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+};
+
+/**
+ * Mostly small objects (descriptors, list nodes), some medium ones (buffers, paths) and a few large ones.
+ */
+static size_t pickSize(Random &random) {
+    const uint64_t bucket = random.next() % 100;
+    if (bucket < 70) {
+        return 8 + random.next() % 121;
+    }
+    if (bucket < 99) {
+        return 129 + random.next() % (Slab::MAX_OBJECT_SIZE - 128);
+    }
+    return Slab::MAX_OBJECT_SIZE + 1 + random.next() % (64 * 1024);
+}
+
+struct Allocation {
+    uint8_t *memory;
+    size_t size;
+};
+
+static void churnThread(const HeapVariant *variant, const unsigned cpu, std::atomic<bool> *start,
+                        std::atomic<bool> *failed) {
+    currentCpu = cpu;
+    Random random{0x9E3779B97F4A7C15ULL * (cpu + 1)};
+    std::vector<Allocation> slots(WORKING_SET, Allocation{nullptr, 0});
+
+    while (!start->load(std::memory_order_acquire)) {}
+
+    for (size_t i = 0; i < CHURN_OPS_PER_THREAD; i++) {
+        Allocation &slot = slots[random.next() % WORKING_SET];
+        const auto tag = static_cast<uint8_t>(cpu * 16 + 1);
+        if (slot.memory != nullptr) {
+            if (slot.memory[0] != tag || slot.memory[slot.size - 1] != tag) {
+                std::fprintf(stderr, "'%s', CPU %u: an allocation of %zu bytes was overwritten\n", variant->name, cpu,
+                             slot.size);
+                failed->store(true);
+                return;
+            }
+            variant->free(slot.memory);
+        }
+
+        slot.size = pickSize(random);
+        slot.memory = static_cast<uint8_t *>(variant->allocate(slot.size));
+        if (slot.memory == nullptr) {
+            std::fprintf(stderr, "'%s', CPU %u: out of memory\n", variant->name, cpu);
+            failed->store(true);
+            return;
+        }
+        slot.memory[0] = tag;
+        slot.memory[slot.size - 1] = tag;
+    }
+
+    for (const Allocation &slot : slots) {
+        variant->free(slot.memory);
+    }
+}
+
+/**
+ * Returns the wall-clock time divided by the number of allocation/free pairs done by all the threads together, or a
+ * negative value on failure.
+ */
+static double measureChurn(const HeapVariant &variant, const unsigned threadCount) {
+    std::atomic<bool> start{false};
+    std::atomic<bool> failed{false};
+    std::vector<std::thread> threads;
+    for (unsigned cpu = 0; cpu < threadCount; cpu++) {
+        threads.emplace_back(churnThread, &variant, cpu, &start, &failed);
+    }
+
+    const Bench::Stopwatch stopwatch;
+    start.store(true, std::memory_order_release);
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    const double elapsedNs = stopwatch.elapsedNs();
+
+    if (failed.load()) {
+        return -1;
+    }
+    return elapsedNs / static_cast<double>(CHURN_OPS_PER_THREAD * threadCount);
+}
+
+static void countLeaks(const Slab::ObjectCache &cache, void *context) {
+    if (cache.getAllocatedCount() != 0 || cache.getSlabCount() != 0) {
+        std::fprintf(stderr, "'%s' still has %zu objects in %zu slabs\n", cache.getName(), cache.getAllocatedCount(),
+                     cache.getSlabCount());
+        (*static_cast<size_t *>(context))++;
+    }
+}
+
+/**
+ * Something like a page-table descriptor, the kind of hot object that gets its own cache.
+ */
+struct Descriptor {
+    uint64_t address;
+    uint64_t flags;
+    Descriptor *next;
+    uint32_t references;
+
+    Descriptor(const uint64_t address, const uint64_t flags)
+        : address(address), flags(flags), next(nullptr), references(1) {}
+};
+
+static constinit Slab::TypedCache<Descriptor> descriptorCache("descriptor");
+
+int main() {
+    Slab::setPageSource(allocateSlabPages, releaseSlabPages);
+    Slab::setCpuIndexFunction(getCurrentCpu);
+
+    const unsigned threadCount = std::clamp(std::thread::hardware_concurrency(), 1U, MAX_THREADS);
+
+    std::printf("allocation churn, wall-clock ns per free/allocation pair (all threads together)\n");
+    std::printf("%10s", "threads");
+    for (const HeapVariant &variant : VARIANTS) {
+        std::printf("%10s", variant.name);
+    }
+    std::printf("\n");
+
+    for (unsigned threads = 1; threads <= threadCount; threads *= 2) {
+        std::printf("%10u", threads);
+        for (const HeapVariant &variant : VARIANTS) {
+            const double ns = measureChurn(variant, threads);
+            if (ns < 0) {
+                return 1;
+            }
+            std::printf("%10.2f", ns);
+            std::fflush(stdout);
+        }
+        std::printf("\n");
+    }
+
+    std::printf("\nnamed cache, ns per create/destroy pair\n");
+    const Bench::Measurement pair = Bench::measureOp([] {
+        Descriptor *descriptor = descriptorCache.create(0x1000, 3);
+        Bench::doNotOptimize(descriptor);
+        descriptorCache.destroy(descriptor);
+    });
+    std::printf("%24s%10.2f\n", "descriptor", pair.nsPerOp);
+
+    const Bench::Measurement heapPair = Bench::measureOp([] {
+        void *memory = Slab::allocate(sizeof(Descriptor));
+        Bench::doNotOptimize(memory);
+        Slab::free(memory);
+    });
+    std::printf("%24s%10.2f\n", "heap, same size", heapPair.nsPerOp);
+
+    const Bench::Measurement hostPair = Bench::measureOp([] {
+        void *memory = std::malloc(sizeof(Descriptor));
+        Bench::doNotOptimize(memory);
+        std::free(memory);
+    });
+    std::printf("%24s%10.2f\n", "host, same size", hostPair.nsPerOp);
+
+    //everything was freed, so draining has to give every slab back
+    Slab::drainHeap();
+    descriptorCache.getCache().drain();
+    size_t leakingCaches = 0;
+    Slab::visitCaches(countLeaks, &leakingCaches);
+    if (leakingCaches != 0) {
+        return 1;
+    }
+    std::printf("\nevery cache is empty after draining\n");
+
+    return 0;
+}
@@ -0,0 +1,201 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "c_husky/str_scan.h"
+
+#include "bench_utils.h"
+
+/**
+ * Compares the c_husky string routines (byte and word versions) with the host's strlen, memcmp and strcpy, for string
+ * lengths from 1 B to 64 KiB. Every operation goes over the same input, starting at an odd address so the unaligned
+ * head is always exercised.
+ */
+
+static constexpr size_t MIN_SIZE = 1;
+static constexpr size_t MAX_SIZE = 64 * 1024;
+static constexpr size_t SOURCE_MISALIGNMENT = 3;
+
+static constexpr size_t BYTES_PER_MEASUREMENT = 64ULL * 1024 * 1024;
+static constexpr size_t MIN_ITERATIONS = 16;
+static constexpr size_t MAX_ITERATIONS = 4ULL * 1024 * 1024;
+
+static size_t hostStrlen(const char *str) {
+    return strlen(str);
+}
+
+static int hostMemcmp(const void *left, const void *right, const size_t n) {
+    return memcmp(left, right, n);
+}
+
+static char *hostStpcpy(char *dest, const char *src) {
+    return stpcpy(dest, src);
+}
+
+struct LengthVariant {
+    const char *name;
+    size_t (*function)(const char *str);
+};
+
+struct CompareVariant {
+    const char *name;
+    int (*function)(const void *left, const void *right, size_t n);
+};
+
+struct CopyVariant {
+    const char *name;
+    char *(*function)(char *dest, const char *src);
+};
+
+static constexpr LengthVariant LENGTH_VARIANTS[] = {
+    {"bytes", CHusky::Str::lengthBytes},
+    {"words", CHusky::Str::length},
+    {"host", hostStrlen},
+};
+
+static constexpr CompareVariant COMPARE_VARIANTS[] = {
+    {"bytes", CHusky::Str::compareBytes},
+    {"words", CHusky::Str::compare},
+    {"host", hostMemcmp},
+};
+
+static constexpr CopyVariant COPY_VARIANTS[] = {
+    {"bytes", CHusky::Str::copyStringBytes},
+    {"words", CHusky::Str::copyString},
+    {"host", hostStpcpy},
+};
+
+static size_t getIterations(const size_t size) {
+    size_t iterations = BYTES_PER_MEASUREMENT / size;
+    if (iterations < MIN_ITERATIONS) {
+        iterations = MIN_ITERATIONS;
+    }
+    if (iterations > MAX_ITERATIONS) {
+        iterations = MAX_ITERATIONS;
+    }
+
+    return iterations;
+}
+
+/**
+ * Converts the time taken to process size bytes iterations times into GiB/s.
+ */
+static double toThroughput(const size_t size, const size_t iterations, const double elapsedNs) {
+    return static_cast<double>(size) * static_cast<double>(iterations) / elapsedNs * 1e9 / (1024.0 * 1024.0 * 1024.0);
+}
+
+template <class Variant>
+static void printHeader(const char *title, const Variant (&variants)[3]) {
+    std::printf("\n%s, throughput in GiB/s\n", title);
+    std::printf("%10s", "size");
+    for (const Variant &variant : variants) {
+        std::printf("%10s", variant.name);
+    }
+    std::printf("\n");
+}
+
+int main() {
+    auto *left = static_cast<char *>(std::aligned_alloc(4096, MAX_SIZE + 4096));
+    auto *right = static_cast<char *>(std::aligned_alloc(4096, MAX_SIZE + 4096));
+    auto *dest = static_cast<char *>(std::aligned_alloc(4096, MAX_SIZE + 4096));
+    if (left == nullptr || right == nullptr || dest == nullptr) {
+        std::fprintf(stderr, "Failed to allocate the buffers.\n");
+        return 1;
+    }
+
+    char *const src = left + SOURCE_MISALIGNMENT;
+    char *const other = right + SOURCE_MISALIGNMENT;
+
+    printHeader("strlen", LENGTH_VARIANTS);
+    for (size_t size = MIN_SIZE; size <= MAX_SIZE; size *= 2) {
+        std::memset(src, 'a', size);
+        src[size] = 0;
+
+        char sizeText[32];
+        Bench::formatSize(size, sizeText, sizeof(sizeText));
+        std::printf("%10s", sizeText);
+
+        for (const LengthVariant &variant : LENGTH_VARIANTS) {
+            const size_t iterations = getIterations(size);
+            const Bench::Stopwatch stopwatch;
+            for (size_t i = 0; i < iterations; i++) {
+                Bench::doNotOptimize(src);
+                const size_t length = variant.function(src);
+                Bench::doNotOptimize(length);
+                if (length != size) {
+                    std::fprintf(stderr, "\n'%s' returned %zu instead of %zu\n", variant.name, length, size);
+                    return 1;
+                }
+            }
+            std::printf("%10.2f", toThroughput(size, iterations, stopwatch.elapsedNs()));
+            std::fflush(stdout);
+        }
+        std::printf("\n");
+    }
+
+    //equal buffers are the worst case for memcmp: every byte has to be looked at
+    printHeader("memcmp (equal buffers)", COMPARE_VARIANTS);
+    for (size_t size = MIN_SIZE; size <= MAX_SIZE; size *= 2) {
+        std::memset(src, 'a', size);
+        std::memset(other, 'a', size);
+
+        char sizeText[32];
+        Bench::formatSize(size, sizeText, sizeof(sizeText));
+        std::printf("%10s", sizeText);
+
+        for (const CompareVariant &variant : COMPARE_VARIANTS) {
+            const size_t iterations = getIterations(size);
+            const Bench::Stopwatch stopwatch;
+            for (size_t i = 0; i < iterations; i++) {
+                Bench::doNotOptimize(src);
+                const int result = variant.function(src, other, size);
+                Bench::doNotOptimize(result);
+                if (result != 0) {
+                    std::fprintf(stderr, "\n'%s' found a difference in equal buffers\n", variant.name);
+                    return 1;
+                }
+            }
+            std::printf("%10.2f", toThroughput(size, iterations, stopwatch.elapsedNs()));
+            std::fflush(stdout);
+        }
+        std::printf("\n");
+    }
+
+    printHeader("strcpy", COPY_VARIANTS);
+    for (size_t size = MIN_SIZE; size <= MAX_SIZE; size *= 2) {
+        std::memset(src, 'a', size);
+        src[size] = 0;
+
+        char sizeText[32];
+        Bench::formatSize(size, sizeText, sizeof(sizeText));
+        std::printf("%10s", sizeText);
+
+        for (const CopyVariant &variant : COPY_VARIANTS) {
+            std::memset(dest, 0, size + 1);
+
+            const size_t iterations = getIterations(size);
+            const Bench::Stopwatch stopwatch;
+            for (size_t i = 0; i < iterations; i++) {
+                Bench::doNotOptimize(src);
+                Bench::doNotOptimize(variant.function(dest, src));
+                Bench::clobberMemory();
+            }
+            const double elapsedNs = stopwatch.elapsedNs();
+
+            if (std::memcmp(dest, src, size + 1) != 0) {
+                std::fprintf(stderr, "\n'%s' produced a wrong copy for size %zu\n", variant.name, size);
+                return 1;
+            }
+
+            std::printf("%10.2f", toThroughput(size, iterations, elapsedNs));
+            std::fflush(stdout);
+        }
+        std::printf("\n");
+    }
+
+    std::free(left);
+    std::free(right);
+    std::free(dest);
+    return 0;
+}
@@ -0,0 +1,177 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "elf/elf_definitions.h"
+#include "elf/elf_loader.h"
+
+#include "suite.h"
+
+namespace Suite {
+    using Elf::ElfLoader;
+
+    //where loadExecutableProgram writes the segments; it's big enough for the largest PT_LOAD of the current file
+    static char *segmentScratch = nullptr;
+
+    static void *loadIntoScratch(int, Elf::Elf64_Addr, Elf::Elf_SegmentFlags) {
+        return segmentScratch;
+    }
+
+    /**
+     * Reads the whole file into a page-aligned buffer, like KernelReader does in the bootloader.
+     */
+    static char *readFile(const char *path, size_t *size) {
+        FILE *file = std::fopen(path, "rb");
+        if (file == nullptr) {
+            return nullptr;
+        }
+
+        //files like /proc/self/exe might not report a size up front, so grow the buffer while reading
+        size_t capacity = 1024 * 1024;
+        auto *buffer = static_cast<char *>(std::aligned_alloc(4096, capacity));
+        size_t used = 0;
+        while (buffer != nullptr) {
+            used += std::fread(buffer + used, 1, capacity - used, file);
+            if (used < capacity) {
+                break;
+            }
+
+            auto *bigger = static_cast<char *>(std::aligned_alloc(4096, capacity * 2));
+            if (bigger != nullptr) {
+                std::memcpy(bigger, buffer, used);
+            }
+            std::free(buffer);
+            buffer = bigger;
+            capacity *= 2;
+        }
+
+        std::fclose(file);
+        *size = used;
+        return buffer;
+    }
+
+    static bool runCasesForFile(const char *path) {
+        size_t fileSize;
+        char *file = readFile(path, &fileSize);
+        if (file == nullptr || fileSize < sizeof(Elf::Elf64_ElfHeader)) {
+            std::fprintf(stderr, "Failed to read %s.\n", path);
+            std::free(file);
+            return false;
+        }
+
+        /* The loader only accepts ET_EXEC, but most host binaries are PIE (ET_DYN). The headers have the same layout,
+         * so the type is patched in the in-memory copy to be able to walk them. */
+        auto *header = reinterpret_cast<Elf::Elf64_ElfHeader *>(file);
+        if (header->Type == Elf::Elf_Type::ET_DYN) {
+            header->Type = Elf::Elf_Type::ET_EXEC;
+        }
+
+        const ElfLoader loader(file, fileSize);
+        if (loader.checkElf() != ElfLoader::ElfError::NoError) {
+            std::fprintf(stderr, "%s is not a supported ELF file.\n", path);
+            std::free(file);
+            return false;
+        }
+
+        ElfLoader::ElfError error;
+        int progHeaderCount;
+        const Elf::Elf64_ProgHeader *progHeaders = loader.getProgramHeaders(&progHeaderCount, &error);
+        int sectionHeaderCount;
+        const Elf::Elf64_SectionHeader *sectionHeaders = loader.getSectionHeaders(&sectionHeaderCount, &error);
+        if (progHeaders == nullptr || sectionHeaders == nullptr) {
+            std::fprintf(stderr, "Failed to get the headers of %s.\n", path);
+            std::free(file);
+            return false;
+        }
+
+        size_t loadedBytes = 0;
+        size_t largestSegment = 0;
+        for (int i = 0; i < progHeaderCount; i++) {
+            if (progHeaders[i].SegmentType == Elf::Elf_SegmentType::PT_LOAD) {
+                loadedBytes += progHeaders[i].SizeInMemory;
+                if (progHeaders[i].SizeInMemory > largestSegment) {
+                    largestSegment = progHeaders[i].SizeInMemory;
+                }
+            }
+        }
+
+        const char *fileName = std::strrchr(path, '/') != nullptr ? std::strrchr(path, '/') + 1 : path;
+        std::printf("%s: %zu bytes, %d program headers, %d section headers\n",
+                    path, fileSize, progHeaderCount, sectionHeaderCount);
+
+        char name[64];
+        std::snprintf(name, sizeof(name), "checkElf %s", fileName);
+        report("elf", name, sizeof(Elf::Elf64_ElfHeader), Bench::measureOp([&] {
+            Bench::doNotOptimize(loader.checkElf());
+        }));
+
+        std::snprintf(name, sizeof(name), "program headers %s", fileName);
+        report("elf", name, progHeaderCount * sizeof(Elf::Elf64_ProgHeader), Bench::measureOp([&] {
+            int count;
+            ElfLoader::ElfError opError;
+            const Elf::Elf64_ProgHeader *headers = loader.getProgramHeaders(&count, &opError);
+
+            uint64_t memorySize = 0;
+            for (int i = 0; i < count; i++) {
+                if (headers[i].SegmentType == Elf::Elf_SegmentType::PT_LOAD) {
+                    memorySize += headers[i].SizeInMemory;
+                }
+            }
+            Bench::doNotOptimize(memorySize);
+        }));
+
+        std::snprintf(name, sizeof(name), "section headers %s", fileName);
+        report("elf", name, sectionHeaderCount * sizeof(Elf::Elf64_SectionHeader), Bench::measureOp([&] {
+            int count;
+            ElfLoader::ElfError opError;
+            const Elf::Elf64_SectionHeader *headers = loader.getSectionHeaders(&count, &opError);
+
+            uint64_t allocatedSize = 0;
+            for (int i = 0; i < count; i++) {
+                if ((static_cast<uint64_t>(headers[i].Flags)
+                     & static_cast<uint64_t>(Elf::Elf_SectionFlags::SHF_ALLOC)) != 0) {
+                    allocatedSize += headers[i].SectionSize;
+                }
+            }
+            Bench::doNotOptimize(allocatedSize);
+        }));
+
+        segmentScratch = static_cast<char *>(std::aligned_alloc(4096, (largestSegment + 4095) & ~4095ULL));
+        if (segmentScratch == nullptr) {
+            std::fprintf(stderr, "Failed to allocate the segment buffer.\n");
+            std::free(file);
+            return false;
+        }
+
+        bool isLoadSuccessful = true;
+        std::snprintf(name, sizeof(name), "load PT_LOADs %s", fileName);
+        report("elf", name, loadedBytes, Bench::measureOp([&] {
+            for (int i = 0; i < progHeaderCount; i++) {
+                if (progHeaders[i].SegmentType == Elf::Elf_SegmentType::PT_LOAD
+                    && loader.loadExecutableProgram(&progHeaders[i], loadIntoScratch) != ElfLoader::ElfError::NoError) {
+                    isLoadSuccessful = false;
+                }
+            }
+        }));
+
+        std::free(segmentScratch);
+        segmentScratch = nullptr;
+        std::free(file);
+
+        if (!isLoadSuccessful) {
+            std::fprintf(stderr, "Failed to load the segments of %s.\n", path);
+        }
+        return isLoadSuccessful;
+    }
+
+    bool runElfCases(const char *const *paths, const int pathCount) {
+        for (int i = 0; i < pathCount; i++) {
+            if (!runCasesForFile(paths[i])) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+} //namespace Suite
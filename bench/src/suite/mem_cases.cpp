@@ -0,0 +1,93 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "c_husky/mem_copy.h"
+#include "c_husky/mem_fill.h"
+#include "c_husky/mem_routines.h"
+#include "c_husky/str_scan.h"
+
+#include "suite.h"
+
+namespace Suite {
+    static constexpr size_t SIZES[] = {16, 256, 4096, 64 * 1024};
+    static constexpr size_t MAX_SIZE = 64 * 1024;
+
+    //memmove shifts by this much, so source and destination overlap
+    static constexpr size_t MOVE_DISTANCE = 24;
+
+    static const char *getRoutineSetName(const CHusky::Mem::RoutineSet set) {
+        switch (set) {
+            case CHusky::Mem::RoutineSet::Baseline:
+                return "baseline";
+            case CHusky::Mem::RoutineSet::Erms:
+                return "erms";
+            case CHusky::Mem::RoutineSet::Avx2:
+                return "avx2";
+        }
+
+        return "?";
+    }
+
+    bool runMemCases() {
+        auto *src = static_cast<char *>(std::aligned_alloc(4096, MAX_SIZE + 4096));
+        auto *dest = static_cast<char *>(std::aligned_alloc(4096, MAX_SIZE + 4096));
+        if (src == nullptr || dest == nullptr) {
+            std::fprintf(stderr, "Failed to allocate the buffers.\n");
+            return false;
+        }
+
+        //the same routines the bootloader would pick on this machine
+        const CHusky::Mem::RoutineSet set = CHusky::Mem::resolveRoutines(false);
+
+        std::memset(src, 'a', MAX_SIZE + 4096);
+        std::memset(dest, 'a', MAX_SIZE + 4096);
+
+        char name[64];
+        for (const size_t size : SIZES) {
+            src[size] = 0;
+
+            std::snprintf(name, sizeof(name), "memcpy (%s)", getRoutineSetName(set));
+            report("mem", name, size, Bench::measureOp([&] {
+                Bench::doNotOptimize(CHusky::Mem::copy(dest, src, size));
+            }));
+
+            report("mem", "memmove (overlapping)", size, Bench::measureOp([&] {
+                Bench::doNotOptimize(CHusky::Mem::copyBackward(dest + MOVE_DISTANCE, dest, size));
+            }));
+
+            std::snprintf(name, sizeof(name), "memset (%s)", getRoutineSetName(set));
+            report("mem", name, size, Bench::measureOp([&] {
+                Bench::doNotOptimize(CHusky::Mem::fill(dest, 'a', size));
+            }));
+
+            report("str", "strlen", size, Bench::measureOp([&] {
+                Bench::doNotOptimize(src);
+                Bench::doNotOptimize(CHusky::Str::length(src));
+            }));
+
+            //equal buffers, so every byte is compared
+            report("str", "memcmp", size, Bench::measureOp([&] {
+                Bench::doNotOptimize(src);
+                Bench::doNotOptimize(CHusky::Str::compare(src, dest, size));
+            }));
+
+            report("str", "strcpy", size, Bench::measureOp([&] {
+                Bench::doNotOptimize(CHusky::Str::copyString(dest, src));
+            }));
+
+            //restore the filler, so the memcmp with the next size compares equal buffers again
+            src[size] = 'a';
+            dest[size] = 'a';
+        }
+
+        report("mem", "zeroPages (16 pages)", 16 * CHusky::Mem::ZERO_PAGE_SIZE, Bench::measureOp([&] {
+            CHusky::Mem::zeroPages(dest, 16);
+        }));
+
+        std::free(src);
+        std::free(dest);
+        return true;
+    }
+} //namespace Suite
@@ -0,0 +1,330 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "paginator/page_table.h"
+
+#include "suite.h"
+
+namespace Suite {
+    using Paginator::PageFlags;
+    using Paginator::PageMapError;
+    using Paginator::PageTable_t;
+    using Paginator::PageTableRootController;
+
+    static constexpr size_t FRAME_SIZE = 4096;
+    static constexpr size_t ARENA_SIZE = 64ULL * 1024 * 1024;
+
+    //16 MiB: 4096 leaves, spread over 8 L1 tables
+    static constexpr size_t PAGE_COUNT = 4096;
+    static constexpr size_t BASE_VIRT_ADDRESS = 0xFFFFFFFF80000000ULL;
+    //the frames behind the mappings are never touched, so they don't need to be inside the arena
+    static constexpr size_t BASE_PHYS_ADDRESS = 0x100000000ULL;
+
+    static constexpr size_t RANDOM_LOOKUPS = 4096;
+
+    //what the kernel needs for a direct map of a typical machine
+    static constexpr size_t IDENTITY_MAP_SIZE = 4ULL * 1024 * 1024 * 1024;
+
+    /* The simulated physical memory: the paginator runs with pagingDisabledNow, i.e. it dereferences the "physical"
+     * addresses of its tables directly, so handing out host addresses from this arena makes it work unmodified. */
+    static char *arena = nullptr;
+    static size_t arenaUsed = 0;
+
+    static size_t allocateFrame() {
+        if (arenaUsed + FRAME_SIZE > ARENA_SIZE) {
+            return 0;
+        }
+
+        const size_t frame = reinterpret_cast<size_t>(arena + arenaUsed);
+        arenaUsed += FRAME_SIZE;
+        return frame;
+    }
+
+    /**
+     * Frees every table and returns a fresh (zeroed) root table.
+     */
+    static PageTable_t *resetArena() {
+        arenaUsed = 0;
+        auto *root = reinterpret_cast<PageTable_t *>(allocateFrame());
+        std::memset(root, 0, sizeof(PageTable_t));
+        return root;
+    }
+
+    static bool mapAll(const PageTableRootController &controller) {
+        for (size_t i = 0; i < PAGE_COUNT; i++) {
+            const PageMapError error = controller.mapPage(
+                BASE_VIRT_ADDRESS + i * FRAME_SIZE,
+                BASE_PHYS_ADDRESS + i * FRAME_SIZE,
+                PageFlags::Present | PageFlags::ReadBit | PageFlags::WriteBit);
+            if (error != PageMapError::NoError) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * Checks that the addresses through which the tables are reached once paging is on (via the recursive entry) are
+     * canonical and inside the recursive range, for root indices on both sides of the canonical hole.
+     */
+    static bool checkRecursiveAddresses() {
+        static constexpr size_t ADDRESSES[] = {
+            0x0000000000000000ULL, //root index 0
+            0x0000400000000000ULL, //128, the first user address of the kernel
+            0x00007FFFFFFFF000ULL, //255, the last page below the hole
+            0xFFFF800000000000ULL, //256, the first address above it
+            0xFFFFFFFF80000000ULL, //511, the kernel image
+        };
+
+        for (const size_t address : ADDRESSES) {
+            for (int level = 1; level <= 3; level++) {
+                const size_t tableAddress = PageTableRootController::getRecursiveTableAddress(level, address);
+                const size_t signExtension = tableAddress >> 47;
+                if (
+                    (signExtension != 0 && signExtension != 0x1FFFF)
+                    || tableAddress < Paginator::RECURSIVE_RANGE_START
+                    || tableAddress >= Paginator::RECURSIVE_RANGE_END
+                ) {
+                    std::fprintf(stderr, "Bad recursive address %#zx of the level %d table of %#zx.\n",
+                                 tableAddress, level, address);
+                    return false;
+                }
+            }
+        }
+
+        return true;
+    }
+
+    static size_t releasedFrames = 0;
+
+    static void releaseFrame(size_t) {
+        releasedFrames++;
+    }
+
+    static constexpr PageFlags TEST_FLAGS = PageFlags::Present | PageFlags::ReadBit | PageFlags::WriteBit;
+
+    /**
+     * Checks that the pages of [start, end) translate to pageAddress + offset, and the ones of the holes to 0.
+     */
+    static bool checkTranslations(const PageTableRootController &controller, const size_t start, const size_t end,
+                                  const size_t holeStart, const size_t holeEnd, const size_t physOffset) {
+        for (size_t address = start; address < end; address += FRAME_SIZE) {
+            const bool isInHole = address >= holeStart && address < holeEnd;
+            const size_t expected = isInHole ? 0 : address + physOffset;
+            if (controller.translateVirtToPhys(address) != expected) {
+                std::fprintf(stderr, "Wrong translation of %#zx after unmapRange.\n", address);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Checks unmapRange: the emptied tables going to the releaser, the switch from invlpg to a full flush past
+     * UNMAP_INVLPG_THRESHOLD, and the split of huge pages it only partly covers.
+     */
+    static bool checkUnmapRange() {
+        const size_t physOffset = BASE_PHYS_ADDRESS + FRAME_SIZE - BASE_VIRT_ADDRESS;
+        Paginator::UnmapResult result;
+
+        //4096 small pages under one L3 and one L2 table: 8 L1 tables, all freed with the rest of the branch
+        {
+            const PageTableRootController controller(resetArena(), allocateFrame, true, releaseFrame);
+            if (controller.mapRange(BASE_VIRT_ADDRESS, BASE_PHYS_ADDRESS + FRAME_SIZE, PAGE_COUNT * FRAME_SIZE,
+                                    TEST_FLAGS) != PageMapError::NoError) {
+                std::fprintf(stderr, "mapRange failed before unmapRange.\n");
+                return false;
+            }
+
+            //the first half: 4 of the L1 tables are emptied, the L2 table isn't
+            releasedFrames = 0;
+            const size_t half = PAGE_COUNT / 2 * FRAME_SIZE;
+            if (controller.unmapRange(BASE_VIRT_ADDRESS, half, &result) != PageMapError::NoError
+                || result.freedTables != 4 || releasedFrames != 4 || result.clearedLeaves != PAGE_COUNT / 2
+                || !checkTranslations(controller, BASE_VIRT_ADDRESS, BASE_VIRT_ADDRESS + 2 * half, BASE_VIRT_ADDRESS,
+                                      BASE_VIRT_ADDRESS + half, physOffset)) {
+                std::fprintf(stderr, "unmapRange of half the pages freed %zu tables (4 expected).\n",
+                             result.freedTables);
+                return false;
+            }
+
+            //the second half: the other 4 L1 tables, then the L2 and L3 tables left empty
+            if (controller.unmapRange(BASE_VIRT_ADDRESS + half, half, &result) != PageMapError::NoError
+                || result.freedTables != 6 || releasedFrames != 10) {
+                std::fprintf(stderr, "unmapRange of the rest freed %zu tables (6 expected).\n", result.freedTables);
+                return false;
+            }
+        }
+
+        //up to the threshold, page by page; one page more, a single flush
+        {
+            const PageTableRootController controller(resetArena(), allocateFrame, true, releaseFrame);
+            if (controller.mapRange(BASE_VIRT_ADDRESS, BASE_PHYS_ADDRESS + FRAME_SIZE, PAGE_COUNT * FRAME_SIZE,
+                                    TEST_FLAGS) != PageMapError::NoError) {
+                std::fprintf(stderr, "mapRange failed before unmapRange.\n");
+                return false;
+            }
+
+            const size_t threshold = Paginator::UNMAP_INVLPG_THRESHOLD;
+            if (controller.unmapRange(BASE_VIRT_ADDRESS, threshold * FRAME_SIZE, &result) != PageMapError::NoError
+                || result.isFullFlush || result.clearedLeaves != threshold) {
+                std::fprintf(stderr, "unmapRange of %zu pages didn't invalidate them one by one.\n", threshold);
+                return false;
+            }
+            const size_t next = BASE_VIRT_ADDRESS + threshold * FRAME_SIZE;
+            if (controller.unmapRange(next, (threshold + 1) * FRAME_SIZE, &result) != PageMapError::NoError
+                || !result.isFullFlush || result.clearedLeaves != threshold + 1) {
+                std::fprintf(stderr, "unmapRange of %zu pages didn't flush the TLB once.\n", threshold + 1);
+                return false;
+            }
+            //a page unmapped twice clears nothing
+            if (controller.unmapRange(next, FRAME_SIZE, &result) != PageMapError::NoError
+                || result.clearedLeaves != 0) {
+                std::fprintf(stderr, "unmapRange cleared a page that wasn't mapped.\n");
+                return false;
+            }
+        }
+
+        //a 1 GiB page, cut into by a 4 KiB hole and a 2 MiB one: split into 2 MiB pages, then one into 4 KiB pages
+        {
+            static constexpr size_t GIB = 1024ULL * 1024 * 1024;
+            static constexpr size_t MIB = 1024ULL * 1024;
+            const PageTableRootController controller(resetArena(), allocateFrame, true, releaseFrame);
+            if (controller.identityMapRange(GIB, GIB, TEST_FLAGS) != PageMapError::NoError) {
+                std::fprintf(stderr, "identityMapRange failed before unmapRange.\n");
+                return false;
+            }
+            const size_t tablesBefore = arenaUsed / FRAME_SIZE;
+
+            const size_t page = GIB + 3 * MIB + FRAME_SIZE;
+            if (controller.unmapRange(page, FRAME_SIZE, &result) != PageMapError::NoError
+                || result.clearedLeaves != 1 || arenaUsed / FRAME_SIZE != tablesBefore + 2
+                || !checkTranslations(controller, GIB + 2 * MIB, GIB + 4 * MIB, page, page + FRAME_SIZE, 0)
+                || controller.translateVirtToPhys(GIB + 512 * MIB + 123) != GIB + 512 * MIB + 123) {
+                std::fprintf(stderr, "Unmapping 4 KiB inside a 1 GiB page didn't split it.\n");
+                return false;
+            }
+
+            //a whole 2 MiB page of the split: no table of its own
+            const size_t hole = GIB + 6 * MIB;
+            if (controller.unmapRange(hole, 2 * MIB, &result) != PageMapError::NoError
+                || result.clearedLeaves != 1 || arenaUsed / FRAME_SIZE != tablesBefore + 2
+                || !checkTranslations(controller, GIB + 4 * MIB, GIB + 10 * MIB, hole, hole + 2 * MIB, 0)) {
+                std::fprintf(stderr, "Unmapping 2 MiB inside a split 1 GiB page went wrong.\n");
+                return false;
+            }
+
+            //the rest of the gigabyte: the two tables of the splits and the L3 table are released
+            releasedFrames = 0;
+            if (controller.unmapRange(GIB, GIB, &result) != PageMapError::NoError
+                || result.freedTables != 3 || releasedFrames != 3
+                || controller.translateVirtToPhys(GIB + 512 * MIB) != 0) {
+                std::fprintf(stderr, "Unmapping the split 1 GiB page freed %zu tables (3 expected).\n",
+                             result.freedTables);
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * Turns the cost of a batch into the cost of a single page.
+     */
+    static Bench::Measurement perPage(const Bench::Measurement &batch, const size_t pagesPerBatch) {
+        return {batch.nsPerOp / static_cast<double>(pagesPerBatch),
+                batch.cyclesPerOp / static_cast<double>(pagesPerBatch)};
+    }
+
+    bool runPagingCases() {
+        arena = static_cast<char *>(std::aligned_alloc(FRAME_SIZE, ARENA_SIZE));
+        if (arena == nullptr) {
+            std::fprintf(stderr, "Failed to allocate the physical memory arena.\n");
+            return false;
+        }
+
+        bool isSuccessful = checkRecursiveAddresses();
+        isSuccessful &= checkUnmapRange();
+
+        //every batch starts from an empty address space, so the table allocation and zeroing are part of the cost
+        report("paging", "map 4 KiB (new tables)", FRAME_SIZE, perPage(Bench::measureOp([&] {
+            const PageTableRootController controller(resetArena(), allocateFrame, true);
+            isSuccessful &= mapAll(controller);
+        }), PAGE_COUNT));
+
+        //same pages, one call; the physical base is offset by 4 KiB so no huge page fits and only the walks are saved
+        report("paging", "mapRange 4 KiB (new tables)", FRAME_SIZE, perPage(Bench::measureOp([&] {
+            const PageTableRootController controller(resetArena(), allocateFrame, true);
+            isSuccessful &= controller.mapRange(
+                BASE_VIRT_ADDRESS,
+                BASE_PHYS_ADDRESS + FRAME_SIZE,
+                PAGE_COUNT * FRAME_SIZE,
+                PageFlags::Present | PageFlags::ReadBit | PageFlags::WriteBit) == PageMapError::NoError;
+        }), PAGE_COUNT));
+
+        size_t identityMapTables = 0;
+        report("paging", "identityMapRange 4 GiB", IDENTITY_MAP_SIZE, Bench::measureOp([&] {
+            const PageTableRootController controller(resetArena(), allocateFrame, true);
+            isSuccessful &= controller.identityMapRange(
+                0,
+                IDENTITY_MAP_SIZE,
+                PageFlags::Present | PageFlags::ReadBit | PageFlags::WriteBit,
+                &identityMapTables) == PageMapError::NoError;
+        }));
+        std::printf("paging: identityMapRange of 4 GiB allocated %zu tables\n", identityMapTables);
+
+        const PageTableRootController controller(resetArena(), allocateFrame, true);
+        isSuccessful &= mapAll(controller);
+
+        //all the intermediate tables exist, so this is only the walk and the leaf write
+        report("paging", "map 4 KiB (existing tables)", FRAME_SIZE, perPage(Bench::measureOp([&] {
+            isSuccessful &= mapAll(controller);
+        }), PAGE_COUNT));
+
+        for (size_t i = 0; i < PAGE_COUNT; i++) {
+            const size_t offset = i * FRAME_SIZE + (i % FRAME_SIZE);
+            if (controller.translateVirtToPhys(BASE_VIRT_ADDRESS + offset) != BASE_PHYS_ADDRESS + offset) {
+                std::fprintf(stderr, "Wrong translation for page %zu.\n", i);
+                isSuccessful = false;
+                break;
+            }
+        }
+
+        report("paging", "translate (sequential)", FRAME_SIZE, perPage(Bench::measureOp([&] {
+            uint64_t sum = 0;
+            for (size_t i = 0; i < PAGE_COUNT; i++) {
+                sum += controller.translateVirtToPhys(BASE_VIRT_ADDRESS + i * FRAME_SIZE);
+            }
+            Bench::doNotOptimize(sum);
+        }), PAGE_COUNT));
+
+        //a fixed pseudo-random order, so the walks don't benefit from the previous one's cache lines as much
+        static uint16_t randomPages[RANDOM_LOOKUPS];
+        uint32_t state = 0x12345678;
+        for (uint16_t &page : randomPages) {
+            state = state * 1664525 + 1013904223;
+            page = static_cast<uint16_t>((state >> 16) % PAGE_COUNT);
+        }
+
+        report("paging", "translate (random)", FRAME_SIZE, perPage(Bench::measureOp([&] {
+            uint64_t sum = 0;
+            for (const uint16_t page : randomPages) {
+                sum += controller.translateVirtToPhys(BASE_VIRT_ADDRESS + page * FRAME_SIZE);
+            }
+            Bench::doNotOptimize(sum);
+        }), RANDOM_LOOKUPS));
+
+        std::printf("paging: %zu KiB of tables for %zu pages\n", arenaUsed / 1024, PAGE_COUNT);
+
+        std::free(arena);
+        arena = nullptr;
+
+        if (!isSuccessful) {
+            std::fprintf(stderr, "A mapping failed.\n");
+        }
+        return isSuccessful;
+    }
+} //namespace Suite
@@ -0,0 +1,45 @@
+#ifndef BENCH_SUITE_SUITE_H
+#define BENCH_SUITE_SUITE_H
+
+#include <cstddef>
+
+#include "../bench_utils.h"
+
+/**
+ * The microbenchmark suite: a fixed set of cases over the hot paths of the freestanding libraries, each reported as
+ * ns/op and bytes/cycle, so runs can be compared across machines and commits.
+ */
+namespace Suite {
+    /**
+     * Prints the column names.
+     */
+    void printHeader();
+
+    /**
+     * Prints one result line.
+     * @param group The library/area, e.g. "mem".
+     * @param name The case name.
+     * @param bytesPerOp How many bytes one operation processes; 0 if the metric doesn't make sense for the case.
+     * @param measurement The result from Bench::measureOp.
+     */
+    void report(const char *group, const char *name, size_t bytesPerOp, const Bench::Measurement &measurement);
+
+    /**
+     * The memory and string routines from c_husky, at a few representative sizes.
+     */
+    bool runMemCases();
+
+    /**
+     * ELF header parsing, program/section header iteration and PT_LOAD loading over real binaries.
+     * @param paths The binaries to parse.
+     * @param pathCount The number of paths.
+     */
+    bool runElfCases(const char *const *paths, int pathCount);
+
+    /**
+     * 4-level page-table map/translate against a simulated physical memory arena.
+     */
+    bool runPagingCases();
+} //namespace Suite
+
+#endif //BENCH_SUITE_SUITE_H
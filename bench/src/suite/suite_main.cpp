@@ -0,0 +1,50 @@
+#include <cstdio>
+
+#include "suite.h"
+
+/**
+ * Usage: suite [elf files...]. Without arguments, the ELF cases run over the suite's own binary.
+ */
+
+namespace Suite {
+    void printHeader() {
+        std::printf("%-8s %-32s %10s %12s %12s\n", "group", "case", "bytes/op", "ns/op", "B/cycle");
+    }
+
+    void report(const char *group, const char *name, const size_t bytesPerOp, const Bench::Measurement &measurement) {
+        if (bytesPerOp == 0) {
+            std::printf("%-8s %-32s %10s %12.2f %12s\n", group, name, "-", measurement.nsPerOp, "-");
+        } else {
+            std::printf(
+                "%-8s %-32s %10zu %12.2f %12.3f\n",
+                group,
+                name,
+                bytesPerOp,
+                measurement.nsPerOp,
+                static_cast<double>(bytesPerOp) / measurement.cyclesPerOp);
+        }
+
+        std::fflush(stdout);
+    }
+} //namespace Suite
+
+int main(const int argc, char **argv) {
+    static const char *const DEFAULT_ELF_PATHS[] = {"/proc/self/exe"};
+
+    const char *const *elfPaths = DEFAULT_ELF_PATHS;
+    int elfPathCount = 1;
+    if (argc > 1) {
+        elfPaths = argv + 1;
+        elfPathCount = argc - 1;
+    }
+
+    std::printf("Cycles are TSC (reference) cycles.\n\n");
+    Suite::printHeader();
+
+    const bool isSuccessful =
+        Suite::runMemCases()
+        && Suite::runElfCases(elfPaths, elfPathCount)
+        && Suite::runPagingCases();
+
+    return isSuccessful ? 0 : 1;
+}
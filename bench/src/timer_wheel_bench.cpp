@@ -0,0 +1,195 @@
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "timer_wheel/timer_wheel.h"
+
+#include "bench_utils.h"
+
+/**
+ * The timing wheel against an ordered tree (std::multimap, what a sorted timer queue costs), with a few to a million
+ * timers pending: arming and cancelling a timer (the common case for timeouts), then expiring them, jumping from one
+ * expiry to the next like a tickless timer interrupt. The times are TSC-like ticks (1 GHz), the timeouts spread from
+ * microseconds to a second.
+ *
+ * A random run against the tree checks that every timer expires at the first advance past its expiry, in order, and
+ * that getNextExpiry always gives the tree's first key.
+ */
+
+static constexpr uint64_t MAX_TIMEOUT = 1000000000;
+static constexpr size_t CHECK_TIMERS = 200000;
+static constexpr size_t CHECK_STEPS = 200000;
+static constexpr size_t PENDING_COUNTS[] = {16, 1024, 64 * 1024, 1024 * 1024};
+
+/**
+ * A timeout between 1 µs and a second, spread evenly on a log scale like real ones.
+ */
+static uint64_t randomTimeout(std::mt19937_64 &random) {
+    const unsigned bits = 10 + static_cast<unsigned>(random() % 20);
+    return (1ull << bits) + random() % (1ull << bits);
+}
+
+static bool check() {
+    std::mt19937_64 random(42);
+    auto wheel = std::make_unique<TimerWheel::Wheel>();
+    std::vector<TimerWheel::Timer> timers(CHECK_TIMERS);
+    std::multimap<uint64_t, TimerWheel::Timer *> reference;
+
+    uint64_t now = 1ull << 40;
+    wheel->reset(now);
+    size_t nextTimer = 0;
+    for (size_t step = 0; step < CHECK_STEPS; step++) {
+        //a few operations, then time moves on by a random amount (sometimes far, sometimes not at all)
+        for (int i = 0; i < 4 && nextTimer < CHECK_TIMERS; i++) {
+            TimerWheel::Timer *timer = &timers[nextTimer++];
+            TimerWheel::initTimer(timer, nullptr, nullptr);
+            //some are overdue already
+            const uint64_t expiry = random() % 16 == 0 ? now - random() % 1000 : now + randomTimeout(random);
+            wheel->insert(timer, expiry);
+            reference.emplace(expiry, timer);
+        }
+        if (!reference.empty() && random() % 3 == 0) {
+            auto victim = reference.lower_bound(now + random() % MAX_TIMEOUT);
+            if (victim != reference.end()) {
+                if (!wheel->remove(victim->second)) {
+                    return false;
+                }
+                reference.erase(victim);
+            }
+        }
+
+        uint64_t expiry;
+        if (wheel->getNextExpiry(&expiry) != !reference.empty()
+            || (!reference.empty() && expiry != reference.begin()->first)) {
+            return false;
+        }
+
+        const uint64_t previousNow = now;
+        now += random() % 4 == 0 ? randomTimeout(random) : random() % 4096;
+        uint64_t previous = 0;
+        for (TimerWheel::Timer *timer = wheel->advance(now); timer != nullptr; timer = timer->next) {
+            //the ones inserted overdue come first, in any order
+            if (timer->isPending || timer->expiry > now || (timer->expiry >= previousNow && timer->expiry < previous)) {
+                return false;
+            }
+            if (timer->expiry >= previousNow) {
+                previous = timer->expiry;
+            }
+
+            auto entry = reference.lower_bound(timer->expiry);
+            while (entry != reference.end() && entry->first == timer->expiry && entry->second != timer) {
+                ++entry;
+            }
+            if (entry == reference.end() || entry->second != timer) {
+                return false;
+            }
+            reference.erase(entry);
+        }
+        if (!reference.empty() && reference.begin()->first <= now) {
+            return false;
+        }
+        if (wheel->getPendingCount() != reference.size()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+struct Costs {
+    /**
+     * Arming a timer and cancelling it.
+     */
+    double armCancelNs;
+    /**
+     * Finding the next expiry, expiring the timer and arming it again.
+     */
+    double expireNs;
+};
+
+static Costs measureWheel(const size_t pendingCount) {
+    std::mt19937_64 random(1);
+    auto wheel = std::make_unique<TimerWheel::Wheel>();
+    std::vector<TimerWheel::Timer> timers(pendingCount + 1);
+    uint64_t now = 1ull << 40;
+    wheel->reset(now);
+    for (size_t i = 0; i < pendingCount; i++) {
+        TimerWheel::initTimer(&timers[i], nullptr, nullptr);
+        wheel->insert(&timers[i], now + randomTimeout(random));
+    }
+
+    TimerWheel::Timer *timeout = &timers[pendingCount];
+    TimerWheel::initTimer(timeout, nullptr, nullptr);
+    const Bench::Measurement armCancel = Bench::measureOp([&] {
+        wheel->insert(timeout, now + randomTimeout(random));
+        wheel->remove(timeout);
+    });
+
+    //like the timer interrupt: straight to the next expiry, and every expired timer is armed again
+    uint64_t expiredCount = 0;
+    const Bench::Stopwatch stopwatch;
+    while (expiredCount < 4 * pendingCount + 100000) {
+        uint64_t expiry;
+        if (wheel->getNextExpiry(&expiry) && expiry > now) {
+            now = expiry;
+        }
+        TimerWheel::Timer *timer = wheel->advance(now);
+        while (timer != nullptr) {
+            TimerWheel::Timer *next = timer->next;
+            wheel->insert(timer, now + randomTimeout(random));
+            expiredCount++;
+            timer = next;
+        }
+    }
+    return {armCancel.nsPerOp, stopwatch.elapsedNs() / static_cast<double>(expiredCount)};
+}
+
+static Costs measureTree(const size_t pendingCount) {
+    std::mt19937_64 random(1);
+    std::multimap<uint64_t, size_t> tree;
+    uint64_t now = 1ull << 40;
+    for (size_t i = 0; i < pendingCount; i++) {
+        tree.emplace(now + randomTimeout(random), i);
+    }
+
+    const Bench::Measurement armCancel = Bench::measureOp([&] {
+        const auto entry = tree.emplace(now + randomTimeout(random), pendingCount);
+        tree.erase(entry);
+    });
+
+    uint64_t expiredCount = 0;
+    const Bench::Stopwatch stopwatch;
+    while (expiredCount < 4 * pendingCount + 100000) {
+        if (tree.begin()->first > now) {
+            now = tree.begin()->first;
+        }
+        while (!tree.empty() && tree.begin()->first <= now) {
+            const size_t timer = tree.begin()->second;
+            tree.erase(tree.begin());
+            tree.emplace(now + randomTimeout(random), timer);
+            expiredCount++;
+        }
+    }
+    return {armCancel.nsPerOp, stopwatch.elapsedNs() / static_cast<double>(expiredCount)};
+}
+
+int main() {
+    if (!check()) {
+        std::fprintf(stderr, "the wheel disagrees with the tree\n");
+        return 1;
+    }
+    std::printf("checked against the tree: ok\n\n");
+
+    std::printf("ns per timer\n");
+    std::printf("%10s%18s%18s%18s%18s\n", "pending", "wheel arm+cancel", "tree arm+cancel", "wheel expire",
+                "tree expire");
+    for (const size_t pendingCount : PENDING_COUNTS) {
+        const Costs wheel = measureWheel(pendingCount);
+        const Costs tree = measureTree(pendingCount);
+        std::printf("%10zu%18.1f%18.1f%18.1f%18.1f\n", pendingCount, wheel.armCancelNs, tree.armCancelNs,
+                    wheel.expireNs, tree.expireNs);
+    }
+    return 0;
+}
@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "trace/trace.h"
+
+#include "bench_utils.h"
+
+/**
+ * The cost of a TRACE_BEGIN/TRACE_END pair, from one thread and from several at once (they all share the index of the
+ * buffer), then the speed of the Chrome trace writer over a full buffer. With an argument, the trace is also written
+ * to that file, to check that it loads in chrome://tracing or Perfetto.
+ */
+
+static constexpr unsigned MAX_THREADS = 8;
+static constexpr size_t PAIRS_PER_THREAD = 1024 * 1024;
+
+static thread_local unsigned currentCpu = 0;
+
+static unsigned getCurrentCpu() {
+    return currentCpu;
+}
+
+/**
+ * Returns the wall-clock ns per pair, all threads together.
+ */
+static double measureContendedPairs(const unsigned threadCount) {
+    std::vector<std::thread> threads;
+    const Bench::Stopwatch stopwatch;
+    for (unsigned cpu = 0; cpu < threadCount; cpu++) {
+        threads.emplace_back([cpu] {
+            currentCpu = cpu;
+            for (size_t i = 0; i < PAIRS_PER_THREAD; i++) {
+                TRACE_BEGIN("contended");
+                TRACE_END("contended");
+            }
+        });
+    }
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    return stopwatch.elapsedNs() / static_cast<double>(PAIRS_PER_THREAD * threadCount);
+}
+
+static void countBytes(const char *, const size_t size, void *context) {
+    *static_cast<size_t *>(context) += size;
+}
+
+static void writeToFile(const char *data, const size_t size, void *context) {
+    std::fwrite(data, 1, size, static_cast<FILE *>(context));
+}
+
+int main(const int argc, char **argv) {
+    auto *buffer = static_cast<Trace::Buffer *>(std::aligned_alloc(alignof(Trace::Buffer), sizeof(Trace::Buffer)));
+    if (buffer == nullptr) {
+        return 1;
+    }
+
+    //the frequency only matters for the output, so a rough one is enough
+    const Bench::Stopwatch calibration;
+    const uint64_t startTsc = Bench::readTsc();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    const uint64_t tscFrequency =
+        static_cast<uint64_t>(static_cast<double>(Bench::readTsc() - startTsc) * 1e9 / calibration.elapsedNs());
+
+    Trace::initBuffer(buffer, tscFrequency);
+    Trace::setBuffer(buffer);
+    Trace::setCpuIndexFunction(getCurrentCpu);
+
+    std::printf("ns (TSC cycles) per TRACE_BEGIN/TRACE_END pair\n");
+    const Bench::Measurement pair = Bench::measureOp([] {
+        TRACE_BEGIN("pair");
+        TRACE_END("pair");
+    });
+    std::printf("%24s%10.2f (%.1f)\n", "one thread", pair.nsPerOp, pair.cyclesPerOp);
+
+    Trace::setBuffer(nullptr);
+    const Bench::Measurement disabled = Bench::measureOp([] {
+        TRACE_BEGIN("pair");
+        TRACE_END("pair");
+    });
+    std::printf("%24s%10.2f (%.1f)\n", "no buffer", disabled.nsPerOp, disabled.cyclesPerOp);
+    Trace::setBuffer(buffer);
+
+    std::printf("\nwall-clock ns per pair, all threads together\n");
+    const unsigned threadCount = std::clamp(std::thread::hardware_concurrency(), 1U, MAX_THREADS);
+    for (unsigned threads = 1; threads <= threadCount; threads *= 2) {
+        std::printf("%16u threads%10.2f\n", threads, measureContendedPairs(threads));
+    }
+
+    //a nested, readable trace to finish with, over a fresh buffer so it isn't overwritten by the pairs above
+    Trace::initBuffer(buffer, tscFrequency);
+    currentCpu = 0;
+    TRACE_BEGIN("boot");
+    for (int i = 0; i < 3; i++) {
+        TRACE_BEGIN("phase \"quoted\"");
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+        TRACE_END("phase \"quoted\"");
+    }
+    TRACE_END("boot");
+
+    //the writer's speed is measured over a full buffer, so the readable trace is put aside
+    std::vector<char> copy(sizeof(Trace::Buffer));
+    std::memcpy(copy.data(), buffer, sizeof(Trace::Buffer));
+    for (size_t i = 0; i < Trace::BUFFER_CAPACITY; i++) {
+        TRACE_BEGIN("filler");
+    }
+    size_t traceSize = 0;
+    const Bench::Stopwatch writeStopwatch;
+    Trace::writeChromeTrace(*buffer, countBytes, &traceSize);
+    std::printf("\nwriting %zu events: %zu bytes in %.1f us\n", Trace::BUFFER_CAPACITY, traceSize,
+                writeStopwatch.elapsedNs() / 1000);
+
+    if (argc > 1) {
+        FILE *file = std::fopen(argv[1], "w");
+        if (file == nullptr) {
+            std::fprintf(stderr, "can't open %s\n", argv[1]);
+            return 1;
+        }
+        std::memcpy(buffer, copy.data(), sizeof(Trace::Buffer));
+        Trace::writeChromeTrace(*buffer, writeToFile, file);
+        std::fclose(file);
+    }
+
+    std::free(buffer);
+    return 0;
+}
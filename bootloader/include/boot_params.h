@@ -2,6 +2,10 @@
 #define BOOT_PARAMS_H
 
 #include <cstddef>
+#include <cstdint>
+
+#include <frame_allocator/memory_map.h>
+#include <trace/trace.h>
 
 static constexpr int PAGE_SIZE = 4096;
 
@@ -69,18 +73,144 @@ static constexpr MemoryMap_t INVALID_MEMORY_MAP = {
     0
 };
 
+/**
+ * A range of physical memory that only held data for the boot process. The kernel can use it as free memory once it
+ * doesn't need that data anymore.
+ */
+struct ReclaimableRegion_t {
+    /**
+     * The physical address of the first page.
+     */
+    uint64_t physical_start;
+    /**
+     * The number of 4 KiB pages in the region.
+     */
+    uint64_t page_count;
+};
+
+static constexpr ReclaimableRegion_t INVALID_RECLAIMABLE_REGION = {
+    0,
+    0
+};
+
 struct FramebufferInfo_t {
     uint32_t Width;
     uint32_t Height;
     uint32_t BytesPerRow;
     bool isRgb;
+    /**
+     * The physical address of the framebuffer, and its size in bytes.
+     */
+    uint64_t BaseAddress;
+    uint64_t Size;
 };
 
 static constexpr FramebufferInfo_t INVALID_FRAMEBUFFER_INFO = {
     0,
     0,
     0,
-    false
+    false,
+    0,
+    0
+};
+
+/**
+ * Where the kernel image was loaded. The image is contiguous both physically and virtually, so a kernel address is
+ * turned into a physical one with physical_start + (address - virtual_start).
+ */
+struct KernelLayout_t {
+    uint64_t physical_start;
+    uint64_t virtual_start;
+    /**
+     * The size of the image in bytes, a multiple of 4 KiB.
+     */
+    uint64_t size;
+    /**
+     * The virtual address of kernel_main.
+     */
+    uint64_t entry_point;
+};
+
+/**
+ * "BOOTPRMS" in little-endian ASCII.
+ */
+static constexpr uint64_t BOOT_PARAMS_MAGIC = 0x534D5250544F4F42;
+
+/**
+ * The size of BootParams_t::ap_trampoline: one page for the code, one for the page tables the APs start with.
+ */
+static constexpr uint64_t AP_TRAMPOLINE_PAGES = 2;
+
+/**
+ * Incremented whenever BootParams_t changes in a way the kernel has to know about. New fields are only ever appended.
+ */
+static constexpr uint32_t BOOT_PARAMS_VERSION = 3;
+
+/**
+ * Everything the bootloader found out about the machine, given to kernel_main, so the kernel never has to ask the
+ * firmware again (it can't anyway, after ExitBootServices).
+ *
+ * The block and everything it points to live in the bootloader's arena, described by boot_arena so the kernel can
+ * reclaim it: the kernel has to copy what it wants to keep before that. The pointers are physical addresses, which the
+ * bootloader identity-maps.
+ */
+struct alignas(64) BootParams_t {
+    /**
+     * BOOT_PARAMS_MAGIC and BOOT_PARAMS_VERSION, checked by the kernel before using anything else.
+     */
+    uint64_t magic;
+    uint32_t version;
+    /**
+     * sizeof(BootParams_t) as the bootloader knows it.
+     */
+    uint32_t size;
+
+    /**
+     * The memory map, sorted by address, without overlaps, and with adjacent regions of the same kind merged (see
+     * FrameAllocator::collectRegions). The bootloader's memory, kernel included, is reported as LoaderData.
+     */
+    FrameAllocator::MemoryRegion *memory_regions;
+    uint64_t memory_region_count;
+    /**
+     * The memory of the bootloader's arena, which holds this block and the memory map.
+     */
+    ReclaimableRegion_t boot_arena;
+
+    FramebufferInfo_t framebuffer;
+    KernelLayout_t kernel;
+
+    /**
+     * The physical address of the ACPI RSDP, or 0 if the firmware doesn't have one.
+     */
+    uint64_t acpi_rsdp;
+    /**
+     * 2 if acpi_rsdp points to an ACPI 2.0+ RSDP (with the XSDT), 0 for an ACPI 1.0 one.
+     */
+    uint32_t acpi_revision;
+    /**
+     * The frequency of the TSC in Hz, or 0 if it couldn't be determined.
+     */
+    uint64_t tsc_frequency;
+
+    /**
+     * The events recorded by the bootloader. Unlike the rest, it's not in the arena: the kernel keeps recording into
+     * it. nullptr if it couldn't be allocated.
+     */
+    Trace::Buffer *trace_buffer;
+
+    /**
+     * The physical address of the BSP's local APIC registers, identity-mapped like the rest (0 if there's no APIC).
+     */
+    uint64_t local_apic;
+    /**
+     * AP_TRAMPOLINE_PAGES pages below 1 MiB for the kernel to start the other CPUs from (a startup IPI can only point
+     * there), or 0 if the firmware had none left. Reported as LoaderData.
+     */
+    uint64_t ap_trampoline;
+    /**
+     * The top of the stack kernel_main is called on (KERNEL_STACK_PAGES pages, LoaderData).
+     */
+    uint64_t kernel_stack_top;
 };
 
 #endif //BOOT_PARAMS_H
@@ -0,0 +1,61 @@
+#include "boot_arena.h"
+
+namespace BootArena {
+    static EFI_PHYSICAL_ADDRESS arenaStart = 0;
+    static UINTN arenaSize = 0;
+    static UINTN usedSize = 0;
+
+    bool init(EFI_BOOT_SERVICES *bootServices, const UINTN pageCount) {
+        EFI_PHYSICAL_ADDRESS start = 0;
+        const EFI_STATUS status = bootServices->AllocatePages(AllocateAnyPages, EfiLoaderData, pageCount, &start);
+        if (EFI_ERROR(status) || start == 0) {
+            return false;
+        }
+
+        arenaStart = start;
+        arenaSize = pageCount * EFI_PAGE_SIZE;
+        usedSize = 0;
+        return true;
+    }
+
+    void *allocate(const UINTN size, UINTN alignment) {
+        if (alignment < MIN_ALIGNMENT) {
+            alignment = MIN_ALIGNMENT;
+        }
+
+        const UINTN address = (arenaStart + usedSize + alignment - 1) & ~(alignment - 1);
+        const UINTN start = address - arenaStart;
+        if (arenaStart == 0 || start > arenaSize || size > arenaSize - start) {
+            return nullptr;
+        }
+
+        usedSize = start + size;
+        return reinterpret_cast<void *>(address);
+    }
+
+    Mark getMark() {
+        return usedSize;
+    }
+
+    void release(const Mark mark) {
+        if (mark < usedSize) {
+            usedSize = mark;
+        }
+    }
+
+    UINTN getFreeSize() {
+        return arenaSize - usedSize;
+    }
+
+    ReclaimableRegion_t getRegion() {
+        if (arenaStart == 0) {
+            return INVALID_RECLAIMABLE_REGION;
+        }
+
+        const ReclaimableRegion_t region = {
+            arenaStart,
+            arenaSize / EFI_PAGE_SIZE,
+        };
+        return region;
+    }
+} //namespace BootArena
@@ -0,0 +1,66 @@
+#ifndef BOOTLOADER_BOOT_ARENA_H
+#define BOOTLOADER_BOOT_ARENA_H
+
+#include <efi.h>
+#include "boot_params.h"
+
+/**
+ * The memory for everything the bootloader allocates for itself (file info, program headers, the memory map...). One
+ * EfiLoaderData region is taken from the firmware at startup, and handed out with a bump pointer: an allocation is an
+ * addition, and doesn't change the firmware's memory map (which matters when the map has to stay valid for
+ * ExitBootServices). Since it's a single region, the kernel can take it back in one go once it doesn't need the boot
+ * data anymore.
+ *
+ * Nothing is freed one by one: temporary buffers are released together with release, back to a mark taken before
+ * allocating them (so only the most recent allocations can be released).
+ */
+namespace BootArena {
+    /**
+     * 2 MiB: the bootloader's own data takes a few tens of KiB at most, even with a large memory map.
+     */
+    constexpr UINTN DEFAULT_PAGE_COUNT = 512;
+
+    /**
+     * Every allocation is aligned to at least this, like AllocatePool.
+     */
+    constexpr UINTN MIN_ALIGNMENT = 16;
+
+    /**
+     * A position in the arena, as given by getMark.
+     */
+    typedef UINTN Mark;
+
+    /**
+     * Takes the memory of the arena from the firmware. Must be called before any other function.
+     * @return False if the firmware doesn't have pageCount contiguous pages.
+     */
+    bool init(EFI_BOOT_SERVICES *bootServices, UINTN pageCount);
+
+    /**
+     * @param alignment A power of two; at least MIN_ALIGNMENT is used.
+     * @return The memory, or nullptr if the arena is full (or not initialized).
+     */
+    [[nodiscard]] void *allocate(UINTN size, UINTN alignment = MIN_ALIGNMENT);
+
+    /**
+     * Returns the current position, to give to release later.
+     */
+    Mark getMark();
+
+    /**
+     * Releases everything allocated after the mark was taken.
+     */
+    void release(Mark mark);
+
+    /**
+     * Returns the number of bytes that are still free (before alignment).
+     */
+    UINTN getFreeSize();
+
+    /**
+     * Returns the memory of the arena, for the kernel to reclaim, or INVALID_RECLAIMABLE_REGION before init.
+     */
+    ReclaimableRegion_t getRegion();
+} //namespace BootArena
+
+#endif //BOOTLOADER_BOOT_ARENA_H
@@ -53,19 +53,28 @@ namespace Gop {
             }
         }
 
+        //both supported formats have 4 bytes per pixel
         *fbInfo = FramebufferInfo_t {
             bestModeInfo->HorizontalResolution,
             bestModeInfo->VerticalResolution,
-            bestModeInfo->PixelsPerScanLine,
+            bestModeInfo->PixelsPerScanLine * 4,
             bestModeInfo->PixelFormat == PixelRedGreenBlueReserved8BitPerColor,
+            0,
+            0,
         };
         
-        if (bestModeInfo == gop->Mode->Info) {
-            return true;
+        if (bestModeInfo != gop->Mode->Info) {
+            const EFI_STATUS status = gop->SetMode(gop, bestModeIndex);
+            if (EFI_ERROR(status)) {
+                *fbInfo = INVALID_FRAMEBUFFER_INFO;
+                return false;
+            }
         }
 
-        const EFI_STATUS status = gop->SetMode(gop, bestModeIndex);
-        return !EFI_ERROR(status);
+        //the framebuffer may move with the mode, so it's only known now
+        fbInfo->BaseAddress = gop->Mode->FrameBufferBase;
+        fbInfo->Size = gop->Mode->FrameBufferSize;
+        return true;
     }
 
 }//namespace Gop
\ No newline at end of file
@@ -0,0 +1,171 @@
+#include <c_husky/mem_routines.h>
+#include <paginator/page_table.h>
+#include <serial_log/serial_log.h>
+#include <trace/trace.h>
+
+#include "handoff.h"
+
+namespace Handoff {
+    /**
+     * Everything is mapped executable and writable: these are only the tables the kernel starts with, and it
+     * replaces them with its own. That also means the entries never use the NX bit, which needs EFER.NXE.
+     */
+    constexpr Paginator::PageFlags BOOT_MAPPING_FLAGS =
+        Paginator::PageFlags::Present
+        | Paginator::PageFlags::ReadBit
+        | Paginator::PageFlags::WriteBit
+        | Paginator::PageFlags::ExecuteBit;
+
+    static EFI_PHYSICAL_ADDRESS tablePoolStart = 0;
+    static UINTN usedTablePages = 0;
+    static EFI_PHYSICAL_ADDRESS kernelStackStart = 0;
+    static EFI_PHYSICAL_ADDRESS apTrampoline = 0;
+
+    /**
+     * Paginator::PageTableRootController::PageFrameAllocator on top of the pool. The paginator zeroes the tables.
+     */
+    static std::size_t allocateTableFrame() {
+        if (tablePoolStart == 0 || usedTablePages == PAGE_TABLE_POOL_PAGES) {
+            return 0;
+        }
+        return tablePoolStart + usedTablePages++ * EFI_PAGE_SIZE;
+    }
+
+    /**
+     * Identity-maps a range, leaving out the part taken by the recursive entry.
+     */
+    static bool identityMap(const Paginator::PageTableRootController &controller, const uint64_t start,
+                            const uint64_t end) {
+        if (start >= end) {
+            return true;
+        }
+
+        if (end <= Paginator::RECURSIVE_RANGE_START || start >= Paginator::RECURSIVE_RANGE_END) {
+            return controller.identityMapRange(start, end - start, BOOT_MAPPING_FLAGS) ==
+                   Paginator::PageMapError::NoError;
+        }
+
+        return identityMap(controller, start, Paginator::RECURSIVE_RANGE_START)
+               && identityMap(controller, Paginator::RECURSIVE_RANGE_END, end);
+    }
+
+    /**
+     * Builds the tables described in enterKernel.
+     * @return False if the pool is too small.
+     */
+    static bool buildPageTables(const Paginator::PageTableRootController &controller, const BootParams_t *bootParams) {
+        if (!controller.installRecursiveEntry()) {
+            return false;
+        }
+
+        for (uint64_t i = 0; i < bootParams->memory_region_count; i++) {
+            const FrameAllocator::MemoryRegion &region = bootParams->memory_regions[i];
+            //the reserved regions can be huge MMIO windows, which the kernel maps itself with the right caching
+            if (region.kind == FrameAllocator::RegionKind::Reserved) {
+                continue;
+            }
+
+            if (!identityMap(controller, region.physStart, region.physStart + region.frameCount * EFI_PAGE_SIZE)) {
+                return false;
+            }
+        }
+
+        const FramebufferInfo_t &framebuffer = bootParams->framebuffer;
+        if (framebuffer.BaseAddress != 0) {
+            const uint64_t start = framebuffer.BaseAddress & ~static_cast<uint64_t>(EFI_PAGE_SIZE - 1);
+            if (!identityMap(controller, start, framebuffer.BaseAddress + framebuffer.Size)) {
+                return false;
+            }
+        }
+
+        //a reserved region too, usually
+        if (bootParams->local_apic != 0
+            && !identityMap(controller, bootParams->local_apic, bootParams->local_apic + EFI_PAGE_SIZE)) {
+            return false;
+        }
+
+        //global (see enterKernel): with CR4.PGE, which the kernel sets, its entries survive every CR3 switch
+        const KernelLayout_t &kernel = bootParams->kernel;
+        return controller.mapRange(kernel.virtual_start, kernel.physical_start, kernel.size, BOOT_MAPPING_FLAGS) ==
+               Paginator::PageMapError::NoError;
+    }
+
+    bool prepare(EFI_BOOT_SERVICES *bootServices) {
+        EFI_PHYSICAL_ADDRESS pool = 0;
+        EFI_STATUS status = bootServices->AllocatePages(AllocateAnyPages, EfiLoaderData, PAGE_TABLE_POOL_PAGES, &pool);
+        if (EFI_ERROR(status)) {
+            return false;
+        }
+
+        EFI_PHYSICAL_ADDRESS stack = 0;
+        status = bootServices->AllocatePages(AllocateAnyPages, EfiLoaderData, KERNEL_STACK_PAGES, &stack);
+        if (EFI_ERROR(status)) {
+            bootServices->FreePages(pool, PAGE_TABLE_POOL_PAGES);
+            return false;
+        }
+
+        tablePoolStart = pool;
+        usedTablePages = 0;
+        kernelStackStart = stack;
+
+        //the firmware often keeps most of the first MiB to itself, so going without is fine
+        EFI_PHYSICAL_ADDRESS trampoline = AP_TRAMPOLINE_MAX_ADDRESS;
+        status = bootServices->AllocatePages(AllocateMaxAddress, EfiLoaderData, AP_TRAMPOLINE_PAGES, &trampoline);
+        apTrampoline = EFI_ERROR(status) ? 0 : trampoline;
+        return true;
+    }
+
+    void fillBootParams(BootParams_t *bootParams) {
+        bootParams->ap_trampoline = apTrampoline;
+        bootParams->kernel_stack_top = kernelStackStart + KERNEL_STACK_PAGES * EFI_PAGE_SIZE;
+    }
+
+    [[noreturn]] void enterKernel(const BootParams_t *bootParams) {
+        const std::size_t rootAddress = allocateTableFrame();
+        if (rootAddress == 0) {
+            halt();
+        }
+
+        auto *rootTable = reinterpret_cast<Paginator::PageTable_t *>(rootAddress);
+        CHusky::Mem::zeroPage(rootTable);
+
+        TRACE_BEGIN("page_tables");
+        Paginator::PageTableRootController controller(rootTable, allocateTableFrame, true);
+        //only the higher half is affected: the kernel's image, the same in every address space the kernel makes
+        controller.setGlobalKernelMappings(true);
+        if (!buildPageTables(controller, bootParams)) {
+            halt();
+        }
+        TRACE_END("page_tables");
+
+        //the kernel sets the UART up again, which would cut off what is still queued
+        SerialLog::flush();
+
+        //the firmware's interrupt handlers aren't mapped at the same place anymore (if at all)
+        asm volatile("cli");
+        if (!controller.activateRootPageTable()) {
+            halt();
+        }
+
+        /* kernel_main uses the System V ABI (the bootloader uses Microsoft's), so the call is made by hand: the boot
+         * parameters go in rdi, and the stack is 16-byte aligned before the call, as the ABI expects. */
+        const uint64_t stackTop = bootParams->kernel_stack_top;
+        asm volatile(
+            "mov %0, %%rsp\n"
+            "xor %%ebp, %%ebp\n"
+            "call *%1\n"
+            :
+            : "r"(stackTop), "r"(bootParams->kernel.entry_point), "D"(bootParams)
+            : "memory");
+
+        //kernel_main never returns
+        halt();
+    }
+
+    [[noreturn]] void halt() {
+        SerialLog::flush();
+        while (true) {
+            asm volatile("cli; hlt");
+        }
+    }
+} //namespace Handoff
@@ -0,0 +1,56 @@
+#ifndef BOOTLOADER_HANDOFF_H
+#define BOOTLOADER_HANDOFF_H
+
+#include <efi.h>
+#include "boot_params.h"
+
+/**
+ * The last steps of the boot: building the kernel's page tables and jumping to kernel_main, after ExitBootServices.
+ */
+namespace Handoff {
+    /**
+     * The pages the page tables are taken from. With huge pages, a few tables per memory region are enough.
+     */
+    constexpr UINTN PAGE_TABLE_POOL_PAGES = 256;
+
+    /**
+     * The stack kernel_main starts on: 64 KiB.
+     */
+    constexpr UINTN KERNEL_STACK_PAGES = 16;
+
+    /**
+     * The AP trampoline has to be below 1 MiB, where the APs start in real mode.
+     */
+    constexpr EFI_PHYSICAL_ADDRESS AP_TRAMPOLINE_MAX_ADDRESS = 0xFFFFF;
+
+    /**
+     * Takes the memory that has to outlive the boot services (the page tables, the kernel's first stack and the AP
+     * trampoline) from the firmware. It's kept by the kernel, so it doesn't come from the arena. Must be called before
+     * the final memory map is taken.
+     * @return False if the firmware doesn't have enough memory. Only the trampoline is optional: without it, the
+     * kernel just runs on one CPU.
+     */
+    bool prepare(EFI_BOOT_SERVICES *bootServices);
+
+    /**
+     * Records what prepare took in the boot parameters: the AP trampoline (0 if there was nothing free below 1 MiB)
+     * and the kernel's stack.
+     */
+    void fillBootParams(BootParams_t *bootParams);
+
+    /**
+     * Builds the page tables, installs them and calls kernel_main. The kernel is mapped at its virtual addresses, and
+     * the memory of the map (except the reserved regions), the framebuffer and the local APIC are identity-mapped, so
+     * the bootloader keeps running after the switch and the kernel can follow the physical pointers of the boot
+     * parameters. Only after ExitBootServices, and after prepare.
+     */
+    [[noreturn]] void enterKernel(const BootParams_t *bootParams);
+
+    /**
+     * Stops the CPU, for the failures after ExitBootServices (the firmware can't even print anymore). What is left in
+     * the serial log is sent first.
+     */
+    [[noreturn]] void halt();
+} //namespace Handoff
+
+#endif //BOOTLOADER_HANDOFF_H
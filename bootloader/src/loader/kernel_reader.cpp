@@ -1,21 +1,51 @@
 #include <cstdint>
 #include "elf/elf_loader.h"
+#include "elf/elf_stream_loader.h"
 #include "src/main.h"
+#include "src/boot_arena.h"
+#include "parallel_zero.h"
 
 #include "kernel_reader.h"
 
 namespace KernelReader {
-    typedef struct ReadFileInfo {
-        void *Buffer;
-        uint64_t BufferSize;
-    } ReadFileInfo;
+    /**
+     * What the ELF loader's read callback needs to read from the kernel file.
+     */
+    typedef struct KernelReadContext {
+        EFI_FILE_HANDLE FileHandle;
+        KernelLoadError *Error;
+    } KernelReadContext;
 
-    constexpr ReadFileInfo INVALID_READ_FILE_INFO = {nullptr, 0};
     static EFI_BOOT_SERVICES *bs;
 
     static EFI_FILE_HANDLE getVolume(EFI_HANDLE handle, bool *isSuccessful);
 
-    static ReadFileInfo readFile(EFI_FILE_HANDLE fileHandle, KernelLoadError *error);
+    /**
+     * Returns the size of the file, or 0 if it couldn't be determined (error is set in that case).
+     */
+    static uint64_t getFileSize(EFI_FILE_HANDLE fileHandle, KernelLoadError *error);
+
+    /**
+     * Reads exactly size bytes from the given offset of the file into dest.
+     * @return True on success, false otherwise (error is set in that case).
+     */
+    static bool readAt(EFI_FILE_HANDLE fileHandle, uint64_t offset, uint64_t size, void *dest, KernelLoadError *error);
+
+    /**
+     * Elf::ElfStreamLoader::ReadFunction on top of readAt; the context is a KernelReadContext.
+     */
+    static bool readKernelBytes(void *context, uint64_t offset, uint64_t size, void *dest);
+
+    /**
+     * Loads every PT_LOAD segment of the kernel straight into its final pages.
+     */
+    static KernelElfInfo loadSegments(EFI_FILE_HANDLE fileHandle, uint64_t fileSize, KernelLoadError *error);
+
+    static KernelElfInfo loadSegmentsWithHeaders(
+        const Elf::ElfStreamLoader &elfLoader,
+        const Elf::Elf64_ProgHeader *progHeaders,
+        int numProgHeaders,
+        KernelLoadError *error);
 
     KernelElfInfo readKernel(EFI_HANDLE handle, const EFI_SYSTEM_TABLE *systemTable, KernelLoadError *error) {
         *error = FileReadUnknownError;
@@ -56,86 +86,161 @@ namespace KernelReader {
             return INVALID_KERNEL_ELF_INFO;
         }
 
-        const ReadFileInfo kernelFileInfo = readFile(fileHandle, error);
-        if (kernelFileInfo.BufferSize == 0) {
+        const uint64_t fileSize = getFileSize(fileHandle, error);
+        if (fileSize == 0) {
+            volumeHandle->Close(fileHandle);
             return INVALID_KERNEL_ELF_INFO;
         }
 
-        const auto elfLoader = Elf::ElfLoader(kernelFileInfo.Buffer, kernelFileInfo.BufferSize);
-        Elf::ElfLoader::ElfError err = elfLoader.checkElf();
+        const KernelElfInfo kernelInfo = loadSegments(fileHandle, fileSize, error);
+        volumeHandle->Close(fileHandle);
+        return kernelInfo;
+    }
 
-        if (err != Elf::ElfLoader::ElfError::NoError) {
+    static KernelElfInfo loadSegments(EFI_FILE_HANDLE fileHandle, const uint64_t fileSize, KernelLoadError *error) {
+        /* Only the ELF header and the program header table are read into memory (generally less than 1 KiB); the
+         * segments are read straight into their final pages, and the rest of the file is never touched. */
+        KernelReadContext readContext = {fileHandle, error};
+        auto elfLoader = Elf::ElfStreamLoader(readKernelBytes, &readContext, fileSize);
+        if (elfLoader.readHeader() != Elf::ElfLoader::ElfError::NoError) {
             Log::print(L"Failed to load kernel: ELF header is corrupt.\r\n");
+            return INVALID_KERNEL_ELF_INFO;
         }
 
-        int numProgHeaders = 0;
-        const Elf::Elf64_ProgHeader *progHeaders = elfLoader.getProgramHeaders(&numProgHeaders, &err);
+        const int numProgHeaders = elfLoader.getProgramHeaderCount();
+        if (numProgHeaders == 0) {
+            Log::print(L"Failed to load kernel: there's nothing to load.\r\n");
+            return INVALID_KERNEL_ELF_INFO;
+        }
 
+        //the program headers are only needed while loading, so they're given back to the arena afterwards
+        const BootArena::Mark arenaMark = BootArena::getMark();
+        void *progHeaders = BootArena::allocate(
+            numProgHeaders * sizeof(Elf::Elf64_ProgHeader),
+            alignof(Elf::Elf64_ProgHeader));
+        if (progHeaders == nullptr) {
+            Log::print(L"Failed to load kernel: not enough memory for the program headers.\r\n");
+            return INVALID_KERNEL_ELF_INFO;
+        }
+
+        KernelElfInfo kernelInfo = INVALID_KERNEL_ELF_INFO;
+        if (elfLoader.readProgramHeaders(static_cast<Elf::Elf64_ProgHeader *>(progHeaders)) ==
+            Elf::ElfLoader::ElfError::NoError) {
+            kernelInfo = loadSegmentsWithHeaders(
+                elfLoader,
+                static_cast<Elf::Elf64_ProgHeader *>(progHeaders),
+                numProgHeaders,
+                error);
+        } else {
+            Log::print(L"Failed to load kernel: the program headers are corrupt.\r\n");
+        }
+
+        BootArena::release(arenaMark);
+        return kernelInfo;
+    }
+
+    static KernelElfInfo loadSegmentsWithHeaders(
+        const Elf::ElfStreamLoader &elfLoader,
+        const Elf::Elf64_ProgHeader *progHeaders,
+        const int numProgHeaders,
+        KernelLoadError *error) {
+        //the physical span of all the PT_LOAD segments, which is allocated in one go
+        uint64_t imageStart = UINT64_MAX;
+        uint64_t imageEnd = 0;
+        uint64_t virtualStart = UINT64_MAX;
         for (int i = 0; i < numProgHeaders; i++) {
-            const Elf::ElfLoader::LoaderFunction fn = [](
-                const int bufferSize,
-                Elf::Elf64_Addr,
-                Elf::Elf_SegmentFlags)
-                -> void * {
-                EFI_PHYSICAL_ADDRESS buffer = 0;
-                const EFI_STATUS allocStatus = bs->AllocatePages(
-                    AllocateAnyPages,
-                    EfiLoaderData,
-                    (bufferSize + EFI_PAGE_SIZE - 1) / EFI_PAGE_SIZE,
-                    &buffer);
-
-                if (EFI_ERROR(allocStatus)) {
-                    return nullptr;
-                }
+            const Elf::Elf64_ProgHeader &progHeader = progHeaders[i];
+            if (progHeader.SegmentType != Elf::Elf_SegmentType::PT_LOAD || progHeader.SizeInMemory == 0) {
+                continue;
+            }
 
-                return reinterpret_cast<void *>(buffer);
-            };
+            if (progHeader.PhysAddress < imageStart) {
+                imageStart = progHeader.PhysAddress;
+                virtualStart = progHeader.VirtAddress;
+            }
+            if (progHeader.PhysAddress + progHeader.SizeInMemory > imageEnd) {
+                imageEnd = progHeader.PhysAddress + progHeader.SizeInMemory;
+            }
+        }
+
+        if (imageEnd == 0) {
+            Log::print(L"Failed to load kernel: there's nothing to load.\r\n");
+            return INVALID_KERNEL_ELF_INFO;
+        }
+
+        imageStart &= ~static_cast<uint64_t>(EFI_PAGE_SIZE - 1);
+        virtualStart &= ~static_cast<uint64_t>(EFI_PAGE_SIZE - 1);
+        const uint64_t imagePages = (imageEnd - imageStart + EFI_PAGE_SIZE - 1) / EFI_PAGE_SIZE;
 
-            const Elf::ElfLoader::ElfError elfLoadError = elfLoader.loadExecutableProgram(&progHeaders[i], fn);
-            if (
-                elfLoadError != Elf::ElfLoader::ElfError::NoError
-                && elfLoadError != Elf::ElfLoader::ElfError::ElfSectionNotLoadable
-            ) {
-                Log::print(L"Failed to load program header with index {?}! Boot failed\r\n");
+        /* Prefer the physical address the kernel was linked for. If the firmware already uses that memory, any other
+         * place works too: the kernel runs from its virtual addresses, so only the relative layout matters. */
+        EFI_PHYSICAL_ADDRESS imageBase = imageStart;
+        EFI_STATUS status = bs->AllocatePages(AllocateAddress, EfiLoaderData, imagePages, &imageBase);
+        if (EFI_ERROR(status)) {
+            status = bs->AllocatePages(AllocateAnyPages, EfiLoaderData, imagePages, &imageBase);
+            if (EFI_ERROR(status)) {
+                Log::print(L"Failed to load kernel: not enough memory.\r\n");
                 return INVALID_KERNEL_ELF_INFO;
             }
         }
 
-        int numSectionHeaders = 0;
-        const Elf::Elf64_SectionHeader *sectionHeaders = elfLoader.getSectionHeaders(&numSectionHeaders, &err);
-
-        for (int i = 0; i < numSectionHeaders; i++) {
-            const Elf::ElfLoader::LoaderFunction fn = [](
-                const int bufferSize,
-                Elf::Elf64_Addr,
-                Elf::Elf_SegmentFlags)
-                -> void * {
-                EFI_PHYSICAL_ADDRESS buffer = 0;
-                const EFI_STATUS allocStatus = bs->AllocatePages(
-                    AllocateAnyPages,
-                    EfiLoaderData,
-                    (bufferSize + EFI_PAGE_SIZE - 1) / EFI_PAGE_SIZE,
-                    &buffer);
-
-                if (EFI_ERROR(allocStatus)) {
-                    return nullptr;
-                }
+        /* The .bss parts are zeroed by the other cores while this one reads the file parts (which only it can do,
+         * since it needs the boot services). Beyond MAX_RANGES segments, the loader zeroes the rest itself. */
+        ParallelZero::Range zeroRanges[ParallelZero::MAX_RANGES];
+        UINTN zeroRangeCount = 0;
+        for (int i = 0; i < numProgHeaders && zeroRangeCount < ParallelZero::MAX_RANGES; i++) {
+            const Elf::Elf64_ProgHeader &progHeader = progHeaders[i];
+            if (progHeader.SegmentType != Elf::Elf_SegmentType::PT_LOAD
+                || progHeader.SizeInMemory <= progHeader.SizeInFile) {
+                continue;
+            }
 
-                return reinterpret_cast<void *>(buffer);
+            const uint64_t bssAddress = imageBase + (progHeader.PhysAddress - imageStart) + progHeader.SizeInFile;
+            zeroRanges[zeroRangeCount++] = {
+                reinterpret_cast<void *>(bssAddress),
+                progHeader.SizeInMemory - progHeader.SizeInFile,
             };
+        }
+        ParallelZero::start(bs, zeroRanges, zeroRangeCount);
 
-            const Elf::ElfLoader::ElfError elfLoadError = elfLoader.loadNoBitsSection(&sectionHeaders[i], fn);
-            if (
-                elfLoadError != Elf::ElfLoader::ElfError::NoError
-                && elfLoadError != Elf::ElfLoader::ElfError::ElfSectionNotLoadable
-            ) {
-                Log::print(L"Failed to load program header with index {?}! Boot failed\r\n");
-                return INVALID_KERNEL_ELF_INFO;
+        bool isLoaded = true;
+        UINTN queuedRanges = 0;
+        for (int i = 0; i < numProgHeaders; i++) {
+            const Elf::Elf64_ProgHeader &progHeader = progHeaders[i];
+            if (progHeader.SegmentType != Elf::Elf_SegmentType::PT_LOAD || progHeader.SizeInMemory == 0) {
+                continue;
+            }
+
+            //the segments with a .bss were queued in order, until the queue was full
+            bool isQueued = false;
+            if (progHeader.SizeInMemory > progHeader.SizeInFile && queuedRanges < zeroRangeCount) {
+                isQueued = true;
+                queuedRanges++;
+            }
+
+            void *dest = reinterpret_cast<void *>(imageBase + (progHeader.PhysAddress - imageStart));
+            if (elfLoader.loadExecutableProgramAt(&progHeader, dest, !isQueued) != Elf::ElfLoader::ElfError::NoError) {
+                isLoaded = false;
+                break;
             }
         }
 
-        volumeHandle->Close(fileHandle);
-        return INVALID_KERNEL_ELF_INFO;
+        //the other cores write to the image until here, so it can't be freed (or used) before
+        ParallelZero::finish();
+        if (!isLoaded) {
+            Log::print(L"Failed to load kernel: couldn't load a segment.\r\n");
+            bs->FreePages(imageBase, imagePages);
+            return INVALID_KERNEL_ELF_INFO;
+        }
+
+        *error = FileReadSuccess;
+        const KernelElfInfo kernelInfo = {
+            imageBase,
+            virtualStart,
+            imagePages * EFI_PAGE_SIZE,
+            elfLoader.getHeader().EntryPoint,
+        };
+        return kernelInfo;
     }
 
     static EFI_FILE_HANDLE getVolume(EFI_HANDLE handle, bool *isSuccessful) {
@@ -172,17 +277,16 @@ namespace KernelReader {
         return volumeHandle;
     }
 
-    static ReadFileInfo readFile(EFI_FILE_HANDLE fileHandle, KernelLoadError *error) {
+    static uint64_t getFileSize(EFI_FILE_HANDLE fileHandle, KernelLoadError *error) {
         *error = FileReadUnknownError;
         EFI_GUID fileInfoGuid = EFI_FILE_INFO_ID;
 
         constexpr size_t DEFAULT_BUFFER_SIZE = 256U;
+        const BootArena::Mark arenaMark = BootArena::getMark();
         UINTN bufferSize = DEFAULT_BUFFER_SIZE;
-        void *infoBuffer;
-        EFI_STATUS status = bs->AllocatePool(EfiLoaderData, bufferSize, &infoBuffer);
-        if (EFI_ERROR(status)) {
-            bs->FreePool(infoBuffer);
-            return INVALID_READ_FILE_INFO;
+        void *infoBuffer = BootArena::allocate(bufferSize);
+        if (infoBuffer == nullptr) {
+            return 0;
         }
 
         // normally we will loop max. 2 times, as the second call will contain the correct buffer size (given by UEFI),
@@ -190,7 +294,7 @@ namespace KernelReader {
         int retries = 0;
         constexpr int NUM_RETRIES = 5;
         while (retries < NUM_RETRIES) {
-            status = fileHandle->GetInfo(fileHandle, &fileInfoGuid, &bufferSize, infoBuffer);
+            const EFI_STATUS status = fileHandle->GetInfo(fileHandle, &fileInfoGuid, &bufferSize, infoBuffer);
             // if success, break the loop
             if (!EFI_ERROR(status)) {
                 break;
@@ -210,56 +314,52 @@ namespace KernelReader {
                         break;
                 }
 
-                bs->FreePool(infoBuffer);
-                return INVALID_READ_FILE_INFO;
+                BootArena::release(arenaMark);
+                return 0;
             }
 
-            // if the buffer was too small, we try again with the EFI-provided size
-            bs->FreePool(infoBuffer);
-            bs->AllocatePool(EfiLoaderData, bufferSize, &infoBuffer);
+            // if the buffer was too small, we try again with the EFI-provided size, in place of the old buffer
+            BootArena::release(arenaMark);
+            infoBuffer = BootArena::allocate(bufferSize);
+            if (infoBuffer == nullptr) {
+                return 0;
+            }
             retries++;
         }
 
         if (retries >= NUM_RETRIES) {
-            bs->FreePool(infoBuffer);
-            return INVALID_READ_FILE_INFO;
+            BootArena::release(arenaMark);
+            return 0;
         }
 
-        // the max file size is 256 MiB, can't possibly have such a large file
-        constexpr uint64_t MAX_FILE_SIZE = 256LU * 1024LU * 1024LU;
-
-        const auto *fileInfo = static_cast<EFI_FILE_INFO *>(infoBuffer);
-        if (fileInfo->FileSize == 0 || fileInfo->FileSize > MAX_FILE_SIZE) {
-            bs->FreePool(infoBuffer);
-            return INVALID_READ_FILE_INFO;
-        }
+        const uint64_t fileSize = static_cast<EFI_FILE_INFO *>(infoBuffer)->FileSize;
+        BootArena::release(arenaMark);
+        return fileSize;
+    }
 
-        uint64_t fileSize = fileInfo->FileSize;
-        const uint64_t neededPages = (fileSize + (EFI_PAGE_SIZE - 1)) / EFI_PAGE_SIZE;
-        if (neededPages > SIZE_MAX) {
-            bs->FreePool(infoBuffer);
-            return INVALID_READ_FILE_INFO;
+    static bool readAt(
+        EFI_FILE_HANDLE fileHandle,
+        const uint64_t offset,
+        const uint64_t size,
+        void *dest,
+        KernelLoadError *error) {
+        if (size == 0) {
+            return true;
         }
 
-        // free the file info buffer, we don't need it anymore
-        bs->FreePool(infoBuffer);
+        EFI_STATUS status = fileHandle->SetPosition(fileHandle, offset);
+        if (!EFI_ERROR(status)) {
+            UINTN readSize = size;
+            status = fileHandle->Read(fileHandle, &readSize, dest);
 
-        EFI_PHYSICAL_ADDRESS fileBufferPhysAddress;
-        bs->AllocatePages(
-            AllocateAnyPages,
-            EfiLoaderData,
-            neededPages,
-            &fileBufferPhysAddress);
+            //a short read means the file is shorter than the headers claim
+            if (!EFI_ERROR(status) && readSize != size) {
+                status = EFI_END_OF_FILE;
+            }
+        }
 
-        status = fileHandle->Read(fileHandle, &fileSize, reinterpret_cast<void *>(fileBufferPhysAddress));
         if (!EFI_ERROR(status)) {
-            // success! return the necessary info
-            const ReadFileInfo readFileInfo = {
-                reinterpret_cast<void *>(fileBufferPhysAddress),
-                fileSize,
-            };
-
-            return readFileInfo;
+            return true;
         }
 
         switch (status) {
@@ -274,7 +374,11 @@ namespace KernelReader {
                 break;
         }
 
-        bs->FreePool(infoBuffer);
-        return INVALID_READ_FILE_INFO;
+        return false;
+    }
+
+    static bool readKernelBytes(void *context, const uint64_t offset, const uint64_t size, void *dest) {
+        const auto *readContext = static_cast<KernelReadContext *>(context);
+        return readAt(readContext->FileHandle, offset, size, dest, readContext->Error);
     }
 }
@@ -9,6 +9,14 @@ namespace KernelReader {
          * The physical address where the kernel executable is loaded.
          */
         uint64_t PhysicalAddress;
+        /**
+         * The virtual address the kernel executable is linked for (the one matching PhysicalAddress).
+         */
+        uint64_t VirtualAddress;
+        /**
+         * The size of the loaded image in bytes, a multiple of EFI_PAGE_SIZE.
+         */
+        uint64_t Size;
         /**
          * The virtual address of the entry point (kernel_main).
          */
@@ -18,6 +26,8 @@ namespace KernelReader {
     static constexpr KernelElfInfo INVALID_KERNEL_ELF_INFO = {
         0,
         0,
+        0,
+        0,
     };
 
     typedef enum KernelLoadError {
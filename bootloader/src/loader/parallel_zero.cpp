@@ -0,0 +1,118 @@
+#include <c_husky/mem_routines.h>
+
+#include "src/mp_services.h"
+
+#include "parallel_zero.h"
+
+namespace ParallelZero {
+    static EFI_BOOT_SERVICES *bs = nullptr;
+    static EFI_MP_SERVICES_PROTOCOL *mpServices = nullptr;
+
+    static Range jobRanges[MAX_RANGES];
+    static UINTN jobRangeCount = 0;
+    /**
+     * The index of the first chunk of every range, and the total number of chunks at the end.
+     */
+    static UINTN firstChunks[MAX_RANGES + 1];
+    static UINTN nextChunk = 0;
+
+    /**
+     * Signaled by the firmware when every application processor is done; nullptr if they weren't started.
+     */
+    static EFI_EVENT doneEvent = nullptr;
+    /**
+     * Set when the firmware refuses to start the application processors in the background (it's allowed to after
+     * ReadyToBoot): finish then runs them in blocking mode instead.
+     */
+    static bool useBlockingMode = false;
+
+    /**
+     * Runs on every core: takes chunks until there's none left.
+     */
+    static VOID EFIAPI zeroChunks(VOID *) {
+        const UINTN chunkCount = firstChunks[jobRangeCount];
+        UINTN rangeIdx = 0;
+        while (true) {
+            const UINTN chunk = __atomic_fetch_add(&nextChunk, 1, __ATOMIC_RELAXED);
+            if (chunk >= chunkCount) {
+                return;
+            }
+
+            //the chunks are taken in order, so the range only ever moves forward
+            while (chunk >= firstChunks[rangeIdx + 1]) {
+                rangeIdx++;
+            }
+
+            const Range &range = jobRanges[rangeIdx];
+            const UINTN offset = (chunk - firstChunks[rangeIdx]) * CHUNK_SIZE;
+            const UINTN size = range.size - offset < CHUNK_SIZE ? range.size - offset : CHUNK_SIZE;
+            CHusky::Mem::fill(static_cast<UINT8 *>(range.start) + offset, 0, size);
+        }
+    }
+
+    bool start(EFI_BOOT_SERVICES *bootServices, const Range *ranges, const UINTN count) {
+        if (count > MAX_RANGES) {
+            return false;
+        }
+
+        bs = bootServices;
+        jobRangeCount = count;
+        nextChunk = 0;
+        doneEvent = nullptr;
+        useBlockingMode = false;
+
+        UINTN totalSize = 0;
+        firstChunks[0] = 0;
+        for (UINTN i = 0; i < count; i++) {
+            jobRanges[i] = ranges[i];
+            firstChunks[i + 1] = firstChunks[i] + (ranges[i].size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+            totalSize += ranges[i].size;
+        }
+
+        if (totalSize < MIN_PARALLEL_SIZE) {
+            return true;
+        }
+
+        if (mpServices == nullptr) {
+            EFI_GUID mpServicesGuid = EFI_MP_SERVICES_PROTOCOL_GUID;
+            if (EFI_ERROR(bs->LocateProtocol(&mpServicesGuid, nullptr, reinterpret_cast<void **>(&mpServices)))) {
+                mpServices = nullptr;
+                return true;
+            }
+        }
+
+        if (EFI_ERROR(bs->CreateEvent(0, 0, nullptr, nullptr, &doneEvent))) {
+            doneEvent = nullptr;
+            return true;
+        }
+
+        const EFI_STATUS status = mpServices->StartupAllAPs(mpServices, zeroChunks, FALSE, doneEvent, 0, nullptr,
+                                                            nullptr);
+        if (EFI_ERROR(status)) {
+            //EFI_NOT_STARTED means there's no enabled application processor at all
+            bs->CloseEvent(doneEvent);
+            doneEvent = nullptr;
+            useBlockingMode = status == EFI_UNSUPPORTED;
+        }
+        return true;
+    }
+
+    void finish() {
+        if (doneEvent != nullptr) {
+            zeroChunks(nullptr);
+
+            UINTN index;
+            bs->WaitForEvent(1, &doneEvent, &index);
+            bs->CloseEvent(doneEvent);
+            doneEvent = nullptr;
+        } else if (useBlockingMode) {
+            //this core waits for the others, and only takes the chunks they left (all of them, if they failed)
+            mpServices->StartupAllAPs(mpServices, zeroChunks, FALSE, nullptr, 0, nullptr, nullptr);
+            zeroChunks(nullptr);
+        } else {
+            zeroChunks(nullptr);
+        }
+
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    }
+} //namespace ParallelZero
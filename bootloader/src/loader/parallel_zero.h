@@ -0,0 +1,41 @@
+#ifndef BOOTLOADER_PARALLEL_ZERO_H
+#define BOOTLOADER_PARALLEL_ZERO_H
+
+#include <efi.h>
+
+/**
+ * Zeroes memory on every core through EFI_MP_SERVICES_PROTOCOL, while the boot processor does something else (the
+ * application processors can't call the boot services, so they can't read files, but they can fill memory). The work
+ * is split in chunks that every core takes from a shared counter, so a slow core doesn't hold the others back.
+ */
+namespace ParallelZero {
+    struct Range {
+        void *start;
+        UINTN size;
+    };
+
+    constexpr UINTN MAX_RANGES = 16;
+
+    constexpr UINTN CHUNK_SIZE = 256 * 1024;
+
+    /**
+     * Waking the application processors takes tens of microseconds, about the time it takes to zero this much on a
+     * single core.
+     */
+    constexpr UINTN MIN_PARALLEL_SIZE = 1024 * 1024;
+
+    /**
+     * Starts zeroing the ranges on the application processors and returns right away; the caller must not touch the
+     * ranges until finish. Small jobs, or firmwares without MP services, are left to finish, on this core.
+     * @return False if there are more than MAX_RANGES ranges; nothing is zeroed then (and finish must not be called).
+     */
+    bool start(EFI_BOOT_SERVICES *bootServices, const Range *ranges, UINTN count);
+
+    /**
+     * Zeroes what's left on this core, then waits for the application processors. Every range is zero when it
+     * returns.
+     */
+    void finish();
+} //namespace ParallelZero
+
+#endif //BOOTLOADER_PARALLEL_ZERO_H
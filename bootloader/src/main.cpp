@@ -1,8 +1,14 @@
 #include <efi.h>
+#include <c_husky/mem_routines.h>
+#include <serial_log/serial_log.h>
+#include <trace/trace.h>
 
 #include "boot_params.h"
+#include "boot_arena.h"
 #include "loader/kernel_reader.h"
 #include "gop.h"
+#include "handoff.h"
+#include "platform_info.h"
 
 #include "main.h"
 
@@ -15,12 +21,71 @@
  */
 static MemoryMap_t getMemoryMap(bool *isSuccessful);
 
+/**
+ * Creates the boot parameters in the arena, with everything but the memory map (see fillMemoryRegions).
+ * @return The boot parameters, or nullptr if the arena is full.
+ */
+static BootParams_t *createBootParams(
+    const FramebufferInfo_t &fbInfo,
+    const KernelReader::KernelElfInfo &kernelInfo);
+
+/**
+ * Puts the normalized memory map into the boot parameters. The regions come from the arena, so this works after
+ * ExitBootServices too.
+ * @return False if the map is invalid or the arena is full.
+ */
+static bool fillMemoryRegions(BootParams_t *bootParams, const MemoryMap_t &memMap);
+
+/**
+ * Takes the final memory map and exits the boot services. After a success, the firmware can't be used anymore, not
+ * even to print.
+ * @param memMap [OUT] The memory map the boot services were exited with.
+ * @return True on success. On failure, the boot services may be partly shut down already.
+ */
+static bool exitBootServices(EFI_HANDLE handle, MemoryMap_t *memMap);
+
+/**
+ * Allocates the trace buffer and starts recording into it. Tracing is only a diagnostic, so nothing fails without it.
+ */
+static void startTracing(EFI_BOOT_SERVICES *bootServices);
+
 static EFI_SYSTEM_TABLE *systemTable = nullptr;
 static EFI_SIMPLE_TEXT_OUT_PROTOCOL *cout = nullptr;
 
+/**
+ * 16 KiB: at 115200 baud, that's about 1.4 s of output the UART hasn't caught up with.
+ */
+constexpr UINTN LOG_RING_SIZE = 16 * 1024;
+alignas(64) static uint64_t logStorage[LOG_RING_SIZE / sizeof(uint64_t)];
+static constinit SerialLog::LogRing logRing(logStorage, LOG_RING_SIZE);
+
+/**
+ * Copies a message to the serial log. The messages of the bootloader are all ASCII, so the characters are just
+ * narrowed.
+ * @return False if (part of) the message was dropped.
+ */
+static bool printToSerial(const CHAR16 *str) {
+    constexpr UINTN CHUNK_SIZE = 128;
+    char chunk[CHUNK_SIZE];
+    bool isLogged = true;
+
+    while (*str != 0) {
+        UINTN length = 0;
+        while (length < CHUNK_SIZE && str[length] != 0) {
+            chunk[length] = static_cast<char>(str[length] < 0x80 ? str[length] : '?');
+            length++;
+        }
+        isLogged = SerialLog::write(chunk, length) && isLogged;
+        str += length;
+    }
+    return isLogged;
+}
+
 EFI_STATUS Log::print(CHAR16 *str) {
+    const bool isLogged = printToSerial(str);
+    //after ExitBootServices, the serial port is the only output left
     if (cout == nullptr) {
-        return EFI_DEVICE_ERROR;
+        return isLogged ? EFI_SUCCESS : EFI_DEVICE_ERROR;
     }
 
     return cout->OutputString(cout, str);
@@ -28,6 +93,7 @@ EFI_STATUS Log::print(CHAR16 *str) {
 
 [[noreturn]] void panic() {
     Log::print(L"Boot failed. You can turn off the device now.\r\n");
+    SerialLog::flush();
 
     while (true) {
         UINTN x;
@@ -36,11 +102,23 @@ EFI_STATUS Log::print(CHAR16 *str) {
 }
 
 extern "C" EFI_STATUS efi_main(const EFI_HANDLE handle, EFI_SYSTEM_TABLE *st) {
+    //the firmware owns the FPU/vector state, so stick to the general-purpose register routines
+    CHusky::Mem::resolveRoutines(false);
+
     systemTable = st;
     cout = systemTable->ConOut;
+    SerialLog::init(&logRing, SerialLog::Uart16550(SerialLog::COM1_PORT));
+
+    startTracing(st->BootServices);
+    TRACE_BEGIN("efi_main");
 
     Log::print(L"Start booting ChihuahuaOS.\r\n");
 
+    if (!BootArena::init(st->BootServices, BootArena::DEFAULT_PAGE_COUNT)) {
+        Log::print(L"Failed to allocate memory for the bootloader.\r\n");
+        panic();
+    }
+
     EFI_GUID gopGuid = EFI_GRAPHICS_OUTPUT_PROTOCOL_GUID;
     EFI_GRAPHICS_OUTPUT_PROTOCOL *gop;
 
@@ -54,7 +132,10 @@ extern "C" EFI_STATUS efi_main(const EFI_HANDLE handle, EFI_SYSTEM_TABLE *st) {
     FramebufferInfo_t fbInfo = INVALID_FRAMEBUFFER_INFO;
     constexpr int PREFERRED_WIDTH = 1920;
     constexpr int PREFERRED_HEIGHT = 1080;
-    if (Gop::setAppropriateFramebuffer(gop, PREFERRED_WIDTH, PREFERRED_HEIGHT, &fbInfo)) {
+    TRACE_BEGIN("set_graphics_mode");
+    const bool isModeSet = Gop::setAppropriateFramebuffer(gop, PREFERRED_WIDTH, PREFERRED_HEIGHT, &fbInfo);
+    TRACE_END("set_graphics_mode");
+    if (isModeSet) {
         //everything printed until now will be lost, but the cursor position won't be reset, so we reset it now 
         cout->ClearScreen(cout);
         cout->SetCursorPosition(cout, 0, 0);
@@ -66,25 +147,89 @@ extern "C" EFI_STATUS efi_main(const EFI_HANDLE handle, EFI_SYSTEM_TABLE *st) {
 
 
     KernelReader::KernelLoadError error;
-    KernelReader::readKernel(handle, st, &error);
+    TRACE_BEGIN("read_kernel");
+    const KernelReader::KernelElfInfo kernelInfo = KernelReader::readKernel(handle, st, &error);
+    TRACE_END("read_kernel");
+    if (error != KernelReader::FileReadSuccess) {
+        Log::print(L"Failed to read the kernel.\r\n");
+        panic();
+    }
 
+    TRACE_BEGIN("boot_params");
+    BootParams_t *bootParams = createBootParams(fbInfo, kernelInfo);
+    TRACE_END("boot_params");
+    if (bootParams == nullptr) {
+        Log::print(L"Not enough memory for the boot parameters.\r\n");
+        panic();
+    }
 
-    bool isSuccessful;
-    getMemoryMap(&isSuccessful);
-    if (isSuccessful) {
-        Log::print(L"Memory map retrieved.\r\n");
+    if (!Handoff::prepare(st->BootServices)) {
+        Log::print(L"Not enough memory for the page tables.\r\n");
+        panic();
     }
-    else {
-        Log::print(L"Memory map failed.\r\n");
+    Handoff::fillBootParams(bootParams);
+
+    Log::print(L"Starting the kernel.\r\n");
+    MemoryMap_t memMap;
+    TRACE_BEGIN("exit_boot_services");
+    const bool isExited = exitBootServices(handle, &memMap);
+    TRACE_END("exit_boot_services");
+    if (!isExited) {
+        Log::print(L"Failed to exit the boot services.\r\n");
+        panic();
     }
 
-    UINTN x;
-    status = systemTable->BootServices->WaitForEvent(1, &systemTable->ConIn->WaitForKey, &x);
-    if (EFI_ERROR(status)) {
-        return status;
+    //from here on, there's no firmware to report errors to
+    cout = nullptr;
+    TRACE_BEGIN("memory_regions");
+    if (!fillMemoryRegions(bootParams, memMap)) {
+        Handoff::halt();
     }
+    TRACE_END("memory_regions");
 
-    return 0;
+    TRACE_END("efi_main");
+    Handoff::enterKernel(bootParams);
+}
+
+static void startTracing(EFI_BOOT_SERVICES *bootServices) {
+    constexpr UINTN TRACE_BUFFER_PAGES = (sizeof(Trace::Buffer) + EFI_PAGE_SIZE - 1) / EFI_PAGE_SIZE;
+    EFI_PHYSICAL_ADDRESS buffer = 0;
+    if (EFI_ERROR(bootServices->AllocatePages(AllocateAnyPages, EfiLoaderData, TRACE_BUFFER_PAGES, &buffer))) {
+        return;
+    }
+
+    //the TSC frequency is only known once the boot parameters are created
+    auto *traceBuffer = reinterpret_cast<Trace::Buffer *>(buffer);
+    Trace::initBuffer(traceBuffer, 0);
+    Trace::setBuffer(traceBuffer);
+}
+
+static bool exitBootServices(const EFI_HANDLE handle, MemoryMap_t *memMap) {
+    /* The map key changes with every change to the map. Nothing in between allocates from the firmware (the map buffer
+     * comes from the arena), so normally the first try works; it only fails if the firmware changed the map itself
+     * (from a timer event, for instance), and then the map is taken again into the same buffer. */
+    const BootArena::Mark arenaMark = BootArena::getMark();
+    constexpr int NUM_RETRIES = 5;
+    for (int retries = 0; retries < NUM_RETRIES; retries++) {
+        bool isSuccessful;
+        *memMap = getMemoryMap(&isSuccessful);
+        if (!isSuccessful) {
+            return false;
+        }
+
+        const EFI_STATUS status = systemTable->BootServices->ExitBootServices(handle, memMap->mem_map_key);
+        if (!EFI_ERROR(status)) {
+            return true;
+        }
+
+        //anything but an outdated key is a real error
+        if (status != EFI_INVALID_PARAMETER) {
+            return false;
+        }
+        BootArena::release(arenaMark);
+    }
+
+    return false;
 }
 
 static MemoryMap_t getMemoryMap(bool *isSuccessful) {
@@ -94,81 +239,117 @@ static MemoryMap_t getMemoryMap(bool *isSuccessful) {
         return INVALID_MEMORY_MAP;
     }
 
-    EFI_PHYSICAL_ADDRESS memMapPtr = 0;
-    EFI_STATUS status = systemTable->BootServices->AllocatePages(
-        AllocateAnyPages,
-        EfiLoaderData,
-        1,
-        &memMapPtr);
-    if (EFI_ERROR(status) || memMapPtr == 0) {
-        return INVALID_MEMORY_MAP;
-    }
-
-    UINTN mapSize = PAGE_SIZE;
+    //the first call only gives the size of the map (and of a descriptor)
+    UINTN mapSize = 0;
     UINTN mapKey = 0;
     UINTN descriptorSize = 0;
     UINT32 descriptorVersion = 0;
-
-    status = systemTable->BootServices->GetMemoryMap(
+    EFI_STATUS status = systemTable->BootServices->GetMemoryMap(
         &mapSize,
-        reinterpret_cast<EFI_MEMORY_DESCRIPTOR *>(memMapPtr),
+        nullptr,
         &mapKey,
         &descriptorSize,
         &descriptorVersion);
-
-    if (!EFI_ERROR(status)) {
-        MemoryMap_t mem_map;
-        mem_map.mem_map_size = mapSize;
-        mem_map.mem_map_key = mapKey;
-        mem_map.entries = reinterpret_cast<MemoryMapEntry_t *>(memMapPtr);
-        mem_map.entry_size = descriptorSize;
-        mem_map.entry_version = descriptorVersion;
-
-        *isSuccessful = true;
-        return mem_map;
-    }
-
-    //if we get an error, and it's not from insufficient memory, then we abort
     if (status != EFI_BUFFER_TOO_SMALL) {
         return INVALID_MEMORY_MAP;
     }
 
-    //we free the one page that we allocated, so we can allocate the correct size
-    status = systemTable->BootServices->FreePages(memMapPtr, 1);
-    if (EFI_ERROR(status)) {
-        return INVALID_MEMORY_MAP;
+    /* The buffer comes from the arena, so allocating it doesn't change the map it's about to hold (AllocatePages could
+     * split a free region and add an entry). A few extra entries still cover the firmware's own allocations between
+     * the two calls; if that's not enough, the buffer is given back and taken again with the new size. */
+    constexpr UINTN EXTRA_ENTRIES = 8;
+    const BootArena::Mark arenaMark = BootArena::getMark();
+    int retries = 0;
+    constexpr int NUM_RETRIES = 5;
+    while (retries < NUM_RETRIES) {
+        mapSize += EXTRA_ENTRIES * descriptorSize;
+        void *entries = BootArena::allocate(mapSize, alignof(EFI_MEMORY_DESCRIPTOR));
+        if (entries == nullptr) {
+            return INVALID_MEMORY_MAP;
+        }
+
+        status = systemTable->BootServices->GetMemoryMap(
+            &mapSize,
+            static_cast<EFI_MEMORY_DESCRIPTOR *>(entries),
+            &mapKey,
+            &descriptorSize,
+            &descriptorVersion);
+        if (!EFI_ERROR(status)) {
+            MemoryMap_t memMap;
+            memMap.mem_map_size = mapSize;
+            memMap.mem_map_key = mapKey;
+            memMap.entries = static_cast<MemoryMapEntry_t *>(entries);
+            memMap.entry_size = descriptorSize;
+            memMap.entry_version = descriptorVersion;
+
+            *isSuccessful = true;
+            return memMap;
+        }
+
+        //if we get an error, and it's not from insufficient memory, then we abort
+        BootArena::release(arenaMark);
+        if (status != EFI_BUFFER_TOO_SMALL) {
+            return INVALID_MEMORY_MAP;
+        }
+        retries++;
     }
 
-    status = systemTable->BootServices->AllocatePages(
-        AllocateAnyPages,
-        EfiLoaderData,
-        (mapSize + PAGE_SIZE - 1) / PAGE_SIZE,
-        &memMapPtr);
+    return INVALID_MEMORY_MAP;
+}
 
-    if (EFI_ERROR(status)) {
-        return INVALID_MEMORY_MAP;
+static BootParams_t *createBootParams(
+    const FramebufferInfo_t &fbInfo,
+    const KernelReader::KernelElfInfo &kernelInfo) {
+    auto *bootParams = static_cast<BootParams_t *>(BootArena::allocate(sizeof(BootParams_t), alignof(BootParams_t)));
+    if (bootParams == nullptr) {
+        return nullptr;
     }
 
-    //try again
-    status = systemTable->BootServices->GetMemoryMap(
-        &mapSize,
-        reinterpret_cast<EFI_MEMORY_DESCRIPTOR *>(memMapPtr),
-        &mapKey,
-        &descriptorSize,
-        &descriptorVersion);
+    *bootParams = BootParams_t {};
+    bootParams->magic = BOOT_PARAMS_MAGIC;
+    bootParams->version = BOOT_PARAMS_VERSION;
+    bootParams->size = sizeof(BootParams_t);
+    bootParams->boot_arena = BootArena::getRegion();
+    bootParams->framebuffer = fbInfo;
+    bootParams->kernel = KernelLayout_t {
+        kernelInfo.PhysicalAddress,
+        kernelInfo.VirtualAddress,
+        kernelInfo.Size,
+        kernelInfo.EntryPointVirtualAddress,
+    };
+    bootParams->acpi_rsdp = PlatformInfo::findAcpiRsdp(systemTable, &bootParams->acpi_revision);
+    bootParams->tsc_frequency = PlatformInfo::getTscFrequency(systemTable->BootServices);
+    bootParams->trace_buffer = Trace::getBuffer();
+    if (bootParams->trace_buffer != nullptr) {
+        bootParams->trace_buffer->tscFrequency = bootParams->tsc_frequency;
+    }
+    bootParams->local_apic = PlatformInfo::getLocalApicAddress();
+    //set once Handoff::prepare took the pages
+    bootParams->ap_trampoline = 0;
+    bootParams->kernel_stack_top = 0;
+    return bootParams;
+}
 
-    //if it's still an error, abort
-    if (EFI_ERROR(status)) {
-        return INVALID_MEMORY_MAP;
+static bool fillMemoryRegions(BootParams_t *bootParams, const MemoryMap_t &memMap) {
+    if (memMap.entry_size == 0) {
+        return false;
     }
 
-    MemoryMap_t memMap;
-    memMap.mem_map_size = mapSize;
-    memMap.mem_map_key = mapKey;
-    memMap.entries = reinterpret_cast<MemoryMapEntry_t *>(memMapPtr);
-    memMap.entry_size = descriptorSize;
-    memMap.entry_version = descriptorVersion;
-
-    *isSuccessful = true;
-    return memMap;
+    //normalizing may split a region in two, which needs spare entries
+    const size_t capacity = memMap.mem_map_size / memMap.entry_size * 2;
+    auto *regions = static_cast<FrameAllocator::MemoryRegion *>(BootArena::allocate(
+        capacity * sizeof(FrameAllocator::MemoryRegion),
+        alignof(FrameAllocator::MemoryRegion)));
+    if (regions == nullptr) {
+        return false;
+    }
+
+    const size_t regionCount = FrameAllocator::collectRegions(memMap, regions, capacity, false);
+    if (regionCount == 0) {
+        return false;
+    }
+
+    bootParams->memory_regions = regions;
+    bootParams->memory_region_count = regionCount;
+    return true;
 }
@@ -0,0 +1,95 @@
+#include "platform_info.h"
+
+namespace PlatformInfo {
+    constexpr uint32_t LEAF_MAX_BASIC = 0x0;
+    //CPUID.15H: TSC/core crystal clock ratio
+    constexpr uint32_t LEAF_TSC_CRYSTAL = 0x15;
+    constexpr uint32_t LEAF_FEATURES = 0x1;
+    constexpr uint32_t FEATURE_EDX_APIC = 1 << 9;
+
+    constexpr uint32_t MSR_APIC_BASE = 0x1B;
+    //bits 12 to 51
+    constexpr uint64_t APIC_BASE_ADDRESS_MASK = 0x000FFFFFFFFFF000;
+
+    static void cpuid(const uint32_t leaf, const uint32_t subLeaf, uint32_t *regs) {
+        asm volatile(
+            "cpuid"
+            : "=a"(regs[0]), "=b"(regs[1]), "=c"(regs[2]), "=d"(regs[3])
+            : "a"(leaf), "c"(subLeaf));
+    }
+
+    static uint64_t readMsr(const uint32_t msr) {
+        uint32_t low;
+        uint32_t high;
+        asm volatile("rdmsr" : "=a"(low), "=d"(high) : "c"(msr));
+        return static_cast<uint64_t>(high) << 32 | low;
+    }
+
+    static uint64_t readTsc() {
+        uint32_t low;
+        uint32_t high;
+        asm volatile("lfence; rdtsc; lfence" : "=a"(low), "=d"(high) : : "memory");
+        return static_cast<uint64_t>(high) << 32 | low;
+    }
+
+    static bool isSameGuid(const EFI_GUID &first, const EFI_GUID &second) {
+        if (first.Data1 != second.Data1 || first.Data2 != second.Data2 || first.Data3 != second.Data3) {
+            return false;
+        }
+        for (int i = 0; i < 8; i++) {
+            if (first.Data4[i] != second.Data4[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    uint64_t findAcpiRsdp(const EFI_SYSTEM_TABLE *systemTable, uint32_t *revision) {
+        const EFI_GUID acpi20Guid = ACPI_20_TABLE_GUID;
+        const EFI_GUID acpi10Guid = ACPI_TABLE_GUID;
+
+        uint64_t acpi10Rsdp = 0;
+        for (UINTN i = 0; i < systemTable->NumberOfTableEntries; i++) {
+            const EFI_CONFIGURATION_TABLE &table = systemTable->ConfigurationTable[i];
+            if (isSameGuid(table.VendorGuid, acpi20Guid)) {
+                *revision = 2;
+                return reinterpret_cast<uint64_t>(table.VendorTable);
+            }
+            if (isSameGuid(table.VendorGuid, acpi10Guid)) {
+                acpi10Rsdp = reinterpret_cast<uint64_t>(table.VendorTable);
+            }
+        }
+
+        *revision = 0;
+        return acpi10Rsdp;
+    }
+
+    uint64_t getTscFrequency(EFI_BOOT_SERVICES *bootServices) {
+        uint32_t regs[4];
+        cpuid(LEAF_MAX_BASIC, 0, regs);
+        if (regs[0] >= LEAF_TSC_CRYSTAL) {
+            //EAX/EBX is the TSC/crystal ratio, ECX the crystal frequency (0 when not enumerated)
+            cpuid(LEAF_TSC_CRYSTAL, 0, regs);
+            if (regs[0] != 0 && regs[1] != 0 && regs[2] != 0) {
+                return static_cast<uint64_t>(regs[2]) * regs[1] / regs[0];
+            }
+        }
+
+        const uint64_t start = readTsc();
+        if (EFI_ERROR(bootServices->Stall(CALIBRATION_TIME_US))) {
+            return 0;
+        }
+        const uint64_t elapsed = readTsc() - start;
+        return elapsed * (1000000 / CALIBRATION_TIME_US);
+    }
+
+    uint64_t getLocalApicAddress() {
+        uint32_t regs[4];
+        cpuid(LEAF_FEATURES, 0, regs);
+        if ((regs[3] & FEATURE_EDX_APIC) == 0) {
+            return 0;
+        }
+
+        return readMsr(MSR_APIC_BASE) & APIC_BASE_ADDRESS_MASK;
+    }
+} //namespace PlatformInfo
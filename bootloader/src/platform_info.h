@@ -0,0 +1,31 @@
+#ifndef BOOTLOADER_PLATFORM_INFO_H
+#define BOOTLOADER_PLATFORM_INFO_H
+
+#include <efi.h>
+
+/**
+ * What the kernel needs to know about the machine and can only be found cheaply while the firmware is still around.
+ */
+namespace PlatformInfo {
+    /**
+     * Looks for the ACPI RSDP in the EFI configuration table, preferring the ACPI 2.0+ one.
+     * @param revision Set to 2 for an ACPI 2.0+ RSDP, 0 for an ACPI 1.0 one.
+     * @return The physical address of the RSDP, or 0 if there's none.
+     */
+    uint64_t findAcpiRsdp(const EFI_SYSTEM_TABLE *systemTable, uint32_t *revision);
+
+    /**
+     * Returns the frequency of the TSC in Hz: from CPUID leaf 0x15 when the CPU reports it, otherwise measured
+     * against the firmware's Stall (which takes CALIBRATION_TIME_US).
+     */
+    uint64_t getTscFrequency(EFI_BOOT_SERVICES *bootServices);
+
+    /**
+     * Returns the physical address of the local APIC's registers (from IA32_APIC_BASE), or 0 if the CPU has no APIC.
+     */
+    uint64_t getLocalApicAddress();
+
+    constexpr UINTN CALIBRATION_TIME_US = 20000;
+} //namespace PlatformInfo
+
+#endif //BOOTLOADER_PLATFORM_INFO_H
@@ -0,0 +1,136 @@
+#include "acpi.h"
+
+namespace Acpi {
+    struct [[gnu::packed]] Madt {
+        SdtHeader header;
+        std::uint32_t localApicAddress;
+        std::uint32_t flags;
+    };
+
+    struct [[gnu::packed]] MadtEntryHeader {
+        std::uint8_t type;
+        std::uint8_t length;
+    };
+
+    struct [[gnu::packed]] MadtLocalApic {
+        MadtEntryHeader header;
+        std::uint8_t processorId;
+        std::uint8_t apicId;
+        std::uint32_t flags;
+    };
+
+    struct [[gnu::packed]] MadtLocalApicOverride {
+        MadtEntryHeader header;
+        std::uint16_t reserved;
+        std::uint64_t address;
+    };
+
+    struct [[gnu::packed]] MadtLocalX2Apic {
+        MadtEntryHeader header;
+        std::uint16_t reserved;
+        std::uint32_t x2ApicId;
+        std::uint32_t flags;
+        std::uint32_t processorUid;
+    };
+
+    constexpr std::uint8_t MADT_LOCAL_APIC = 0;
+    constexpr std::uint8_t MADT_LOCAL_APIC_OVERRIDE = 5;
+    constexpr std::uint8_t MADT_LOCAL_X2APIC = 9;
+    constexpr std::uint32_t MADT_CPU_ENABLED = 1 << 0;
+
+    /**
+     * The RSDP of ACPI 1.0 ends before the length field.
+     */
+    constexpr std::size_t RSDP_V1_SIZE = 20;
+
+    static bool isChecksumValid(const void *data, const std::size_t size) {
+        const auto *bytes = static_cast<const std::uint8_t *>(data);
+        std::uint8_t sum = 0;
+        for (std::size_t i = 0; i < size; i++) {
+            sum += bytes[i];
+        }
+        return sum == 0;
+    }
+
+    static bool hasSignature(const SdtHeader *table, const char *signature) {
+        for (int i = 0; i < 4; i++) {
+            if (table->signature[i] != signature[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    const SdtHeader *findTable(const std::uint64_t rsdpAddress, const std::uint32_t revision, const char *signature) {
+        const auto *rsdp = reinterpret_cast<const Rsdp *>(rsdpAddress);
+        if (rsdp == nullptr || !isChecksumValid(rsdp, RSDP_V1_SIZE)) {
+            return nullptr;
+        }
+
+        //the XSDT has 8-byte entries, the RSDT 4-byte ones; either way they're only 4-byte aligned
+        const bool useXsdt = revision >= 2 && rsdp->xsdtAddress != 0;
+        const auto *root = reinterpret_cast<const SdtHeader *>(useXsdt ? rsdp->xsdtAddress : rsdp->rsdtAddress);
+        if (root == nullptr || !isChecksumValid(root, root->length)) {
+            return nullptr;
+        }
+
+        const std::size_t entrySize = useXsdt ? sizeof(std::uint64_t) : sizeof(std::uint32_t);
+        const std::size_t entryCount = (root->length - sizeof(SdtHeader)) / entrySize;
+        const auto *entries = reinterpret_cast<const std::uint8_t *>(root + 1);
+        for (std::size_t i = 0; i < entryCount; i++) {
+            std::uint64_t address = 0;
+            for (std::size_t byte = 0; byte < entrySize; byte++) {
+                address |= static_cast<std::uint64_t>(entries[i * entrySize + byte]) << (byte * 8);
+            }
+
+            const auto *table = reinterpret_cast<const SdtHeader *>(address);
+            if (table != nullptr && hasSignature(table, signature) && isChecksumValid(table, table->length)) {
+                return table;
+            }
+        }
+        return nullptr;
+    }
+
+    std::size_t findCpus(const std::uint64_t rsdpAddress, const std::uint32_t revision, std::uint32_t *apicIds,
+                         const std::size_t capacity, std::uint64_t *localApicAddress) {
+        const auto *madt = reinterpret_cast<const Madt *>(findTable(rsdpAddress, revision, "APIC"));
+        if (madt == nullptr) {
+            return 0;
+        }
+
+        *localApicAddress = madt->localApicAddress;
+        std::size_t count = 0;
+        const auto *entry = reinterpret_cast<const std::uint8_t *>(madt + 1);
+        const auto *end = reinterpret_cast<const std::uint8_t *>(madt) + madt->header.length;
+        while (entry + sizeof(MadtEntryHeader) <= end) {
+            const auto *header = reinterpret_cast<const MadtEntryHeader *>(entry);
+            //a zero length would loop forever, a longer one than what's left would read past the table
+            if (header->length < sizeof(MadtEntryHeader) || entry + header->length > end) {
+                break;
+            }
+
+            if (header->type == MADT_LOCAL_APIC && header->length >= sizeof(MadtLocalApic)) {
+                const auto *localApic = reinterpret_cast<const MadtLocalApic *>(entry);
+                if ((localApic->flags & MADT_CPU_ENABLED) != 0) {
+                    if (count < capacity) {
+                        apicIds[count] = localApic->apicId;
+                    }
+                    count++;
+                }
+            } else if (header->type == MADT_LOCAL_X2APIC && header->length >= sizeof(MadtLocalX2Apic)) {
+                const auto *localX2Apic = reinterpret_cast<const MadtLocalX2Apic *>(entry);
+                if ((localX2Apic->flags & MADT_CPU_ENABLED) != 0) {
+                    if (count < capacity) {
+                        apicIds[count] = localX2Apic->x2ApicId;
+                    }
+                    count++;
+                }
+            } else if (header->type == MADT_LOCAL_APIC_OVERRIDE && header->length >= sizeof(MadtLocalApicOverride)) {
+                *localApicAddress = reinterpret_cast<const MadtLocalApicOverride *>(entry)->address;
+            }
+
+            entry += header->length;
+        }
+        return count;
+    }
+} //namespace Acpi
@@ -0,0 +1,61 @@
+#ifndef KERNEL_ARCH_X86_64_ACPI_H
+#define KERNEL_ARCH_X86_64_ACPI_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Reading the ACPI tables the firmware left in memory (identity-mapped by the bootloader, with the rest of the ACPI
+ * regions).
+ */
+namespace Acpi {
+    struct [[gnu::packed]] Rsdp {
+        char signature[8];
+        std::uint8_t checksum;
+        char oemId[6];
+        std::uint8_t revision;
+        std::uint32_t rsdtAddress;
+        //the rest is only there from ACPI 2.0
+        std::uint32_t length;
+        std::uint64_t xsdtAddress;
+        std::uint8_t extendedChecksum;
+        std::uint8_t reserved[3];
+    };
+
+    /**
+     * The header every system description table starts with.
+     */
+    struct [[gnu::packed]] SdtHeader {
+        char signature[4];
+        std::uint32_t length;
+        std::uint8_t revision;
+        std::uint8_t checksum;
+        char oemId[6];
+        char oemTableId[8];
+        std::uint32_t oemRevision;
+        std::uint32_t creatorId;
+        std::uint32_t creatorRevision;
+    };
+
+    /**
+     * Looks for a table through the XSDT (ACPI 2.0+) or the RSDT. Tables with a wrong checksum are skipped.
+     * @param rsdpAddress The physical address of the RSDP (BootParams_t::acpi_rsdp).
+     * @param revision BootParams_t::acpi_revision.
+     * @param signature The 4 characters of the table's signature, e.g. "APIC" for the MADT.
+     * @return The table, or nullptr if there's none.
+     */
+    const SdtHeader *findTable(std::uint64_t rsdpAddress, std::uint32_t revision, const char *signature);
+
+    /**
+     * Lists the usable CPUs from the MADT: the local APIC and local x2APIC entries that are enabled (those that are
+     * only online-capable need hot-plugging, which the kernel doesn't do).
+     * @param apicIds [OUT] The APIC IDs of the CPUs, in the MADT's order (the BSP isn't necessarily first).
+     * @param capacity The size of apicIds. The CPUs after that are counted but not written.
+     * @param localApicAddress [OUT] The physical address of the local APIC registers.
+     * @return The number of CPUs, or 0 if there's no MADT.
+     */
+    std::size_t findCpus(std::uint64_t rsdpAddress, std::uint32_t revision, std::uint32_t *apicIds,
+                         std::size_t capacity, std::uint64_t *localApicAddress);
+} //namespace Acpi
+
+#endif //KERNEL_ARCH_X86_64_ACPI_H
@@ -0,0 +1,234 @@
+#include <cstddef>
+
+#include <boot_params.h>
+#include <c_husky/mem_routines.h>
+
+#include "ap_trampoline.h"
+#include "cpu.h"
+
+/* The offsets in Parameters, shared with the assembly below (which only knows the block as apTrampolineParameters). */
+#define PARAMETER_GDTR 24
+#define PARAMETER_LONG_JUMP 30
+#define PARAMETER_TEMPORARY_CR3 36
+#define PARAMETER_EFER 40
+#define PARAMETER_CR0 48
+#define PARAMETER_CR4 56
+#define PARAMETER_CR3 64
+#define PARAMETER_CPUS 72
+#define PARAMETER_CPU_COUNT 80
+#define PARAMETER_CPU_SIZE 88
+#define PARAMETER_APIC_ID_OFFSET 96
+#define PARAMETER_STACK_TOP_OFFSET 104
+#define PARAMETER_ENTRY 112
+#define PARAMETERS_SIZE 120
+
+#define STRINGIFY_VALUE(x) #x
+#define STRINGIFY(x) STRINGIFY_VALUE(x)
+
+/* Real mode runs with CS = DS = the page, so its addresses are offsets from apTrampolineStart. PAE, LME and then PE and
+ * PG together take the CPU from real mode to long mode directly, on a copy of the BSP's top-level table in the second
+ * page (CR3 only takes 32 bits until then). In long mode, the code is position-independent (RIP-relative) and switches
+ * to the BSP's real control registers. */
+asm(R"(
+.pushsection .rodata.ap_trampoline, "a"
+.balign 4096
+.global apTrampolineStart
+apTrampolineStart:
+.code16
+    cli
+    cld
+    mov %cs, %ax
+    mov %ax, %ds
+    lgdtl apTrampolineParameters + )" STRINGIFY(PARAMETER_GDTR) R"( - apTrampolineStart
+
+    mov %cr4, %eax
+    or $0x20, %eax
+    mov %eax, %cr4
+    movl apTrampolineParameters + )" STRINGIFY(PARAMETER_TEMPORARY_CR3) R"( - apTrampolineStart, %eax
+    mov %eax, %cr3
+
+    mov $0xC0000080, %ecx
+    movl apTrampolineParameters + )" STRINGIFY(PARAMETER_EFER) R"( - apTrampolineStart, %eax
+    xor %edx, %edx
+    wrmsr
+
+    mov %cr0, %eax
+    or $0x80000001, %eax
+    mov %eax, %cr0
+    ljmpl *apTrampolineParameters + )" STRINGIFY(PARAMETER_LONG_JUMP) R"( - apTrampolineStart
+
+.code64
+.global apTrampolineLongMode
+apTrampolineLongMode:
+    mov $0x10, %eax
+    mov %eax, %ds
+    mov %eax, %es
+    mov %eax, %ss
+    xor %eax, %eax
+    mov %eax, %fs
+    mov %eax, %gs
+
+    mov apTrampolineParameters + )" STRINGIFY(PARAMETER_CR4) R"((%rip), %rax
+    mov %rax, %cr4
+    mov apTrampolineParameters + )" STRINGIFY(PARAMETER_CR0) R"((%rip), %rax
+    mov %rax, %cr0
+    mov apTrampolineParameters + )" STRINGIFY(PARAMETER_CR3) R"((%rip), %rax
+    mov %rax, %cr3
+
+    # the x2APIC ID from leaf 0xB when there's one, the 8-bit initial APIC ID otherwise
+    xor %eax, %eax
+    cpuid
+    cmp $0xB, %eax
+    jb 1f
+    mov $0xB, %eax
+    xor %ecx, %ecx
+    cpuid
+    test %ebx, %ebx
+    jz 1f
+    mov %edx, %r8d
+    jmp 2f
+1:
+    mov $1, %eax
+    cpuid
+    shr $24, %ebx
+    mov %ebx, %r8d
+2:
+    mov apTrampolineParameters + )" STRINGIFY(PARAMETER_CPUS) R"((%rip), %rdi
+    mov apTrampolineParameters + )" STRINGIFY(PARAMETER_CPU_COUNT) R"((%rip), %rcx
+    mov apTrampolineParameters + )" STRINGIFY(PARAMETER_CPU_SIZE) R"((%rip), %r11
+    mov apTrampolineParameters + )" STRINGIFY(PARAMETER_APIC_ID_OFFSET) R"((%rip), %r9
+    mov apTrampolineParameters + )" STRINGIFY(PARAMETER_STACK_TOP_OFFSET) R"((%rip), %r10
+3:
+    test %rcx, %rcx
+    jz 5f
+    cmp %r8d, (%rdi, %r9)
+    je 4f
+    add %r11, %rdi
+    dec %rcx
+    jmp 3b
+4:
+    mov (%rdi, %r10), %rsp
+    xor %ebp, %ebp
+    mov apTrampolineParameters + )" STRINGIFY(PARAMETER_ENTRY) R"((%rip), %rax
+    call *%rax
+5:
+    cli
+    hlt
+    jmp 5b
+
+.balign 8
+.global apTrampolineParameters
+apTrampolineParameters:
+    .skip )" STRINGIFY(PARAMETERS_SIZE) R"(
+.global apTrampolineEnd
+apTrampolineEnd:
+.popsection
+)");
+
+extern "C" const char apTrampolineStart[];
+extern "C" const char apTrampolineLongMode[];
+extern "C" const char apTrampolineParameters[];
+extern "C" const char apTrampolineEnd[];
+
+namespace ApTrampoline {
+    struct [[gnu::packed]] Parameters {
+        std::uint64_t gdt[3];
+        //the operand of lgdtl
+        std::uint16_t gdtLimit;
+        std::uint32_t gdtBase;
+        //the operand of ljmpl
+        std::uint32_t longModeAddress;
+        std::uint16_t longModeSelector;
+        std::uint32_t temporaryCr3;
+        std::uint32_t efer;
+        std::uint32_t padding;
+        std::uint64_t cr0;
+        std::uint64_t cr4;
+        std::uint64_t cr3;
+        PerCpu::Data *cpus;
+        std::uint64_t cpuCount;
+        std::uint64_t cpuSize;
+        std::uint64_t apicIdOffset;
+        std::uint64_t stackTopOffset;
+        EntryFunction entry;
+    };
+
+    static_assert(offsetof(Parameters, gdtLimit) == PARAMETER_GDTR);
+    static_assert(offsetof(Parameters, longModeAddress) == PARAMETER_LONG_JUMP);
+    static_assert(offsetof(Parameters, temporaryCr3) == PARAMETER_TEMPORARY_CR3);
+    static_assert(offsetof(Parameters, efer) == PARAMETER_EFER);
+    static_assert(offsetof(Parameters, cr0) == PARAMETER_CR0);
+    static_assert(offsetof(Parameters, cr4) == PARAMETER_CR4);
+    static_assert(offsetof(Parameters, cr3) == PARAMETER_CR3);
+    static_assert(offsetof(Parameters, cpus) == PARAMETER_CPUS);
+    static_assert(offsetof(Parameters, cpuCount) == PARAMETER_CPU_COUNT);
+    static_assert(offsetof(Parameters, cpuSize) == PARAMETER_CPU_SIZE);
+    static_assert(offsetof(Parameters, apicIdOffset) == PARAMETER_APIC_ID_OFFSET);
+    static_assert(offsetof(Parameters, stackTopOffset) == PARAMETER_STACK_TOP_OFFSET);
+    static_assert(offsetof(Parameters, entry) == PARAMETER_ENTRY);
+    static_assert(sizeof(Parameters) == PARAMETERS_SIZE);
+
+    constexpr std::uint64_t PAGE_SIZE = 4096;
+
+    //the same descriptors as the kernel's GDT, which the APs load once in the kernel
+    constexpr std::uint64_t CODE_DESCRIPTOR = 0x00AF9A000000FFFF;
+    constexpr std::uint64_t DATA_DESCRIPTOR = 0x00CF92000000FFFF;
+    constexpr std::uint16_t CODE_SELECTOR = 0x08;
+
+    //what the APs take from the BSP's EFER: SCE, LME and NXE (LMA is set by the CPU)
+    constexpr std::uint64_t EFER_COPIED_BITS = 1 << 0 | 1 << 8 | 1 << 11;
+
+    static std::uint64_t readCr0() {
+        std::uint64_t value;
+        asm volatile("mov %%cr0, %0" : "=r"(value));
+        return value;
+    }
+
+    static std::uint64_t readCr4() {
+        std::uint64_t value;
+        asm volatile("mov %%cr4, %0" : "=r"(value));
+        return value;
+    }
+
+    std::uint8_t install(const std::uint64_t base, PerCpu::Data *cpus, const std::uint64_t cpuCount,
+                         const EntryFunction entry) {
+        static_assert(AP_TRAMPOLINE_PAGES >= 2);
+        const std::size_t codeSize = apTrampolineEnd - apTrampolineStart;
+        const auto *code = reinterpret_cast<const std::uint8_t *>(apTrampolineStart);
+
+        auto *trampoline = reinterpret_cast<std::uint8_t *>(base);
+        CHusky::Mem::copy(trampoline, code, codeSize);
+
+        //the second page gets the copy of the top-level table (which has to be below 4 GiB)
+        const std::uint64_t cr3 = Cpu::readCr3();
+        const std::uint64_t temporaryTable = base + PAGE_SIZE;
+        CHusky::Mem::copy(reinterpret_cast<void *>(temporaryTable), reinterpret_cast<const void *>(cr3 & ~0xFFFULL),
+                          PAGE_SIZE);
+
+        auto *parameters = reinterpret_cast<Parameters *>(trampoline + (apTrampolineParameters - apTrampolineStart));
+        parameters->gdt[0] = 0;
+        parameters->gdt[1] = CODE_DESCRIPTOR;
+        parameters->gdt[2] = DATA_DESCRIPTOR;
+        parameters->gdtLimit = sizeof(parameters->gdt) - 1;
+        parameters->gdtBase = static_cast<std::uint32_t>(base + (apTrampolineParameters - apTrampolineStart));
+        parameters->longModeAddress = static_cast<std::uint32_t>(base + (apTrampolineLongMode - apTrampolineStart));
+        parameters->longModeSelector = CODE_SELECTOR;
+        parameters->temporaryCr3 = static_cast<std::uint32_t>(temporaryTable);
+        parameters->efer = static_cast<std::uint32_t>(Cpu::readMsr(Cpu::MSR_EFER) & EFER_COPIED_BITS);
+        parameters->padding = 0;
+        parameters->cr0 = readCr0();
+        //PGE and PCIDE included: the kernel turns them on before the APs start, and CR3 holds PCID 0
+        parameters->cr4 = readCr4();
+        parameters->cr3 = cr3;
+        parameters->cpus = cpus;
+        parameters->cpuCount = cpuCount;
+        parameters->cpuSize = sizeof(PerCpu::Data);
+        parameters->apicIdOffset = offsetof(PerCpu::Data, apicId);
+        parameters->stackTopOffset = offsetof(PerCpu::Data, kernelStackTop);
+        parameters->entry = entry;
+
+        //the APs read all of it with paging off, so it has to be in memory before the startup IPIs
+        asm volatile("mfence" : : : "memory");
+        return static_cast<std::uint8_t>(base / PAGE_SIZE);
+    }
+} //namespace ApTrampoline
@@ -0,0 +1,30 @@
+#ifndef KERNEL_ARCH_X86_64_AP_TRAMPOLINE_H
+#define KERNEL_ARCH_X86_64_AP_TRAMPOLINE_H
+
+#include <cstdint>
+
+#include "per_cpu.h"
+
+/**
+ * The code the APs start in: from real mode at the startup IPI's page, straight to long mode with the BSP's page tables,
+ * then onto their own stack and into the kernel. An AP finds its PerCpu::Data by its APIC ID, so the APs can be started
+ * all at once.
+ */
+namespace ApTrampoline {
+    /**
+     * Where the APs go once they're in long mode, with their stack set up. Never returns.
+     */
+    typedef void (*EntryFunction)(PerCpu::Data *cpu);
+
+    /**
+     * Copies the trampoline to the given pages and fills in what the APs need.
+     * @param base BootParams_t::ap_trampoline: AP_TRAMPOLINE_PAGES identity-mapped pages below 1 MiB.
+     * @param cpus The blocks of the CPUs to start, with their apicId and kernelStackTop set. An AP that isn't in
+     * there halts.
+     * @param entry Called on the AP's stack, with its block as argument.
+     * @return The vector of the startup IPI (the page number of base).
+     */
+    std::uint8_t install(std::uint64_t base, PerCpu::Data *cpus, std::uint64_t cpuCount, EntryFunction entry);
+} //namespace ApTrampoline
+
+#endif //KERNEL_ARCH_X86_64_AP_TRAMPOLINE_H
@@ -0,0 +1,119 @@
+#ifndef KERNEL_ARCH_X86_64_CPU_H
+#define KERNEL_ARCH_X86_64_CPU_H
+
+#include <cstdint>
+
+/**
+ * Thin wrappers around the instructions the kernel needs outside of assembly.
+ */
+namespace Cpu {
+    constexpr std::uint32_t MSR_APIC_BASE = 0x1B;
+    /**
+     * The TSC value the local APIC timer fires at, in TSC-deadline mode; 0 disarms it.
+     */
+    constexpr std::uint32_t MSR_TSC_DEADLINE = 0x6E0;
+    constexpr std::uint32_t MSR_EFER = 0xC0000080;
+    /**
+     * The selectors SYSCALL and SYSRET load (bits 32-47 and 48-63).
+     */
+    constexpr std::uint32_t MSR_STAR = 0xC0000081;
+    /**
+     * Where SYSCALL jumps to in 64-bit mode.
+     */
+    constexpr std::uint32_t MSR_LSTAR = 0xC0000082;
+    /**
+     * The RFLAGS bits SYSCALL clears.
+     */
+    constexpr std::uint32_t MSR_FMASK = 0xC0000084;
+    constexpr std::uint32_t MSR_FS_BASE = 0xC0000100;
+    constexpr std::uint32_t MSR_GS_BASE = 0xC0000101;
+    /**
+     * The GS base swapgs exchanges with MSR_GS_BASE.
+     */
+    constexpr std::uint32_t MSR_KERNEL_GS_BASE = 0xC0000102;
+    /**
+     * The value RDTSCP and RDPID read, for user mode to find out which CPU it runs on.
+     */
+    constexpr std::uint32_t MSR_TSC_AUX = 0xC0000103;
+
+    constexpr std::uint64_t EFER_SYSCALL_ENABLE = 1 << 0;
+    constexpr std::uint64_t EFER_NO_EXECUTE_ENABLE = 1 << 11;
+
+    constexpr std::uint64_t RFLAGS_TRAP = 1 << 8;
+    constexpr std::uint64_t RFLAGS_INTERRUPT_ENABLE = 1 << 9;
+    constexpr std::uint64_t RFLAGS_DIRECTION = 1 << 10;
+    constexpr std::uint64_t RFLAGS_ALIGNMENT_CHECK = 1 << 18;
+
+    struct CpuidResult {
+        std::uint32_t eax;
+        std::uint32_t ebx;
+        std::uint32_t ecx;
+        std::uint32_t edx;
+    };
+
+    inline CpuidResult cpuid(const std::uint32_t leaf, const std::uint32_t subLeaf = 0) {
+        CpuidResult result;
+        asm volatile("cpuid"
+                     : "=a"(result.eax), "=b"(result.ebx), "=c"(result.ecx), "=d"(result.edx)
+                     : "a"(leaf), "c"(subLeaf));
+        return result;
+    }
+
+    inline std::uint64_t readMsr(const std::uint32_t msr) {
+        std::uint32_t low;
+        std::uint32_t high;
+        asm volatile("rdmsr" : "=a"(low), "=d"(high) : "c"(msr));
+        return static_cast<std::uint64_t>(high) << 32 | low;
+    }
+
+    inline void writeMsr(const std::uint32_t msr, const std::uint64_t value) {
+        asm volatile("wrmsr"
+                     :
+                     : "c"(msr), "a"(static_cast<std::uint32_t>(value)), "d"(static_cast<std::uint32_t>(value >> 32))
+                     : "memory");
+    }
+
+    inline std::uint64_t readTsc() {
+        std::uint32_t low;
+        std::uint32_t high;
+        asm volatile("rdtsc" : "=a"(low), "=d"(high));
+        return static_cast<std::uint64_t>(high) << 32 | low;
+    }
+
+    inline std::uint8_t readPort8(const std::uint16_t port) {
+        std::uint8_t value;
+        asm volatile("inb %1, %0" : "=a"(value) : "Nd"(port));
+        return value;
+    }
+
+    inline void writePort8(const std::uint16_t port, const std::uint8_t value) {
+        asm volatile("outb %0, %1" : : "a"(value), "Nd"(port));
+    }
+
+    inline std::uint64_t readCr3() {
+        std::uint64_t value;
+        asm volatile("mov %%cr3, %0" : "=r"(value));
+        return value;
+    }
+
+    /**
+     * Disables the interrupts, and returns whether they were enabled (to give to restoreInterrupts).
+     */
+    inline bool disableInterrupts() {
+        std::uint64_t flags;
+        asm volatile("pushfq; popq %0; cli" : "=r"(flags) : : "memory");
+        return (flags & RFLAGS_INTERRUPT_ENABLE) != 0;
+    }
+
+    inline void restoreInterrupts(const bool wereEnabled) {
+        if (wereEnabled) {
+            asm volatile("sti" : : : "memory");
+        }
+    }
+
+    inline void pause() {
+        asm volatile("pause" : : : "memory");
+    }
+} //namespace Cpu
+
+#endif //KERNEL_ARCH_X86_64_CPU_H
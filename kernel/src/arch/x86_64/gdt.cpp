@@ -0,0 +1,77 @@
+#include "gdt.h"
+
+namespace Gdt {
+    struct [[gnu::packed]] Pointer {
+        std::uint16_t limit;
+        std::uint64_t base;
+    };
+
+    //access byte: present, DPL 0 or 3, code/data, executable/writable; flags: L (64-bit code) or G with 32-bit default
+    constexpr std::uint64_t KERNEL_CODE_DESCRIPTOR = 0x00AF9A000000FFFF;
+    constexpr std::uint64_t KERNEL_DATA_DESCRIPTOR = 0x00CF92000000FFFF;
+    constexpr std::uint64_t USER_DATA_DESCRIPTOR = 0x00CFF2000000FFFF;
+    constexpr std::uint64_t USER_CODE_DESCRIPTOR = 0x00AFFA000000FFFF;
+
+    /**
+     * Present, DPL 0, available 64-bit TSS.
+     */
+    constexpr std::uint64_t TSS_TYPE = 0x89;
+
+    /**
+     * The entries before the TSS descriptors, which take two each.
+     */
+    constexpr unsigned SEGMENT_COUNT = 6;
+
+    alignas(16) static constinit std::uint64_t descriptors[SEGMENT_COUNT + 2 * MAX_TSS_COUNT] = {
+        0,
+        KERNEL_CODE_DESCRIPTOR,
+        KERNEL_DATA_DESCRIPTOR,
+        //no 32-bit user code: SYSRET is only ever used to return to 64-bit code
+        0,
+        USER_DATA_DESCRIPTOR,
+        USER_CODE_DESCRIPTOR,
+    };
+
+    static_assert(USER_BASE_SELECTOR == 3 * 8 && (USER_DATA_SELECTOR & ~3) == 4 * 8
+                  && (USER_CODE_SELECTOR & ~3) == 5 * 8, "SYSRET expects them in this order");
+
+    void load() {
+        const Pointer pointer = {
+            sizeof(descriptors) - 1,
+            reinterpret_cast<std::uint64_t>(descriptors),
+        };
+
+        //CS can only be reloaded with a far transfer, here a far return to the next instruction
+        asm volatile(
+            "lgdt %0\n"
+            "pushq %1\n"
+            "leaq 1f(%%rip), %%rax\n"
+            "pushq %%rax\n"
+            "lretq\n"
+            "1:\n"
+            "mov %2, %%ds\n"
+            "mov %2, %%es\n"
+            "mov %2, %%ss\n"
+            "mov %3, %%fs\n"
+            "mov %3, %%gs\n"
+            :
+            : "m"(pointer), "i"(KERNEL_CODE_SELECTOR), "r"(static_cast<std::uint32_t>(KERNEL_DATA_SELECTOR)),
+              "r"(0U)
+            : "rax", "memory");
+    }
+
+    void loadTss(const unsigned index, Tss *tss) {
+        tss->ioMapBase = sizeof(Tss);
+
+        const auto base = reinterpret_cast<std::uint64_t>(tss);
+        const unsigned entry = SEGMENT_COUNT + 2 * index;
+        descriptors[entry] = (sizeof(Tss) - 1)
+            | (base & 0xFFFFFF) << 16
+            | TSS_TYPE << 40
+            | (base >> 24 & 0xFF) << 56;
+        descriptors[entry + 1] = base >> 32;
+
+        //ltr marks the descriptor busy, so it's loaded only once per CPU
+        asm volatile("ltr %w0" : : "r"(static_cast<std::uint16_t>(entry * 8)) : "memory");
+    }
+} //namespace Gdt
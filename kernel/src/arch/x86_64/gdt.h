@@ -0,0 +1,64 @@
+#ifndef KERNEL_ARCH_X86_64_GDT_H
+#define KERNEL_ARCH_X86_64_GDT_H
+
+#include <cstdint>
+
+/**
+ * The kernel's GDT, shared by every CPU. In long mode, the segments only matter for their privilege level and mode:
+ * the bases and limits are ignored (FS and GS get their bases from MSRs). Every CPU also has its own TSS, for the
+ * stack the CPU switches to on an interrupt from user mode and the IST stacks (see Idt).
+ *
+ * The user segments are in the order SYSRET wants: from the base in STAR, the (unused) 32-bit code segment, then the
+ * data segment, then the 64-bit code segment.
+ */
+namespace Gdt {
+    constexpr std::uint16_t KERNEL_CODE_SELECTOR = 0x08;
+    constexpr std::uint16_t KERNEL_DATA_SELECTOR = 0x10;
+    /**
+     * The base of the user segments in STAR, where SYSRET would take the 32-bit code segment from.
+     */
+    constexpr std::uint16_t USER_BASE_SELECTOR = 0x18;
+    constexpr std::uint16_t USER_DATA_SELECTOR = 0x20 | 3;
+    constexpr std::uint16_t USER_CODE_SELECTOR = 0x28 | 3;
+
+    /**
+     * How many CPUs can have a TSS.
+     */
+    constexpr unsigned MAX_TSS_COUNT = 64;
+
+    /**
+     * The 64-bit task state segment: only the stack pointers are used (there's no I/O permission bitmap).
+     */
+    struct [[gnu::packed]] Tss {
+        std::uint32_t reserved0;
+        /**
+         * The stacks of the privilege levels; rsp[0] is where an interrupt from user mode lands.
+         */
+        std::uint64_t rsp[3];
+        std::uint64_t reserved1;
+        std::uint64_t ist[7];
+        std::uint64_t reserved2;
+        std::uint16_t reserved3;
+        /**
+         * Set to the size of the TSS: past its limit, so there's no I/O permission bitmap.
+         */
+        std::uint16_t ioMapBase;
+    };
+
+    static_assert(sizeof(Tss) == 104);
+
+    /**
+     * Loads the GDT on the current CPU and reloads every segment register. FS and GS are loaded with the null
+     * selector, which clears their bases: set MSR_GS_BASE afterwards.
+     */
+    void load();
+
+    /**
+     * Points the TSS descriptor of a CPU to its TSS and loads it on the current CPU. Only after load.
+     * @param index The index of the current CPU, below MAX_TSS_COUNT.
+     * @param tss The CPU's TSS, which must stay where it is.
+     */
+    void loadTss(unsigned index, Tss *tss);
+} //namespace Gdt
+
+#endif //KERNEL_ARCH_X86_64_GDT_H
@@ -0,0 +1,223 @@
+#include <cstddef>
+
+#include <serial_log/serial_log.h>
+
+#include "idt.h"
+
+#include "../../log.h"
+#include "gdt.h"
+#include "local_apic.h"
+
+/* One 16-byte stub per vector, so the stub of vector v is at interruptStubs + 16 * v. The vectors the CPU pushes no
+ * error code for get a 0 instead, so every frame looks the same. The common part pushes the caller-saved registers
+ * (the handler saves the rest, as the ABI wants), which leaves the stack 16-byte aligned for the call: the CPU aligns
+ * it before pushing its 5 words, and 2 + 9 more make 16.
+ *
+ * Coming from user mode (the saved CS has RPL 3), GS still has the user's base: swapgs brings in the kernel's (the
+ * per-CPU block) until the way back.
+ *
+ * #DB (1), NMI (2) and #MC (18) take interruptIstCommon instead. They can land between a swapgs and the end of the code
+ * around it, where CS doesn't tell which base is active, so MSR_GS_BASE is read: the per-CPU blocks are in the kernel's
+ * image, in the higher half, while user mode can't set a base with bit 63 (its only one is 0, or from a descriptor).
+ * The swapgs is undone on the way back only if there was one, kept in a word below the frame. */
+asm(R"(
+.pushsection .text
+.balign 16
+.global interruptStubs
+interruptStubs:
+.set vector, 0
+.rept 256
+    .balign 16
+    .if vector == 8 || (vector >= 10 && vector <= 14) || vector == 17 || vector == 21 || vector == 29 || vector == 30
+    .else
+        pushq $0
+    .endif
+    pushq $vector
+    .if vector == 1 || vector == 2 || vector == 18
+        jmp interruptIstCommon
+    .else
+        jmp interruptCommon
+    .endif
+    .set vector, vector + 1
+.endr
+
+interruptCommon:
+    testb $3, 24(%rsp)
+    jz 1f
+    swapgs
+1:
+    push %rax
+    push %rcx
+    push %rdx
+    push %rsi
+    push %rdi
+    push %r8
+    push %r9
+    push %r10
+    push %r11
+    cld
+    mov %rsp, %rdi
+    call interruptDispatch
+    pop %r11
+    pop %r10
+    pop %r9
+    pop %r8
+    pop %rdi
+    pop %rsi
+    pop %rdx
+    pop %rcx
+    pop %rax
+    testb $3, 24(%rsp)
+    jz 1f
+    swapgs
+1:
+    add $16, %rsp
+    iretq
+
+interruptIstCommon:
+    push %rax
+    push %rcx
+    push %rdx
+    push %rsi
+    push %rdi
+    push %r8
+    push %r9
+    push %r10
+    push %r11
+    cld
+    mov $0xC0000101, %ecx
+    rdmsr
+    xor %esi, %esi
+    test %edx, %edx
+    js 1f
+    swapgs
+    mov $1, %esi
+1:
+    sub $8, %rsp
+    push %rsi
+    lea 16(%rsp), %rdi
+    call interruptDispatch
+    pop %rsi
+    add $8, %rsp
+    test %esi, %esi
+    jz 1f
+    swapgs
+1:
+    pop %r11
+    pop %r10
+    pop %r9
+    pop %r8
+    pop %rdi
+    pop %rsi
+    pop %rdx
+    pop %rcx
+    pop %rax
+    add $16, %rsp
+    iretq
+.popsection
+)");
+
+extern "C" char interruptStubs[];
+
+namespace Idt {
+    constexpr std::size_t STUB_SIZE = 16;
+
+    /**
+     * Present, DPL 0, 64-bit interrupt gate (which clears IF on entry).
+     */
+    constexpr std::uint8_t INTERRUPT_GATE = 0x8E;
+    /**
+     * The same with DPL 3, so user mode can reach it with int.
+     */
+    constexpr std::uint8_t USER_INTERRUPT_GATE = 0xEE;
+
+    struct Gate {
+        std::uint16_t offsetLow;
+        std::uint16_t selector;
+        std::uint8_t interruptStackTable;
+        std::uint8_t typeAttributes;
+        std::uint16_t offsetMiddle;
+        std::uint32_t offsetHigh;
+        std::uint32_t reserved;
+    };
+
+    struct [[gnu::packed]] Pointer {
+        std::uint16_t limit;
+        std::uint64_t base;
+    };
+
+    static_assert(sizeof(Gate) == 16);
+
+    alignas(16) static constinit Gate gates[VECTOR_COUNT] = {};
+    static constinit Handler handlers[VECTOR_COUNT] = {};
+
+    static std::uint8_t istEntry(const unsigned vector) {
+        switch (vector) {
+            case DEBUG_VECTOR:
+                return DEBUG_STACK;
+            case NMI_VECTOR:
+                return NMI_STACK;
+            case MACHINE_CHECK_VECTOR:
+                return MACHINE_CHECK_STACK;
+            default:
+                return 0;
+        }
+    }
+
+    [[noreturn]] static void haltOnException(const InterruptFrame *frame) {
+        Log::print("CPU exception ", frame->vector, "");
+        Log::print(" at rip ", frame->rip, "");
+        Log::print(", error code ", frame->errorCode, ".\n");
+        SerialLog::flush();
+        while (true) {
+            asm volatile("cli; hlt");
+        }
+    }
+
+    void init() {
+        for (unsigned vector = 0; vector < VECTOR_COUNT; vector++) {
+            const auto stub = reinterpret_cast<std::uint64_t>(interruptStubs + vector * STUB_SIZE);
+            gates[vector] = {
+                static_cast<std::uint16_t>(stub),
+                Gdt::KERNEL_CODE_SELECTOR,
+                istEntry(vector),
+                INTERRUPT_GATE,
+                static_cast<std::uint16_t>(stub >> 16),
+                static_cast<std::uint32_t>(stub >> 32),
+                0,
+            };
+        }
+    }
+
+    void load() {
+        const Pointer pointer = {
+            sizeof(gates) - 1,
+            reinterpret_cast<std::uint64_t>(gates),
+        };
+        asm volatile("lidt %0" : : "m"(pointer));
+    }
+
+    void setHandler(const std::uint8_t vector, const Handler handler) {
+        __atomic_store_n(&handlers[vector], handler, __ATOMIC_RELEASE);
+    }
+
+    void setUserCallable(const std::uint8_t vector) {
+        gates[vector].typeAttributes = USER_INTERRUPT_GATE;
+    }
+} //namespace Idt
+
+extern "C" void interruptDispatch(Idt::InterruptFrame *frame) {
+    const Idt::Handler handler = __atomic_load_n(&Idt::handlers[frame->vector], __ATOMIC_ACQUIRE);
+    if (handler != nullptr) {
+        handler(frame);
+        return;
+    }
+
+    if (frame->vector < Idt::FIRST_INTERRUPT_VECTOR) {
+        Idt::haltOnException(frame);
+    }
+    //a spurious interrupt needs no end of interrupt; any other stray one does, or it would block the lower priorities
+    if (frame->vector != LocalApic::SPURIOUS_VECTOR) {
+        LocalApic::endOfInterrupt();
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef KERNEL_ARCH_X86_64_IDT_H
+#define KERNEL_ARCH_X86_64_IDT_H
+
+#include <cstdint>
+
+/**
+ * The kernel's IDT, shared by every CPU. Every vector has a small stub that saves the caller-saved registers and calls
+ * the handler set for the vector; a CPU exception without a handler logs where it happened and halts the CPU.
+ *
+ * The handlers run on the interrupted thread's kernel stack with interrupts disabled (from user mode, the CPU switches
+ * to the one in the TSS), and may switch to another thread (the stub's frame waits on the stack until the thread is
+ * switched back to).
+ *
+ * NMI, #DB and #MC are the exceptions: they can come in anywhere, even in the syscall entry before it's on a kernel
+ * stack, so they get their own stacks through the TSS's IST, and their handlers must not switch threads.
+ */
+namespace Idt {
+    constexpr unsigned VECTOR_COUNT = 256;
+
+    /**
+     * The first vector that isn't a CPU exception.
+     */
+    constexpr unsigned FIRST_INTERRUPT_VECTOR = 32;
+
+    constexpr std::uint8_t DEBUG_VECTOR = 1;
+    constexpr std::uint8_t NMI_VECTOR = 2;
+    constexpr std::uint8_t MACHINE_CHECK_VECTOR = 18;
+
+    /**
+     * The IST entries of the vectors above, from 1 (Gdt::Tss::ist[entry - 1]). Every CPU fills them in before loading
+     * its TSS.
+     */
+    constexpr std::uint8_t DEBUG_STACK = 1;
+    constexpr std::uint8_t NMI_STACK = 2;
+    constexpr std::uint8_t MACHINE_CHECK_STACK = 3;
+    constexpr unsigned IST_STACK_COUNT = 3;
+
+    /**
+     * What the stub leaves on the stack, from the last register it pushed to what the CPU pushed.
+     */
+    struct InterruptFrame {
+        std::uint64_t r11;
+        std::uint64_t r10;
+        std::uint64_t r9;
+        std::uint64_t r8;
+        std::uint64_t rdi;
+        std::uint64_t rsi;
+        std::uint64_t rdx;
+        std::uint64_t rcx;
+        std::uint64_t rax;
+        std::uint64_t vector;
+        /**
+         * 0 for the vectors the CPU pushes no error code for.
+         */
+        std::uint64_t errorCode;
+        std::uint64_t rip;
+        std::uint64_t cs;
+        std::uint64_t rflags;
+        std::uint64_t rsp;
+        std::uint64_t ss;
+    };
+
+    typedef void (*Handler)(InterruptFrame *frame);
+
+    /**
+     * Fills the IDT. Must be called once, before load.
+     */
+    void init();
+
+    /**
+     * Loads the IDT on the current CPU.
+     */
+    void load();
+
+    /**
+     * Sets the function called for a vector (nullptr to remove it). Set them before enabling the interrupts that use
+     * them.
+     */
+    void setHandler(std::uint8_t vector, Handler handler);
+
+    /**
+     * Lets user mode raise a vector with int; the others make it fault. Before the vector is used.
+     */
+    void setUserCallable(std::uint8_t vector);
+} //namespace Idt
+
+#endif //KERNEL_ARCH_X86_64_IDT_H
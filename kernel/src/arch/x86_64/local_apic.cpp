@@ -0,0 +1,186 @@
+#include "local_apic.h"
+
+#include "cpu.h"
+#include "pit.h"
+
+namespace LocalApic {
+    constexpr std::uint32_t REGISTER_ID = 0x20;
+    constexpr std::uint32_t REGISTER_EOI = 0xB0;
+    constexpr std::uint32_t REGISTER_SPURIOUS = 0xF0;
+    constexpr std::uint32_t REGISTER_ICR_LOW = 0x300;
+    constexpr std::uint32_t REGISTER_ICR_HIGH = 0x310;
+    constexpr std::uint32_t REGISTER_LVT_TIMER = 0x320;
+    constexpr std::uint32_t REGISTER_TIMER_INITIAL_COUNT = 0x380;
+    constexpr std::uint32_t REGISTER_TIMER_CURRENT_COUNT = 0x390;
+    constexpr std::uint32_t REGISTER_TIMER_DIVIDE = 0x3E0;
+
+    /**
+     * In x2APIC mode, the register at xAPIC offset x is the MSR X2APIC_MSR_BASE + x / 16.
+     */
+    constexpr std::uint32_t X2APIC_MSR_BASE = 0x800;
+
+    constexpr std::uint64_t APIC_BASE_X2APIC_ENABLE = 1 << 10;
+    constexpr std::uint64_t APIC_BASE_ENABLE = 1 << 11;
+    constexpr std::uint32_t SPURIOUS_APIC_ENABLE = 1 << 8;
+
+    constexpr std::uint32_t LEAF_FEATURES = 0x1;
+    constexpr std::uint32_t FEATURE_ECX_X2APIC = 1 << 21;
+    constexpr std::uint32_t FEATURE_ECX_TSC_DEADLINE = 1 << 24;
+    constexpr std::uint32_t FEATURE_EDX_APIC = 1 << 9;
+
+    constexpr std::uint32_t ICR_DELIVERY_FIXED = 0x000;
+    constexpr std::uint32_t ICR_DELIVERY_INIT = 0x500;
+    constexpr std::uint32_t ICR_DELIVERY_STARTUP = 0x600;
+    constexpr std::uint32_t ICR_DELIVERY_PENDING = 1 << 12;
+    constexpr std::uint32_t ICR_LEVEL_ASSERT = 1 << 14;
+
+    constexpr std::uint32_t LVT_MASKED = 1 << 16;
+    constexpr std::uint32_t LVT_TIMER_ONE_SHOT = 0 << 17;
+    constexpr std::uint32_t LVT_TIMER_TSC_DEADLINE = 2 << 17;
+    /**
+     * The timer counts down once every 16 bus cycles: slow enough for 32 bits to last seconds.
+     */
+    constexpr std::uint32_t TIMER_DIVIDE_BY_16 = 0x3;
+    constexpr std::uint64_t CALIBRATION_TIME_US = 10000;
+
+    static constinit bool useX2Apic = false;
+    static constinit volatile std::uint32_t *registers = nullptr;
+
+    std::uint32_t read(const std::uint32_t offset) {
+        if (useX2Apic) {
+            return static_cast<std::uint32_t>(Cpu::readMsr(X2APIC_MSR_BASE + offset / 16));
+        }
+        return registers[offset / sizeof(std::uint32_t)];
+    }
+
+    void write(const std::uint32_t offset, const std::uint32_t value) {
+        if (useX2Apic) {
+            Cpu::writeMsr(X2APIC_MSR_BASE + offset / 16, value);
+        } else {
+            registers[offset / sizeof(std::uint32_t)] = value;
+        }
+    }
+
+    static void enableCurrentCpu() {
+        //going from disabled straight to x2APIC faults, so the APIC is enabled in xAPIC mode first
+        const std::uint64_t apicBase = Cpu::readMsr(Cpu::MSR_APIC_BASE) | APIC_BASE_ENABLE;
+        Cpu::writeMsr(Cpu::MSR_APIC_BASE, apicBase);
+        if (useX2Apic) {
+            Cpu::writeMsr(Cpu::MSR_APIC_BASE, apicBase | APIC_BASE_X2APIC_ENABLE);
+        }
+
+        write(REGISTER_SPURIOUS, SPURIOUS_APIC_ENABLE | SPURIOUS_VECTOR);
+    }
+
+    static void sendIpi(const std::uint32_t apicId, const std::uint32_t command) {
+        if (useX2Apic) {
+            //a single MSR, so the write is atomic and there's no delivery status to wait for
+            Cpu::writeMsr(X2APIC_MSR_BASE + REGISTER_ICR_LOW / 16, static_cast<std::uint64_t>(apicId) << 32 | command);
+            return;
+        }
+
+        //an interrupt handler sending its own IPI between the two writes would change the destination
+        const bool wereEnabled = Cpu::disableInterrupts();
+        write(REGISTER_ICR_HIGH, apicId << 24);
+        write(REGISTER_ICR_LOW, command);
+        while ((read(REGISTER_ICR_LOW) & ICR_DELIVERY_PENDING) != 0) {
+            Cpu::pause();
+        }
+        Cpu::restoreInterrupts(wereEnabled);
+    }
+
+    bool init(const std::uint64_t mmioAddress) {
+        const Cpu::CpuidResult features = Cpu::cpuid(LEAF_FEATURES);
+        if ((features.edx & FEATURE_EDX_APIC) == 0) {
+            return false;
+        }
+
+        //the firmware may have switched to x2APIC already (it has to with more than 255 CPUs)
+        const bool isX2ApicOn = (Cpu::readMsr(Cpu::MSR_APIC_BASE) & APIC_BASE_X2APIC_ENABLE) != 0;
+        useX2Apic = isX2ApicOn || (features.ecx & FEATURE_ECX_X2APIC) != 0;
+        if (!useX2Apic) {
+            if (mmioAddress == 0) {
+                return false;
+            }
+            registers = reinterpret_cast<volatile std::uint32_t *>(mmioAddress);
+        }
+
+        enableCurrentCpu();
+        return true;
+    }
+
+    void initCurrentCpu() {
+        enableCurrentCpu();
+    }
+
+    bool isX2Apic() {
+        return useX2Apic;
+    }
+
+    std::uint32_t getId() {
+        const std::uint32_t id = read(REGISTER_ID);
+        return useX2Apic ? id : id >> 24;
+    }
+
+    void sendInit(const std::uint32_t apicId) {
+        sendIpi(apicId, ICR_DELIVERY_INIT | ICR_LEVEL_ASSERT);
+    }
+
+    void sendStartup(const std::uint32_t apicId, const std::uint8_t vectorPage) {
+        sendIpi(apicId, ICR_DELIVERY_STARTUP | ICR_LEVEL_ASSERT | vectorPage);
+    }
+
+    void sendFixed(const std::uint32_t apicId, const std::uint8_t vector) {
+        sendIpi(apicId, ICR_DELIVERY_FIXED | ICR_LEVEL_ASSERT | vector);
+    }
+
+    void endOfInterrupt() {
+        write(REGISTER_EOI, 0);
+    }
+
+    bool hasTscDeadline() {
+        return (Cpu::cpuid(LEAF_FEATURES).ecx & FEATURE_ECX_TSC_DEADLINE) != 0;
+    }
+
+    std::uint64_t calibrateTimer(const std::uint64_t tscFrequency) {
+        write(REGISTER_TIMER_DIVIDE, TIMER_DIVIDE_BY_16);
+        write(REGISTER_LVT_TIMER, LVT_MASKED);
+
+        write(REGISTER_TIMER_INITIAL_COUNT, 0xFFFFFFFF);
+        if (!Pit::wait(CALIBRATION_TIME_US)) {
+            //the TSC's frequency may only be a guess then, but it's the best clock left
+            const std::uint64_t ticks = tscFrequency / 1000000 * CALIBRATION_TIME_US;
+            write(REGISTER_TIMER_INITIAL_COUNT, 0xFFFFFFFF);
+            const std::uint64_t start = Cpu::readTsc();
+            while (Cpu::readTsc() - start < ticks) {
+                Cpu::pause();
+            }
+        }
+        const std::uint32_t elapsed = 0xFFFFFFFF - read(REGISTER_TIMER_CURRENT_COUNT);
+        write(REGISTER_TIMER_INITIAL_COUNT, 0);
+
+        return static_cast<std::uint64_t>(elapsed) * (1000000 / CALIBRATION_TIME_US);
+    }
+
+    void startTscDeadlineTimer(const std::uint8_t vector) {
+        write(REGISTER_LVT_TIMER, LVT_TIMER_TSC_DEADLINE | vector);
+        //the SDM asks for a fence between switching to TSC-deadline mode and writing the deadline, or the write can
+        //be ordered before the mode change and lost
+        asm volatile("mfence" : : : "memory");
+        Cpu::writeMsr(Cpu::MSR_TSC_DEADLINE, 0);
+    }
+
+    void setTscDeadline(const std::uint64_t deadline) {
+        Cpu::writeMsr(Cpu::MSR_TSC_DEADLINE, deadline);
+    }
+
+    void startOneShotTimer(const std::uint8_t vector) {
+        write(REGISTER_TIMER_DIVIDE, TIMER_DIVIDE_BY_16);
+        write(REGISTER_LVT_TIMER, LVT_TIMER_ONE_SHOT | vector);
+        write(REGISTER_TIMER_INITIAL_COUNT, 0);
+    }
+
+    void setOneShotCount(const std::uint32_t count) {
+        write(REGISTER_TIMER_INITIAL_COUNT, count);
+    }
+} //namespace LocalApic
@@ -0,0 +1,110 @@
+#ifndef KERNEL_ARCH_X86_64_LOCAL_APIC_H
+#define KERNEL_ARCH_X86_64_LOCAL_APIC_H
+
+#include <cstdint>
+
+/**
+ * The local APIC of the current CPU. In x2APIC mode (used whenever the CPU supports it), the registers are MSRs;
+ * otherwise, they're the MMIO page the bootloader identity-mapped.
+ */
+namespace LocalApic {
+    /**
+     * The vector spurious interrupts are delivered to.
+     */
+    constexpr std::uint8_t SPURIOUS_VECTOR = 0xFF;
+
+    /**
+     * The vector of the timer, which drives preemption, and the one a CPU sends to get another out of hlt. The first
+     * 32 vectors are the CPU's exceptions.
+     */
+    constexpr std::uint8_t TIMER_VECTOR = 0x20;
+    constexpr std::uint8_t WAKE_VECTOR = 0x21;
+
+    /**
+     * Sets up the BSP's local APIC: switches it to x2APIC mode if possible, and enables it.
+     * @param mmioAddress The physical (= virtual) address of the registers, for xAPIC mode.
+     * @return False if there's no local APIC at all.
+     */
+    bool init(std::uint64_t mmioAddress);
+
+    /**
+     * Sets up the local APIC of an AP the same way as the BSP's. Only after init.
+     */
+    void initCurrentCpu();
+
+    /**
+     * Returns whether the local APICs are in x2APIC mode (with 32-bit IDs).
+     */
+    bool isX2Apic();
+
+    /**
+     * Returns the APIC ID of the current CPU.
+     */
+    std::uint32_t getId();
+
+    /**
+     * Sends an INIT IPI, which puts the CPU in the wait-for-SIPI state.
+     */
+    void sendInit(std::uint32_t apicId);
+
+    /**
+     * Sends a startup IPI: the CPU starts in real mode at vectorPage * 4 KiB.
+     */
+    void sendStartup(std::uint32_t apicId, std::uint8_t vectorPage);
+
+    /**
+     * Sends an IPI with the given vector to another CPU.
+     */
+    void sendFixed(std::uint32_t apicId, std::uint8_t vector);
+
+    /**
+     * Signals the end of the interrupt being handled.
+     */
+    void endOfInterrupt();
+
+    /**
+     * Returns whether the timer has the TSC-deadline mode, where it fires once the TSC reaches a value.
+     */
+    bool hasTscDeadline();
+
+    /**
+     * Measures how fast the timer counts (divided by 16), against the PIT, or against the TSC if there's no PIT; takes
+     * 10 ms. Every CPU's timer runs at the same rate, so it's only measured once.
+     * @return The frequency in Hz.
+     */
+    std::uint64_t calibrateTimer(std::uint64_t tscFrequency);
+
+    /**
+     * Puts the timer of the current CPU in TSC-deadline mode, firing the vector, and disarms it.
+     */
+    void startTscDeadlineTimer(std::uint8_t vector);
+
+    /**
+     * Arms the timer of the current CPU (in TSC-deadline mode) to fire once the TSC reaches the deadline; a deadline
+     * that passed already fires right away, and 0 disarms the timer.
+     */
+    void setTscDeadline(std::uint64_t deadline);
+
+    /**
+     * Puts the timer of the current CPU in one-shot mode, firing the vector, and disarms it.
+     */
+    void startOneShotTimer(std::uint8_t vector);
+
+    /**
+     * Arms the timer of the current CPU (in one-shot mode) to fire after count counts (of the frequency
+     * calibrateTimer measured); 0 disarms it.
+     */
+    void setOneShotCount(std::uint32_t count);
+
+    /**
+     * Reads a register, given as its xAPIC offset (e.g. 0x320 for the LVT timer).
+     */
+    std::uint32_t read(std::uint32_t offset);
+
+    /**
+     * Writes a register, given as its xAPIC offset.
+     */
+    void write(std::uint32_t offset, std::uint32_t value);
+} //namespace LocalApic
+
+#endif //KERNEL_ARCH_X86_64_LOCAL_APIC_H
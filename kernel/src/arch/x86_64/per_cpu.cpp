@@ -0,0 +1,12 @@
+#include "per_cpu.h"
+
+#include "cpu.h"
+
+namespace PerCpu {
+    void install(Data *data) {
+        data->self = data;
+        Cpu::writeMsr(Cpu::MSR_GS_BASE, reinterpret_cast<std::uint64_t>(data));
+        //swapgs exchanges the two, and the kernel's must be the active one whenever the kernel runs
+        Cpu::writeMsr(Cpu::MSR_KERNEL_GS_BASE, 0);
+    }
+} //namespace PerCpu
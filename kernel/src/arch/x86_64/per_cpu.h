@@ -0,0 +1,98 @@
+#ifndef KERNEL_ARCH_X86_64_PER_CPU_H
+#define KERNEL_ARCH_X86_64_PER_CPU_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <scheduler/scheduler.h>
+
+#include "gdt.h"
+
+//the offsets the syscall entry reaches with %gs (asserted below)
+#define PER_CPU_THREAD_STACK_TOP 64
+#define PER_CPU_USER_STACK_POINTER 72
+
+/**
+ * The data every CPU keeps for itself, reached through the GS base: finding it is a single gs-relative load, with no
+ * APIC ID lookup and no lock.
+ */
+namespace PerCpu {
+    /**
+     * What the idle loop of a CPU runs when another CPU hands it something with Smp::runOn.
+     */
+    typedef void (*CallFunction)(void *argument);
+
+    struct alignas(64) Data {
+        /**
+         * Points to the block itself, so current() is "mov %gs:0". Must stay the first field.
+         */
+        Data *self;
+        /**
+         * The CPU's index, from 0 (the BSP) to Smp::getCpuCount() - 1. The allocators' per-CPU caches are indexed
+         * with it.
+         */
+        std::uint32_t index;
+        std::uint32_t apicId;
+        /**
+         * The top of the CPU's kernel stack (16-byte aligned).
+         */
+        std::uint64_t kernelStackTop;
+
+        /**
+         * The thread running on the CPU as of the last switch (set by the scheduler's switchingTo hook); nullptr
+         * until the first one.
+         */
+        Scheduler::Thread *currentThread;
+
+        /**
+         * The call handed to the CPU's idle loop: 0 when empty, 1 while a sender fills it in, 2 once it's ready.
+         */
+        std::uint32_t callState;
+        CallFunction callFunction;
+        void *callArgument;
+
+        /**
+         * Set by the CPU once it runs kernel code on its own stack.
+         */
+        bool isOnline;
+
+        /**
+         * The top of the kernel stack of the running thread (16-byte aligned), which the syscall entry switches to;
+         * set by the switchingTo hook, like tss.rsp[0].
+         */
+        std::uint64_t threadStackTop;
+        /**
+         * Where the syscall entry keeps the user stack pointer until it's on the kernel stack.
+         */
+        std::uint64_t userStackPointer;
+        Gdt::Tss tss;
+    };
+
+    static_assert(offsetof(Data, threadStackTop) == PER_CPU_THREAD_STACK_TOP);
+    static_assert(offsetof(Data, userStackPointer) == PER_CPU_USER_STACK_POINTER);
+
+    /**
+     * Loads the GS base of the current CPU with the block. Only after Gdt::load, which clears it.
+     */
+    void install(Data *data);
+
+    /**
+     * Returns the block of the current CPU. Only after install.
+     */
+    inline Data *current() {
+        Data *data;
+        asm volatile("mov %%gs:0, %0" : "=r"(data));
+        return data;
+    }
+
+    /**
+     * Returns the index of the current CPU. Also usable as Slab::CpuIndexFunction and the like.
+     */
+    inline unsigned getIndex() {
+        std::uint32_t index;
+        asm volatile("movl %%gs:%c1, %0" : "=r"(index) : "i"(offsetof(Data, index)));
+        return index;
+    }
+} //namespace PerCpu
+
+#endif //KERNEL_ARCH_X86_64_PER_CPU_H
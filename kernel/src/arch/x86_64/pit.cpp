@@ -0,0 +1,53 @@
+#include "pit.h"
+
+#include "cpu.h"
+
+namespace Pit {
+    constexpr std::uint16_t PORT_CHANNEL_2 = 0x42;
+    constexpr std::uint16_t PORT_COMMAND = 0x43;
+    /**
+     * The keyboard controller's port B, which holds channel 2's gate and output.
+     */
+    constexpr std::uint16_t PORT_CONTROL = 0x61;
+
+    constexpr std::uint8_t CONTROL_GATE_2 = 1 << 0;
+    constexpr std::uint8_t CONTROL_SPEAKER = 1 << 1;
+    constexpr std::uint8_t CONTROL_OUTPUT_2 = 1 << 5;
+
+    /**
+     * Channel 2, low then high byte of the count, mode 0 (the output goes high once the count reaches 0), binary.
+     */
+    constexpr std::uint8_t COMMAND_CHANNEL_2_ONE_SHOT = 0xB0;
+
+    /**
+     * How many times the output is polled before the PIT is given up on; a port read takes about a microsecond, so
+     * that's well over the longest wait.
+     */
+    constexpr std::uint32_t MAX_POLLS = 10000000;
+
+    bool wait(std::uint32_t microseconds) {
+        if (microseconds > MAX_WAIT_US) {
+            microseconds = MAX_WAIT_US;
+        }
+        const auto count = static_cast<std::uint16_t>(FREQUENCY * microseconds / 1000000);
+
+        //gate on, so the count runs as soon as it's written, and speaker off
+        const std::uint8_t control = Cpu::readPort8(PORT_CONTROL);
+        Cpu::writePort8(PORT_CONTROL, static_cast<std::uint8_t>((control & ~CONTROL_SPEAKER) | CONTROL_GATE_2));
+
+        Cpu::writePort8(PORT_COMMAND, COMMAND_CHANNEL_2_ONE_SHOT);
+        Cpu::writePort8(PORT_CHANNEL_2, static_cast<std::uint8_t>(count));
+        Cpu::writePort8(PORT_CHANNEL_2, static_cast<std::uint8_t>(count >> 8));
+
+        //the command drives the output low; still high means nothing answers on these ports (they read as all ones)
+        if ((Cpu::readPort8(PORT_CONTROL) & CONTROL_OUTPUT_2) != 0) {
+            return false;
+        }
+        for (std::uint32_t i = 0; i < MAX_POLLS; i++) {
+            if ((Cpu::readPort8(PORT_CONTROL) & CONTROL_OUTPUT_2) != 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+} //namespace Pit
@@ -0,0 +1,28 @@
+#ifndef KERNEL_ARCH_X86_64_PIT_H
+#define KERNEL_ARCH_X86_64_PIT_H
+
+#include <cstdint>
+
+/**
+ * The legacy programmable interval timer (8254), only used as a known clock to measure the TSC and the local APIC
+ * timer against. Its channel 2 (the PC speaker's) counts without raising an interrupt, and its output can be polled.
+ */
+namespace Pit {
+    /**
+     * The rate every PIT counts at, in Hz.
+     */
+    constexpr std::uint64_t FREQUENCY = 1193182;
+
+    /**
+     * The longest wait: the counter has 16 bits.
+     */
+    constexpr std::uint32_t MAX_WAIT_US = 50000;
+
+    /**
+     * Busy-waits for the given time (at most MAX_WAIT_US) on channel 2.
+     * @return False if the PIT doesn't count, as on machines that dropped the legacy devices.
+     */
+    bool wait(std::uint32_t microseconds);
+} //namespace Pit
+
+#endif //KERNEL_ARCH_X86_64_PIT_H
@@ -0,0 +1,299 @@
+#include <serial_log/serial_log.h>
+#include <slab/object_cache.h>
+#include <frame_allocator/buddy_allocator.h>
+#include <paginator/page_table.h>
+#include <scheduler/scheduler.h>
+#include <trace/trace.h>
+
+#include "smp.h"
+
+#include "../../timers.h"
+#include "../../vdso.h"
+#include "ap_trampoline.h"
+#include "acpi.h"
+#include "cpu.h"
+#include "gdt.h"
+#include "idt.h"
+#include "local_apic.h"
+#include "pit.h"
+#include "syscall_entry.h"
+
+namespace Smp {
+    static_assert(MAX_CPUS <= Slab::MAX_CPUS && MAX_CPUS <= FrameAllocator::MAX_CPUS,
+                  "every CPU needs its own allocator caches");
+    static_assert(MAX_CPUS <= Paginator::MAX_CPUS, "every CPU needs its own PCID flush bitmap");
+    static_assert(MAX_CPUS <= Gdt::MAX_TSS_COUNT, "every CPU needs its own TSS");
+
+    /**
+     * What the Intel SDM asks for between the INIT and the first startup IPI, and between the two startup IPIs.
+     */
+    constexpr std::uint64_t INIT_DELAY_US = 10000;
+    constexpr std::uint64_t STARTUP_DELAY_US = 200;
+
+    /**
+     * How long the TSC is measured against the PIT when the bootloader couldn't find its frequency.
+     */
+    constexpr std::uint32_t TSC_CALIBRATION_TIME_US = 10000;
+
+    /**
+     * Only used if neither the bootloader nor the PIT gave the TSC frequency: the delays are then at least as long as
+     * asked on anything slower than 4 GHz.
+     */
+    constexpr std::uint64_t FALLBACK_TSC_FREQUENCY = 4000000000;
+
+    constexpr std::uint32_t CALL_EMPTY = 0;
+    constexpr std::uint32_t CALL_FILLING = 1;
+    constexpr std::uint32_t CALL_READY = 2;
+
+    /**
+     * Set in startupClaims once startAps stopped waiting for the APs.
+     */
+    constexpr std::uint32_t STARTUP_CLOSED = 1u << 31;
+
+    static constinit PerCpu::Data cpus[MAX_CPUS] = {};
+    alignas(4096) static std::uint8_t apStacks[MAX_CPUS - 1][AP_STACK_SIZE];
+    alignas(4096) static std::uint8_t istStacks[MAX_CPUS][Idt::IST_STACK_COUNT][IST_STACK_SIZE];
+    static constinit unsigned cpuCount = 1;
+    static constinit unsigned onlineCount = 1;
+    /**
+     * The number of APs that got past the trampoline, which take the indices from 1 in that order, and STARTUP_CLOSED:
+     * an AP that arrives after startAps gave up on it parks instead, so the CPUs stay numbered without gaps.
+     */
+    static constinit std::uint32_t startupClaims = 0;
+    /**
+     * The blocks by CPU index (the APs' blocks are in the MADT's order in cpus, not in the order they start).
+     */
+    static constinit PerCpu::Data *cpusByIndex[MAX_CPUS] = {};
+    static constinit std::uint64_t tscFrequency = 0;
+
+    static void delayMicroseconds(const std::uint64_t microseconds) {
+        const std::uint64_t start = Cpu::readTsc();
+        const std::uint64_t ticks = tscFrequency / 1000000 * microseconds;
+        while (Cpu::readTsc() - start < ticks) {
+            Cpu::pause();
+        }
+    }
+
+    /**
+     * Measures the TSC against the PIT.
+     * @return The frequency in Hz, or 0 without a PIT.
+     */
+    static std::uint64_t measureTscFrequency() {
+        const std::uint64_t start = Cpu::readTsc();
+        if (!Pit::wait(TSC_CALIBRATION_TIME_US)) {
+            return 0;
+        }
+        return (Cpu::readTsc() - start) * (1000000 / TSC_CALIBRATION_TIME_US);
+    }
+
+    /**
+     * Points the IST entries of a CPU's TSS to its stacks, then loads the TSS.
+     */
+    static void loadTss(PerCpu::Data *cpu) {
+        for (unsigned i = 0; i < Idt::IST_STACK_COUNT; i++) {
+            cpu->tss.ist[i] = reinterpret_cast<std::uint64_t>(istStacks[cpu->index][i] + IST_STACK_SIZE);
+        }
+        Gdt::loadTss(cpu->index, &cpu->tss);
+    }
+
+    /**
+     * Where the APs land from the trampoline, on their own stack.
+     */
+    [[noreturn]] static void enterAp(PerCpu::Data *cpu) {
+        Gdt::load();
+        Idt::load();
+
+        std::uint32_t claims = __atomic_load_n(&startupClaims, __ATOMIC_RELAXED);
+        do {
+            if ((claims & STARTUP_CLOSED) != 0) {
+                /* Too late: startAps reported the CPUs without this one, so it never shows up. It has no TSS for
+                 * the IST vectors, but its local APIC was left as INIT made it, with LINT1 masked. */
+                while (true) {
+                    asm volatile("cli; hlt");
+                }
+            }
+        } while (!__atomic_compare_exchange_n(
+            &startupClaims, &claims, claims + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+        cpu->index = claims + 1;
+        //published along with the rest of the block by isOnline
+        __atomic_store_n(&cpusByIndex[cpu->index], cpu, __ATOMIC_RELAXED);
+
+        PerCpu::install(cpu);
+        loadTss(cpu);
+        SyscallEntry::initCurrentCpu();
+        Vdso::initCurrentCpu();
+        LocalApic::initCurrentCpu();
+        TRACE_BEGIN("ap_start");
+
+        __atomic_store_n(&cpu->isOnline, true, __ATOMIC_RELEASE);
+        __atomic_fetch_add(&onlineCount, 1, __ATOMIC_RELEASE);
+        TRACE_END("ap_start");
+
+        idleLoop();
+    }
+
+    void initBsp(const std::uint64_t kernelStackTop) {
+        Gdt::load();
+        Idt::init();
+        Idt::load();
+
+        PerCpu::Data &bsp = cpus[0];
+        bsp.index = 0;
+        bsp.kernelStackTop = kernelStackTop;
+        bsp.isOnline = true;
+        cpusByIndex[0] = &bsp;
+        PerCpu::install(&bsp);
+        loadTss(&bsp);
+        //before the APs start, as they take NX from the BSP's EFER
+        SyscallEntry::initCurrentCpu();
+        Vdso::initCurrentCpu();
+
+        Slab::setCpuIndexFunction(PerCpu::getIndex);
+        Trace::setCpuIndexFunction(PerCpu::getIndex);
+        Paginator::setCpuIndexFunction(PerCpu::getIndex);
+        /* The APs get CR4.PGE and CR4.PCIDE through the trampoline's copy of CR4. The bootloader maps the kernel's
+         * image global; PCIDs can be turned on since CR3 still holds PCID 0. */
+        Paginator::PageTableRootController::enableGlobalPages();
+        Paginator::PageTableRootController::enablePcid();
+    }
+
+    unsigned startAps(const BootParams_t &bootParams) {
+        tscFrequency = bootParams.tsc_frequency != 0 ? bootParams.tsc_frequency : measureTscFrequency();
+        if (tscFrequency == 0) {
+            tscFrequency = FALLBACK_TSC_FREQUENCY;
+        }
+
+        const bool hasLocalApic = LocalApic::init(bootParams.local_apic);
+        Timers::init(tscFrequency, hasLocalApic);
+        if (!hasLocalApic) {
+            SerialLog::print("SMP: no local APIC, running on the BSP only.\n");
+            return 1;
+        }
+        const std::uint32_t bspApicId = LocalApic::getId();
+        cpus[0].apicId = bspApicId;
+
+        std::uint32_t apicIds[MAX_CPUS];
+        std::uint64_t madtApicAddress = 0;
+        const std::size_t foundCount =
+            Acpi::findCpus(bootParams.acpi_rsdp, bootParams.acpi_revision, apicIds, MAX_CPUS, &madtApicAddress);
+        if (foundCount > MAX_CPUS) {
+            SerialLog::print("SMP: more CPUs than MAX_CPUS, the rest stay asleep.\n");
+        }
+        if (bootParams.ap_trampoline == 0) {
+            SerialLog::print("SMP: no memory below 1 MiB for the trampoline, running on the BSP only.\n");
+            return 1;
+        }
+
+        //the BSP is somewhere in the list; the APs get the next blocks, in the MADT's order
+        const std::size_t listedCount = foundCount < MAX_CPUS ? foundCount : MAX_CPUS;
+        for (std::size_t i = 0; i < listedCount && cpuCount < MAX_CPUS; i++) {
+            if (apicIds[i] == bspApicId) {
+                continue;
+            }
+
+            //the index is the AP's to take when it starts
+            PerCpu::Data &cpu = cpus[cpuCount];
+            cpu.apicId = apicIds[i];
+            //the stacks grow down from the end of their array; the SysV ABI wants 16-byte alignment
+            cpu.kernelStackTop = reinterpret_cast<std::uint64_t>(apStacks[cpuCount - 1] + AP_STACK_SIZE);
+            cpuCount++;
+        }
+        if (cpuCount == 1) {
+            return 1;
+        }
+
+        TRACE_BEGIN("start_aps");
+        const std::uint8_t vector = ApTrampoline::install(bootParams.ap_trampoline, cpus + 1, cpuCount - 1, enterAp);
+
+        //every AP gets its INIT, then a single wait, then its startup IPIs: all of them boot at the same time
+        for (unsigned i = 1; i < cpuCount; i++) {
+            LocalApic::sendInit(cpus[i].apicId);
+        }
+        delayMicroseconds(INIT_DELAY_US);
+        for (unsigned i = 1; i < cpuCount; i++) {
+            LocalApic::sendStartup(cpus[i].apicId, vector);
+        }
+        delayMicroseconds(STARTUP_DELAY_US);
+        //the second startup IPI is only for the APs that missed the first (a running one ignores it anyway)
+        for (unsigned i = 1; i < cpuCount; i++) {
+            if (!__atomic_load_n(&cpus[i].isOnline, __ATOMIC_ACQUIRE)) {
+                LocalApic::sendStartup(cpus[i].apicId, vector);
+            }
+        }
+
+        const std::uint64_t start = Cpu::readTsc();
+        const std::uint64_t timeout = tscFrequency / 1000000 * AP_START_TIMEOUT_US;
+        while (__atomic_load_n(&onlineCount, __ATOMIC_ACQUIRE) < cpuCount && Cpu::readTsc() - start < timeout) {
+            Cpu::pause();
+        }
+
+        //the APs past the trampoline by now are waited for (they're only doing their own setup), the others park
+        const std::uint32_t claimedCount =
+            __atomic_fetch_or(&startupClaims, STARTUP_CLOSED, __ATOMIC_RELAXED) & ~STARTUP_CLOSED;
+        const unsigned startedCount = claimedCount + 1;
+        while (__atomic_load_n(&onlineCount, __ATOMIC_ACQUIRE) < startedCount) {
+            Cpu::pause();
+        }
+        TRACE_END("start_aps");
+
+        if (startedCount < cpuCount) {
+            SerialLog::print("SMP: some APs didn't start in time; they park if they ever do.\n");
+        }
+        return startedCount;
+    }
+
+    unsigned getCpuCount() {
+        return __atomic_load_n(&onlineCount, __ATOMIC_ACQUIRE);
+    }
+
+    PerCpu::Data *getCpu(const unsigned index) {
+        if (index >= MAX_CPUS) {
+            return nullptr;
+        }
+        PerCpu::Data *cpu = __atomic_load_n(&cpusByIndex[index], __ATOMIC_RELAXED);
+        if (cpu == nullptr || !__atomic_load_n(&cpu->isOnline, __ATOMIC_ACQUIRE)) {
+            return nullptr;
+        }
+        return cpu;
+    }
+
+    bool runOn(const unsigned index, const PerCpu::CallFunction function, void *argument) {
+        PerCpu::Data *cpu = getCpu(index);
+        if (cpu == nullptr) {
+            return false;
+        }
+
+        std::uint32_t expected = CALL_EMPTY;
+        if (!__atomic_compare_exchange_n(
+            &cpu->callState, &expected, CALL_FILLING, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            return false;
+        }
+        cpu->callFunction = function;
+        cpu->callArgument = argument;
+        __atomic_store_n(&cpu->callState, CALL_READY, __ATOMIC_RELEASE);
+        LocalApic::sendFixed(cpu->apicId, LocalApic::WAKE_VECTOR);
+        return true;
+    }
+
+    void runPendingCall() {
+        PerCpu::Data *cpu = PerCpu::current();
+        if (__atomic_load_n(&cpu->callState, __ATOMIC_ACQUIRE) != CALL_READY) {
+            return;
+        }
+
+        const PerCpu::CallFunction function = cpu->callFunction;
+        void *argument = cpu->callArgument;
+        __atomic_store_n(&cpu->callState, CALL_EMPTY, __ATOMIC_RELEASE);
+        function(argument);
+    }
+
+    [[noreturn]] void idleLoop() {
+        Timers::initCurrentCpu();
+
+        //nothing in the kernel stops the scheduler, but run can return in general
+        Scheduler::run();
+        while (true) {
+            asm volatile("cli; hlt");
+        }
+    }
+} //namespace Smp
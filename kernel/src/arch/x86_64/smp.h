@@ -0,0 +1,81 @@
+#ifndef KERNEL_ARCH_X86_64_SMP_H
+#define KERNEL_ARCH_X86_64_SMP_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <boot_params.h>
+
+#include "per_cpu.h"
+
+/**
+ * Bringing up the other CPUs (the APs) and keeping track of them. Every CPU gets a PerCpu::Data block, a kernel stack
+ * and the IST stacks, all static, and ends up in idleLoop, running threads.
+ */
+namespace Smp {
+    /**
+     * The most CPUs the kernel uses (the others stay asleep); the same as the allocators' per-CPU caches.
+     */
+    constexpr unsigned MAX_CPUS = 64;
+
+    /**
+     * The kernel stack of each AP: 32 KiB.
+     */
+    constexpr std::size_t AP_STACK_SIZE = 32 * 1024;
+
+    /**
+     * Each of the stacks a CPU switches to for NMI, #DB and #MC (see Idt): 8 KiB.
+     */
+    constexpr std::size_t IST_STACK_SIZE = 8 * 1024;
+
+    /**
+     * How long startAps waits for the APs to report in, in microseconds.
+     */
+    constexpr std::uint64_t AP_START_TIMEOUT_US = 100000;
+
+    /**
+     * Loads the kernel's GDT, IDT and TSS on the BSP, turns on SYSCALL and makes it CPU 0. Must be called first in
+     * kernel_main: PerCpu::current and getIndex don't work before.
+     * @param kernelStackTop The top of the stack the BSP runs on.
+     */
+    void initBsp(std::uint64_t kernelStackTop);
+
+    /**
+     * Finds the CPUs in the MADT and starts all of them with INIT-SIPI-SIPI. The APs are started together (each one
+     * finds its own block by APIC ID), so this takes about 10 ms whatever their number. Also sets up the timers
+     * (Timers::init). Threads::init must have been called: the APs go straight to idleLoop.
+     * @return The number of CPUs running, the BSP included.
+     */
+    unsigned startAps(const BootParams_t &bootParams);
+
+    /**
+     * Returns the number of CPUs running, numbered from 0 without gaps. Only grows while startAps runs.
+     */
+    unsigned getCpuCount();
+
+    /**
+     * Returns the block of a CPU, or nullptr if there's no such CPU running.
+     */
+    PerCpu::Data *getCpu(unsigned index);
+
+    /**
+     * Hands a call to the idle loop of another CPU, and wakes the CPU up if it's in hlt. The call is made once the
+     * CPU has no thread to run, with interrupts disabled. Doesn't wait for it to run.
+     * @return False if the CPU isn't running or still has a call to make.
+     */
+    bool runOn(unsigned index, PerCpu::CallFunction function, void *argument);
+
+    /**
+     * Makes the call handed to the current CPU with runOn, if there's one. Called by the scheduler's idle loop before
+     * it halts the CPU.
+     */
+    void runPendingCall();
+
+    /**
+     * What every CPU ends up in once it's done with its own setup: sets up the CPU's timer and runs the scheduler on
+     * it, whose idle loop halts the CPU until an interrupt when there's no thread to run.
+     */
+    [[noreturn]] void idleLoop();
+} //namespace Smp
+
+#endif //KERNEL_ARCH_X86_64_SMP_H
@@ -0,0 +1,116 @@
+#include "syscall_entry.h"
+
+#include "../../syscalls.h"
+#include "cpu.h"
+#include "gdt.h"
+#include "per_cpu.h"
+
+#define STRINGIFY_VALUE(x) #x
+#define STRINGIFY(x) STRINGIFY_VALUE(x)
+
+/* SYSCALL leaves rsp alone and masks the interrupts (FMASK), so nothing maskable can come in before the entry is on
+ * the kernel stack; NMI, #DB and #MC still can, and get their own stacks (see Idt). The 10 pushes keep the stack
+ * 16-byte aligned for the call, as the thread's stack top is. The way back is the mirror image with the interrupts
+ * masked again, from the pop of the user rsp to sysretq.
+ *
+ * SYSRET jumps to rcx as it is: a non-canonical one would fault in kernel mode, on the user stack. The return address
+ * comes from SYSCALL itself and the last user page below the hole is never mapped (see UserMemory), so it's always
+ * canonical. */
+asm(R"(
+.pushsection .text
+.global syscallEntry
+syscallEntry:
+    swapgs
+    mov %rsp, %gs:)" STRINGIFY(PER_CPU_USER_STACK_POINTER) R"(
+    mov %gs:)" STRINGIFY(PER_CPU_THREAD_STACK_TOP) R"(, %rsp
+    pushq %gs:)" STRINGIFY(PER_CPU_USER_STACK_POINTER) R"(
+    push %r11
+    push %rcx
+    push %r9
+    push %r8
+    push %r10
+    push %rdx
+    push %rsi
+    push %rdi
+    push %rax
+    sti
+    mov %rsp, %rdi
+    call syscallDispatch
+    cli
+    pop %rax
+    pop %rdi
+    pop %rsi
+    pop %rdx
+    pop %r10
+    pop %r8
+    pop %r9
+    pop %rcx
+    pop %r11
+    pop %rsp
+    swapgs
+    sysretq
+.popsection
+)");
+
+extern "C" char syscallEntry[];
+
+namespace SyscallEntry {
+    static_assert(sizeof(Frame) % 16 == 0, "the entry relies on the frame keeping the stack aligned");
+
+    /**
+     * Bit 20 of CPUID 0x80000001 EDX.
+     */
+    constexpr std::uint32_t CPUID_NO_EXECUTE = 1 << 20;
+
+    /**
+     * The user RFLAGS enterUserMode starts with: the interrupts enabled, and the bit that always reads 1.
+     */
+    constexpr std::uint64_t USER_START_RFLAGS = Cpu::RFLAGS_INTERRUPT_ENABLE | 1 << 1;
+
+    void initCurrentCpu() {
+        std::uint64_t efer = Cpu::readMsr(Cpu::MSR_EFER) | Cpu::EFER_SYSCALL_ENABLE;
+        //the paginator sets NX on every page mapped without ExecuteBit, and the bit is reserved until this
+        if (Cpu::cpuid(0x80000000).eax >= 0x80000001 && (Cpu::cpuid(0x80000001).edx & CPUID_NO_EXECUTE) != 0) {
+            efer |= Cpu::EFER_NO_EXECUTE_ENABLE;
+        }
+        Cpu::writeMsr(Cpu::MSR_EFER, efer);
+
+        //SYSCALL loads CS from bits 32-47 and SS 8 above; SYSRET loads CS 16 above bits 48-63 and SS 8 above, RPL 3
+        Cpu::writeMsr(Cpu::MSR_STAR, static_cast<std::uint64_t>(Gdt::USER_BASE_SELECTOR) << 48
+                                     | static_cast<std::uint64_t>(Gdt::KERNEL_CODE_SELECTOR) << 32);
+        Cpu::writeMsr(Cpu::MSR_LSTAR, reinterpret_cast<std::uint64_t>(syscallEntry));
+        Cpu::writeMsr(Cpu::MSR_FMASK, Cpu::RFLAGS_INTERRUPT_ENABLE | Cpu::RFLAGS_DIRECTION | Cpu::RFLAGS_TRAP
+                                      | Cpu::RFLAGS_ALIGNMENT_CHECK);
+    }
+
+    void enterUserMode(const std::uint64_t rip, const std::uint64_t rsp) {
+        //nothing of the kernel's is left in the registers; the interrupts stay off until sysretq loads RFLAGS
+        asm volatile(
+            "cli\n"
+            "mov %%rsi, %%rsp\n"
+            "mov %2, %%r11\n"
+            "xor %%eax, %%eax\n"
+            "xor %%ebx, %%ebx\n"
+            "xor %%edx, %%edx\n"
+            "xor %%esi, %%esi\n"
+            "xor %%edi, %%edi\n"
+            "xor %%ebp, %%ebp\n"
+            "xor %%r8d, %%r8d\n"
+            "xor %%r9d, %%r9d\n"
+            "xor %%r10d, %%r10d\n"
+            "xor %%r12d, %%r12d\n"
+            "xor %%r13d, %%r13d\n"
+            "xor %%r14d, %%r14d\n"
+            "xor %%r15d, %%r15d\n"
+            "swapgs\n"
+            "sysretq\n"
+            :
+            : "c"(rip), "S"(rsp), "i"(USER_START_RFLAGS)
+            : "memory");
+        __builtin_unreachable();
+    }
+} //namespace SyscallEntry
+
+extern "C" void syscallDispatch(SyscallEntry::Frame *frame) {
+    frame->rax = Syscalls::dispatch(frame->rax, frame->rdi, frame->rsi, frame->rdx, frame->r10, frame->r8, frame->r9);
+}
@@ -0,0 +1,53 @@
+#ifndef KERNEL_ARCH_X86_64_SYSCALL_ENTRY_H
+#define KERNEL_ARCH_X86_64_SYSCALL_ENTRY_H
+
+#include <cstdint>
+
+/**
+ * The way into the kernel from user mode, and the way back, with SYSCALL and SYSRET: no descriptor table, no stack
+ * switch by the CPU and no frame pushed, so a system call costs a fraction of an int/iretq round trip.
+ *
+ * SYSCALL doesn't switch stacks: the entry swapgs to the per-CPU block, takes the running thread's kernel stack from
+ * it (set by the switchingTo hook), and pushes a Frame for Syscalls::dispatch with interrupts enabled. The number is
+ * in rax and the arguments in rdi, rsi, rdx, r10, r8 and r9 (rcx and r11 hold the return address and RFLAGS), like on
+ * Linux; the result comes back in rax, and every other register is kept.
+ */
+namespace SyscallEntry {
+    /**
+     * What the entry pushes on the kernel stack, from the last register it pushed.
+     */
+    struct Frame {
+        std::uint64_t rax;
+        std::uint64_t rdi;
+        std::uint64_t rsi;
+        std::uint64_t rdx;
+        std::uint64_t r10;
+        std::uint64_t r8;
+        std::uint64_t r9;
+        /**
+         * The user's rip, saved by SYSCALL.
+         */
+        std::uint64_t rcx;
+        /**
+         * The user's RFLAGS, saved by SYSCALL.
+         */
+        std::uint64_t r11;
+        std::uint64_t rsp;
+    };
+
+    /**
+     * Turns on SYSCALL (and NX pages, if the CPU has them) on the current CPU, and points it to the entry. Called by
+     * every CPU after PerCpu::install.
+     */
+    void initCurrentCpu();
+
+    /**
+     * Drops the current thread to user mode at the given address and stack, with interrupts enabled and every other
+     * register cleared. From a thread (not an idle loop), whose kernel stack the entry then reuses from its top.
+     * @param rip Where to start; must be canonical.
+     * @param rsp The user stack pointer.
+     */
+    [[noreturn]] void enterUserMode(std::uint64_t rip, std::uint64_t rsp);
+} //namespace SyscallEntry
+
+#endif //KERNEL_ARCH_X86_64_SYSCALL_ENTRY_H
@@ -0,0 +1,49 @@
+#include <cstddef>
+#include <cstdint>
+
+#include <serial_log/serial_log.h>
+
+#include "log.h"
+
+namespace Log {
+    /**
+     * 64 KiB, so a burst from every CPU fits while the UART (about 11 KiB/s) catches up.
+     */
+    constexpr std::size_t RING_SIZE = 64 * 1024;
+
+    alignas(64) static std::uint64_t ringStorage[RING_SIZE / sizeof(std::uint64_t)];
+    static constinit SerialLog::LogRing ring(ringStorage, RING_SIZE);
+
+    /**
+     * The longest message print(prefix, value, suffix) makes; the rest is cut.
+     */
+    constexpr std::size_t MAX_MESSAGE_SIZE = 256;
+
+    void init() {
+        SerialLog::init(&ring, SerialLog::Uart16550(SerialLog::COM1_PORT));
+    }
+
+    static std::size_t appendString(char *message, std::size_t size, const char *string) {
+        while (*string != '\0' && size < MAX_MESSAGE_SIZE) {
+            message[size++] = *string++;
+        }
+        return size;
+    }
+
+    void print(const char *prefix, std::uint64_t value, const char *suffix) {
+        char digits[20];
+        int digitCount = 0;
+        do {
+            digits[digitCount++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value != 0);
+
+        char message[MAX_MESSAGE_SIZE];
+        std::size_t size = appendString(message, 0, prefix);
+        while (digitCount > 0 && size < MAX_MESSAGE_SIZE) {
+            message[size++] = digits[--digitCount];
+        }
+        size = appendString(message, size, suffix);
+        SerialLog::write(message, size);
+    }
+} //namespace Log
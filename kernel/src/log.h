@@ -0,0 +1,21 @@
+#ifndef KERNEL_LOG_H
+#define KERNEL_LOG_H
+
+#include <cstdint>
+
+/**
+ * The kernel's log, on COM1 through SerialLog (SerialLog::print and the rest work once init was called).
+ */
+namespace Log {
+    /**
+     * Sets up COM1 and the ring the messages are queued in.
+     */
+    void init();
+
+    /**
+     * Logs "<prefix><value in decimal><suffix>" as one message.
+     */
+    void print(const char *prefix, std::uint64_t value, const char *suffix);
+} //namespace Log
+
+#endif //KERNEL_LOG_H
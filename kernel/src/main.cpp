@@ -1,4 +1,27 @@
-extern "C" [[noreturn]] void kernel_main(void) {
+#include <c_husky/mem_routines.h>
+
+#include <boot_params.h>
+#include <serial_log/serial_log.h>
+#include <trace/trace.h>
+
+#include "log.h"
+#include "memory.h"
+#include "syscalls.h"
+#include "threads.h"
+#include "vdso.h"
+#include "arch/x86_64/smp.h"
+
+#ifdef WITH_SYSCALL_BENCH
+#include "syscall_bench.h"
+#endif
+
+/**
+ * The bootloader's block lives in memory the kernel reclaims, so the kernel works from its own copy.
+ */
+static constinit BootParams_t bootParams = {};
+
+[[noreturn]] static void halt() {
+    SerialLog::flush();
     while (true) {
 #if __x86_64
         asm("cli");
@@ -6,3 +29,69 @@ extern "C" [[noreturn]] void kernel_main(void) {
 #endif
     }
 }
+
+static void writeToLog(const char *data, const std::size_t size, void *) {
+    //the trace is much bigger than the ring, so this waits for room instead of dropping lines
+    if (!SerialLog::write(data, size)) {
+        SerialLog::flush();
+        SerialLog::write(data, size);
+    }
+}
+
+/**
+ * Writes the boot trace to the serial port, as Chrome trace JSON (to cut out of debug.log and load into Perfetto).
+ */
+static void dumpTrace() {
+    const Trace::Buffer *traceBuffer = Trace::getBuffer();
+    if (traceBuffer != nullptr) {
+        Trace::writeChromeTrace(*traceBuffer, writeToLog, nullptr);
+    }
+}
+
+extern "C" [[noreturn]] void kernel_main(const BootParams_t *bootloaderParams) {
+    /* ERMS or baseline: the thread switches and interrupt stubs don't save the YMM registers, so AVX2 routines
+     * preempted in one thread would have their registers clobbered by another. */
+    CHusky::Mem::resolveRoutines(false);
+    Log::init();
+
+    //a bootloader from another version could lay out the block differently, so nothing else can be trusted
+    if (bootloaderParams == nullptr
+        || bootloaderParams->magic != BOOT_PARAMS_MAGIC
+        || bootloaderParams->version != BOOT_PARAMS_VERSION
+        || bootloaderParams->size != sizeof(BootParams_t)) {
+        SerialLog::print("The boot parameters don't match this kernel.\n");
+        halt();
+    }
+    bootParams = *bootloaderParams;
+    Smp::initBsp(bootParams.kernel_stack_top);
+
+    //the buffer is only kept recording into if the bootloader managed to set it up
+    Trace::Buffer *traceBuffer = bootParams.trace_buffer;
+    if (traceBuffer != nullptr && traceBuffer->magic == Trace::BUFFER_MAGIC) {
+        Trace::setBuffer(traceBuffer);
+    }
+    TRACE_BEGIN("kernel_main");
+
+    SerialLog::print("ChihuahuaOS kernel started.\n");
+
+    if (Memory::init(bootParams)) {
+        Log::print("", Memory::getFreeFrameCount() / 256, " MiB of memory free.\n");
+    } else {
+        SerialLog::print("No usable memory in the memory map.\n");
+    }
+    Threads::init();
+    Syscalls::init();
+
+    const unsigned cpuCount = Smp::startAps(bootParams);
+    Log::print("Running on ", cpuCount, " CPUs.\n");
+    Vdso::init();
+#ifdef WITH_SYSCALL_BENCH
+    SyscallBench::start();
+#endif
+
+    TRACE_END("kernel_main");
+    dumpTrace();
+    SerialLog::flush();
+
+    Smp::idleLoop();
+}
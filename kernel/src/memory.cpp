@@ -0,0 +1,73 @@
+#include <frame_allocator/buddy_allocator.h>
+#include <frame_allocator/memory_map.h>
+#include <frame_allocator/page_table_frames.h>
+#include <scheduler/scheduler.h>
+#include <slab/object_cache.h>
+
+#include "memory.h"
+
+#include "arch/x86_64/per_cpu.h"
+
+namespace Memory {
+    static constinit FrameAllocator::BuddyAllocator allocator;
+
+    /**
+     * The smallest order whose blocks hold size bytes.
+     */
+    static int getOrder(const std::size_t size) {
+        int order = 0;
+        while ((FrameAllocator::FRAME_SIZE << order) < size) {
+            order++;
+        }
+        return order;
+    }
+
+    static void *allocateSlabPages(const std::size_t size) {
+        return allocatePages(getOrder(size));
+    }
+
+    static void releaseSlabPages(void *pages, const std::size_t size) {
+        freePages(pages, getOrder(size));
+    }
+
+    bool init(const BootParams_t &bootParams) {
+        if (!FrameAllocator::seedFromRegions(allocator, bootParams.memory_regions, bootParams.memory_region_count, 0)) {
+            return false;
+        }
+
+        //PerCpu::install ran already (in Smp::initBsp), so the index is right on every CPU from here on
+        allocator.setCpuIndexFunction(PerCpu::getIndex);
+        FrameAllocator::setPageTableFrameSource(&allocator);
+        Slab::setPageSource(allocateSlabPages, releaseSlabPages);
+        return true;
+    }
+
+    void *allocatePages(const int order) {
+        if (order > FrameAllocator::MAX_ORDER) {
+            return nullptr;
+        }
+        //single pages, by far the most common, come from the cache of the current CPU without taking the lock
+        if (order == 0) {
+            const Scheduler::PreemptionGuard guard;
+            return reinterpret_cast<void *>(allocator.allocateFrame());
+        }
+        return reinterpret_cast<void *>(allocator.allocate(order));
+    }
+
+    void freePages(void *pages, const int order) {
+        if (pages == nullptr) {
+            return;
+        }
+
+        if (order == 0) {
+            const Scheduler::PreemptionGuard guard;
+            allocator.freeFrame(reinterpret_cast<std::uint64_t>(pages));
+        } else {
+            allocator.free(reinterpret_cast<std::uint64_t>(pages), order);
+        }
+    }
+
+    std::size_t getFreeFrameCount() {
+        return allocator.getFreeFrameCount();
+    }
+} //namespace Memory
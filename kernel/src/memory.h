@@ -0,0 +1,40 @@
+#ifndef KERNEL_MEMORY_H
+#define KERNEL_MEMORY_H
+
+#include <cstddef>
+
+#include <boot_params.h>
+
+/**
+ * The kernel's physical memory: a buddy allocator over the Usable regions of the boot memory map (identity-mapped by
+ * the bootloader, so a physical address is also the virtual one). It's also the page source of the slab heap behind
+ * operator new, and of the page tables (through FrameAllocator::allocatePageTableFrame).
+ *
+ * Single pages go through the per-CPU caches of the allocator with preemption disabled, like the slab heap (so not
+ * from an interrupt handler that could land in the middle of another call); larger blocks come from the buddy lists.
+ */
+namespace Memory {
+    /**
+     * Seeds the allocator from the memory map and hands it to the slab heap. Until then, every allocation fails.
+     * @return False if there's no usable memory.
+     */
+    bool init(const BootParams_t &bootParams);
+
+    /**
+     * Allocates 2^order contiguous pages, aligned to their size.
+     * @return nullptr if there's no block large enough.
+     */
+    [[nodiscard]] void *allocatePages(int order);
+
+    /**
+     * Frees pages given by allocatePages, with the same order.
+     */
+    void freePages(void *pages, int order);
+
+    /**
+     * Returns the number of free frames (without the ones in the per-CPU caches).
+     */
+    [[nodiscard]] std::size_t getFreeFrameCount();
+} //namespace Memory
+
+#endif //KERNEL_MEMORY_H
@@ -1,16 +1,26 @@
 //These are necessary for C++ to function correctly in a kernel environment,
 //see https://wiki.osdev.org/C%2B%2B
 
+#include <cstddef>
+
+#include <scheduler/scheduler.h>
+#include <serial_log/serial_log.h>
+#include <slab/heap.h>
+
 /**
  * For pure virtual functions; should never get called
  */
 extern "C" void __cxa_pure_virtual() // NOLINT(*-reserved-identifier)
 {
-    //TODO: print an error message.
+    SerialLog::print("A pure virtual function was called.\n");
+    SerialLog::flush();
 }
 
 /**
- * This is for static variable guards (specific to GCC).
+ * This is for static variable guards (specific to GCC). Following the Itanium C++ ABI, the first byte of the guard is
+ * set once the variable is initialized (the code GCC inlines checks it before calling in); the second one is taken by
+ * the thread running the initializer, while the other ones spin until it's done. The initializer runs with preemption
+ * enabled, so a thread spinning on the same CPU eventually lets it finish.
  */
 namespace __cxxabiv1 // NOLINT(*-reserved-identifier)
 {
@@ -19,23 +29,91 @@ namespace __cxxabiv1 // NOLINT(*-reserved-identifier)
     /* The ABI requires a 64-bit type.  */
     __extension__ typedef int __guard __attribute__((mode(__DI__))); // NOLINT(*-reserved-identifier)
 
-    //TODO: we need to implement some mutexes here
     extern "C" int __cxa_guard_acquire (__guard *); // NOLINT(*-reserved-identifier)
     extern "C" void __cxa_guard_release (__guard *); // NOLINT(*-reserved-identifier)
     extern "C" void __cxa_guard_abort (__guard *); // NOLINT(*-reserved-identifier)
 
-    extern "C" int __cxa_guard_acquire (__guard *g) 
+    static char *getInitializedByte(__guard *g)
     {
-        return !*reinterpret_cast<char *>(g);
+        return reinterpret_cast<char *>(g);
     }
 
-    extern "C" void __cxa_guard_release (__guard *g)
+    static char *getInProgressByte(__guard *g)
     {
-        *reinterpret_cast<char *>(g) = 1;
+        return reinterpret_cast<char *>(g) + 1;
     }
 
-    extern "C" void __cxa_guard_abort (__guard *)
+    extern "C" int __cxa_guard_acquire (__guard *g)
     {
+        for (;;) {
+            if (__atomic_load_n(getInitializedByte(g), __ATOMIC_ACQUIRE) != 0) {
+                return 0;
+            }
+            if (__atomic_exchange_n(getInProgressByte(g), 1, __ATOMIC_ACQUIRE) == 0) {
+                //another thread may have finished between the check and taking the guard
+                if (__atomic_load_n(getInitializedByte(g), __ATOMIC_ACQUIRE) != 0) {
+                    __atomic_store_n(getInProgressByte(g), 0, __ATOMIC_RELEASE);
+                    return 0;
+                }
+                return 1;
+            }
+            while (__atomic_load_n(getInProgressByte(g), __ATOMIC_RELAXED) != 0) {
+                asm volatile("pause");
+            }
+        }
+    }
 
+    extern "C" void __cxa_guard_release (__guard *g)
+    {
+        //the variable is visible as initialized before the guard is given up, so nobody runs the initializer again
+        __atomic_store_n(getInitializedByte(g), 1, __ATOMIC_RELEASE);
+        __atomic_store_n(getInProgressByte(g), 0, __ATOMIC_RELEASE);
     }
-}
\ No newline at end of file
+
+    extern "C" void __cxa_guard_abort (__guard *g)
+    {
+        //the initializer didn't complete: the next thread to get the guard runs it again
+        __atomic_store_n(getInProgressByte(g), 0, __ATOMIC_RELEASE);
+    }
+}
+
+/* The global operator new and delete go to the size-classed slab caches. There are no exceptions in the kernel, so
+ * running out of memory returns nullptr instead of throwing std::bad_alloc. Until the page source is set, every
+ * allocation fails. The slab caches are per CPU, so the thread must not move to another CPU (or be preempted by one
+ * using the same cache) in the middle of a call. */
+
+void *operator new(std::size_t size)
+{
+    const Scheduler::PreemptionGuard guard;
+    return Slab::allocate(size);
+}
+
+void *operator new[](std::size_t size)
+{
+    const Scheduler::PreemptionGuard guard;
+    return Slab::allocate(size);
+}
+
+void operator delete(void *memory) noexcept
+{
+    const Scheduler::PreemptionGuard guard;
+    Slab::free(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+    const Scheduler::PreemptionGuard guard;
+    Slab::free(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept
+{
+    const Scheduler::PreemptionGuard guard;
+    Slab::free(memory);
+}
+
+void operator delete[](void *memory, std::size_t) noexcept
+{
+    const Scheduler::PreemptionGuard guard;
+    Slab::free(memory);
+}
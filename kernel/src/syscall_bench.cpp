@@ -0,0 +1,231 @@
+#include <cstddef>
+#include <initializer_list>
+
+#include <c_husky/mem_routines.h>
+#include <serial_log/serial_log.h>
+
+#include "syscall_bench.h"
+
+#include "log.h"
+#include "memory.h"
+#include "syscalls.h"
+#include "threads.h"
+#include "timers.h"
+#include "user_memory.h"
+#include "vdso.h"
+#include "arch/x86_64/syscall_entry.h"
+
+#define STRINGIFY_VALUE(x) #x
+#define STRINGIFY(x) STRINGIFY_VALUE(x)
+
+//the layout of the results page and the numbers the user code uses (asserted below)
+#define RESULT_ITERATIONS 0
+#define RESULT_SYSCALL_CYCLES 8
+#define RESULT_LEGACY_CYCLES 16
+#define RESULT_IS_DONE 24
+#define RESULT_CLOCK_GET_TIME_ADDRESS 32
+#define RESULT_GET_CPU_ADDRESS 40
+#define RESULT_CLOCK_GET_TIME_CYCLES 48
+#define RESULT_GET_CPU_CYCLES 56
+#define CLOCK_MONOTONIC 1
+#define SYSCALL_NULL 0
+#define SYSCALL_EXIT 3
+#define SYSCALL_LEGACY_VECTOR 0x80
+
+/* The user code, copied to its own page: the results page comes right after it, so it's reached rip-relative. Each
+ * loop is timed as a whole, between two serialized TSC reads, so the calls run back to back like in a real program.
+ * The timer ticks land in both loops the same way. The vDSO functions are called the same way, from the addresses the
+ * kernel looked up (skipped if it didn't find them), with the stack as their output. */
+asm(R"(
+.pushsection .rodata
+.macro SYSCALL_BENCH_READ_TSC
+    lfence
+    rdtsc
+    shl $32, %rdx
+    or %rdx, %rax
+.endm
+
+.global syscallBenchUserCode
+syscallBenchUserCode:
+    leaq syscallBenchUserCode + 4096(%rip), %rbx
+    mov )" STRINGIFY(RESULT_ITERATIONS) R"((%rbx), %r12
+
+    SYSCALL_BENCH_READ_TSC
+    mov %rax, %r13
+    mov %r12, %r14
+1:
+    mov $)" STRINGIFY(SYSCALL_NULL) R"(, %eax
+    syscall
+    dec %r14
+    jnz 1b
+    SYSCALL_BENCH_READ_TSC
+    sub %r13, %rax
+    mov %rax, )" STRINGIFY(RESULT_SYSCALL_CYCLES) R"((%rbx)
+
+    SYSCALL_BENCH_READ_TSC
+    mov %rax, %r13
+    mov %r12, %r14
+2:
+    mov $)" STRINGIFY(SYSCALL_NULL) R"(, %eax
+    int $)" STRINGIFY(SYSCALL_LEGACY_VECTOR) R"(
+    dec %r14
+    jnz 2b
+    SYSCALL_BENCH_READ_TSC
+    sub %r13, %rax
+    mov %rax, )" STRINGIFY(RESULT_LEGACY_CYCLES) R"((%rbx)
+
+    mov )" STRINGIFY(RESULT_CLOCK_GET_TIME_ADDRESS) R"((%rbx), %r15
+    test %r15, %r15
+    jz 4f
+    sub $16, %rsp
+    SYSCALL_BENCH_READ_TSC
+    mov %rax, %r13
+    mov %r12, %r14
+3:
+    mov $)" STRINGIFY(CLOCK_MONOTONIC) R"(, %edi
+    mov %rsp, %rsi
+    call *%r15
+    dec %r14
+    jnz 3b
+    SYSCALL_BENCH_READ_TSC
+    sub %r13, %rax
+    mov %rax, )" STRINGIFY(RESULT_CLOCK_GET_TIME_CYCLES) R"((%rbx)
+    add $16, %rsp
+4:
+
+    mov )" STRINGIFY(RESULT_GET_CPU_ADDRESS) R"((%rbx), %r15
+    test %r15, %r15
+    jz 6f
+    sub $16, %rsp
+    SYSCALL_BENCH_READ_TSC
+    mov %rax, %r13
+    mov %r12, %r14
+5:
+    mov %rsp, %rdi
+    xor %esi, %esi
+    xor %edx, %edx
+    call *%r15
+    dec %r14
+    jnz 5b
+    SYSCALL_BENCH_READ_TSC
+    sub %r13, %rax
+    mov %rax, )" STRINGIFY(RESULT_GET_CPU_CYCLES) R"((%rbx)
+    add $16, %rsp
+6:
+
+    movq $1, )" STRINGIFY(RESULT_IS_DONE) R"((%rbx)
+    mov $)" STRINGIFY(SYSCALL_EXIT) R"(, %eax
+    syscall
+    ud2
+.global syscallBenchUserCodeEnd
+syscallBenchUserCodeEnd:
+.popsection
+)");
+
+extern "C" const char syscallBenchUserCode[];
+extern "C" const char syscallBenchUserCodeEnd[];
+
+namespace SyscallBench {
+    struct Results {
+        /**
+         * Set by the kernel before the user thread starts.
+         */
+        std::uint64_t iterations;
+        std::uint64_t syscallCycles;
+        std::uint64_t legacyCycles;
+        /**
+         * Set by the user thread once all loops are done.
+         */
+        std::uint64_t isDone;
+        /**
+         * The vDSO functions, set by the kernel (0 to skip a loop).
+         */
+        std::uint64_t clockGetTimeAddress;
+        std::uint64_t getCpuAddress;
+        std::uint64_t clockGetTimeCycles;
+        std::uint64_t getCpuCycles;
+    };
+
+    static_assert(offsetof(Results, iterations) == RESULT_ITERATIONS);
+    static_assert(offsetof(Results, syscallCycles) == RESULT_SYSCALL_CYCLES);
+    static_assert(offsetof(Results, legacyCycles) == RESULT_LEGACY_CYCLES);
+    static_assert(offsetof(Results, isDone) == RESULT_IS_DONE);
+    static_assert(offsetof(Results, clockGetTimeAddress) == RESULT_CLOCK_GET_TIME_ADDRESS);
+    static_assert(offsetof(Results, getCpuAddress) == RESULT_GET_CPU_ADDRESS);
+    static_assert(offsetof(Results, clockGetTimeCycles) == RESULT_CLOCK_GET_TIME_CYCLES);
+    static_assert(offsetof(Results, getCpuCycles) == RESULT_GET_CPU_CYCLES);
+    static_assert(static_cast<std::uint64_t>(Syscalls::Number::Null) == SYSCALL_NULL);
+    static_assert(static_cast<std::uint64_t>(Syscalls::Number::Exit) == SYSCALL_EXIT);
+    static_assert(Syscalls::LEGACY_VECTOR == SYSCALL_LEGACY_VECTOR);
+    static_assert(PAGE_SIZE == 4096, "the user code expects the results page 4096 bytes after it");
+
+    constexpr std::uint64_t ITERATIONS = 100000;
+    constexpr std::uint64_t CODE_ADDRESS = UserMemory::START;
+    constexpr std::uint64_t RESULTS_ADDRESS = CODE_ADDRESS + PAGE_SIZE;
+    constexpr std::uint64_t STACK_ADDRESS = RESULTS_ADDRESS + PAGE_SIZE;
+    /**
+     * How often the kernel thread looks at the results.
+     */
+    constexpr std::uint64_t POLL_INTERVAL_NS = 10000000;
+
+    static void runUser(void *) {
+        SyscallEntry::enterUserMode(CODE_ADDRESS, STACK_ADDRESS + PAGE_SIZE);
+    }
+
+    /**
+     * Sets up the user pages and thread, and waits for the results. The pages stay mapped afterwards: nothing unmaps
+     * user memory yet.
+     */
+    static void run(void *) {
+        void *code = Memory::allocatePages(0);
+        void *results = Memory::allocatePages(0);
+        void *stack = Memory::allocatePages(0);
+        if (code == nullptr || results == nullptr || stack == nullptr) {
+            for (void *page : {code, results, stack}) {
+                if (page != nullptr) {
+                    Memory::freePages(page, 0);
+                }
+            }
+            SerialLog::print("Syscall bench: not enough memory.\n");
+            return;
+        }
+
+        //user mode sees all of them, so nothing of the kernel's is left in them
+        CHusky::Mem::zeroPage(code);
+        CHusky::Mem::zeroPage(results);
+        CHusky::Mem::zeroPage(stack);
+        CHusky::Mem::copy(code, syscallBenchUserCode, syscallBenchUserCodeEnd - syscallBenchUserCode);
+        auto *sharedResults = static_cast<Results *>(results);
+        sharedResults->iterations = ITERATIONS;
+        const bool hasClockGetTime = Vdso::findSymbol("__vdso_clock_gettime", &sharedResults->clockGetTimeAddress);
+        const bool hasGetCpu = Vdso::findSymbol("__vdso_getcpu", &sharedResults->getCpuAddress);
+
+        if (!UserMemory::mapPage(CODE_ADDRESS, code, false, true)
+            || !UserMemory::mapPage(RESULTS_ADDRESS, results, true, false)
+            || !UserMemory::mapPage(STACK_ADDRESS, stack, true, false)) {
+            SerialLog::print("Syscall bench: couldn't map the user pages.\n");
+            return;
+        }
+        if (Threads::create(runUser, nullptr, "syscall_bench_user") == nullptr) {
+            SerialLog::print("Syscall bench: couldn't create the user thread.\n");
+            return;
+        }
+
+        while (!__atomic_load_n(&sharedResults->isDone, __ATOMIC_ACQUIRE)) {
+            Timers::sleep(POLL_INTERVAL_NS);
+        }
+        Log::print("Syscall bench: null call round trip, SYSCALL/SYSRET ", sharedResults->syscallCycles / ITERATIONS,
+                   " cycles");
+        Log::print(", int 0x80/iretq ", sharedResults->legacyCycles / ITERATIONS, " cycles.\n");
+        if (hasClockGetTime && hasGetCpu) {
+            Log::print("Syscall bench: vDSO clock_gettime ", sharedResults->clockGetTimeCycles / ITERATIONS, " cycles");
+            Log::print(", getcpu ", sharedResults->getCpuCycles / ITERATIONS, " cycles.\n");
+        }
+    }
+
+    void start() {
+        if (Threads::create(run, nullptr, "syscall_bench") == nullptr) {
+            SerialLog::print("Syscall bench: couldn't create the thread.\n");
+        }
+    }
+} //namespace SyscallBench
@@ -0,0 +1,21 @@
+#ifndef KERNEL_SYSCALL_BENCH_H
+#define KERNEL_SYSCALL_BENCH_H
+
+/**
+ * The round trip of a null system call from user mode, timed with the TSC at boot (under QEMU/KVM or on hardware):
+ * SYSCALL/SYSRET against the int 0x80/iretq baseline, through the same dispatcher. There's no host equivalent, as the
+ * cost is the privilege switch itself.
+ *
+ * A user thread runs a loop of each from a code page, then exits; a kernel thread logs the cycles per call. The same
+ * loops time the vDSO's clock_gettime and getcpu, what a call costs when it doesn't enter the kernel at all.
+ *
+ * Only built with the syscall_bench option (meson configure -Dsyscall_bench=true), which defines WITH_SYSCALL_BENCH.
+ */
+namespace SyscallBench {
+    /**
+     * Starts the benchmark threads. Called once, after Smp::startAps.
+     */
+    void start();
+} //namespace SyscallBench
+
+#endif //KERNEL_SYSCALL_BENCH_H
@@ -0,0 +1,73 @@
+#include <scheduler/scheduler.h>
+
+#include "syscalls.h"
+
+#include "timers.h"
+#include "arch/x86_64/cpu.h"
+#include "arch/x86_64/idt.h"
+
+namespace Syscalls {
+    struct Arguments {
+        std::uint64_t values[6];
+    };
+
+    typedef std::uint64_t (*Function)(const Arguments &arguments);
+
+    static std::uint64_t doNull(const Arguments &) {
+        return 0;
+    }
+
+    static std::uint64_t doYield(const Arguments &) {
+        Scheduler::yield();
+        return 0;
+    }
+
+    static std::uint64_t doSleep(const Arguments &arguments) {
+        Timers::sleep(arguments.values[0]);
+        return 0;
+    }
+
+    static std::uint64_t doExit(const Arguments &) {
+        Scheduler::exit();
+    }
+
+    /**
+     * Indexed with Number.
+     */
+    static constexpr Function functions[] = {
+        doNull,
+        doYield,
+        doSleep,
+        doExit,
+    };
+
+    static_assert(sizeof(functions) / sizeof(functions[0]) == static_cast<std::size_t>(Number::Count),
+                  "every number needs its function");
+
+    static void onLegacyInterrupt(Idt::InterruptFrame *frame) {
+        //an interrupt gate masks the interrupts, and a call can block
+        Cpu::restoreInterrupts(true);
+        frame->rax = dispatch(frame->rax, frame->rdi, frame->rsi, frame->rdx, frame->r10, frame->r8, frame->r9);
+        Cpu::disableInterrupts();
+    }
+
+    void init() {
+        Idt::setHandler(LEGACY_VECTOR, onLegacyInterrupt);
+        Idt::setUserCallable(LEGACY_VECTOR);
+    }
+
+    std::uint64_t dispatch(
+        const std::uint64_t number,
+        const std::uint64_t argument0,
+        const std::uint64_t argument1,
+        const std::uint64_t argument2,
+        const std::uint64_t argument3,
+        const std::uint64_t argument4,
+        const std::uint64_t argument5) {
+        if (number >= static_cast<std::uint64_t>(Number::Count)) {
+            return INVALID_NUMBER;
+        }
+        const Arguments arguments = {{argument0, argument1, argument2, argument3, argument4, argument5}};
+        return functions[number](arguments);
+    }
+} //namespace Syscalls
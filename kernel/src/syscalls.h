@@ -0,0 +1,60 @@
+#ifndef KERNEL_SYSCALLS_H
+#define KERNEL_SYSCALLS_H
+
+#include <cstdint>
+
+/**
+ * The system calls, numbered and looked up in a table. They're entered with SYSCALL (see SyscallEntry); int 0x80
+ * reaches the same table with the same registers, but only as the baseline the syscall benchmark compares with.
+ */
+namespace Syscalls {
+    enum class Number : std::uint64_t {
+        /**
+         * Does nothing and returns 0: the cost of getting in and out.
+         */
+        Null,
+        /**
+         * Lets another thread run.
+         */
+        Yield,
+        /**
+         * Blocks the thread for at least the number of nanoseconds in the first argument.
+         */
+        Sleep,
+        /**
+         * Ends the thread.
+         */
+        Exit,
+        Count,
+    };
+
+    /**
+     * What a number without a call returns.
+     */
+    constexpr std::uint64_t INVALID_NUMBER = ~0ull;
+
+    /**
+     * The vector of the int 0x80 entry.
+     */
+    constexpr std::uint8_t LEGACY_VECTOR = 0x80;
+
+    /**
+     * Opens the int 0x80 entry to user mode. Called once, on the BSP after Idt::init.
+     */
+    void init();
+
+    /**
+     * Runs a call with the current thread, with the interrupts enabled.
+     * @return The call's result, for the user's rax.
+     */
+    std::uint64_t dispatch(
+        std::uint64_t number,
+        std::uint64_t argument0,
+        std::uint64_t argument1,
+        std::uint64_t argument2,
+        std::uint64_t argument3,
+        std::uint64_t argument4,
+        std::uint64_t argument5);
+} //namespace Syscalls
+
+#endif //KERNEL_SYSCALLS_H
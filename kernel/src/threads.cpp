@@ -0,0 +1,81 @@
+#include "threads.h"
+
+#include "memory.h"
+#include "timers.h"
+#include "arch/x86_64/cpu.h"
+#include "arch/x86_64/idt.h"
+#include "arch/x86_64/local_apic.h"
+#include "arch/x86_64/per_cpu.h"
+#include "arch/x86_64/smp.h"
+
+namespace Threads {
+    static_assert(Smp::MAX_CPUS <= Scheduler::MAX_CPUS, "every CPU needs its own run queue");
+
+    static void waitForWork() {
+        Smp::runPendingCall();
+        //sti only takes effect after the next instruction, so an interrupt pending since the last check ends the hlt
+        asm volatile("sti; hlt; cli" : : : "memory");
+    }
+
+    static void wakeCpu(const unsigned cpuIndex) {
+        const PerCpu::Data *cpu = Smp::getCpu(cpuIndex);
+        if (cpu != nullptr) {
+            LocalApic::sendFixed(cpu->apicId, LocalApic::WAKE_VECTOR);
+        }
+    }
+
+    static void threadExited(Scheduler::Thread *thread) {
+        Memory::freePages(thread->stackBase, STACK_ORDER);
+        delete thread;
+    }
+
+    static void switchingTo(Scheduler::Thread *thread) {
+        PerCpu::Data *cpu = PerCpu::current();
+        cpu->currentThread = thread;
+        if (!thread->isIdle) {
+            //a thread in user mode has nothing on its kernel stack, so syscalls and interrupts start from the top
+            const auto stackEnd = reinterpret_cast<std::uint64_t>(thread->stackBase) + thread->stackSize;
+            const std::uint64_t stackTop = stackEnd & ~static_cast<std::uint64_t>(15);
+            cpu->threadStackTop = stackTop;
+            cpu->tss.rsp[0] = stackTop;
+        }
+        Timers::setTicking(!thread->isIdle);
+    }
+
+    static void onWake(Idt::InterruptFrame *) {
+        //getting out of hlt was the point; the idle loop looks for threads by itself
+        LocalApic::endOfInterrupt();
+    }
+
+    void init() {
+        const Scheduler::Hooks hooks = {
+            PerCpu::getIndex,
+            Cpu::disableInterrupts,
+            Cpu::restoreInterrupts,
+            waitForWork,
+            wakeCpu,
+            threadExited,
+            switchingTo,
+        };
+        Scheduler::init(hooks);
+
+        Idt::setHandler(LocalApic::WAKE_VECTOR, onWake);
+    }
+
+    Scheduler::Thread *create(const Scheduler::ThreadFunction function, void *argument, const char *name) {
+        void *stack = Memory::allocatePages(STACK_ORDER);
+        if (stack == nullptr) {
+            return nullptr;
+        }
+        auto *thread = new Scheduler::Thread;
+        if (thread == nullptr) {
+            Memory::freePages(stack, STACK_ORDER);
+            return nullptr;
+        }
+
+        const std::size_t stackSize = static_cast<std::size_t>(PAGE_SIZE) << STACK_ORDER;
+        Scheduler::initThread(thread, stack, stackSize, function, argument, name);
+        Scheduler::start(thread, PerCpu::getIndex());
+        return thread;
+    }
+} //namespace Threads
@@ -0,0 +1,31 @@
+#ifndef KERNEL_THREADS_H
+#define KERNEL_THREADS_H
+
+#include <scheduler/scheduler.h>
+
+/**
+ * Kernel threads, on top of the scheduler library: the hooks it needs on x86 (interrupts, hlt, wake-up IPIs, the
+ * ticks of the CPUs running a thread, the kernel stack for syscalls and interrupts from user mode), and the memory of
+ * the threads.
+ */
+namespace Threads {
+    /**
+     * The kernel stack of a thread: 2^3 pages, 32 KiB, like the APs' stacks.
+     */
+    constexpr int STACK_ORDER = 3;
+
+    /**
+     * Sets up the scheduler and the handler of the wake-up vector. Must be called on the BSP after
+     * Smp::initBsp and Memory::init, and before Smp::startAps.
+     */
+    void init();
+
+    /**
+     * Creates a thread and makes it ready on the current CPU (the idle ones steal it if this one is busy). Its stack
+     * and the Thread are freed once it exits.
+     * @return The thread, or nullptr if there's not enough memory.
+     */
+    Scheduler::Thread *create(Scheduler::ThreadFunction function, void *argument, const char *name);
+} //namespace Threads
+
+#endif //KERNEL_THREADS_H
@@ -0,0 +1,302 @@
+#include <scheduler/scheduler.h>
+#include <serial_log/serial_log.h>
+
+#include "timers.h"
+
+#include "log.h"
+#include "arch/x86_64/cpu.h"
+#include "arch/x86_64/idt.h"
+#include "arch/x86_64/local_apic.h"
+#include "arch/x86_64/per_cpu.h"
+#include "arch/x86_64/smp.h"
+
+namespace Timers {
+    enum class Mode {
+        /**
+         * No local APIC: timers never fire.
+         */
+        None,
+        TscDeadline,
+        OneShot,
+    };
+
+    constexpr std::uint64_t NANOSECONDS_PER_SECOND = 1000000000;
+    /**
+     * Zero, so the array of CpuTimers is all zeros and stays in .bss; a deadline of 0 is programmed as 1.
+     */
+    constexpr std::uint64_t NOTHING_PROGRAMMED = 0;
+
+    struct alignas(64) CpuTimers {
+        std::uint32_t lockWord = 0;
+        TimerWheel::Wheel wheel;
+        /**
+         * The TSC value the local APIC timer is armed for, or NOTHING_PROGRAMMED.
+         */
+        std::uint64_t programmedDeadline = NOTHING_PROGRAMMED;
+        Timer tickTimer = {};
+        /**
+         * Set once initCurrentCpu has set up the local APIC timer.
+         */
+        bool isReady = false;
+        bool isTicking = false;
+        /**
+         * Set by the tick timer, so the interrupt handler calls Scheduler::onTick once the wheel is unlocked.
+         */
+        bool isTickDue = false;
+    };
+
+    static constinit Mode mode = Mode::None;
+    static constinit std::uint64_t tscFrequency = 0;
+    /**
+     * The local APIC timer's frequency, in one-shot mode.
+     */
+    static constinit std::uint64_t apicTimerFrequency = 0;
+    /**
+     * TICK_PERIOD_NS in TSC ticks.
+     */
+    static constinit std::uint64_t tickPeriod = 0;
+    static constinit CpuTimers cpus[Smp::MAX_CPUS] = {};
+
+    //split so nothing overflows (and no 128-bit division from libgcc)
+    std::uint64_t toNanoseconds(const std::uint64_t ticks) {
+        if (tscFrequency == 0) {
+            return 0;
+        }
+        return ticks / tscFrequency * NANOSECONDS_PER_SECOND
+            + ticks % tscFrequency * NANOSECONDS_PER_SECOND / tscFrequency;
+    }
+
+    static std::uint64_t toTicks(const std::uint64_t nanoseconds) {
+        return nanoseconds / NANOSECONDS_PER_SECOND * tscFrequency
+            + nanoseconds % NANOSECONDS_PER_SECOND * tscFrequency / NANOSECONDS_PER_SECOND;
+    }
+
+    static void lock(CpuTimers &cpu) {
+        while (__atomic_exchange_n(&cpu.lockWord, 1, __ATOMIC_ACQUIRE) != 0) {
+            while (__atomic_load_n(&cpu.lockWord, __ATOMIC_RELAXED) != 0) {
+                Cpu::pause();
+            }
+        }
+    }
+
+    static void unlock(CpuTimers &cpu) {
+        __atomic_store_n(&cpu.lockWord, 0, __ATOMIC_RELEASE);
+    }
+
+    /**
+     * Points the local APIC timer of the current CPU to the earliest expiry of its wheel, or disarms it. With the
+     * wheel locked.
+     */
+    static void program(CpuTimers &cpu) {
+        if (mode == Mode::None || !cpu.isReady) {
+            return;
+        }
+
+        std::uint64_t expiry;
+        if (!cpu.wheel.getNextExpiry(&expiry)) {
+            if (cpu.programmedDeadline != NOTHING_PROGRAMMED) {
+                if (mode == Mode::TscDeadline) {
+                    LocalApic::setTscDeadline(0);
+                } else {
+                    LocalApic::setOneShotCount(0);
+                }
+                cpu.programmedDeadline = NOTHING_PROGRAMMED;
+            }
+            return;
+        }
+        //0 would disarm the TSC deadline (and means NOTHING_PROGRAMMED), and any deadline in the past fires right away
+        if (expiry == 0) {
+            expiry = 1;
+        }
+        if (expiry == cpu.programmedDeadline) {
+            return;
+        }
+        cpu.programmedDeadline = expiry;
+
+        if (mode == Mode::TscDeadline) {
+            LocalApic::setTscDeadline(expiry);
+            return;
+        }
+
+        const std::uint64_t now = Cpu::readTsc();
+        const std::uint64_t ticks = expiry > now ? expiry - now : 0;
+        //rounded up, as firing early only means coming back; a deadline too far for 32 bits fires early the same way
+        std::uint64_t count = ticks / tscFrequency * apicTimerFrequency
+            + ticks % tscFrequency * apicTimerFrequency / tscFrequency + 1;
+        if (count > 0xFFFFFFFF) {
+            count = 0xFFFFFFFF;
+        }
+        LocalApic::setOneShotCount(static_cast<std::uint32_t>(count));
+    }
+
+    /**
+     * Arms a timer on the current CPU's wheel, with the expiry in TSC ticks.
+     */
+    static bool armTicks(Timer *timer, const std::uint64_t expiry) {
+        const bool wereEnabled = Cpu::disableInterrupts();
+        const unsigned cpuIndex = PerCpu::getIndex();
+        CpuTimers &cpu = cpus[cpuIndex];
+
+        lock(cpu);
+        const bool wasPending = timer->entry.isPending;
+        if (!wasPending) {
+            timer->cpuIndex = cpuIndex;
+            cpu.wheel.insert(&timer->entry, expiry);
+            if (cpu.programmedDeadline == NOTHING_PROGRAMMED || expiry < cpu.programmedDeadline) {
+                program(cpu);
+            }
+        }
+        unlock(cpu);
+
+        Cpu::restoreInterrupts(wereEnabled);
+        return !wasPending;
+    }
+
+    static void onTickTimer(void *argument) {
+        auto *cpu = static_cast<CpuTimers *>(argument);
+        cpu->isTickDue = true;
+        if (cpu->isTicking) {
+            armTicks(&cpu->tickTimer, Cpu::readTsc() + tickPeriod);
+        }
+    }
+
+    static void onInterrupt(Idt::InterruptFrame *) {
+        //before onTick, which may switch to another thread for a while
+        LocalApic::endOfInterrupt();
+        CpuTimers &cpu = cpus[PerCpu::getIndex()];
+
+        lock(cpu);
+        TimerWheel::Timer *expired = cpu.wheel.advance(Cpu::readTsc());
+        unlock(cpu);
+
+        //unlocked, so the functions can arm timers; the next one is read first, as a function can reuse its timer
+        while (expired != nullptr) {
+            TimerWheel::Timer *next = expired->next;
+            const Timer *timer = static_cast<Timer *>(expired->context);
+            timer->function(timer->argument);
+            expired = next;
+        }
+
+        lock(cpu);
+        //the timer fired, so whatever it was armed for is gone (or it fired early, and is armed again)
+        cpu.programmedDeadline = NOTHING_PROGRAMMED;
+        program(cpu);
+        unlock(cpu);
+
+        if (cpu.isTickDue) {
+            cpu.isTickDue = false;
+            Scheduler::onTick();
+        }
+    }
+
+    void init(const std::uint64_t tscFrequency, const bool hasLocalApic) {
+        Timers::tscFrequency = tscFrequency;
+        tickPeriod = toTicks(TICK_PERIOD_NS);
+        if (!hasLocalApic) {
+            SerialLog::print("Timers: no local APIC, timers never fire.\n");
+            return;
+        }
+
+        if (LocalApic::hasTscDeadline()) {
+            mode = Mode::TscDeadline;
+            SerialLog::print("Timers: TSC-deadline mode.\n");
+        } else {
+            apicTimerFrequency = LocalApic::calibrateTimer(tscFrequency);
+            mode = Mode::OneShot;
+            Log::print("Timers: one-shot mode, local APIC timer at ", apicTimerFrequency / 1000, " kHz.\n");
+        }
+        Idt::setHandler(LocalApic::TIMER_VECTOR, onInterrupt);
+    }
+
+    void initCurrentCpu() {
+        CpuTimers &cpu = cpus[PerCpu::getIndex()];
+        initTimer(&cpu.tickTimer, onTickTimer, &cpu);
+        if (mode == Mode::None) {
+            return;
+        }
+
+        if (mode == Mode::TscDeadline) {
+            LocalApic::startTscDeadlineTimer(LocalApic::TIMER_VECTOR);
+        } else {
+            LocalApic::startOneShotTimer(LocalApic::TIMER_VECTOR);
+        }
+
+        //timers armed on this CPU before now are programmed too
+        const bool wereEnabled = Cpu::disableInterrupts();
+        lock(cpu);
+        cpu.isReady = true;
+        cpu.programmedDeadline = NOTHING_PROGRAMMED;
+        program(cpu);
+        unlock(cpu);
+        Cpu::restoreInterrupts(wereEnabled);
+    }
+
+    std::uint64_t getTime() {
+        return toNanoseconds(Cpu::readTsc());
+    }
+
+    std::uint64_t getTscFrequency() {
+        return tscFrequency;
+    }
+
+    void initTimer(Timer *timer, const TimerFunction function, void *argument) {
+        TimerWheel::initTimer(&timer->entry, nullptr, timer);
+        timer->function = function;
+        timer->argument = argument;
+        timer->cpuIndex = 0;
+    }
+
+    bool arm(Timer *timer, const std::uint64_t expiry) {
+        return armTicks(timer, toTicks(expiry));
+    }
+
+    bool cancel(Timer *timer) {
+        const bool wereEnabled = Cpu::disableInterrupts();
+        CpuTimers &cpu = cpus[timer->cpuIndex];
+
+        //the local APIC timer stays armed: if it was for this timer, it fires for nothing and is programmed again
+        lock(cpu);
+        const bool wasPending = cpu.wheel.remove(&timer->entry);
+        unlock(cpu);
+
+        Cpu::restoreInterrupts(wereEnabled);
+        return wasPending;
+    }
+
+    static void wakeSleeper(void *argument) {
+        Scheduler::wake(static_cast<Scheduler::Thread *>(argument));
+    }
+
+    void sleep(const std::uint64_t nanoseconds) {
+        const std::uint64_t expiry = getTime() + nanoseconds;
+        if (mode == Mode::None) {
+            //nothing would wake the thread up
+            while (getTime() < expiry) {
+                Scheduler::yield();
+            }
+            return;
+        }
+
+        //only the timer wakes a sleeping thread, so it expired once block returns, and can live on the stack
+        Timer timer;
+        initTimer(&timer, wakeSleeper, Scheduler::getCurrentThread());
+        //armed after prepareToBlock: a timer that expires before block makes it return right away
+        Scheduler::prepareToBlock();
+        arm(&timer, expiry);
+        Scheduler::block();
+    }
+
+    void setTicking(const bool isTicking) {
+        CpuTimers &cpu = cpus[PerCpu::getIndex()];
+        if (!cpu.isReady || cpu.isTicking == isTicking) {
+            return;
+        }
+
+        cpu.isTicking = isTicking;
+        if (isTicking) {
+            armTicks(&cpu.tickTimer, Cpu::readTsc() + tickPeriod);
+        } else {
+            cancel(&cpu.tickTimer);
+        }
+    }
+} //namespace Timers
@@ -0,0 +1,92 @@
+#ifndef KERNEL_TIMERS_H
+#define KERNEL_TIMERS_H
+
+#include <cstdint>
+
+#include <timer_wheel/timer_wheel.h>
+
+/**
+ * Timers for the kernel, on one timing wheel per CPU (in TSC ticks). The local APIC timer of a CPU is a one-shot timer
+ * programmed for the earliest expiry of the CPU's wheel: in TSC-deadline mode when the CPU has it, or else counting
+ * down at the rate measured against the PIT. Nothing ticks periodically: a CPU that has nothing to run only wakes for
+ * its next timer, and only a CPU running a thread gets the ticks that end time slices (as a timer that re-arms itself).
+ *
+ * Times are in nanoseconds since the CPUs came out of reset (the TSCs are taken to be in sync).
+ */
+namespace Timers {
+    /**
+     * How often a CPU running a thread ticks, in nanoseconds; a time slice is Scheduler::TIME_SLICE_TICKS ticks.
+     */
+    constexpr std::uint64_t TICK_PERIOD_NS = 1000000;
+
+    typedef void (*TimerFunction)(void *argument);
+
+    struct Timer {
+        TimerWheel::Timer entry;
+        TimerFunction function;
+        void *argument;
+        /**
+         * The CPU whose wheel the timer was armed on.
+         */
+        unsigned cpuIndex;
+    };
+
+    /**
+     * Picks the timer mode and sets up the timer interrupt. Called by Smp::startAps on the BSP, before the APs start.
+     * @param tscFrequency The TSC's frequency in Hz.
+     * @param hasLocalApic Whether LocalApic::init succeeded; without it, timers never fire.
+     */
+    void init(std::uint64_t tscFrequency, bool hasLocalApic);
+
+    /**
+     * Sets up the local APIC timer of the current CPU and its wheel. Called by every CPU before it runs threads.
+     */
+    void initCurrentCpu();
+
+    /**
+     * Returns the current time in nanoseconds.
+     */
+    [[nodiscard]] std::uint64_t getTime();
+
+    /**
+     * Converts a TSC value to the time in nanoseconds, rounded down (getTime is this with the current TSC).
+     */
+    [[nodiscard]] std::uint64_t toNanoseconds(std::uint64_t ticks);
+
+    /**
+     * Returns the TSC's frequency in Hz, as given to init.
+     */
+    [[nodiscard]] std::uint64_t getTscFrequency();
+
+    /**
+     * Sets up a timer that calls function(argument) once it expires, on the CPU it was armed on, in the timer
+     * interrupt.
+     */
+    void initTimer(Timer *timer, TimerFunction function, void *argument);
+
+    /**
+     * Arms a timer that isn't pending on the current CPU's wheel, to expire at the given time (a time that passed
+     * already expires right away).
+     * @return False if the timer is pending already.
+     */
+    bool arm(Timer *timer, std::uint64_t expiry);
+
+    /**
+     * Disarms a pending timer, from any CPU; arm and cancel of the same timer mustn't run at the same time.
+     * @return False if it wasn't pending: it never was, or it expired (its function may still be running).
+     */
+    bool cancel(Timer *timer);
+
+    /**
+     * Blocks the current thread (not an idle loop) for at least the given time.
+     */
+    void sleep(std::uint64_t nanoseconds);
+
+    /**
+     * Starts or stops the ticks of the current CPU, from the scheduler's switchingTo hook: a CPU only ticks while it
+     * runs a thread other than its idle loop.
+     */
+    void setTicking(bool isTicking);
+} //namespace Timers
+
+#endif //KERNEL_TIMERS_H
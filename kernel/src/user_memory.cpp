@@ -0,0 +1,42 @@
+#include <frame_allocator/page_table_frames.h>
+#include <paginator/page_table.h>
+#include <scheduler/scheduler.h>
+
+#include "user_memory.h"
+
+#include "memory.h"
+#include "arch/x86_64/cpu.h"
+
+namespace UserMemory {
+    /**
+     * The bits of CR3 that aren't the root table's address (PCID, caching).
+     */
+    constexpr std::uint64_t CR3_FLAGS_MASK = 0xFFF;
+
+    bool mapPage(const std::uint64_t address, const void *page, const bool isWritable, const bool isExecutable) {
+        if (address < START || address >= END || address % PAGE_SIZE != 0) {
+            return false;
+        }
+
+        auto flags = Paginator::PageFlags::Present
+            | Paginator::PageFlags::ReadBit
+            | Paginator::PageFlags::UserModeAccessible;
+        if (isWritable) {
+            flags = flags | Paginator::PageFlags::WriteBit;
+        }
+        //the NX bit is reserved until SyscallEntry::initCurrentCpu turns it on
+        if (isExecutable || (Cpu::readMsr(Cpu::MSR_EFER) & Cpu::EFER_NO_EXECUTE_ENABLE) == 0) {
+            flags = flags | Paginator::PageFlags::ExecuteBit;
+        }
+
+        /* The root table is identity-mapped like the rest of memory, and the tables below it are reached through the
+         * recursive entry. It's the kernel's address space, which runs as PCID 0, so there's no PCID to pass. The
+         * tables come from the per-CPU frame caches, so the thread stays on its CPU meanwhile. */
+        auto *root = reinterpret_cast<Paginator::PageTable_t *>(Cpu::readCr3() & ~CR3_FLAGS_MASK);
+        const Paginator::PageTableRootController controller(root, FrameAllocator::allocatePageTableFrame);
+        const Scheduler::PreemptionGuard guard;
+        //a fresh user address was never in a TLB, so nothing needs invalidating
+        return controller.mapPage(address, reinterpret_cast<std::size_t>(page), flags, false)
+            == Paginator::PageMapError::NoError;
+    }
+} //namespace UserMemory
@@ -0,0 +1,31 @@
+#ifndef KERNEL_USER_MEMORY_H
+#define KERNEL_USER_MEMORY_H
+
+#include <cstdint>
+
+/**
+ * The user half of the address space. There's a single address space for now, the kernel's: user pages go into the
+ * current page tables (through the paginator, like the bootloader's mappings), so every CPU sees them.
+ */
+namespace UserMemory {
+    /**
+     * The first user address: PML4 entry 128, clear of the identity mapping and of the paginator's recursive entry.
+     */
+    constexpr std::uint64_t START = 0x0000400000000000;
+    /**
+     * The end of the user range. The last page below the canonical hole is left out: code there would make SYSRET
+     * return to a non-canonical address (see SyscallEntry).
+     */
+    constexpr std::uint64_t END = 0x0000800000000000 - 4096;
+
+    /**
+     * Maps a page from Memory::allocatePages at a user address, readable from user mode. Without NX support, every
+     * page is executable.
+     * @param address Where, page-aligned, in [START, END).
+     * @param page The page, which stays allocated while it's mapped.
+     * @return False if the address is outside the range or a page table couldn't be allocated.
+     */
+    bool mapPage(std::uint64_t address, const void *page, bool isWritable, bool isExecutable);
+} //namespace UserMemory
+
+#endif //KERNEL_USER_MEMORY_H
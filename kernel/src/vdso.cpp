@@ -0,0 +1,167 @@
+#include <cstddef>
+#include <initializer_list>
+
+#include <c_husky/mem_routines.h>
+#include <elf/elf_loader.h>
+#include <serial_log/serial_log.h>
+
+#include "vdso.h"
+
+#include "memory.h"
+#include "timers.h"
+#include "user_memory.h"
+#include "arch/x86_64/cpu.h"
+#include "arch/x86_64/per_cpu.h"
+
+extern "C" const char vdsoImage[];
+extern "C" const char vdsoImageEnd[];
+
+namespace Vdso {
+    static_assert(offsetof(Data, sequence) == VDSO_DATA_SEQUENCE);
+    static_assert(offsetof(Data, cpuIdMethod) == VDSO_DATA_CPU_ID_METHOD);
+    static_assert(offsetof(Data, tscBase) == VDSO_DATA_TSC_BASE);
+    static_assert(offsetof(Data, nanosecondsBase) == VDSO_DATA_NANOSECONDS_BASE);
+    static_assert(offsetof(Data, multiplier) == VDSO_DATA_MULTIPLIER);
+    static_assert(DATA_ADDRESS == IMAGE_ADDRESS + PAGE_SIZE, "the image's code expects the data page right after it");
+    static_assert(IMAGE_ADDRESS >= UserMemory::START && DATA_ADDRESS + PAGE_SIZE <= UserMemory::END);
+
+    constexpr std::uint64_t NANOSECONDS_PER_SECOND = 1000000000;
+    constexpr std::uint64_t REBASE_PERIOD_NS = NANOSECONDS_PER_SECOND;
+
+    /**
+     * Bit 22 of CPUID 7 ECX.
+     */
+    constexpr std::uint32_t CPUID_RDPID = 1 << 22;
+    /**
+     * Bit 27 of CPUID 0x80000001 EDX.
+     */
+    constexpr std::uint32_t CPUID_RDTSCP = 1 << 27;
+
+    /**
+     * The kernel's view of the mapped pages (identity-mapped), once init succeeded.
+     */
+    static constinit void *image = nullptr;
+    static constinit std::size_t imageSize = 0;
+    static constinit Data *data = nullptr;
+    static constinit Timers::Timer rebaseTimer = {};
+
+    /**
+     * Returns how user mode can read TSC_AUX on this machine: RDPID is a single fast instruction, RDTSCP also reads the
+     * TSC and waits for the instructions before it.
+     */
+    static std::uint32_t getCpuIdMethod() {
+        if (Cpu::cpuid(0).eax >= 7 && (Cpu::cpuid(7).ecx & CPUID_RDPID) != 0) {
+            return VDSO_CPU_ID_RDPID;
+        }
+        if (Cpu::cpuid(0x80000000).eax >= 0x80000001 && (Cpu::cpuid(0x80000001).edx & CPUID_RDTSCP) != 0) {
+            return VDSO_CPU_ID_RDTSCP;
+        }
+        return VDSO_CPU_ID_NONE;
+    }
+
+    /**
+     * Moves the base to the current TSC, with the exact time for it. Only one CPU at a time writes: init, then the
+     * rebase timer, which always expires on the CPU it was armed on.
+     */
+    static void rebase() {
+        const std::uint64_t tsc = Cpu::readTsc();
+        const std::uint32_t sequence = data->sequence;
+
+        __atomic_store_n(&data->sequence, sequence + 1, __ATOMIC_RELAXED);
+        //the odd sequence is visible before anything else changes
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        __atomic_store_n(&data->tscBase, tsc, __ATOMIC_RELAXED);
+        __atomic_store_n(&data->nanosecondsBase, Timers::toNanoseconds(tsc), __ATOMIC_RELAXED);
+        __atomic_store_n(&data->sequence, sequence + 2, __ATOMIC_RELEASE);
+    }
+
+    static void onRebaseTimer(void *) {
+        rebase();
+        Timers::arm(&rebaseTimer, Timers::getTime() + REBASE_PERIOD_NS);
+    }
+
+    void initCurrentCpu() {
+        //the MSR only exists along with one of the instructions that read it
+        if (getCpuIdMethod() != VDSO_CPU_ID_NONE) {
+            Cpu::writeMsr(Cpu::MSR_TSC_AUX, PerCpu::getIndex());
+        }
+    }
+
+    bool init() {
+        const auto size = static_cast<std::size_t>(vdsoImageEnd - vdsoImage);
+        const std::uint64_t tscFrequency = Timers::getTscFrequency();
+        if (size > PAGE_SIZE || tscFrequency == 0) {
+            SerialLog::print("vDSO: the image doesn't fit in a page, or the TSC frequency is unknown.\n");
+            return false;
+        }
+
+        void *imagePage = Memory::allocatePages(0);
+        void *dataPage = Memory::allocatePages(0);
+        if (imagePage == nullptr || dataPage == nullptr) {
+            for (void *page : {imagePage, dataPage}) {
+                if (page != nullptr) {
+                    Memory::freePages(page, 0);
+                }
+            }
+            SerialLog::print("vDSO: not enough memory.\n");
+            return false;
+        }
+        CHusky::Mem::zeroPage(imagePage);
+        CHusky::Mem::zeroPage(dataPage);
+        CHusky::Mem::copy(imagePage, vdsoImage, size);
+
+        //the same lookup a program loader would do, so a broken image shows up now rather than in user mode
+        const Elf::ElfLoader loader(imagePage, size);
+        Elf::Elf64_Addr address;
+        if (loader.checkElf() != Elf::ElfLoader::ElfError::NoError
+            || loader.findSymbol("__vdso_clock_gettime", &address) != Elf::ElfLoader::ElfError::NoError
+            || loader.findSymbol("__vdso_getcpu", &address) != Elf::ElfLoader::ElfError::NoError) {
+            SerialLog::print("vDSO: the image is broken.\n");
+            Memory::freePages(imagePage, 0);
+            Memory::freePages(dataPage, 0);
+            return false;
+        }
+
+        /* UserMemory::mapPage maps nothing when it fails, so a page it refused can be given back. The image page
+         * stays mapped for good once it is, even if the data page then can't be. */
+        if (!UserMemory::mapPage(IMAGE_ADDRESS, imagePage, false, true)) {
+            Memory::freePages(imagePage, 0);
+            Memory::freePages(dataPage, 0);
+            SerialLog::print("vDSO: couldn't map the image page.\n");
+            return false;
+        }
+        //user mode only reads it; nothing runs in user mode yet, so it's filled in after it's mapped
+        if (!UserMemory::mapPage(DATA_ADDRESS, dataPage, false, false)) {
+            Memory::freePages(dataPage, 0);
+            SerialLog::print("vDSO: couldn't map the data page.\n");
+            return false;
+        }
+
+        data = static_cast<Data *>(dataPage);
+        data->cpuIdMethod = getCpuIdMethod();
+        //rounded down, so the vDSO time never gets ahead of Timers::getTime between two rebases
+        data->multiplier = (NANOSECONDS_PER_SECOND << 32) / tscFrequency;
+        rebase();
+
+        image = imagePage;
+        imageSize = size;
+
+        Timers::initTimer(&rebaseTimer, onRebaseTimer, nullptr);
+        Timers::arm(&rebaseTimer, Timers::getTime() + REBASE_PERIOD_NS);
+        return true;
+    }
+
+    bool findSymbol(const char *name, std::uint64_t *address) {
+        if (image == nullptr) {
+            return false;
+        }
+
+        const Elf::ElfLoader loader(image, imageSize);
+        Elf::Elf64_Addr symbolAddress;
+        if (loader.findSymbol(name, &symbolAddress) != Elf::ElfLoader::ElfError::NoError) {
+            return false;
+        }
+        *address = symbolAddress;
+        return true;
+    }
+} //namespace Vdso
@@ -0,0 +1,75 @@
+#ifndef KERNEL_VDSO_H
+#define KERNEL_VDSO_H
+
+#include <cstdint>
+
+//the addresses and the data page layout the image's code uses (asserted in vdso.cpp)
+#define VDSO_IMAGE_ADDRESS 0x00007FFFFFFFD000
+#define VDSO_DATA_ADDRESS 0x00007FFFFFFFE000
+#define VDSO_DATA_SEQUENCE 0
+#define VDSO_DATA_CPU_ID_METHOD 4
+#define VDSO_DATA_TSC_BASE 8
+#define VDSO_DATA_NANOSECONDS_BASE 16
+#define VDSO_DATA_MULTIPLIER 24
+#define VDSO_CPU_ID_NONE 0
+#define VDSO_CPU_ID_RDTSCP 1
+#define VDSO_CPU_ID_RDPID 2
+
+/**
+ * The vDSO: a small ELF image mapped read-only into user space, with functions user code calls instead of a system
+ * call for what it can work out by itself from a data page the kernel keeps up to date next to it:
+ * - __vdso_clock_gettime(clockId, timespec *): the monotonic clocks (CLOCK_MONOTONIC, CLOCK_MONOTONIC_RAW and
+ *   CLOCK_BOOTTIME are all Timers::getTime), from the TSC with the scale and base in the data page. Other clocks give
+ *   -EINVAL.
+ * - __vdso_getcpu(unsigned *cpu, unsigned *node, void *): the index of the CPU, from TSC_AUX through RDPID or RDTSCP
+ *   (the node is always 0). Without either, -ENOSYS.
+ *
+ * The functions follow the SysV ABI (like the Linux ones, with the same names), and are found with the image's dynamic
+ * symbol table. The image is linked at its fixed address, so it's an ET_EXEC and a symbol's value is its address.
+ *
+ * The data page is written under a seqlock: the sequence is odd while the kernel writes it, and a reader retries if it
+ * changed (or was odd) while it read. The base is moved forward every second, as the scale is rounded down: the vDSO
+ * time never runs ahead of Timers::getTime, and never goes back.
+ */
+namespace Vdso {
+    constexpr std::uint64_t IMAGE_ADDRESS = VDSO_IMAGE_ADDRESS;
+    constexpr std::uint64_t DATA_ADDRESS = VDSO_DATA_ADDRESS;
+
+    struct Data {
+        std::uint32_t sequence;
+        /**
+         * How __vdso_getcpu reads TSC_AUX: one of the VDSO_CPU_ID values.
+         */
+        std::uint32_t cpuIdMethod;
+        std::uint64_t tscBase;
+        /**
+         * The time at tscBase, in nanoseconds.
+         */
+        std::uint64_t nanosecondsBase;
+        /**
+         * Nanoseconds per TSC tick, in 32.32 fixed point (rounded down).
+         */
+        std::uint64_t multiplier;
+    };
+
+    /**
+     * Puts the index of the current CPU in TSC_AUX, for __vdso_getcpu. Called by every CPU after PerCpu::install.
+     */
+    void initCurrentCpu();
+
+    /**
+     * Maps the image and the data page into user space (the single address space there is), and starts keeping the
+     * data page up to date. Called once, on the BSP after Smp::startAps.
+     * @return False if there's not enough memory or the image is broken.
+     */
+    bool init();
+
+    /**
+     * Looks a symbol of the image up, like a program loader handing the vDSO to a program would.
+     * @param address [OUT] The symbol's user address.
+     * @return False if the image has no such symbol, or init didn't succeed.
+     */
+    bool findSymbol(const char *name, std::uint64_t *address);
+} //namespace Vdso
+
+#endif //KERNEL_VDSO_H
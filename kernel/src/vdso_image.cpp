@@ -0,0 +1,212 @@
+#include "vdso.h"
+
+#define STRINGIFY_VALUE(x) #x
+#define STRINGIFY(x) STRINGIFY_VALUE(x)
+
+/* The vDSO image, a whole ELF file laid out by hand, page-aligned so its copy can be mapped as it is: the ELF header,
+ * a single PT_LOAD for the whole file (read and execute), the code, the dynamic symbol table and its strings, and the
+ * section headers (.text, .dynsym, .dynstr, .shstrtab). The code reaches the data page rip-relative, as it's mapped
+ * right after the image's page.
+ *
+ * __vdso_clock_gettime reads the base and the scale between two reads of the sequence (x86 doesn't reorder loads with
+ * each other, so no fence is needed), then converts with a 64x64 bit multiply: it overflows after 2^64 ns. A TSC a bit
+ * behind the base (read on another CPU than the one that moved it) counts as no time passed. The seconds come from a
+ * multiply by the reciprocal of 10^9 (what compilers emit for the division, exact for any 64-bit value) instead of a
+ * div, which costs more than the rest of the conversion. The clock ids are a bit mask: 1 << CLOCK_MONOTONIC
+ * | 1 << CLOCK_MONOTONIC_RAW | 1 << CLOCK_BOOTTIME. */
+asm(R"(
+.pushsection .rodata
+.balign 4096
+.global vdsoImage
+vdsoImage:
+    .byte 0x7F, 'E', 'L', 'F', 2, 1, 1, 0
+    .zero 8
+    .short 2
+    .short 0x3E
+    .long 1
+    .quad 0
+    .quad vdsoProgramHeader - vdsoImage
+    .quad vdsoSectionHeaders - vdsoImage
+    .long 0
+    .short 64
+    .short 56
+    .short 1
+    .short 64
+    .short 5
+    .short 4
+
+vdsoProgramHeader:
+    .long 1
+    .long 5
+    .quad 0
+    .quad )" STRINGIFY(VDSO_IMAGE_ADDRESS) R"(
+    .quad )" STRINGIFY(VDSO_IMAGE_ADDRESS) R"(
+    .quad vdsoImageEnd - vdsoImage
+    .quad vdsoImageEnd - vdsoImage
+    .quad 4096
+
+.balign 16
+vdsoText:
+vdsoClockGetTime:
+    cmp $31, %edi
+    ja 4f
+    mov $0x92, %eax
+    bt %edi, %eax
+    jnc 4f
+    leaq vdsoImage + 4096(%rip), %r8
+1:
+    mov )" STRINGIFY(VDSO_DATA_SEQUENCE) R"((%r8), %ecx
+    test $1, %ecx
+    jnz 3f
+    mov )" STRINGIFY(VDSO_DATA_TSC_BASE) R"((%r8), %r9
+    mov )" STRINGIFY(VDSO_DATA_NANOSECONDS_BASE) R"((%r8), %r10
+    mov )" STRINGIFY(VDSO_DATA_MULTIPLIER) R"((%r8), %r11
+    lfence
+    rdtsc
+    cmp )" STRINGIFY(VDSO_DATA_SEQUENCE) R"((%r8), %ecx
+    jne 1b
+    shl $32, %rdx
+    or %rdx, %rax
+    sub %r9, %rax
+    jae 2f
+    xor %eax, %eax
+2:
+    mul %r11
+    shrd $32, %rdx, %rax
+    add %r10, %rax
+    mov %rax, %r9
+    shr $9, %rax
+    movabs $0x44B82FA09B5A53, %rdx
+    mul %rdx
+    shr $11, %rdx
+    mov %rdx, (%rsi)
+    imul $1000000000, %rdx, %rax
+    sub %rax, %r9
+    mov %r9, 8(%rsi)
+    xor %eax, %eax
+    ret
+3:
+    pause
+    jmp 1b
+4:
+    mov $-22, %eax
+    ret
+vdsoClockGetTimeEnd:
+
+.balign 16
+vdsoGetCpu:
+    leaq vdsoImage + 4096(%rip), %r8
+    mov )" STRINGIFY(VDSO_DATA_CPU_ID_METHOD) R"((%r8), %eax
+    cmp $)" STRINGIFY(VDSO_CPU_ID_RDPID) R"(, %eax
+    jne 1f
+    rdpid %rcx
+    jmp 2f
+1:
+    cmp $)" STRINGIFY(VDSO_CPU_ID_RDTSCP) R"(, %eax
+    jne 4f
+    rdtscp
+2:
+    test %rdi, %rdi
+    jz 3f
+    mov %ecx, (%rdi)
+3:
+    test %rsi, %rsi
+    jz 5f
+    movl $0, (%rsi)
+5:
+    xor %eax, %eax
+    ret
+4:
+    mov $-38, %eax
+    ret
+vdsoGetCpuEnd:
+vdsoTextEnd:
+
+.balign 8
+vdsoSymbols:
+    .zero 24
+    .long vdsoNameClockGetTime - vdsoStrings
+    .byte 0x12
+    .byte 0
+    .short 1
+    .quad )" STRINGIFY(VDSO_IMAGE_ADDRESS) R"( + (vdsoClockGetTime - vdsoImage)
+    .quad vdsoClockGetTimeEnd - vdsoClockGetTime
+    .long vdsoNameGetCpu - vdsoStrings
+    .byte 0x12
+    .byte 0
+    .short 1
+    .quad )" STRINGIFY(VDSO_IMAGE_ADDRESS) R"( + (vdsoGetCpu - vdsoImage)
+    .quad vdsoGetCpuEnd - vdsoGetCpu
+vdsoSymbolsEnd:
+
+vdsoStrings:
+    .byte 0
+vdsoNameClockGetTime:
+    .asciz "__vdso_clock_gettime"
+vdsoNameGetCpu:
+    .asciz "__vdso_getcpu"
+vdsoStringsEnd:
+
+vdsoSectionNames:
+    .byte 0
+vdsoNameText:
+    .asciz ".text"
+vdsoNameDynsym:
+    .asciz ".dynsym"
+vdsoNameDynstr:
+    .asciz ".dynstr"
+vdsoNameShstrtab:
+    .asciz ".shstrtab"
+vdsoSectionNamesEnd:
+
+.balign 8
+vdsoSectionHeaders:
+    .zero 64
+
+    .long vdsoNameText - vdsoSectionNames
+    .long 1
+    .quad 6
+    .quad )" STRINGIFY(VDSO_IMAGE_ADDRESS) R"( + (vdsoText - vdsoImage)
+    .quad vdsoText - vdsoImage
+    .quad vdsoTextEnd - vdsoText
+    .long 0
+    .long 0
+    .quad 16
+    .quad 0
+
+    .long vdsoNameDynsym - vdsoSectionNames
+    .long 11
+    .quad 2
+    .quad )" STRINGIFY(VDSO_IMAGE_ADDRESS) R"( + (vdsoSymbols - vdsoImage)
+    .quad vdsoSymbols - vdsoImage
+    .quad vdsoSymbolsEnd - vdsoSymbols
+    .long 3
+    .long 1
+    .quad 8
+    .quad 24
+
+    .long vdsoNameDynstr - vdsoSectionNames
+    .long 3
+    .quad 2
+    .quad )" STRINGIFY(VDSO_IMAGE_ADDRESS) R"( + (vdsoStrings - vdsoImage)
+    .quad vdsoStrings - vdsoImage
+    .quad vdsoStringsEnd - vdsoStrings
+    .long 0
+    .long 0
+    .quad 1
+    .quad 0
+
+    .long vdsoNameShstrtab - vdsoSectionNames
+    .long 3
+    .quad 0
+    .quad 0
+    .quad vdsoSectionNames - vdsoImage
+    .quad vdsoSectionNamesEnd - vdsoSectionNames
+    .long 0
+    .long 0
+    .quad 1
+    .quad 0
+.global vdsoImageEnd
+vdsoImageEnd:
+.popsection
+)");
@@ -0,0 +1,50 @@
+#ifndef C_HUSKY_CPU_FEATURES_H
+#define C_HUSKY_CPU_FEATURES_H
+
+namespace CHusky::Cpu {
+    /**
+     * The CPU features that the memory routines and the paging code care about. Everything is false on non-x86_64
+     * targets.
+     */
+    struct CpuFeatures {
+        /**
+         * Enhanced REP MOVSB/STOSB: "rep movsb" and "rep stosb" are the fastest way to copy/fill large buffers.
+         */
+        bool hasErms;
+        /**
+         * Fast Short REP MOVSB: "rep movsb" is also fast for small sizes (generally under 128 bytes).
+         */
+        bool hasFsrm;
+        /**
+         * AVX2 is implemented by the CPU. This says nothing about whether the OS saves the YMM state, see
+         * isAvxStateEnabled for that.
+         */
+        bool hasAvx2;
+        /**
+         * Process-context identifiers: CR4.PCIDE can be set, and the low 12 bits of CR3 then tag the TLB entries.
+         */
+        bool hasPcid;
+        /**
+         * The "invpcid" instruction, to invalidate the TLB entries of a single PCID (or all of them).
+         */
+        bool hasInvpcid;
+        /**
+         * Global pages: with CR4.PGE set, the TLB entries of pages marked global survive CR3 writes.
+         */
+        bool hasPge;
+    };
+
+    /**
+     * Returns the features of the current CPU. CPUID is only executed on the first call (it is slow, especially
+     * under a hypervisor, where it always causes a VM exit), the next calls return the cached value.
+     */
+    const CpuFeatures &getCpuFeatures();
+
+    /**
+     * Checks whether the YMM registers can be used right now, i.e. CR4.OSXSAVE is set and XCR0 enables both the SSE and
+     * the AVX state. Unlike getCpuFeatures, this is never cached, because it changes when the kernel enables XSAVE.
+     */
+    bool isAvxStateEnabled();
+} //namespace CHusky::Cpu
+
+#endif //C_HUSKY_CPU_FEATURES_H
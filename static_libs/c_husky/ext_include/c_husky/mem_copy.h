@@ -0,0 +1,81 @@
+#ifndef C_HUSKY_MEM_COPY_H
+#define C_HUSKY_MEM_COPY_H
+
+#include <cstddef>
+
+/**
+ * The copy engine behind memcpy and memmove. Everything here only uses general-purpose registers and string
+ * instructions, so it's legal to call with -mno-sse -mno-mmx (i.e. in the bootloader and the kernel).
+ *
+ * There are two layers: the strategies (copyWords, copyRepMovsb...) and the per-CPU variants built from them
+ * (copyBaseline, copyErms...). memcpy calls whichever variant was picked by resolveRoutines (see mem_routines.h).
+ * Everything is exposed mostly for the host benchmarks; normal code should just call memcpy/memmove.
+ */
+namespace CHusky::Mem {
+    /**
+     * Sizes up to this value are copied with (possibly overlapping) head and tail loads/stores, without any loop.
+     */
+    constexpr size_t SMALL_COPY_LIMIT = 32;
+
+    /**
+     * From this size onward, copyErms uses "rep movsb" and copyBaseline uses "rep movsq".
+     */
+    constexpr size_t REP_MOVS_THRESHOLD = 2048;
+
+    /**
+     * From this size onward, copyFsrm uses "rep movsb". The startup overhead of the microcode is low enough with FSRM
+     * that the string instruction beats the word loop even for small buffers.
+     */
+    constexpr size_t FSRM_THRESHOLD = 128;
+
+    /**
+     * Copies one byte per iteration. This is the old implementation and is kept only as a baseline for benchmarks.
+     */
+    void *copyBytes(void *dest, const void *src, size_t n);
+
+    /**
+     * Copies using 8-byte words (4 per iteration), with the unaligned head and tail handled by overlapping stores.
+     * Overlap-safe when dest is before src.
+     */
+    void *copyWords(void *dest, const void *src, size_t n);
+
+    /**
+     * Copies using "rep movsq" for the bulk of the data and a single overlapping store for the tail. Only efficient
+     * for large sizes.
+     */
+    void *copyRepMovsq(void *dest, const void *src, size_t n);
+
+    /**
+     * Copies using a single "rep movsb". Only efficient for large sizes on CPUs with ERMS (or for any size with FSRM).
+     */
+    void *copyRepMovsb(void *dest, const void *src, size_t n);
+
+    /**
+     * Variant for any x86_64 CPU: head/tail stores for small sizes, the word loop for medium sizes and "rep movsq" for
+     * large sizes.
+     */
+    void *copyBaseline(void *dest, const void *src, size_t n);
+
+    /**
+     * Variant for CPUs with ERMS: like copyBaseline, but with "rep movsb" for large sizes.
+     */
+    void *copyErms(void *dest, const void *src, size_t n);
+
+    /**
+     * Variant for CPUs with FSRM: like copyErms, but "rep movsb" takes over from FSRM_THRESHOLD.
+     */
+    void *copyFsrm(void *dest, const void *src, size_t n);
+
+    /**
+     * Variant for CPUs with AVX2, using 32-byte loads/stores. Only safe to call when the OS saves the YMM state: on the
+     * host, not in the bootloader nor (yet) in the kernel.
+     */
+    void *copyAvx2(void *dest, const void *src, size_t n);
+
+    /**
+     * Copies from the end towards the start with the word loop, so it's overlap-safe when dest is after src.
+     */
+    void *copyBackward(void *dest, const void *src, size_t n);
+} //namespace CHusky::Mem
+
+#endif //C_HUSKY_MEM_COPY_H
@@ -0,0 +1,82 @@
+#ifndef C_HUSKY_MEM_FILL_H
+#define C_HUSKY_MEM_FILL_H
+
+#include <cstddef>
+
+/**
+ * The fill engine behind memset, plus dedicated page-zeroing routines. Like the copy engine, it only uses
+ * general-purpose registers and string instructions, so it's legal with -mno-sse -mno-mmx.
+ *
+ * Like for the copy engine, there are strategies (fillWords, fillRepStosb...) and per-CPU variants built from them
+ * (fillBaseline, fillErms...); memset, zeroPage and zeroPages (see mem_routines.h) call whichever variant was picked by
+ * resolveRoutines. Everything is exposed mostly for the host benchmarks.
+ */
+namespace CHusky::Mem {
+    /**
+     * The size of the pages handled by zeroPage and zeroPages.
+     */
+    constexpr size_t ZERO_PAGE_SIZE = 4096;
+
+    /**
+     * Sizes up to this value are filled with (possibly overlapping) head and tail stores, without any loop.
+     */
+    constexpr size_t SMALL_FILL_LIMIT = 32;
+
+    /**
+     * From this size onward, fillErms uses "rep stosb" and fillBaseline uses "rep stosq".
+     */
+    constexpr size_t REP_STOS_THRESHOLD = 1024;
+
+    /**
+     * Fills one byte per iteration. Kept only as a baseline for benchmarks.
+     */
+    void *fillBytes(void *dest, int c, size_t n);
+
+    /**
+     * Fills using 8-byte stores (4 per iteration), with the unaligned head and tail handled by overlapping stores.
+     */
+    void *fillWords(void *dest, int c, size_t n);
+
+    /**
+     * Fills using "rep stosq" for the aligned bulk of the data and overlapping stores for the head and tail.
+     */
+    void *fillRepStosq(void *dest, int c, size_t n);
+
+    /**
+     * Fills using a single "rep stosb". Only efficient for large sizes on CPUs with ERMS.
+     */
+    void *fillRepStosb(void *dest, int c, size_t n);
+
+    /**
+     * Variant for any x86_64 CPU: head/tail stores for small sizes, the word loop for medium sizes and "rep stosq" for
+     * large sizes.
+     */
+    void *fillBaseline(void *dest, int c, size_t n);
+
+    /**
+     * Variant for CPUs with ERMS: like fillBaseline, but with "rep stosb" for large sizes.
+     */
+    void *fillErms(void *dest, int c, size_t n);
+
+    /**
+     * Variant for CPUs with AVX2, using 32-byte stores. Only safe to call when the OS saves the YMM state: on the host,
+     * not in the bootloader nor (yet) in the kernel.
+     */
+    void *fillAvx2(void *dest, int c, size_t n);
+
+    /**
+     * Zeroes whole 4 KiB pages with "rep stosq".
+     * @param pages The address of the first page; must be 4 KiB-aligned.
+     * @param count The number of pages.
+     */
+    void zeroPagesRepStosq(void *pages, size_t count);
+
+    /**
+     * Zeroes whole 4 KiB pages with "rep stosb". Only efficient on CPUs with ERMS.
+     * @param pages The address of the first page; must be 4 KiB-aligned.
+     * @param count The number of pages.
+     */
+    void zeroPagesRepStosb(void *pages, size_t count);
+} //namespace CHusky::Mem
+
+#endif //C_HUSKY_MEM_FILL_H
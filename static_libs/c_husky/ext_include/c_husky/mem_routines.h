@@ -0,0 +1,92 @@
+#ifndef C_HUSKY_MEM_ROUTINES_H
+#define C_HUSKY_MEM_ROUTINES_H
+
+#include <cstddef>
+
+/**
+ * Picks the copy/fill variants (see mem_copy.h and mem_fill.h) that memcpy, memset and the page-zeroing routines
+ * dispatch to. The choice is made once, by resolveRoutines, instead of checking the CPU features on every call.
+ * Until resolveRoutines is called, the baseline variants (which work on any x86_64 CPU) are used.
+ */
+namespace CHusky::Mem {
+    enum class RoutineSet {
+        /**
+         * Word loops and "rep movsq"/"rep stosq".
+         */
+        Baseline,
+        /**
+         * "rep movsb"/"rep stosb" for large sizes (and for medium copies too with FSRM).
+         */
+        Erms,
+        /**
+         * 32-byte vector loops. Requires the YMM state to be enabled.
+         */
+        Avx2
+    };
+
+    typedef void *(*CopyFunction)(void *dest, const void *src, size_t n);
+    typedef void *(*FillFunction)(void *dest, int c, size_t n);
+    typedef void (*ZeroPagesFunction)(void *pages, size_t count);
+
+    struct Routines {
+        RoutineSet set;
+        CopyFunction copy;
+        FillFunction fill;
+        ZeroPagesFunction zeroPages;
+    };
+
+    /**
+     * The routines in use. Written only by resolveRoutines.
+     */
+    extern Routines activeRoutines;
+
+    /**
+     * Chooses the best variants for the current CPU. Must be called once, early and before other cores are started,
+     * by each program linking c_husky: the table is not synchronized.
+     * @param allowAvx Whether the AVX2 variants may be picked. The bootloader must pass false (the firmware owns the
+     * FPU state), and so does the kernel for now, as it doesn't save the YMM registers on thread switches and
+     * interrupts. Passing true needs both that and XSAVE enabled (the YMM state is checked anyway).
+     * @return The chosen set.
+     */
+    RoutineSet resolveRoutines(bool allowAvx);
+
+    /**
+     * Returns the set chosen by the last call to resolveRoutines, or Baseline.
+     */
+    inline RoutineSet getActiveRoutineSet() {
+        return activeRoutines.set;
+    }
+
+    /**
+     * Copies n bytes with the active variant. The buffers must not overlap.
+     */
+    inline void *copy(void *dest, const void *src, const size_t n) {
+        return activeRoutines.copy(dest, src, n);
+    }
+
+    /**
+     * Fills n bytes with the active variant.
+     */
+    inline void *fill(void *dest, const int c, const size_t n) {
+        return activeRoutines.fill(dest, c, n);
+    }
+
+    /**
+     * Zeroes whole 4 KiB pages with the active variant.
+     * @param pages The address of the first page; must be 4 KiB-aligned.
+     * @param count The number of pages.
+     */
+    inline void zeroPages(void *pages, const size_t count) {
+        activeRoutines.zeroPages(pages, count);
+    }
+
+    /**
+     * Zeroes a single 4 KiB page (e.g. a freshly allocated page table).
+     * @param page The address of the page; must be 4 KiB-aligned.
+     */
+    inline void zeroPage(void *page) {
+        activeRoutines.zeroPages(page, 1);
+    }
+} //namespace CHusky::Mem
+
+#endif //C_HUSKY_MEM_ROUTINES_H
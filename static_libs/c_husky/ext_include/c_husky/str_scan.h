@@ -0,0 +1,56 @@
+#ifndef C_HUSKY_STR_SCAN_H
+#define C_HUSKY_STR_SCAN_H
+
+#include <cstddef>
+
+/**
+ * The string engine behind strlen, memcmp, strcpy, strncpy, strcat and strncat. The word versions look at 8 bytes per
+ * iteration and find the terminator with the "has zero byte" trick: (x - 0x0101...) & ~x & 0x8080... is non-zero iff x
+ * contains a zero byte.
+ *
+ * To find the terminator, the source is read with aligned 8-byte loads, which may read a few bytes before the start
+ * or after the end of the string, but never cross into the next page, so they can't fault on an unmapped page.
+ * The byte versions are only kept as a baseline for the host benchmarks.
+ */
+namespace CHusky::Str {
+    /**
+     * Returns the length of the string, one byte per iteration.
+     */
+    size_t lengthBytes(const char *str);
+
+    /**
+     * Returns the length of the string, 8 bytes per iteration.
+     */
+    size_t length(const char *str);
+
+    /**
+     * Returns the length of the string, but at most maxLength. Never reads past the word containing
+     * str[maxLength - 1].
+     */
+    size_t boundedLength(const char *str, size_t maxLength);
+
+    /**
+     * Compares n bytes one at a time, like memcmp.
+     */
+    int compareBytes(const void *left, const void *right, size_t n);
+
+    /**
+     * Compares n bytes 8 at a time, like memcmp. The result is the difference between the first mismatching bytes
+     * (as unsigned char), like in the byte version.
+     */
+    int compare(const void *left, const void *right, size_t n);
+
+    /**
+     * Copies the string (terminator included) one byte per iteration.
+     * @return The address of the terminator in dest.
+     */
+    char *copyStringBytes(char *dest, const char *src);
+
+    /**
+     * Copies the string (terminator included) 8 bytes per iteration. dest doesn't need to be aligned.
+     * @return The address of the terminator in dest.
+     */
+    char *copyString(char *dest, const char *src);
+} //namespace CHusky::Str
+
+#endif //C_HUSKY_STR_SCAN_H
@@ -0,0 +1,92 @@
+#include <cstdint>
+
+#include "c_husky/cpu_features.h"
+
+namespace CHusky::Cpu {
+    constexpr uint32_t LEAF_MAX_BASIC = 0x00;
+    constexpr uint32_t LEAF_BASIC_FEATURES = 0x01;
+    constexpr uint32_t LEAF_EXTENDED_FEATURES = 0x07;
+
+    //CPUID.(EAX=01H):ECX
+    constexpr uint32_t ECX_PCID = 1U << 17;
+    constexpr uint32_t ECX_OSXSAVE = 1U << 27;
+    constexpr uint32_t ECX_AVX = 1U << 28;
+    //CPUID.(EAX=01H):EDX
+    constexpr uint32_t EDX_PGE = 1U << 13;
+    //CPUID.(EAX=07H, ECX=0):EBX
+    constexpr uint32_t EBX_AVX2 = 1U << 5;
+    constexpr uint32_t EBX_ERMS = 1U << 9;
+    constexpr uint32_t EBX_INVPCID = 1U << 10;
+    //CPUID.(EAX=07H, ECX=0):EDX
+    constexpr uint32_t EDX_FSRM = 1U << 4;
+
+    //XCR0 bits: the XMM (SSE) and YMM (AVX) state components
+    constexpr uint64_t XCR0_SSE_AVX = (1U << 1) | (1U << 2);
+
+    static CpuFeatures cachedFeatures = {false, false, false, false, false, false};
+    static bool areFeaturesCached = false;
+
+    static void cpuid(const uint32_t leaf, const uint32_t subLeaf, uint32_t *regs) {
+#if __x86_64__
+        asm volatile(
+            "cpuid"
+            : "=a"(regs[0]), "=b"(regs[1]), "=c"(regs[2]), "=d"(regs[3])
+            : "a"(leaf), "c"(subLeaf));
+#else
+        regs[0] = regs[1] = regs[2] = regs[3] = 0;
+#endif
+    }
+
+    const CpuFeatures &getCpuFeatures() {
+        if (areFeaturesCached) {
+            return cachedFeatures;
+        }
+
+        uint32_t regs[4];
+        cpuid(LEAF_MAX_BASIC, 0, regs);
+        const uint32_t maxLeaf = regs[0];
+
+        bool hasAvx = false;
+        if (maxLeaf >= LEAF_BASIC_FEATURES) {
+            cpuid(LEAF_BASIC_FEATURES, 0, regs);
+            hasAvx = (regs[2] & ECX_AVX) != 0;
+            cachedFeatures.hasPcid = (regs[2] & ECX_PCID) != 0;
+            cachedFeatures.hasPge = (regs[3] & EDX_PGE) != 0;
+        }
+
+        if (maxLeaf >= LEAF_EXTENDED_FEATURES) {
+            cpuid(LEAF_EXTENDED_FEATURES, 0, regs);
+            cachedFeatures.hasErms = (regs[1] & EBX_ERMS) != 0;
+            cachedFeatures.hasFsrm = (regs[3] & EDX_FSRM) != 0;
+            cachedFeatures.hasAvx2 = hasAvx && (regs[1] & EBX_AVX2) != 0;
+            cachedFeatures.hasInvpcid = (regs[1] & EBX_INVPCID) != 0;
+        }
+
+        //this might race on SMP, but all the cores write the same values, so it doesn't matter
+        areFeaturesCached = true;
+        return cachedFeatures;
+    }
+
+    bool isAvxStateEnabled() {
+        uint32_t regs[4];
+        cpuid(LEAF_MAX_BASIC, 0, regs);
+        if (regs[0] < LEAF_BASIC_FEATURES) {
+            return false;
+        }
+
+        //xgetbv is #UD unless CR4.OSXSAVE is set, which CPUID reflects in the OSXSAVE bit
+        cpuid(LEAF_BASIC_FEATURES, 0, regs);
+        if ((regs[2] & ECX_OSXSAVE) == 0) {
+            return false;
+        }
+
+#if __x86_64__
+        uint32_t low, high;
+        asm volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+        const uint64_t xcr0 = (static_cast<uint64_t>(high) << 32) | low;
+        return (xcr0 & XCR0_SSE_AVX) == XCR0_SSE_AVX;
+#else
+        return false;
+#endif
+    }
+} //namespace CHusky::Cpu
@@ -0,0 +1,109 @@
+#include <cstdint>
+
+#include "mem_internal.h"
+
+#include "c_husky/mem_copy.h"
+#include "c_husky/mem_fill.h"
+
+#if __x86_64__
+#include <immintrin.h>
+#endif
+
+/* The AVX2 variants. The rest of the tree is built with -mno-sse, so only these functions are compiled for AVX2 (with
+ * the target attribute), and they must never be called before the resolver has checked that the YMM state is enabled.
+ * Every exit path runs vzeroupper, so the legacy SSE code in the firmware/other cores doesn't pay the transition
+ * penalty. */
+namespace CHusky::Mem {
+    using Internal::broadcast;
+    using Internal::copySmall;
+    using Internal::fillSmall;
+
+#if __x86_64__
+    constexpr size_t VECTOR_SIZE = 32;
+
+    __attribute__((target("avx2"))) static inline __m256i loadVector(const unsigned char *p) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    }
+
+    __attribute__((target("avx2"))) static inline void storeVector(unsigned char *p, const __m256i value) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(p), value);
+    }
+
+    __attribute__((target("avx2"))) void *copyAvx2(void *dest, const void *src, const size_t n) {
+        auto *d = static_cast<unsigned char *>(dest);
+        const auto *s = static_cast<const unsigned char *>(src);
+
+        if (n <= SMALL_COPY_LIMIT) {
+            copySmall(d, s, n);
+            return dest;
+        }
+
+        //same shape as copyWords, with 32-byte vectors instead of 8-byte words
+        const __m256i head = loadVector(s);
+        const __m256i tail = loadVector(s + n - VECTOR_SIZE);
+
+        const size_t k = -reinterpret_cast<uintptr_t>(d) & (VECTOR_SIZE - 1);
+        unsigned char *vd = d + k;
+        const unsigned char *vs = s + k;
+        size_t vectors = (n - k) / VECTOR_SIZE;
+
+        for (; vectors >= 4; vectors -= 4, vd += 4 * VECTOR_SIZE, vs += 4 * VECTOR_SIZE) {
+            const __m256i a = loadVector(vs);
+            const __m256i b = loadVector(vs + VECTOR_SIZE);
+            const __m256i c = loadVector(vs + 2 * VECTOR_SIZE);
+            const __m256i e = loadVector(vs + 3 * VECTOR_SIZE);
+            storeVector(vd, a);
+            storeVector(vd + VECTOR_SIZE, b);
+            storeVector(vd + 2 * VECTOR_SIZE, c);
+            storeVector(vd + 3 * VECTOR_SIZE, e);
+        }
+
+        for (; vectors != 0; vectors--, vd += VECTOR_SIZE, vs += VECTOR_SIZE) {
+            storeVector(vd, loadVector(vs));
+        }
+
+        storeVector(d, head);
+        storeVector(d + n - VECTOR_SIZE, tail);
+        _mm256_zeroupper();
+        return dest;
+    }
+
+    __attribute__((target("avx2"))) void *fillAvx2(void *dest, const int c, const size_t n) {
+        auto *d = static_cast<unsigned char *>(dest);
+
+        if (n <= SMALL_FILL_LIMIT) {
+            fillSmall(d, broadcast(c), n);
+            return dest;
+        }
+
+        const __m256i value = _mm256_set1_epi8(static_cast<char>(c));
+        storeVector(d, value);
+        storeVector(d + n - VECTOR_SIZE, value);
+
+        unsigned char *vd = d + (-reinterpret_cast<uintptr_t>(d) & (VECTOR_SIZE - 1));
+        size_t vectors = (n - (vd - d)) / VECTOR_SIZE;
+
+        for (; vectors >= 4; vectors -= 4, vd += 4 * VECTOR_SIZE) {
+            storeVector(vd, value);
+            storeVector(vd + VECTOR_SIZE, value);
+            storeVector(vd + 2 * VECTOR_SIZE, value);
+            storeVector(vd + 3 * VECTOR_SIZE, value);
+        }
+
+        for (; vectors != 0; vectors--, vd += VECTOR_SIZE) {
+            storeVector(vd, value);
+        }
+
+        _mm256_zeroupper();
+        return dest;
+    }
+#else
+    void *copyAvx2(void *dest, const void *src, const size_t n) {
+        return copyBaseline(dest, src, n);
+    }
+
+    void *fillAvx2(void *dest, const int c, const size_t n) {
+        return fillBaseline(dest, c, n);
+    }
+#endif
+} //namespace CHusky::Mem
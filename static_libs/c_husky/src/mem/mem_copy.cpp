@@ -0,0 +1,181 @@
+#include <cstdint>
+
+#include "mem_internal.h"
+
+#include "c_husky/mem_copy.h"
+
+namespace CHusky::Mem {
+    using Internal::copySmall;
+    using Internal::load64;
+    using Internal::store64;
+
+    void *copyBytes(void *dest, const void *src, size_t n) {
+        auto *d = static_cast<unsigned char *>(dest);
+        const auto *s = static_cast<const unsigned char *>(src);
+
+        for (; n != 0; n--) {
+            *d = *s;
+            d++;
+            s++;
+        }
+
+        return dest;
+    }
+
+    void *copyWords(void *dest, const void *src, const size_t n) {
+        auto *d = static_cast<unsigned char *>(dest);
+        const auto *s = static_cast<const unsigned char *>(src);
+
+        if (n <= SMALL_COPY_LIMIT) {
+            copySmall(d, s, n);
+            return dest;
+        }
+
+        /* The first and last 8 bytes are loaded up front and stored at the end, so the loop can start at an aligned
+         * destination and stop at the last full word without caring about the leftovers. Loading them early is also
+         * what makes this safe for memmove when dest < src. */
+        const uint64_t head = load64(s);
+        const uint64_t tail = load64(s + n - 8);
+
+        const size_t k = -reinterpret_cast<uintptr_t>(d) & 7;
+        unsigned char *wd = d + k;
+        const unsigned char *ws = s + k;
+        size_t words = (n - k) / 8;
+
+        for (; words >= 4; words -= 4, wd += 32, ws += 32) {
+            const uint64_t a = load64(ws);
+            const uint64_t b = load64(ws + 8);
+            const uint64_t c = load64(ws + 16);
+            const uint64_t e = load64(ws + 24);
+            store64(wd, a);
+            store64(wd + 8, b);
+            store64(wd + 16, c);
+            store64(wd + 24, e);
+        }
+
+        for (; words != 0; words--, wd += 8, ws += 8) {
+            store64(wd, load64(ws));
+        }
+
+        store64(d, head);
+        store64(d + n - 8, tail);
+        return dest;
+    }
+
+    void *copyRepMovsq(void *dest, const void *src, const size_t n) {
+        auto *d = static_cast<unsigned char *>(dest);
+        const auto *s = static_cast<const unsigned char *>(src);
+
+        if (n < 8) {
+            copySmall(d, s, n);
+            return dest;
+        }
+
+#if __x86_64__
+        const uint64_t tail = load64(s + n - 8);
+        size_t words = n / 8;
+        asm volatile(
+            "rep movsq"
+            : "+D"(d), "+S"(s), "+c"(words)
+            :
+            : "memory");
+
+        store64(static_cast<unsigned char *>(dest) + n - 8, tail);
+        return dest;
+#else
+        return copyWords(dest, src, n);
+#endif
+    }
+
+    void *copyRepMovsb(void *dest, const void *src, size_t n) {
+#if __x86_64__
+        auto *d = static_cast<unsigned char *>(dest);
+        const auto *s = static_cast<const unsigned char *>(src);
+        asm volatile(
+            "rep movsb"
+            : "+D"(d), "+S"(s), "+c"(n)
+            :
+            : "memory");
+
+        return dest;
+#else
+        return copyWords(dest, src, n);
+#endif
+    }
+
+    void *copyBaseline(void *dest, const void *src, const size_t n) {
+        if (n <= SMALL_COPY_LIMIT) {
+            copySmall(static_cast<unsigned char *>(dest), static_cast<const unsigned char *>(src), n);
+            return dest;
+        }
+
+        if (n >= REP_MOVS_THRESHOLD) {
+            return copyRepMovsq(dest, src, n);
+        }
+
+        return copyWords(dest, src, n);
+    }
+
+    void *copyErms(void *dest, const void *src, const size_t n) {
+        if (n <= SMALL_COPY_LIMIT) {
+            copySmall(static_cast<unsigned char *>(dest), static_cast<const unsigned char *>(src), n);
+            return dest;
+        }
+
+        if (n >= REP_MOVS_THRESHOLD) {
+            return copyRepMovsb(dest, src, n);
+        }
+
+        return copyWords(dest, src, n);
+    }
+
+    void *copyFsrm(void *dest, const void *src, const size_t n) {
+        if (n <= SMALL_COPY_LIMIT) {
+            copySmall(static_cast<unsigned char *>(dest), static_cast<const unsigned char *>(src), n);
+            return dest;
+        }
+
+        if (n >= FSRM_THRESHOLD) {
+            return copyRepMovsb(dest, src, n);
+        }
+
+        return copyWords(dest, src, n);
+    }
+
+    void *copyBackward(void *dest, const void *src, const size_t n) {
+        auto *d = static_cast<unsigned char *>(dest);
+        const auto *s = static_cast<const unsigned char *>(src);
+
+        if (n <= SMALL_COPY_LIMIT) {
+            copySmall(d, s, n);
+            return dest;
+        }
+
+        /* Mirror image of copyWords: the loop walks down from the last aligned destination word and the head/tail
+         * (loaded before anything is written) patch up both ends. A backwards "rep movsq" (with the direction flag
+         * set) is notoriously slow on most microarchitectures, so the word loop is used for every size. */
+        const uint64_t head = load64(s);
+        const uint64_t tail = load64(s + n - 8);
+
+        size_t i = n - (reinterpret_cast<uintptr_t>(d + n) & 7);
+
+        for (; i >= 8 + 32; i -= 32) {
+            const uint64_t a = load64(s + i - 8);
+            const uint64_t b = load64(s + i - 16);
+            const uint64_t c = load64(s + i - 24);
+            const uint64_t e = load64(s + i - 32);
+            store64(d + i - 8, a);
+            store64(d + i - 16, b);
+            store64(d + i - 24, c);
+            store64(d + i - 32, e);
+        }
+
+        for (; i > 8; i -= 8) {
+            store64(d + i - 8, load64(s + i - 8));
+        }
+
+        store64(d + n - 8, tail);
+        store64(d, head);
+        return dest;
+    }
+} //namespace CHusky::Mem
@@ -0,0 +1,152 @@
+#include <cstdint>
+
+#include "mem_internal.h"
+
+#include "c_husky/mem_fill.h"
+
+namespace CHusky::Mem {
+    using Internal::broadcast;
+    using Internal::fillSmall;
+    using Internal::store64;
+
+    void *fillBytes(void *dest, const int c, size_t n) {
+        auto *d = static_cast<unsigned char *>(dest);
+
+        for (; n != 0; n--) {
+            *d = static_cast<unsigned char>(c);
+            d++;
+        }
+
+        return dest;
+    }
+
+    void *fillWords(void *dest, const int c, const size_t n) {
+        auto *d = static_cast<unsigned char *>(dest);
+        const uint64_t word = broadcast(c);
+
+        if (n <= SMALL_FILL_LIMIT) {
+            fillSmall(d, word, n);
+            return dest;
+        }
+
+        //the unaligned head and tail are covered by overlapping stores, the loop only does aligned ones
+        store64(d, word);
+        store64(d + n - 8, word);
+
+        const size_t k = -reinterpret_cast<uintptr_t>(d) & 7;
+        unsigned char *w = d + k;
+        size_t words = (n - k) / 8;
+
+        for (; words >= 4; words -= 4, w += 32) {
+            store64(w, word);
+            store64(w + 8, word);
+            store64(w + 16, word);
+            store64(w + 24, word);
+        }
+
+        for (; words != 0; words--, w += 8) {
+            store64(w, word);
+        }
+
+        return dest;
+    }
+
+    void *fillRepStosq(void *dest, const int c, const size_t n) {
+        auto *d = static_cast<unsigned char *>(dest);
+        const uint64_t word = broadcast(c);
+
+        if (n <= SMALL_FILL_LIMIT) {
+            fillSmall(d, word, n);
+            return dest;
+        }
+
+#if __x86_64__
+        store64(d, word);
+        store64(d + n - 8, word);
+
+        const size_t k = -reinterpret_cast<uintptr_t>(d) & 7;
+        unsigned char *aligned = d + k;
+        size_t words = (n - k) / 8;
+        asm volatile(
+            "rep stosq"
+            : "+D"(aligned), "+c"(words)
+            : "a"(word)
+            : "memory");
+
+        return dest;
+#else
+        return fillWords(dest, c, n);
+#endif
+    }
+
+    void *fillRepStosb(void *dest, const int c, size_t n) {
+#if __x86_64__
+        auto *d = static_cast<unsigned char *>(dest);
+        asm volatile(
+            "rep stosb"
+            : "+D"(d), "+c"(n)
+            : "a"(c)
+            : "memory");
+
+        return dest;
+#else
+        return fillWords(dest, c, n);
+#endif
+    }
+
+    void *fillBaseline(void *dest, const int c, const size_t n) {
+        if (n <= SMALL_FILL_LIMIT) {
+            fillSmall(static_cast<unsigned char *>(dest), broadcast(c), n);
+            return dest;
+        }
+
+        if (n >= REP_STOS_THRESHOLD) {
+            return fillRepStosq(dest, c, n);
+        }
+
+        return fillWords(dest, c, n);
+    }
+
+    void *fillErms(void *dest, const int c, const size_t n) {
+        if (n <= SMALL_FILL_LIMIT) {
+            fillSmall(static_cast<unsigned char *>(dest), broadcast(c), n);
+            return dest;
+        }
+
+        if (n >= REP_STOS_THRESHOLD) {
+            return fillRepStosb(dest, c, n);
+        }
+
+        return fillWords(dest, c, n);
+    }
+
+    /* The destination of the page routines is page-aligned and the size is a multiple of the page size, so the string
+     * instructions can run without any head/tail fix-ups. */
+
+    void zeroPagesRepStosq(void *pages, const size_t count) {
+#if __x86_64__
+        size_t words = count * (ZERO_PAGE_SIZE / 8);
+        asm volatile(
+            "rep stosq"
+            : "+D"(pages), "+c"(words)
+            : "a"(0ULL)
+            : "memory");
+#else
+        fillWords(pages, 0, count * ZERO_PAGE_SIZE);
+#endif
+    }
+
+    void zeroPagesRepStosb(void *pages, const size_t count) {
+#if __x86_64__
+        //with ERMS, the microcode internally uses the widest stores available (even though SSE is disabled for us)
+        size_t n = count * ZERO_PAGE_SIZE;
+        asm volatile(
+            "rep stosb"
+            : "+D"(pages), "+c"(n)
+            : "a"(0)
+            : "memory");
+#else
+        fillWords(pages, 0, count * ZERO_PAGE_SIZE);
+#endif
+    }
+} //namespace CHusky::Mem
@@ -0,0 +1,107 @@
+#ifndef C_HUSKY_MEM_INTERNAL_H
+#define C_HUSKY_MEM_INTERNAL_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Helpers shared by the memory routine variants. Not part of the public interface.
+ */
+namespace CHusky::Mem::Internal {
+    /* Unaligned accessors that don't violate strict aliasing. They compile to plain "mov" instructions on x86_64,
+     * so there's no SSE involved and no risk of the compiler turning them into a call to memcpy. */
+    typedef uint64_t __attribute__((__may_alias__, __aligned__(1))) UnalignedU64;
+    typedef uint32_t __attribute__((__may_alias__, __aligned__(1))) UnalignedU32;
+    typedef uint16_t __attribute__((__may_alias__, __aligned__(1))) UnalignedU16;
+
+    //for aligned loads that may read past the end of an object (but never past the end of its page)
+    typedef uint64_t __attribute__((__may_alias__)) AliasedU64;
+
+    inline uint64_t load64(const unsigned char *p) {
+        return *reinterpret_cast<const UnalignedU64 *>(p);
+    }
+
+    inline void store64(unsigned char *p, const uint64_t value) {
+        *reinterpret_cast<UnalignedU64 *>(p) = value;
+    }
+
+    /**
+     * Replicates the low byte of c in all the 8 bytes of a word.
+     */
+    inline uint64_t broadcast(const int c) {
+        return static_cast<uint64_t>(static_cast<unsigned char>(c)) * 0x0101010101010101ULL;
+    }
+
+    /**
+     * Returns a word with the high bit set in (at least) the lowest zero byte of x, and no bits set below it. Bytes
+     * above the lowest zero byte can be false positives because of the borrow, so only the lowest set bit is reliable.
+     */
+    inline uint64_t zeroByteMask(const uint64_t x) {
+        return (x - 0x0101010101010101ULL) & ~x & 0x8080808080808080ULL;
+    }
+
+    /**
+     * Returns the index (in memory order) of the byte flagged by the lowest set bit of a non-zero mask.
+     */
+    inline size_t firstFlaggedByte(const uint64_t mask) {
+        return static_cast<size_t>(__builtin_ctzll(mask)) / 8;
+    }
+
+    /**
+     * Copies up to 32 bytes. All the loads happen before any store, so it's overlap-safe in both directions.
+     */
+    inline void copySmall(unsigned char *d, const unsigned char *s, const size_t n) {
+        if (n >= 16) {
+            const uint64_t a = load64(s);
+            const uint64_t b = load64(s + 8);
+            const uint64_t c = load64(s + n - 16);
+            const uint64_t e = load64(s + n - 8);
+            store64(d, a);
+            store64(d + 8, b);
+            store64(d + n - 16, c);
+            store64(d + n - 8, e);
+        } else if (n >= 8) {
+            const uint64_t a = load64(s);
+            const uint64_t b = load64(s + n - 8);
+            store64(d, a);
+            store64(d + n - 8, b);
+        } else if (n >= 4) {
+            const uint32_t a = *reinterpret_cast<const UnalignedU32 *>(s);
+            const uint32_t b = *reinterpret_cast<const UnalignedU32 *>(s + n - 4);
+            *reinterpret_cast<UnalignedU32 *>(d) = a;
+            *reinterpret_cast<UnalignedU32 *>(d + n - 4) = b;
+        } else if (n >= 2) {
+            const uint16_t a = *reinterpret_cast<const UnalignedU16 *>(s);
+            const uint16_t b = *reinterpret_cast<const UnalignedU16 *>(s + n - 2);
+            *reinterpret_cast<UnalignedU16 *>(d) = a;
+            *reinterpret_cast<UnalignedU16 *>(d + n - 2) = b;
+        } else if (n == 1) {
+            *d = *s;
+        }
+    }
+
+    /**
+     * Fills up to 32 bytes with the given (broadcast) word.
+     */
+    inline void fillSmall(unsigned char *d, const uint64_t word, const size_t n) {
+        if (n >= 16) {
+            store64(d, word);
+            store64(d + 8, word);
+            store64(d + n - 16, word);
+            store64(d + n - 8, word);
+        } else if (n >= 8) {
+            store64(d, word);
+            store64(d + n - 8, word);
+        } else if (n >= 4) {
+            *reinterpret_cast<UnalignedU32 *>(d) = static_cast<uint32_t>(word);
+            *reinterpret_cast<UnalignedU32 *>(d + n - 4) = static_cast<uint32_t>(word);
+        } else if (n >= 2) {
+            *reinterpret_cast<UnalignedU16 *>(d) = static_cast<uint16_t>(word);
+            *reinterpret_cast<UnalignedU16 *>(d + n - 2) = static_cast<uint16_t>(word);
+        } else if (n == 1) {
+            *d = static_cast<unsigned char>(word);
+        }
+    }
+} //namespace CHusky::Mem::Internal
+
+#endif //C_HUSKY_MEM_INTERNAL_H
@@ -0,0 +1,35 @@
+#include "c_husky/cpu_features.h"
+#include "c_husky/mem_copy.h"
+#include "c_husky/mem_fill.h"
+
+#include "c_husky/mem_routines.h"
+
+namespace CHusky::Mem {
+    Routines activeRoutines = {RoutineSet::Baseline, copyBaseline, fillBaseline, zeroPagesRepStosq};
+
+    RoutineSet resolveRoutines(const bool allowAvx) {
+        const Cpu::CpuFeatures &features = Cpu::getCpuFeatures();
+
+        if (allowAvx && features.hasAvx2 && Cpu::isAvxStateEnabled()) {
+            /* Page zeroing stays on the string instructions: with ERMS they write whole cache lines without reading
+             * them first, which the vector loop can't do. */
+            activeRoutines = {
+                RoutineSet::Avx2,
+                copyAvx2,
+                fillAvx2,
+                features.hasErms ? zeroPagesRepStosb : zeroPagesRepStosq,
+            };
+        } else if (features.hasErms) {
+            activeRoutines = {
+                RoutineSet::Erms,
+                features.hasFsrm ? copyFsrm : copyErms,
+                fillErms,
+                zeroPagesRepStosb,
+            };
+        } else {
+            activeRoutines = {RoutineSet::Baseline, copyBaseline, fillBaseline, zeroPagesRepStosq};
+        }
+
+        return activeRoutines.set;
+    }
+} //namespace CHusky::Mem
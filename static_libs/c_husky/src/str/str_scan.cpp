@@ -0,0 +1,144 @@
+#include <cstdint>
+
+#include "../mem/mem_internal.h"
+
+#include "c_husky/str_scan.h"
+
+namespace CHusky::Str {
+    using Mem::Internal::AliasedU64;
+    using Mem::Internal::firstFlaggedByte;
+    using Mem::Internal::load64;
+    using Mem::Internal::store64;
+    using Mem::Internal::zeroByteMask;
+
+    constexpr uintptr_t WORD_MASK = 7;
+
+    /**
+     * Returns the aligned word containing str, with the bytes before str forced to 0xFF, so they're never mistaken for
+     * the terminator.
+     */
+    static inline uint64_t loadHeadWord(const char *str) {
+        const uintptr_t address = reinterpret_cast<uintptr_t>(str);
+        const uint64_t word = *reinterpret_cast<const AliasedU64 *>(address & ~WORD_MASK);
+        return word | ((1ULL << ((address & WORD_MASK) * 8)) - 1);
+    }
+
+    size_t lengthBytes(const char *str) {
+        const char *s = str;
+        while (*s != 0) {
+            s++;
+        }
+
+        return s - str;
+    }
+
+    size_t length(const char *str) {
+        const auto *word = reinterpret_cast<const AliasedU64 *>(reinterpret_cast<uintptr_t>(str) & ~WORD_MASK);
+
+        uint64_t mask = zeroByteMask(loadHeadWord(str));
+        while (mask == 0) {
+            word++;
+            mask = zeroByteMask(*word);
+        }
+
+        return reinterpret_cast<const char *>(word) + firstFlaggedByte(mask) - str;
+    }
+
+    size_t boundedLength(const char *str, const size_t maxLength) {
+        if (maxLength == 0) {
+            return 0;
+        }
+
+        const auto *word = reinterpret_cast<const AliasedU64 *>(reinterpret_cast<uintptr_t>(str) & ~WORD_MASK);
+        //how many bytes of the string have been looked at, counting from str
+        size_t scanned = 8 - (reinterpret_cast<uintptr_t>(str) & WORD_MASK);
+
+        uint64_t mask = zeroByteMask(loadHeadWord(str));
+        while (mask == 0) {
+            if (scanned >= maxLength) {
+                return maxLength;
+            }
+
+            word++;
+            scanned += 8;
+            mask = zeroByteMask(*word);
+        }
+
+        const size_t len = reinterpret_cast<const char *>(word) + firstFlaggedByte(mask) - str;
+        return len < maxLength ? len : maxLength;
+    }
+
+    int compareBytes(const void *left, const void *right, size_t n) {
+        const auto *l = static_cast<const unsigned char *>(left);
+        const auto *r = static_cast<const unsigned char *>(right);
+        for (; n != 0 && *l == *r; n--, l++, r++) {}
+        return n != 0 ? *l - *r : 0;
+    }
+
+    /**
+     * Returns the difference between the first mismatching bytes of two different words.
+     */
+    static inline int compareWords(const uint64_t l, const uint64_t r) {
+        const size_t shift = firstFlaggedByte(l ^ r) * 8;
+        return static_cast<int>((l >> shift) & 0xFF) - static_cast<int>((r >> shift) & 0xFF);
+    }
+
+    int compare(const void *left, const void *right, const size_t n) {
+        const auto *l = static_cast<const unsigned char *>(left);
+        const auto *r = static_cast<const unsigned char *>(right);
+
+        if (n < 8) {
+            return compareBytes(l, r, n);
+        }
+
+        /* Unaligned loads are fine here: unlike with strings, all the n bytes are known to be readable. The last
+         * (partial) word is handled by comparing the last 8 bytes, which overlap bytes already known to be equal. */
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            const uint64_t a = load64(l + i);
+            const uint64_t b = load64(r + i);
+            if (a != b) {
+                return compareWords(a, b);
+            }
+        }
+
+        if (i != n) {
+            const uint64_t a = load64(l + n - 8);
+            const uint64_t b = load64(r + n - 8);
+            if (a != b) {
+                return compareWords(a, b);
+            }
+        }
+
+        return 0;
+    }
+
+    char *copyStringBytes(char *dest, const char *src) {
+        while ((*dest = *src) != 0) {
+            dest++;
+            src++;
+        }
+
+        return dest;
+    }
+
+    char *copyString(char *dest, const char *src) {
+        //byte by byte until src is aligned, so the word loads below never cross a page boundary
+        for (; (reinterpret_cast<uintptr_t>(src) & WORD_MASK) != 0; dest++, src++) {
+            if ((*dest = *src) == 0) {
+                return dest;
+            }
+        }
+
+        for (;; dest += 8, src += 8) {
+            const uint64_t word = *reinterpret_cast<const AliasedU64 *>(src);
+            if (zeroByteMask(word) != 0) {
+                break;
+            }
+
+            store64(reinterpret_cast<unsigned char *>(dest), word);
+        }
+
+        return copyStringBytes(dest, src);
+    }
+} //namespace CHusky::Str
@@ -1,8 +1,6 @@
 #include "cstring.h"
+#include "c_husky/str_scan.h"
 
 int memcmp(const void *left, const void *right, size_t n) {
-    const auto *l = static_cast<const unsigned char *>(left);
-    const auto *r = static_cast<const unsigned char *>(right);
-    for (; n != 0 && *l == *r; n--, l++, r++){}
-    return n != 0 ? *l-*r : 0;
+    return CHusky::Str::compare(left, right, n);
 }
@@ -1,31 +1,20 @@
 #include <cstdint>
 
 #include "cstring.h"
+#include "c_husky/mem_copy.h"
+#include "c_husky/mem_routines.h"
 
 void *memmove(void *dest, const void *src, size_t n)
 {
-    auto *d = static_cast<char *>(dest);
-    const auto *s = static_cast<const char *>(src);
-
-    if (d==s) {
-        return d;
-    }
-    if (reinterpret_cast<uintptr_t>(s) - reinterpret_cast<uintptr_t>(d) - n <= -2 * n) {
-        return memcpy(d, s, n);
+    if (dest == src || n == 0) {
+        return dest;
     }
 
-    if (d<s) {
-        for (; n != 0; n--) {
-            *d = *s;
-            d++;
-            s++;
-        }
-    } else {
-        while (n != 0) {
-            d[n] = s[n];
-            n--;
-        }
+    /* If dest is before src (or the regions don't overlap at all), a forward copy never overwrites unread bytes. All
+     * the variants qualify: they load a whole block (and the head/tail) before storing it. */
+    if (reinterpret_cast<uintptr_t>(dest) - reinterpret_cast<uintptr_t>(src) >= n) {
+        return CHusky::Mem::copy(dest, src, n);
     }
 
-    return dest;
+    return CHusky::Mem::copyBackward(dest, src, n);
 }
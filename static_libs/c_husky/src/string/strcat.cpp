@@ -1,6 +1,7 @@
 #include "cstring.h"
+#include "c_husky/str_scan.h"
 
 char *strcat(char *dest, const char *source) {
-    strcpy(dest + strlen(dest), source);
+    CHusky::Str::copyString(dest + CHusky::Str::length(dest), source);
     return dest;
-}
\ No newline at end of file
+}
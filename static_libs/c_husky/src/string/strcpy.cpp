@@ -1,13 +1,7 @@
 #include "string.h"
+#include "c_husky/str_scan.h"
 
 char *strcpy(char *dest, const char *src) {
-    char *d = dest;
-    
-    while (*src != 0) {
-        *d = *src;
-        d++;
-        src++;
-    }
-
+    CHusky::Str::copyString(dest, src);
     return dest;
-}
\ No newline at end of file
+}
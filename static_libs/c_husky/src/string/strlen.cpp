@@ -1,10 +1,6 @@
 #include "cstring.h"
+#include "c_husky/str_scan.h"
 
 size_t strlen(const char *str) {
-    const char *s = str;
-    while (*s != 0) {
-        s++;
-    }
-
-    return s - str;
+    return CHusky::Str::length(str);
 }
@@ -1,16 +1,11 @@
 #include "cstring.h"
+#include "c_husky/str_scan.h"
 
 char *strncat(char *dest, const char *source, size_t num) {
-    char *a = dest;
-    dest += strlen(dest);
-    
-    while (num != 0 && *source != 0) {
-        *dest = *source;
-        dest++;
-        source++;
-        num--;
-    }
-    
-    *dest = 0;
-    return a;
-}
\ No newline at end of file
+    char *end = dest + CHusky::Str::length(dest);
+    const size_t len = CHusky::Str::boundedLength(source, num);
+
+    memcpy(end, source, len);
+    end[len] = 0;
+    return dest;
+}
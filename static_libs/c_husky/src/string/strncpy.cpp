@@ -1,15 +1,10 @@
 #include "string.h"
+#include "c_husky/str_scan.h"
 
 char *strncpy(char *dest, const char *source, size_t num) {
-    char *d = dest;
-    
-    while (*source != 0) {
-        *d = *source;
-        d++;
-        source++;
-        num--;
-    }
-
-    memset(dest, 0, num);
+    //the source can be shorter than num (the rest of dest is zeroed) or longer (dest isn't terminated)
+    const size_t len = CHusky::Str::boundedLength(source, num);
+    memcpy(dest, source, len);
+    memset(dest + len, 0, num - len);
     return dest;
-}
\ No newline at end of file
+}
@@ -1,6 +1,6 @@
 #!/bin/bash
 
-for dir in chihuahua_essentials elf paginator c_husky
+for dir in chihuahua_essentials elf paginator c_husky frame_allocator slab trace serial_log scheduler timer_wheel
 do
     pushd $dir
     source config_meson.sh
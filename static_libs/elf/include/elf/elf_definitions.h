@@ -429,6 +429,43 @@ namespace Elf {
     };
     
 #pragma endregion //ELF section header
+
+
+#pragma region ELF symbol table
+
+    /**
+     * The section index of an undefined symbol.
+     */
+    constexpr uint16_t SHN_UNDEF = 0;
+
+    /**
+     * An entry of a SHT_SYMTAB or SHT_DYNSYM section.
+     */
+    struct Elf64_Symbol {
+        /**
+         * The index of the name in the string table the symbol table's LinkInfo points to; 0 if it has none.
+         */
+        uint32_t NameIndex;
+        /**
+         * The binding (high 4 bits) and the type (low 4 bits).
+         */
+        uint8_t Info;
+        /**
+         * The visibility (low 2 bits).
+         */
+        uint8_t Other;
+        /**
+         * The index of the section the symbol is defined in, or SHN_UNDEF.
+         */
+        uint16_t SectionIndex;
+        /**
+         * The symbol's virtual address, in an executable.
+         */
+        Elf64_Addr Value;
+        uint64_t Size;
+    };
+
+#pragma endregion //ELF symbol table
     
 } //namespace Elf
 
@@ -42,6 +42,14 @@ namespace Elf
              * A parameter indicated to a region outside the ELF file.
              */
             ElfSizeExceeded = 4,
+            /**
+             * The read callback of an ElfStreamLoader failed.
+             */
+            ElfReadFailed = 5,
+            /**
+             * No symbol table defines the symbol looked for.
+             */
+            ElfSymbolNotFound = 6,
             /**
              * A generic error.
              */
@@ -95,6 +103,16 @@ namespace Elf
          * @param loaderCallback The function that needs to give the address at which to write the data.
          */
         ElfError loadNoBitsSection(const Elf64_SectionHeader *sectionHeader, LoaderFunction loaderCallback) const;
+
+        /**
+         * Looks a defined symbol up by name in the symbol tables (SHT_DYNSYM and SHT_SYMTAB) of the file. The entire
+         * file must be loaded into memory.
+         * @param name The symbol's name.
+         * @param address [OUT] The symbol's value: its virtual address.
+         * @return ElfError::NoError if it was found, ElfError::ElfSymbolNotFound if no table has it, otherwise the
+         * error found in the headers or the tables.
+         */
+        ElfError findSymbol(const char *name, Elf64_Addr *address) const;
     };
 } // namespace Elf
 
@@ -0,0 +1,125 @@
+#ifndef ELF_ELF_STREAM_LOADER_H
+#define ELF_ELF_STREAM_LOADER_H
+
+#include <cstdint>
+
+#include "elf_definitions.h"
+#include "elf_loader.h"
+
+namespace Elf
+{
+    /**
+     * An ELF loader that doesn't need the file in memory: every access goes through a read-at-offset callback, and only
+     * the ELF header, the header tables and the segment contents are ever read. Memory usage is therefore proportional
+     * to what gets loaded, not to the size of the file (debug info, symbol tables and so on are never touched).
+     *
+     * The checks are the same as the ones done by ElfLoader, so both can be used interchangeably.
+     */
+    class ElfStreamLoader
+    {
+    public:
+        typedef ElfLoader::ElfError ElfError;
+        typedef ElfLoader::LoaderFunction LoaderFunction;
+
+        /**
+         * Reads bytes from the ELF file.
+         * @param context The context given to the constructor (a file handle, for example).
+         * @param offset The offset in the file to read from.
+         * @param size The number of bytes to read; the read must be complete.
+         * @param dest Where to write the bytes.
+         * @return True if exactly size bytes were read, false otherwise.
+         */
+        typedef bool (*ReadFunction)(void *context, uint64_t offset, uint64_t size, void *dest);
+
+    private:
+        ReadFunction readCallback;
+        void *readContext;
+        uint64_t elfFileSize;
+
+        Elf64_ElfHeader elfHeader{};
+        bool isHeaderRead = false;
+
+        [[nodiscard]] ElfError readTable(
+            uint64_t tableOffset,
+            uint16_t entrySize,
+            uint64_t expectedEntrySize,
+            int numEntries,
+            void *dest) const;
+
+    public:
+        /**
+         * @param readCallback The function used for every read from the file.
+         * @param readContext Passed as-is to readCallback.
+         * @param elfFileSize The size of the file, used for the bounds checks.
+         */
+        ElfStreamLoader(const ReadFunction readCallback, void *readContext, const uint64_t elfFileSize)
+        {
+            this->readCallback = readCallback;
+            this->readContext = readContext;
+            this->elfFileSize = elfFileSize;
+        }
+
+        /**
+         * Reads and checks the ELF header. Must be called (successfully) before any other method.
+         * @return ElfError::NoError if the ELF header is OK and the ELF type is supported, otherwise an error of type
+         * ElfError.
+         */
+        ElfError readHeader();
+
+        /**
+         * Returns the ELF header read by readHeader.
+         */
+        [[nodiscard]] const Elf64_ElfHeader &getHeader() const
+        {
+            return this->elfHeader;
+        }
+
+        /**
+         * Returns the number of program headers, so the caller can size the buffer given to readProgramHeaders.
+         */
+        [[nodiscard]] int getProgramHeaderCount() const
+        {
+            return this->elfHeader.ProgHeaderTableEntriesNum;
+        }
+
+        /**
+         * Returns the number of section headers, so the caller can size the buffer given to readSectionHeaders.
+         */
+        [[nodiscard]] int getSectionHeaderCount() const
+        {
+            return this->elfHeader.SectionHeaderTableEntriesNum;
+        }
+
+        /**
+         * Reads the whole program header table with a single read.
+         * @param dest [OUT] Room for getProgramHeaderCount() entries.
+         * @return ElfError::NoError, or the reason the table couldn't be read.
+         */
+        ElfError readProgramHeaders(Elf64_ProgHeader *dest) const;
+
+        /**
+         * Reads the whole section header table with a single read.
+         * @param dest [OUT] Room for getSectionHeaderCount() entries.
+         * @return ElfError::NoError, or the reason the table couldn't be read.
+         */
+        ElfError readSectionHeaders(Elf64_SectionHeader *dest) const;
+
+        /**
+         * Loads the PT_LOAD segment described by the given program header at the address given by loaderCallback.
+         * The file part is read straight into the destination and the rest (.bss) is zeroed.
+         * @param progHeader A program header returned by readProgramHeaders.
+         * @param loaderCallback The function that needs to give the address at which to write the data.
+         */
+        ElfError loadExecutableProgram(const Elf64_ProgHeader *progHeader, LoaderFunction loaderCallback) const;
+
+        /**
+         * Like loadExecutableProgram, for callers that already know where the segment goes.
+         * @param progHeader A program header returned by readProgramHeaders.
+         * @param dest Room for progHeader->SizeInMemory bytes.
+         * @param zeroRest False to only read the file part, for callers that zero the rest (.bss) themselves.
+         */
+        ElfError loadExecutableProgramAt(const Elf64_ProgHeader *progHeader, void *dest, bool zeroRest = true) const;
+    };
+} // namespace Elf
+
+#endif // ELF_ELF_STREAM_LOADER_H
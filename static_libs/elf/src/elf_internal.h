@@ -0,0 +1,26 @@
+#ifndef ELF_ELF_INTERNAL_H
+#define ELF_ELF_INTERNAL_H
+
+#include <cstdint>
+
+#include "elf/elf_loader.h"
+
+/**
+ * Helpers shared by ElfLoader and ElfStreamLoader. Not part of the public interface.
+ */
+namespace Elf::Internal
+{
+    /**
+     * Checks the identification and type fields of an ELF header.
+     * @return ElfError::NoError if the header is OK and the ELF type is supported, otherwise an error of type ElfError.
+     */
+    ElfLoader::ElfError checkHeader(const Elf64_ElfHeader &header);
+
+    /**
+     * Zeroes the given region. The whole pages inside it are cleared with the page-zeroing routine, so only the
+     * unaligned head and tail go through memset.
+     */
+    void zeroRegion(char *start, uint64_t size);
+} // namespace Elf::Internal
+
+#endif // ELF_ELF_INTERNAL_H
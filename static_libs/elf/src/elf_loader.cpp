@@ -1,26 +1,61 @@
+#include <string.h>
+
+#include "c_husky/mem_fill.h"
+#include "c_husky/mem_routines.h"
 #include "elf/elf_definitions.h"
-#include "chihuahua_essentials/mem_essentials.h"
 
 #include "elf/elf_loader.h"
+#include "elf_internal.h"
 
 namespace Elf
 {
-    ElfLoader::ElfError ElfLoader::checkElf() const
+    using Internal::zeroRegion;
+
+    ElfLoader::ElfError Internal::checkHeader(const Elf64_ElfHeader &header)
     {
-        const Elf64_ElfHeader header = *static_cast<Elf64_ElfHeader *>(this->elfFile);
         if (
             header.Identifiers[static_cast<int>(Elf_IdentIndex::EI_MAG0)] != ELF_MAG0 || header.Identifiers[static_cast<int>(Elf_IdentIndex::EI_MAG1)] != ELF_MAG1 || header.Identifiers[static_cast<int>(Elf_IdentIndex::EI_MAG2)] != ELF_MAG2 || header.Identifiers[static_cast<int>(Elf_IdentIndex::EI_MAG3)] != ELF_MAG3)
         {
-            return ElfError::ElfHeaderCorrupted;
+            return ElfLoader::ElfError::ElfHeaderCorrupted;
         }
 
         if (
             header.Identifiers[static_cast<int>(Elf_IdentIndex::EI_CLASS)] != 2 || header.Identifiers[static_cast<int>(Elf_IdentIndex::EI_VERSION)] != 1 || header.Version != 1 || header.Machine != Elf_Machine::x86_64 || header.Type != Elf_Type::ET_EXEC)
         {
-            return ElfError::ElfTypeNotSupported;
+            return ElfLoader::ElfError::ElfTypeNotSupported;
         }
 
-        return ElfError::NoError;
+        return ElfLoader::ElfError::NoError;
+    }
+
+    void Internal::zeroRegion(char *start, uint64_t size)
+    {
+        constexpr uint64_t PAGE_MASK = CHusky::Mem::ZERO_PAGE_SIZE - 1;
+
+        const uint64_t headSize = -reinterpret_cast<uintptr_t>(start) & PAGE_MASK;
+        if (size <= headSize)
+        {
+            memset(start, 0, size);
+            return;
+        }
+
+        memset(start, 0, headSize);
+        start += headSize;
+        size -= headSize;
+
+        const uint64_t pageCount = size / CHusky::Mem::ZERO_PAGE_SIZE;
+        CHusky::Mem::zeroPages(start, pageCount);
+        memset(start + pageCount * CHusky::Mem::ZERO_PAGE_SIZE, 0, size & PAGE_MASK);
+    }
+
+    ElfLoader::ElfError ElfLoader::checkElf() const
+    {
+        if (this->elfFileSize < sizeof(Elf64_ElfHeader))
+        {
+            return ElfError::ElfSizeExceeded;
+        }
+
+        return Internal::checkHeader(*static_cast<Elf64_ElfHeader *>(this->elfFile));
     }
 
     Elf64_ProgHeader *ElfLoader::getProgramHeaders(int *numProgHeaders, ElfError *error) const
@@ -40,7 +75,7 @@ namespace Elf
         }
 
         *numProgHeaders = elfHeader.ProgHeaderTableEntriesNum;
-        if (elfHeader.ProgHeaderOffset + (*numProgHeaders * sizeof(Elf64_ProgHeader)) >= this->elfFileSize)
+        if (elfHeader.ProgHeaderOffset + (*numProgHeaders * sizeof(Elf64_ProgHeader)) > this->elfFileSize)
         {
             *error = ElfError::ElfSizeExceeded;
             return nullptr;
@@ -66,7 +101,7 @@ namespace Elf
         }
 
         *numSectionHeaders = elfHeader.SectionHeaderTableEntriesNum;
-        if (elfHeader.SectionHeaderOffset + (*numSectionHeaders * sizeof(Elf64_SectionHeader)) >= this->elfFileSize)
+        if (elfHeader.SectionHeaderOffset + (*numSectionHeaders * sizeof(Elf64_SectionHeader)) > this->elfFileSize)
         {
             *error = ElfError::ElfSizeExceeded;
             return nullptr;
@@ -85,6 +120,13 @@ namespace Elf
             return ElfError::ElfSectionNotLoadable;
         }
 
+        // only the file part has to be inside the file, the rest (.bss) is zeroed
+        if (
+            progHeader->Offset > this->elfFileSize || progHeader->SizeInFile > this->elfFileSize - progHeader->Offset)
+        {
+            return ElfError::ElfSizeExceeded;
+        }
+
         void *dest = loaderCallback(
             static_cast<int>(progHeader->SizeInMemory),
             progHeader->VirtAddress,
@@ -95,20 +137,13 @@ namespace Elf
             return ElfError::ElfGenericError;
         }
 
-        if (
-            progHeader->Offset >= this->elfFileSize || progHeader->Offset + progHeader->SizeInFile >= this->elfFileSize || progHeader->Offset + progHeader->SizeInMemory >= this->elfFileSize)
-        {
-            return ElfError::ElfSizeExceeded;
-        }
-
         memcpy(dest, static_cast<char *>(elfFile) + progHeader->Offset, progHeader->SizeInFile);
 
         // zero-out eventual mismatch between the size in file vs the size in memory
         if (progHeader->SizeInMemory > progHeader->SizeInFile)
         {
-            memset(
+            zeroRegion(
                 static_cast<char *>(dest) + progHeader->SizeInFile,
-                0,
                 progHeader->SizeInMemory - progHeader->SizeInFile);
         }
 
@@ -142,7 +177,81 @@ namespace Elf
             return ElfError::ElfGenericError;
         }
 
-        memset(dest, 0, sectionHeader->SectionSize);
+        zeroRegion(static_cast<char *>(dest), sectionHeader->SectionSize);
         return ElfError::NoError;
     }
+
+    /**
+     * Compares a null-terminated name with one of a string table, without reading past the end of the table.
+     */
+    static bool isSameName(const char *name, const char *tableName, uint64_t maxLength)
+    {
+        for (; maxLength != 0; maxLength--, name++, tableName++)
+        {
+            if (*name != *tableName)
+            {
+                return false;
+            }
+            if (*name == '\0')
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    ElfLoader::ElfError ElfLoader::findSymbol(const char *name, Elf64_Addr *address) const
+    {
+        int numSectionHeaders;
+        ElfError error;
+        const Elf64_SectionHeader *sectionHeaders = getSectionHeaders(&numSectionHeaders, &error);
+        if (sectionHeaders == nullptr)
+        {
+            return error;
+        }
+
+        const char *file = static_cast<const char *>(this->elfFile);
+        for (int i = 0; i < numSectionHeaders; i++)
+        {
+            const Elf64_SectionHeader &symbolTable = sectionHeaders[i];
+            if (
+                symbolTable.SectionHeaderType != Elf_SectionType::SHT_DYNSYM && symbolTable.SectionHeaderType != Elf_SectionType::SHT_SYMTAB)
+            {
+                continue;
+            }
+
+            // a symbol table names its string table in LinkInfo
+            if (
+                symbolTable.EntryFixedSize != sizeof(Elf64_Symbol) || symbolTable.LinkInfo >= static_cast<uint32_t>(numSectionHeaders))
+            {
+                return ElfError::ElfHeaderCorrupted;
+            }
+            const Elf64_SectionHeader &stringTable = sectionHeaders[symbolTable.LinkInfo];
+            if (
+                symbolTable.OffsetInFile > this->elfFileSize || symbolTable.SectionSize > this->elfFileSize - symbolTable.OffsetInFile || stringTable.OffsetInFile > this->elfFileSize || stringTable.SectionSize > this->elfFileSize - stringTable.OffsetInFile)
+            {
+                return ElfError::ElfSizeExceeded;
+            }
+
+            const auto *symbols = reinterpret_cast<const Elf64_Symbol *>(file + symbolTable.OffsetInFile);
+            const uint64_t numSymbols = symbolTable.SectionSize / sizeof(Elf64_Symbol);
+            const char *strings = file + stringTable.OffsetInFile;
+            for (uint64_t j = 0; j < numSymbols; j++)
+            {
+                const Elf64_Symbol &symbol = symbols[j];
+                if (symbol.SectionIndex == SHN_UNDEF || symbol.NameIndex == 0 || symbol.NameIndex >= stringTable.SectionSize)
+                {
+                    continue;
+                }
+
+                if (isSameName(name, strings + symbol.NameIndex, stringTable.SectionSize - symbol.NameIndex))
+                {
+                    *address = symbol.Value;
+                    return ElfError::NoError;
+                }
+            }
+        }
+
+        return ElfError::ElfSymbolNotFound;
+    }
 } // namespace Elf
\ No newline at end of file
@@ -0,0 +1,137 @@
+#include "elf/elf_definitions.h"
+
+#include "elf/elf_stream_loader.h"
+#include "elf_internal.h"
+
+namespace Elf
+{
+    ElfStreamLoader::ElfError ElfStreamLoader::readHeader()
+    {
+        this->isHeaderRead = false;
+        if (this->elfFileSize < sizeof(Elf64_ElfHeader))
+        {
+            return ElfError::ElfSizeExceeded;
+        }
+
+        if (!this->readCallback(this->readContext, 0, sizeof(Elf64_ElfHeader), &this->elfHeader))
+        {
+            return ElfError::ElfReadFailed;
+        }
+
+        const ElfError error = Internal::checkHeader(this->elfHeader);
+        this->isHeaderRead = error == ElfError::NoError;
+        return error;
+    }
+
+    ElfStreamLoader::ElfError ElfStreamLoader::readTable(
+        const uint64_t tableOffset,
+        const uint16_t entrySize,
+        const uint64_t expectedEntrySize,
+        const int numEntries,
+        void *dest)
+        const
+    {
+        if (!this->isHeaderRead)
+        {
+            return ElfError::ElfHeaderCorrupted;
+        }
+
+        // it shouldn't be different, but you never know...
+        if (entrySize != expectedEntrySize)
+        {
+            return ElfError::ElfGenericError;
+        }
+
+        // numEntries comes from a 16-bit field, so the multiplication can't overflow
+        const uint64_t tableSize = static_cast<uint64_t>(numEntries) * expectedEntrySize;
+        if (tableOffset > this->elfFileSize || tableSize > this->elfFileSize - tableOffset)
+        {
+            return ElfError::ElfSizeExceeded;
+        }
+
+        if (tableSize != 0 && !this->readCallback(this->readContext, tableOffset, tableSize, dest))
+        {
+            return ElfError::ElfReadFailed;
+        }
+
+        return ElfError::NoError;
+    }
+
+    ElfStreamLoader::ElfError ElfStreamLoader::readProgramHeaders(Elf64_ProgHeader *dest) const
+    {
+        return readTable(
+            this->elfHeader.ProgHeaderOffset,
+            this->elfHeader.ProgHeaderEntrySize,
+            sizeof(Elf64_ProgHeader),
+            getProgramHeaderCount(),
+            dest);
+    }
+
+    ElfStreamLoader::ElfError ElfStreamLoader::readSectionHeaders(Elf64_SectionHeader *dest) const
+    {
+        return readTable(
+            this->elfHeader.SectionHeaderOffset,
+            this->elfHeader.SectionHeaderEntrySize,
+            sizeof(Elf64_SectionHeader),
+            getSectionHeaderCount(),
+            dest);
+    }
+
+    ElfStreamLoader::ElfError ElfStreamLoader::loadExecutableProgram(
+        const Elf64_ProgHeader *progHeader,
+        const LoaderFunction loaderCallback)
+        const
+    {
+        if (progHeader->SegmentType != Elf_SegmentType::PT_LOAD)
+        {
+            return ElfError::ElfSectionNotLoadable;
+        }
+
+        void *dest = loaderCallback(
+            static_cast<int>(progHeader->SizeInMemory),
+            progHeader->VirtAddress,
+            progHeader->Flags);
+
+        if (dest == nullptr)
+        {
+            return ElfError::ElfGenericError;
+        }
+
+        return loadExecutableProgramAt(progHeader, dest);
+    }
+
+    ElfStreamLoader::ElfError ElfStreamLoader::loadExecutableProgramAt(
+        const Elf64_ProgHeader *progHeader,
+        void *dest,
+        const bool zeroRest)
+        const
+    {
+        if (progHeader->SegmentType != Elf_SegmentType::PT_LOAD)
+        {
+            return ElfError::ElfSectionNotLoadable;
+        }
+
+        // only the file part has to be inside the file, the rest (.bss) is zeroed
+        if (
+            progHeader->SizeInFile > progHeader->SizeInMemory || progHeader->Offset > this->elfFileSize || progHeader->SizeInFile > this->elfFileSize - progHeader->Offset)
+        {
+            return ElfError::ElfSizeExceeded;
+        }
+
+        if (
+            progHeader->SizeInFile != 0 && !this->readCallback(this->readContext, progHeader->Offset, progHeader->SizeInFile, dest))
+        {
+            return ElfError::ElfReadFailed;
+        }
+
+        // zero-out eventual mismatch between the size in file vs the size in memory
+        if (zeroRest && progHeader->SizeInMemory > progHeader->SizeInFile)
+        {
+            Internal::zeroRegion(
+                static_cast<char *>(dest) + progHeader->SizeInFile,
+                progHeader->SizeInMemory - progHeader->SizeInFile);
+        }
+
+        return ElfError::NoError;
+    }
+} // namespace Elf
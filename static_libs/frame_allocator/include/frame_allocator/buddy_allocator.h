@@ -0,0 +1,168 @@
+#ifndef FRAME_ALLOCATOR_BUDDY_ALLOCATOR_H
+#define FRAME_ALLOCATOR_BUDDY_ALLOCATOR_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace FrameAllocator {
+    constexpr std::size_t FRAME_SIZE = 4096;
+
+    /**
+     * The largest block is 2^MAX_ORDER frames: 1 GiB, the size of the largest huge page. Order 9 is a 2 MiB huge page.
+     */
+    constexpr int MAX_ORDER = 18;
+
+    /**
+     * The maximum number of CPUs with their own frame cache.
+     */
+    constexpr unsigned MAX_CPUS = 64;
+
+    /**
+     * The number of frames a per-CPU cache can hold, and how many of them move between the cache and the buddy lists
+     * at once.
+     */
+    constexpr unsigned FRAME_CACHE_CAPACITY = 64;
+    constexpr unsigned FRAME_CACHE_BATCH = 32;
+
+    /**
+     * A physical frame allocator based on the buddy system. Blocks of 2^order frames are always aligned to their own
+     * size, so an order 9 block can back a 2 MiB page and an order 18 one a 1 GiB page.
+     *
+     * The free blocks are kept in one doubly-linked list per order, and the links live inside the free frames
+     * themselves (accessed through directMapOffset), so the only metadata is one byte per frame. Single frames, by far
+     * the most common request, go through per-CPU caches first: those are only touched by their own CPU, so the fast
+     * path takes no lock and does no atomic operation. The buddy lists are protected by a spinlock.
+     */
+    class BuddyAllocator {
+    public:
+        /**
+         * Returns the index of the current CPU, below MAX_CPUS.
+         */
+        typedef unsigned (*CpuIndexFunction)();
+
+        //everything is zero until init, so a global instance lives in .bss and needs no constructor call at boot
+        constexpr BuddyAllocator() = default;
+
+        /**
+         * Returns the number of bytes of metadata needed to manage the given number of frames.
+         */
+        static std::size_t getMetadataSize(std::size_t frameCount);
+
+        /**
+         * Sets up the allocator for a physical range. Every frame starts as allocated: the usable ones have to be
+         * given with addFreeRange.
+         * @param metadata getMetadataSize(frameCount) bytes, which the allocator owns from now on.
+         * @param baseAddress The physical address of the first frame; it's aligned down to a 1 GiB boundary so the
+         * blocks are aligned in physical memory too (frameCount is adjusted to cover the same range).
+         * @param frameCount The number of frames from baseAddress.
+         * @param directMapOffset What has to be added to a physical address to access it (0 when identity-mapped).
+         * @return False if the metadata is too small for the adjusted range.
+         */
+        bool init(
+            std::uint8_t *metadata,
+            std::size_t metadataSize,
+            std::uint64_t baseAddress,
+            std::size_t frameCount,
+            std::uint64_t directMapOffset);
+
+        /**
+         * Gives a range of frames to the allocator. The frames outside the managed range and the frame at physical
+         * address 0 (0 is the failure value) are skipped.
+         * @param physAddress The first frame; must be 4 KiB-aligned.
+         */
+        void addFreeRange(std::uint64_t physAddress, std::size_t frameCount);
+
+        /**
+         * Allocates 2^order contiguous frames, aligned to their size.
+         * @return The physical address of the first frame, or 0 if there's no block large enough.
+         */
+        [[nodiscard]] std::uint64_t allocate(int order);
+
+        /**
+         * Frees a block given by allocate, merging it with its free buddies.
+         * @param order The same order given to allocate.
+         */
+        void free(std::uint64_t physAddress, int order);
+
+        /**
+         * Allocates a single frame through the cache of the current CPU. Must not be interrupted by another call on
+         * the same CPU (i.e. call it with preemption disabled, or interrupts for interrupt handlers).
+         * @return The physical address of the frame, or 0 if there's no free frame.
+         */
+        [[nodiscard]] std::uint64_t allocateFrame();
+
+        /**
+         * Frees a frame given by allocateFrame (or by allocate with order 0) through the cache of the current CPU.
+         * Same restrictions as allocateFrame.
+         */
+        void freeFrame(std::uint64_t physAddress);
+
+        /**
+         * Gives every frame held by the per-CPU caches back to the buddy lists. Only safe when no other CPU uses its
+         * cache at the same time.
+         */
+        void drainCaches();
+
+        /**
+         * Sets the function used by allocateFrame/freeFrame to find the current CPU. Until then, everything uses the
+         * cache of CPU 0.
+         */
+        void setCpuIndexFunction(CpuIndexFunction cpuIndexFunction);
+
+        /**
+         * Returns the number of free frames in the buddy lists (the ones in per-CPU caches aren't counted).
+         */
+        [[nodiscard]] std::size_t getFreeFrameCount() const;
+
+        /**
+         * Returns the number of free blocks of the given order.
+         */
+        [[nodiscard]] std::size_t getFreeBlockCount(int order) const;
+
+    private:
+        struct FreeBlock {
+            FreeBlock *next;
+            FreeBlock *prev;
+        };
+
+        //aligned to a cache line, so the caches of different CPUs never share one
+        struct alignas(64) FrameCache {
+            unsigned count = 0;
+            std::uint64_t frames[FRAME_CACHE_CAPACITY] = {};
+        };
+
+        /**
+         * One byte per frame: FREE_BLOCK_HEAD | order for the first frame of a free block, 0 for everything else.
+         */
+        std::uint8_t *frameStates = nullptr;
+        std::size_t frameCount = 0;
+        std::uint64_t baseAddress = 0;
+        std::uint64_t directMapOffset = 0;
+
+        FreeBlock *freeLists[MAX_ORDER + 1] = {};
+        std::size_t freeBlockCounts[MAX_ORDER + 1] = {};
+        std::size_t freeFrameCount = 0;
+
+        std::uint32_t lockWord = 0;
+        CpuIndexFunction cpuIndexFunction = nullptr;
+        FrameCache caches[MAX_CPUS] = {};
+
+        void lock();
+        void unlock();
+
+        [[nodiscard]] FreeBlock *getBlock(std::size_t frameIdx) const;
+        void pushBlock(std::size_t frameIdx, int order);
+        void removeBlock(std::size_t frameIdx, int order);
+
+        /**
+         * allocate and free without the lock.
+         * @return The index of the first frame, or SIZE_MAX.
+         */
+        std::size_t allocateLocked(int order);
+        void freeLocked(std::size_t frameIdx, int order);
+
+        FrameCache &getCurrentCache();
+    };
+} //namespace FrameAllocator
+
+#endif //FRAME_ALLOCATOR_BUDDY_ALLOCATOR_H
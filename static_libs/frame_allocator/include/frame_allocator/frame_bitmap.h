@@ -0,0 +1,94 @@
+#ifndef FRAME_ALLOCATOR_FRAME_BITMAP_H
+#define FRAME_ALLOCATOR_FRAME_BITMAP_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "memory_map.h"
+
+namespace FrameAllocator {
+    /**
+     * A single-frame allocator built on a two-level bitmap: one bit per frame (set when free), and a summary with one
+     * bit per 64-bit word of the first level (set when the word has any free frame). Finding a free frame is a tzcnt on
+     * a summary word and another one on the frame word, and the search starts from the lowest summary word that may
+     * have a free frame, so it's O(1) amortized. The whole thing costs 1 bit per 4 KiB: 16 MiB for 512 GiB of RAM.
+     *
+     * It's meant for early boot, before there's a direct map for the buddy allocator's free lists: it never touches
+     * the frames themselves. It's not thread-safe. The kernel doesn't need it, as the bootloader identity-maps all of
+     * memory before jumping to it, so it's in a library of its own (frame_bitmap_dep) that the kernel doesn't link.
+     */
+    class FrameBitmap {
+    public:
+        //everything is zero until init, so a global instance lives in .bss and needs no constructor call at boot
+        constexpr FrameBitmap() = default;
+
+        /**
+         * Returns the number of bytes of storage needed to track the given number of frames.
+         */
+        static std::size_t getStorageSize(std::size_t frameCount);
+
+        /**
+         * Sets up the bitmap for a physical range. Every frame starts as used: the free ones have to be given with
+         * markFree (or addUsableRegions).
+         * @param storage getStorageSize(frameCount) bytes, 8-byte aligned, which the bitmap owns from now on.
+         * @param baseAddress The physical address of the first frame.
+         * @return False if the storage is too small or misaligned.
+         */
+        bool init(void *storage, std::size_t storageSize, std::uint64_t baseAddress, std::size_t frameCount);
+
+        /**
+         * Marks a range of frames as free. The frames outside the tracked range and the frame at physical address 0
+         * (0 is the failure value) are skipped.
+         */
+        void markFree(std::uint64_t physAddress, std::size_t frameCount);
+
+        /**
+         * Marks a range of frames as used, e.g. the kernel image inside a reclaimed LoaderData region.
+         */
+        void markUsed(std::uint64_t physAddress, std::size_t frameCount);
+
+        /**
+         * Marks every Usable region as free.
+         */
+        void addUsableRegions(const MemoryRegion *regions, std::size_t count);
+
+        /**
+         * Allocates the lowest free frame.
+         * @return Its physical address, or 0 if there's no free frame.
+         */
+        [[nodiscard]] std::uint64_t allocate();
+
+        /**
+         * Frees a frame given by allocate.
+         */
+        void free(std::uint64_t physAddress);
+
+        [[nodiscard]] bool isFree(std::uint64_t physAddress) const;
+
+        [[nodiscard]] std::size_t getFreeFrameCount() const;
+
+    private:
+        std::uint64_t *frameWords = nullptr;
+        std::uint64_t *summaryWords = nullptr;
+        std::size_t frameWordCount = 0;
+        std::size_t summaryWordCount = 0;
+        std::size_t frameCount = 0;
+        std::uint64_t baseAddress = 0;
+        std::size_t freeFrameCount = 0;
+
+        /**
+         * No summary word below this one has a free frame.
+         */
+        std::size_t searchStart = 0;
+
+        /**
+         * Converts a physical range into a range of frame indices, clipped to the tracked frames.
+         * @return False if nothing is left.
+         */
+        bool clipRange(std::uint64_t physAddress, std::size_t frameCount, std::size_t *first, std::size_t *end) const;
+
+        void updateSummary(std::size_t wordIdx);
+    };
+} //namespace FrameAllocator
+
+#endif //FRAME_ALLOCATOR_FRAME_BITMAP_H
@@ -0,0 +1,161 @@
+#ifndef FRAME_ALLOCATOR_MEMORY_MAP_H
+#define FRAME_ALLOCATOR_MEMORY_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "buddy_allocator.h"
+
+namespace FrameAllocator {
+    /**
+     * The EFI_MEMORY_TYPE values the allocators care about.
+     */
+    namespace EfiMemoryType {
+        constexpr std::uint32_t LoaderCode = 1;
+        constexpr std::uint32_t LoaderData = 2;
+        constexpr std::uint32_t BootServicesCode = 3;
+        constexpr std::uint32_t BootServicesData = 4;
+        constexpr std::uint32_t ConventionalMemory = 7;
+        constexpr std::uint32_t AcpiReclaimMemory = 9;
+        constexpr std::uint32_t AcpiMemoryNvs = 10;
+    } //namespace EfiMemoryType
+
+    /**
+     * What a normalized region can be used for. The values are ordered from the least to the most restrictive: when
+     * two descriptors overlap, the more restrictive one wins.
+     */
+    enum class RegionKind : std::uint32_t {
+        /**
+         * Free RAM, including the boot services memory (the map is assumed to be taken after ExitBootServices).
+         */
+        Usable = 0,
+        /**
+         * Allocated by the bootloader: the kernel image, the boot parameters, the page tables... Becomes Usable when
+         * collected with reclaimLoaderData.
+         */
+        LoaderData = 1,
+        /**
+         * The ACPI tables; usable once they have been parsed.
+         */
+        AcpiReclaimable = 2,
+        AcpiNvs = 3,
+        Reserved = 4,
+    };
+
+    /**
+     * A run of frames with the same kind.
+     */
+    struct MemoryRegion {
+        std::uint64_t physStart;
+        std::uint64_t frameCount;
+        RegionKind kind;
+    };
+
+    constexpr RegionKind classifyMemoryType(const std::uint32_t type, const bool reclaimLoaderData) {
+        switch (type) {
+            case EfiMemoryType::BootServicesCode:
+            case EfiMemoryType::BootServicesData:
+            case EfiMemoryType::ConventionalMemory:
+                return RegionKind::Usable;
+            case EfiMemoryType::LoaderCode:
+            case EfiMemoryType::LoaderData:
+                return reclaimLoaderData ? RegionKind::Usable : RegionKind::LoaderData;
+            case EfiMemoryType::AcpiReclaimMemory:
+                return RegionKind::AcpiReclaimable;
+            case EfiMemoryType::AcpiMemoryNvs:
+                return RegionKind::AcpiNvs;
+            default:
+                return RegionKind::Reserved;
+        }
+    }
+
+    /**
+     * Tells if a region of the given EFI memory type can be used once the boot services have exited: boot services
+     * code, boot services data and conventional memory.
+     */
+    constexpr bool isUsableMemoryType(const std::uint32_t type) {
+        return classifyMemoryType(type, false) == RegionKind::Usable;
+    }
+
+    /**
+     * Sorts the regions by address and merges the adjacent ones of the same kind, in place. Overlapping regions (buggy
+     * firmwares do that) are clipped so the more restrictive kind keeps the overlap. Empty regions are dropped.
+     * @param capacity The size of the array. A region that contains a more restrictive one is split in two, which needs
+     * a spare entry; without one, the more restrictive region is extended to the end of the other one (losing some
+     * memory, but never handing out frames that aren't free).
+     * @return The number of regions left at the start of the array.
+     */
+    std::size_t normalizeRegions(MemoryRegion *regions, std::size_t count, std::size_t capacity);
+
+    /**
+     * Sets up an allocator from regions (as collectRegions gives them): the metadata is carved out of the first Usable
+     * region large enough to hold it, and every other Usable frame is given to the allocator.
+     * @param directMapOffset What has to be added to a physical address to access it (0 when identity-mapped).
+     * @return False if there's no usable memory, or no region large enough for the metadata.
+     */
+    bool seedFromRegions(
+        BuddyAllocator &allocator,
+        const MemoryRegion *regions,
+        std::size_t count,
+        std::uint64_t directMapOffset);
+
+    /**
+     * Turns a memory map (MemoryMap_t from the bootloader's boot_params.h, or anything with the same fields) into a
+     * sorted, coalesced list of regions. Must be called after ExitBootServices, since the boot services memory is
+     * reported as Usable.
+     * @param regions Receives the regions; needs one entry per map descriptor (see normalizeRegions for the spare ones).
+     * @param capacity The size of the regions array.
+     * @param reclaimLoaderData True to report the bootloader's memory (LoaderCode/LoaderData) as Usable too. Only when
+     * nothing in it is needed anymore, or when the ranges still in use are marked as used afterwards.
+     * @return The number of regions, or 0 if the map is empty or doesn't fit in the array.
+     */
+    template <class MemoryMap>
+    std::size_t collectRegions(
+        const MemoryMap &map,
+        MemoryRegion *regions,
+        const std::size_t capacity,
+        const bool reclaimLoaderData) {
+        if (map.entries == nullptr || map.entry_size == 0) {
+            return 0;
+        }
+
+        const std::size_t entryCount = map.mem_map_size / map.entry_size;
+        if (entryCount > capacity) {
+            return 0;
+        }
+
+        using Entry = std::remove_pointer_t<decltype(map.entries)>;
+        for (std::size_t i = 0; i < entryCount; i++) {
+            const auto *entry = reinterpret_cast<const Entry *>(
+                reinterpret_cast<const std::uint8_t *>(map.entries) + i * map.entry_size);
+            regions[i].physStart = entry->physical_start;
+            regions[i].frameCount = entry->page_count;
+            regions[i].kind = classifyMemoryType(entry->type, reclaimLoaderData);
+        }
+
+        return normalizeRegions(regions, entryCount, capacity);
+    }
+
+    /**
+     * Sets up an allocator from a memory map (MemoryMap_t from the bootloader's boot_params.h, or anything with the
+     * same fields): collectRegions, then seedFromRegions. The bootloader's memory isn't given to the allocator.
+     * @param regions Scratch space for collectRegions; only needed during the call.
+     * @param capacity The size of the regions array.
+     * @param directMapOffset What has to be added to a physical address to access it (0 when identity-mapped).
+     * @return False if the map doesn't fit in the array, there's no usable memory, or no region large enough for the
+     * metadata.
+     */
+    template <class MemoryMap>
+    bool seedFromMemoryMap(
+        BuddyAllocator &allocator,
+        const MemoryMap &map,
+        MemoryRegion *regions,
+        const std::size_t capacity,
+        const std::uint64_t directMapOffset) {
+        const std::size_t count = collectRegions(map, regions, capacity, false);
+        return count != 0 && seedFromRegions(allocator, regions, count, directMapOffset);
+    }
+} //namespace FrameAllocator
+
+#endif //FRAME_ALLOCATOR_MEMORY_MAP_H
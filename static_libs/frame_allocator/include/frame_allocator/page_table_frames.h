@@ -0,0 +1,32 @@
+#ifndef FRAME_ALLOCATOR_PAGE_TABLE_FRAMES_H
+#define FRAME_ALLOCATOR_PAGE_TABLE_FRAMES_H
+
+#include <cstddef>
+
+#include "buddy_allocator.h"
+
+/**
+ * Adapters between a BuddyAllocator and the callbacks of Paginator::PageTableRootController, which only take plain
+ * function pointers.
+ */
+namespace FrameAllocator {
+    /**
+     * Sets the allocator used by allocatePageTableFrame and releasePageTableFrame.
+     */
+    void setPageTableFrameSource(BuddyAllocator *allocator);
+
+    /**
+     * Allocates one frame for a page table through the per-CPU cache. Matches
+     * Paginator::PageTableRootController::PageFrameAllocator.
+     * @return The physical address of the frame, or 0 if there's no free frame (or no source was set).
+     */
+    std::size_t allocatePageTableFrame();
+
+    /**
+     * Gives back a page-table frame freed by unmapRange. Matches
+     * Paginator::PageTableRootController::PageFrameReleaser.
+     */
+    void releasePageTableFrame(std::size_t physAddress);
+} //namespace FrameAllocator
+
+#endif //FRAME_ALLOCATOR_PAGE_TABLE_FRAMES_H
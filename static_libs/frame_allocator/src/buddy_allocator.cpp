@@ -0,0 +1,277 @@
+#include "frame_allocator/buddy_allocator.h"
+
+namespace FrameAllocator {
+    constexpr std::uint8_t FREE_BLOCK_HEAD = 0x80;
+    constexpr std::size_t NO_FRAME = SIZE_MAX;
+    //the base is aligned to the largest block, so the blocks are aligned in physical memory as well
+    constexpr std::uint64_t BASE_ALIGNMENT = FRAME_SIZE << MAX_ORDER;
+
+    std::size_t BuddyAllocator::getMetadataSize(const std::size_t frameCount) {
+        return frameCount;
+    }
+
+    bool BuddyAllocator::init(
+        std::uint8_t *metadata,
+        const std::size_t metadataSize,
+        const std::uint64_t baseAddress,
+        const std::size_t frameCount,
+        const std::uint64_t directMapOffset) {
+        const std::uint64_t alignedBase = baseAddress & ~(BASE_ALIGNMENT - 1);
+        const std::size_t alignedFrameCount = frameCount + (baseAddress - alignedBase) / FRAME_SIZE;
+        if (metadataSize < getMetadataSize(alignedFrameCount)) {
+            return false;
+        }
+
+        __builtin_memset(metadata, 0, getMetadataSize(alignedFrameCount));
+        this->frameStates = metadata;
+        this->frameCount = alignedFrameCount;
+        this->baseAddress = alignedBase;
+        this->directMapOffset = directMapOffset;
+
+        for (int order = 0; order <= MAX_ORDER; order++) {
+            this->freeLists[order] = nullptr;
+            this->freeBlockCounts[order] = 0;
+        }
+        this->freeFrameCount = 0;
+
+        for (FrameCache &cache : this->caches) {
+            cache.count = 0;
+        }
+        return true;
+    }
+
+    void BuddyAllocator::addFreeRange(const std::uint64_t physAddress, std::size_t frameCount) {
+        if (physAddress + frameCount * FRAME_SIZE <= this->baseAddress) {
+            return;
+        }
+
+        std::size_t frameIdx = 0;
+        if (physAddress >= this->baseAddress) {
+            frameIdx = (physAddress - this->baseAddress) / FRAME_SIZE;
+        } else {
+            frameCount -= (this->baseAddress - physAddress) / FRAME_SIZE;
+        }
+
+        if (frameIdx >= this->frameCount) {
+            return;
+        }
+        if (frameCount > this->frameCount - frameIdx) {
+            frameCount = this->frameCount - frameIdx;
+        }
+
+        //physical address 0 is the failure value, so it's never handed out
+        if (this->baseAddress == 0 && frameIdx == 0 && frameCount != 0) {
+            frameIdx++;
+            frameCount--;
+        }
+
+        lock();
+        //split the range into the largest blocks that are aligned to their size
+        while (frameCount != 0) {
+            int order = frameIdx == 0 ? MAX_ORDER : __builtin_ctzll(frameIdx);
+            if (order > MAX_ORDER) {
+                order = MAX_ORDER;
+            }
+            while ((static_cast<std::size_t>(1) << order) > frameCount) {
+                order--;
+            }
+
+            freeLocked(frameIdx, order);
+            frameIdx += static_cast<std::size_t>(1) << order;
+            frameCount -= static_cast<std::size_t>(1) << order;
+        }
+        unlock();
+    }
+
+    std::uint64_t BuddyAllocator::allocate(const int order) {
+        if (order < 0 || order > MAX_ORDER) {
+            return 0;
+        }
+
+        lock();
+        const std::size_t frameIdx = allocateLocked(order);
+        unlock();
+
+        if (frameIdx == NO_FRAME) {
+            return 0;
+        }
+        return this->baseAddress + frameIdx * FRAME_SIZE;
+    }
+
+    void BuddyAllocator::free(const std::uint64_t physAddress, const int order) {
+        if (order < 0 || order > MAX_ORDER || physAddress < this->baseAddress) {
+            return;
+        }
+
+        const std::size_t frameIdx = (physAddress - this->baseAddress) / FRAME_SIZE;
+        if (frameIdx >= this->frameCount || (frameIdx & ((static_cast<std::size_t>(1) << order) - 1)) != 0) {
+            return;
+        }
+
+        lock();
+        //freeing the head of a free block twice would corrupt the lists, so it's ignored
+        if ((this->frameStates[frameIdx] & FREE_BLOCK_HEAD) == 0) {
+            freeLocked(frameIdx, order);
+        }
+        unlock();
+    }
+
+    std::uint64_t BuddyAllocator::allocateFrame() {
+        FrameCache &cache = getCurrentCache();
+        if (cache.count == 0) {
+            //refill half of the cache at once, so the lock is taken once every FRAME_CACHE_BATCH frames at most
+            lock();
+            while (cache.count < FRAME_CACHE_BATCH) {
+                const std::size_t frameIdx = allocateLocked(0);
+                if (frameIdx == NO_FRAME) {
+                    break;
+                }
+                cache.frames[cache.count++] = this->baseAddress + frameIdx * FRAME_SIZE;
+            }
+            unlock();
+
+            if (cache.count == 0) {
+                return 0;
+            }
+        }
+
+        return cache.frames[--cache.count];
+    }
+
+    void BuddyAllocator::freeFrame(const std::uint64_t physAddress) {
+        FrameCache &cache = getCurrentCache();
+        if (cache.count == FRAME_CACHE_CAPACITY) {
+            /* The oldest frames (at the bottom) go back to the buddy lists; the most recently freed ones, the likeliest
+             * to still be in the CPU caches, stay for the next allocations. */
+            lock();
+            for (unsigned i = 0; i < FRAME_CACHE_BATCH; i++) {
+                freeLocked((cache.frames[i] - this->baseAddress) / FRAME_SIZE, 0);
+            }
+            unlock();
+
+            for (unsigned i = FRAME_CACHE_BATCH; i < cache.count; i++) {
+                cache.frames[i - FRAME_CACHE_BATCH] = cache.frames[i];
+            }
+            cache.count -= FRAME_CACHE_BATCH;
+        }
+
+        cache.frames[cache.count++] = physAddress;
+    }
+
+    void BuddyAllocator::drainCaches() {
+        lock();
+        for (FrameCache &cache : this->caches) {
+            for (unsigned i = 0; i < cache.count; i++) {
+                freeLocked((cache.frames[i] - this->baseAddress) / FRAME_SIZE, 0);
+            }
+            cache.count = 0;
+        }
+        unlock();
+    }
+
+    void BuddyAllocator::setCpuIndexFunction(const CpuIndexFunction cpuIndexFunction) {
+        this->cpuIndexFunction = cpuIndexFunction;
+    }
+
+    std::size_t BuddyAllocator::getFreeFrameCount() const {
+        return this->freeFrameCount;
+    }
+
+    std::size_t BuddyAllocator::getFreeBlockCount(const int order) const {
+        if (order < 0 || order > MAX_ORDER) {
+            return 0;
+        }
+        return this->freeBlockCounts[order];
+    }
+
+    void BuddyAllocator::lock() {
+        while (__atomic_exchange_n(&this->lockWord, 1, __ATOMIC_ACQUIRE) != 0) {
+            //wait on a plain load, so the cache line isn't bounced between the waiting CPUs
+            while (__atomic_load_n(&this->lockWord, __ATOMIC_RELAXED) != 0) {
+#if __x86_64__
+                asm volatile("pause");
+#endif
+            }
+        }
+    }
+
+    void BuddyAllocator::unlock() {
+        __atomic_store_n(&this->lockWord, 0, __ATOMIC_RELEASE);
+    }
+
+    BuddyAllocator::FreeBlock *BuddyAllocator::getBlock(const std::size_t frameIdx) const {
+        return reinterpret_cast<FreeBlock *>(this->baseAddress + frameIdx * FRAME_SIZE + this->directMapOffset);
+    }
+
+    void BuddyAllocator::pushBlock(const std::size_t frameIdx, const int order) {
+        FreeBlock *block = getBlock(frameIdx);
+        block->prev = nullptr;
+        block->next = this->freeLists[order];
+        if (block->next != nullptr) {
+            block->next->prev = block;
+        }
+        this->freeLists[order] = block;
+
+        this->frameStates[frameIdx] = FREE_BLOCK_HEAD | order;
+        this->freeBlockCounts[order]++;
+        this->freeFrameCount += static_cast<std::size_t>(1) << order;
+    }
+
+    void BuddyAllocator::removeBlock(const std::size_t frameIdx, const int order) {
+        const FreeBlock *block = getBlock(frameIdx);
+        if (block->prev != nullptr) {
+            block->prev->next = block->next;
+        } else {
+            this->freeLists[order] = block->next;
+        }
+        if (block->next != nullptr) {
+            block->next->prev = block->prev;
+        }
+
+        this->frameStates[frameIdx] = 0;
+        this->freeBlockCounts[order]--;
+        this->freeFrameCount -= static_cast<std::size_t>(1) << order;
+    }
+
+    std::size_t BuddyAllocator::allocateLocked(const int order) {
+        int blockOrder = order;
+        while (blockOrder <= MAX_ORDER && this->freeLists[blockOrder] == nullptr) {
+            blockOrder++;
+        }
+        if (blockOrder > MAX_ORDER) {
+            return NO_FRAME;
+        }
+
+        const auto blockAddress = reinterpret_cast<std::uint64_t>(this->freeLists[blockOrder]);
+        const std::size_t frameIdx = (blockAddress - this->directMapOffset - this->baseAddress) / FRAME_SIZE;
+        removeBlock(frameIdx, blockOrder);
+
+        //the upper halves of the larger block go back to the lists, one per order
+        while (blockOrder > order) {
+            blockOrder--;
+            pushBlock(frameIdx + (static_cast<std::size_t>(1) << blockOrder), blockOrder);
+        }
+
+        return frameIdx;
+    }
+
+    void BuddyAllocator::freeLocked(std::size_t frameIdx, int order) {
+        while (order < MAX_ORDER) {
+            const std::size_t buddyIdx = frameIdx ^ (static_cast<std::size_t>(1) << order);
+            if (buddyIdx >= this->frameCount || this->frameStates[buddyIdx] != (FREE_BLOCK_HEAD | order)) {
+                break;
+            }
+
+            removeBlock(buddyIdx, order);
+            frameIdx &= ~(static_cast<std::size_t>(1) << order);
+            order++;
+        }
+
+        pushBlock(frameIdx, order);
+    }
+
+    BuddyAllocator::FrameCache &BuddyAllocator::getCurrentCache() {
+        const unsigned cpuIndex = this->cpuIndexFunction != nullptr ? this->cpuIndexFunction() : 0;
+        return this->caches[cpuIndex];
+    }
+} //namespace FrameAllocator
@@ -0,0 +1,165 @@
+#include "frame_allocator/frame_bitmap.h"
+
+namespace FrameAllocator {
+    constexpr std::size_t BITS_PER_WORD = 64;
+
+    static std::size_t divideRoundUp(const std::size_t value, const std::size_t divisor) {
+        return (value + divisor - 1) / divisor;
+    }
+
+    /**
+     * Returns a mask with the bits [first, end) of a word set; end can be 64.
+     */
+    static std::uint64_t getBitRange(const std::size_t first, const std::size_t end) {
+        const std::uint64_t upTo = end == BITS_PER_WORD ? ~0ULL : (1ULL << end) - 1;
+        return upTo & ~((1ULL << first) - 1);
+    }
+
+    std::size_t FrameBitmap::getStorageSize(const std::size_t frameCount) {
+        const std::size_t frameWords = divideRoundUp(frameCount, BITS_PER_WORD);
+        return (frameWords + divideRoundUp(frameWords, BITS_PER_WORD)) * sizeof(std::uint64_t);
+    }
+
+    bool FrameBitmap::init(
+        void *storage,
+        const std::size_t storageSize,
+        const std::uint64_t baseAddress,
+        const std::size_t frameCount) {
+        if (storageSize < getStorageSize(frameCount) ||
+            (reinterpret_cast<std::uintptr_t>(storage) & (sizeof(std::uint64_t) - 1)) != 0) {
+            return false;
+        }
+
+        __builtin_memset(storage, 0, getStorageSize(frameCount));
+        this->frameWordCount = divideRoundUp(frameCount, BITS_PER_WORD);
+        this->summaryWordCount = divideRoundUp(this->frameWordCount, BITS_PER_WORD);
+        this->frameWords = static_cast<std::uint64_t *>(storage);
+        this->summaryWords = this->frameWords + this->frameWordCount;
+        this->frameCount = frameCount;
+        this->baseAddress = baseAddress;
+        this->freeFrameCount = 0;
+        this->searchStart = this->summaryWordCount;
+        return true;
+    }
+
+    void FrameBitmap::markFree(std::uint64_t physAddress, std::size_t frameCount) {
+        //physical address 0 is the failure value, so it's never handed out
+        if (physAddress == 0 && frameCount != 0) {
+            physAddress += FRAME_SIZE;
+            frameCount--;
+        }
+
+        std::size_t first, end;
+        if (!clipRange(physAddress, frameCount, &first, &end)) {
+            return;
+        }
+
+        //whole words at once, so marking hundreds of GiB free stays cheap
+        for (std::size_t wordIdx = first / BITS_PER_WORD; wordIdx * BITS_PER_WORD < end; wordIdx++) {
+            const std::size_t wordStart = wordIdx * BITS_PER_WORD;
+            const std::size_t firstBit = first > wordStart ? first - wordStart : 0;
+            const std::size_t endBit = end - wordStart < BITS_PER_WORD ? end - wordStart : BITS_PER_WORD;
+            const std::uint64_t newBits = getBitRange(firstBit, endBit) & ~this->frameWords[wordIdx];
+
+            this->frameWords[wordIdx] |= newBits;
+            this->freeFrameCount += __builtin_popcountll(newBits);
+            updateSummary(wordIdx);
+        }
+
+        if (first / BITS_PER_WORD / BITS_PER_WORD < this->searchStart) {
+            this->searchStart = first / BITS_PER_WORD / BITS_PER_WORD;
+        }
+    }
+
+    void FrameBitmap::markUsed(const std::uint64_t physAddress, const std::size_t frameCount) {
+        std::size_t first, end;
+        if (!clipRange(physAddress, frameCount, &first, &end)) {
+            return;
+        }
+
+        for (std::size_t wordIdx = first / BITS_PER_WORD; wordIdx * BITS_PER_WORD < end; wordIdx++) {
+            const std::size_t wordStart = wordIdx * BITS_PER_WORD;
+            const std::size_t firstBit = first > wordStart ? first - wordStart : 0;
+            const std::size_t endBit = end - wordStart < BITS_PER_WORD ? end - wordStart : BITS_PER_WORD;
+            const std::uint64_t clearedBits = getBitRange(firstBit, endBit) & this->frameWords[wordIdx];
+
+            this->frameWords[wordIdx] &= ~clearedBits;
+            this->freeFrameCount -= __builtin_popcountll(clearedBits);
+            updateSummary(wordIdx);
+        }
+    }
+
+    void FrameBitmap::addUsableRegions(const MemoryRegion *regions, const std::size_t count) {
+        for (std::size_t i = 0; i < count; i++) {
+            if (regions[i].kind == RegionKind::Usable) {
+                markFree(regions[i].physStart, regions[i].frameCount);
+            }
+        }
+    }
+
+    std::uint64_t FrameBitmap::allocate() {
+        for (std::size_t summaryIdx = this->searchStart; summaryIdx < this->summaryWordCount; summaryIdx++) {
+            const std::uint64_t summary = this->summaryWords[summaryIdx];
+            if (summary == 0) {
+                continue;
+            }
+            //nothing below this word is free anymore, so the next search skips the words that were just scanned
+            this->searchStart = summaryIdx;
+
+            //__builtin_ctzll is a single tzcnt (encoded as "rep bsf", so it also runs on CPUs without BMI1)
+            const std::size_t wordIdx = summaryIdx * BITS_PER_WORD + __builtin_ctzll(summary);
+            const std::size_t bit = __builtin_ctzll(this->frameWords[wordIdx]);
+
+            this->frameWords[wordIdx] &= this->frameWords[wordIdx] - 1;
+            this->freeFrameCount--;
+            updateSummary(wordIdx);
+            return this->baseAddress + (wordIdx * BITS_PER_WORD + bit) * FRAME_SIZE;
+        }
+
+        this->searchStart = this->summaryWordCount;
+        return 0;
+    }
+
+    void FrameBitmap::free(const std::uint64_t physAddress) {
+        markFree(physAddress, 1);
+    }
+
+    bool FrameBitmap::isFree(const std::uint64_t physAddress) const {
+        std::size_t first, end;
+        if (!clipRange(physAddress, 1, &first, &end)) {
+            return false;
+        }
+        return (this->frameWords[first / BITS_PER_WORD] >> (first % BITS_PER_WORD) & 1) != 0;
+    }
+
+    std::size_t FrameBitmap::getFreeFrameCount() const {
+        return this->freeFrameCount;
+    }
+
+    bool FrameBitmap::clipRange(
+        const std::uint64_t physAddress,
+        const std::size_t frameCount,
+        std::size_t *first,
+        std::size_t *end) const {
+        const std::uint64_t rangeEnd = physAddress + frameCount * FRAME_SIZE;
+        if (frameCount == 0 || rangeEnd <= this->baseAddress) {
+            return false;
+        }
+
+        *first = physAddress > this->baseAddress ? (physAddress - this->baseAddress) / FRAME_SIZE : 0;
+        *end = (rangeEnd - this->baseAddress) / FRAME_SIZE;
+        if (*end > this->frameCount) {
+            *end = this->frameCount;
+        }
+        return *first < *end;
+    }
+
+    void FrameBitmap::updateSummary(const std::size_t wordIdx) {
+        const std::uint64_t bit = 1ULL << (wordIdx % BITS_PER_WORD);
+        if (this->frameWords[wordIdx] != 0) {
+            this->summaryWords[wordIdx / BITS_PER_WORD] |= bit;
+        } else {
+            this->summaryWords[wordIdx / BITS_PER_WORD] &= ~bit;
+        }
+    }
+} //namespace FrameAllocator
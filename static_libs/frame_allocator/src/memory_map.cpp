@@ -0,0 +1,181 @@
+#include "frame_allocator/memory_map.h"
+
+namespace FrameAllocator {
+    static std::uint64_t getRegionEnd(const MemoryRegion &region) {
+        return region.physStart + region.frameCount * FRAME_SIZE;
+    }
+
+    static void setRegionEnd(MemoryRegion &region, const std::uint64_t end) {
+        region.frameCount = (end - region.physStart) / FRAME_SIZE;
+    }
+
+    static void removeRegion(MemoryRegion *regions, std::size_t &count, const std::size_t idx) {
+        for (std::size_t i = idx + 1; i < count; i++) {
+            regions[i - 1] = regions[i];
+        }
+        count--;
+    }
+
+    static void swapRegions(MemoryRegion &left, MemoryRegion &right) {
+        const MemoryRegion region = left;
+        left = right;
+        right = region;
+    }
+
+    /**
+     * Moves a region whose start increased up the array, until it's sorted again.
+     */
+    static void sortForward(MemoryRegion *regions, const std::size_t count, std::size_t idx) {
+        for (; idx + 1 < count && regions[idx + 1].physStart < regions[idx].physStart; idx++) {
+            swapRegions(regions[idx], regions[idx + 1]);
+        }
+    }
+
+    /**
+     * Moves a region appended at idx down the array, until it's sorted again.
+     */
+    static void sortBackward(MemoryRegion *regions, std::size_t idx) {
+        for (; idx > 0 && regions[idx - 1].physStart > regions[idx].physStart; idx--) {
+            swapRegions(regions[idx - 1], regions[idx]);
+        }
+    }
+
+    std::size_t normalizeRegions(MemoryRegion *regions, std::size_t count, const std::size_t capacity) {
+        //insertion sort: there are a few hundred descriptors at most, and most firmwares already sort them
+        for (std::size_t i = 1; i < count; i++) {
+            sortBackward(regions, i);
+        }
+
+        for (std::size_t i = 0; i < count;) {
+            if (regions[i].frameCount == 0) {
+                removeRegion(regions, count, i);
+            } else {
+                i++;
+            }
+        }
+
+        /* The regions up to i never overlap, and the ones from i are sorted. Overlaps are rare (buggy firmwares), so
+         * they are resolved one pair at a time. */
+        for (std::size_t i = 0; i + 1 < count;) {
+            MemoryRegion &current = regions[i];
+            MemoryRegion &next = regions[i + 1];
+            const std::uint64_t currentEnd = getRegionEnd(current);
+            const std::uint64_t nextEnd = getRegionEnd(next);
+
+            if (next.physStart >= currentEnd) {
+                i++;
+            } else if (current.kind >= next.kind) {
+                //the current region keeps the overlap; what's left of the next one may have to move further down
+                if (nextEnd <= currentEnd) {
+                    removeRegion(regions, count, i + 1);
+                } else {
+                    next.physStart = currentEnd;
+                    setRegionEnd(next, nextEnd);
+                    sortForward(regions, count, i + 1);
+                }
+            } else {
+                /* The next region keeps the overlap, and whatever the current one had after it becomes a new region.
+                 * Without room for it, the next region grows over it instead: the less restrictive kind must not be
+                 * handed over to the later regions. */
+                if (currentEnd > nextEnd && count < capacity) {
+                    regions[count] = {nextEnd, (currentEnd - nextEnd) / FRAME_SIZE, current.kind};
+                    sortBackward(regions, count);
+                    count++;
+                } else if (currentEnd > nextEnd) {
+                    setRegionEnd(next, currentEnd);
+                }
+
+                setRegionEnd(current, next.physStart);
+                if (current.frameCount == 0) {
+                    removeRegion(regions, count, i);
+                }
+            }
+        }
+
+        //the merging can be done in place, since the output never gets ahead of the input
+        std::size_t outCount = 0;
+        for (std::size_t i = 0; i < count; i++) {
+            if (outCount != 0) {
+                MemoryRegion &last = regions[outCount - 1];
+                if (last.kind == regions[i].kind && getRegionEnd(last) == regions[i].physStart) {
+                    last.frameCount += regions[i].frameCount;
+                    continue;
+                }
+            }
+
+            regions[outCount++] = regions[i];
+        }
+
+        return outCount;
+    }
+
+    bool seedFromRegions(
+        BuddyAllocator &allocator,
+        const MemoryRegion *regions,
+        const std::size_t count,
+        const std::uint64_t directMapOffset) {
+        std::uint64_t lowestStart = UINT64_MAX;
+        std::uint64_t highestEnd = 0;
+        for (std::size_t i = 0; i < count; i++) {
+            const MemoryRegion &region = regions[i];
+            if (region.kind != RegionKind::Usable || region.frameCount == 0) {
+                continue;
+            }
+
+            if (region.physStart < lowestStart) {
+                lowestStart = region.physStart;
+            }
+            if (getRegionEnd(region) > highestEnd) {
+                highestEnd = getRegionEnd(region);
+            }
+        }
+        if (highestEnd == 0) {
+            return false;
+        }
+
+        //init aligns the base down, so the metadata has to cover the frames below lowestStart as well
+        const std::uint64_t alignedBase = lowestStart & ~((FRAME_SIZE << MAX_ORDER) - 1);
+        const std::size_t frameCount = (highestEnd - alignedBase) / FRAME_SIZE;
+        const std::size_t metadataSize = BuddyAllocator::getMetadataSize(frameCount);
+        const std::size_t metadataFrames = (metadataSize + FRAME_SIZE - 1) / FRAME_SIZE;
+
+        const MemoryRegion *metadataRegion = nullptr;
+        for (std::size_t i = 0; i < count; i++) {
+            //frame 0 is never handed out, so it can't be part of the metadata either
+            if (regions[i].kind == RegionKind::Usable && regions[i].physStart != 0
+                && regions[i].frameCount >= metadataFrames) {
+                metadataRegion = &regions[i];
+                break;
+            }
+        }
+        if (metadataRegion == nullptr) {
+            return false;
+        }
+
+        if (!allocator.init(
+            reinterpret_cast<std::uint8_t *>(metadataRegion->physStart + directMapOffset),
+            metadataFrames * FRAME_SIZE,
+            alignedBase,
+            frameCount,
+            directMapOffset)) {
+            return false;
+        }
+
+        for (std::size_t i = 0; i < count; i++) {
+            const MemoryRegion &region = regions[i];
+            if (region.kind != RegionKind::Usable) {
+                continue;
+            }
+
+            if (&region == metadataRegion) {
+                allocator.addFreeRange(
+                    region.physStart + metadataFrames * FRAME_SIZE,
+                    region.frameCount - metadataFrames);
+            } else {
+                allocator.addFreeRange(region.physStart, region.frameCount);
+            }
+        }
+
+        return true;
+    }
+} //namespace FrameAllocator
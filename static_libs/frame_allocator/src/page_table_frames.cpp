@@ -0,0 +1,22 @@
+#include "frame_allocator/page_table_frames.h"
+
+namespace FrameAllocator {
+    static BuddyAllocator *pageTableFrameSource = nullptr;
+
+    void setPageTableFrameSource(BuddyAllocator *allocator) {
+        pageTableFrameSource = allocator;
+    }
+
+    std::size_t allocatePageTableFrame() {
+        if (pageTableFrameSource == nullptr) {
+            return 0;
+        }
+        return pageTableFrameSource->allocateFrame();
+    }
+
+    void releasePageTableFrame(const std::size_t physAddress) {
+        if (pageTableFrameSource != nullptr) {
+            pageTableFrameSource->freeFrame(physAddress);
+        }
+    }
+} //namespace FrameAllocator
@@ -1,6 +1,7 @@
 #ifndef PAGINATOR_PAGE_TABLE_H
 #define PAGINATOR_PAGE_TABLE_H
 
+#include <cstddef>
 #include <cstdint>
 
 namespace Paginator {
@@ -29,18 +30,23 @@ namespace Paginator {
          * If set, the data in this page can be read.
          */
         ReadBit = 1 << 4,
+        /**
+         * If set, the translation is shared by all the address spaces, so it stays in the TLB across address space
+         * switches. Only for kernel mappings: a global user page would be visible to the next process.
+         */
+        Global = 1 << 5,
         /**
          * If set, this page is a "huge" page, generally 1 or 2 MiB, opposed to the usual 4 KiB.
          */
         IsHugePage = 1 << 15,
     };
 
-    inline PageFlags operator|(PageFlags a, PageFlags b)
+    constexpr PageFlags operator|(PageFlags a, PageFlags b)
     {
         return static_cast<PageFlags>(static_cast<int>(a) | static_cast<int>(b));
     }
 
-    inline PageFlags operator&(PageFlags a, PageFlags b)
+    constexpr PageFlags operator&(PageFlags a, PageFlags b)
     {
         return static_cast<PageFlags>(static_cast<int>(a) & static_cast<int>(b));
     }
@@ -56,15 +62,80 @@ namespace Paginator {
          * The allocator callback returned 0 as the physical address. 
          */
         AllocFailed = 3,
+        /**
+         * The addresses of a range are not 4 KiB-aligned, or the range is empty.
+         */
+        InvalidRange = 4,
         UnknownError = INT32_MAX,
     };
     
 
+    /**
+     * The range of virtual addresses taken by the recursive entry of the root table (the entry through which the
+     * tables themselves are reached once paging is on): nothing else can be mapped there.
+     */
+    constexpr std::size_t RECURSIVE_RANGE_START = 1ULL << 39;
+    constexpr std::size_t RECURSIVE_RANGE_END = 2ULL << 39;
+
+    /**
+     * Up to this many pages, unmapRange invalidates every cleared leaf with invlpg; above it, it flushes the whole TLB
+     * once instead.
+     */
+    constexpr std::size_t UNMAP_INVLPG_THRESHOLD = 32;
+
+    /**
+     * What unmapRange did. The TLB is only flushed on the current CPU, so this is also what another CPU running the
+     * same tables would need to drop.
+     */
+    struct UnmapResult {
+        /**
+         * The page tables given to the releaser.
+         */
+        std::size_t freedTables;
+        /**
+         * The cleared leaves, of any size.
+         */
+        std::size_t clearedLeaves;
+        /**
+         * True if the range is past UNMAP_INVLPG_THRESHOLD, so the TLB is flushed as a whole rather than page by page.
+         * Decided the same with pagingDisabledNow, where nothing is actually flushed.
+         */
+        bool isFullFlush;
+    };
+
+    /**
+     * The maximum number of CPUs with their own PCID bookkeeping.
+     */
+    constexpr unsigned MAX_CPUS = 64;
+
+    /**
+     * Returns the index of the current CPU, below MAX_CPUS.
+     */
+    typedef unsigned (*CpuIndexFunction)();
+
+    /**
+     * Sets the function used to find the current CPU, for the TLB bookkeeping of the PCIDs. Until then, everything is
+     * done as on CPU 0, which is only correct with a single CPU.
+     */
+    void setCpuIndexFunction(CpuIndexFunction cpuIndexFunction);
+
+    /**
+     * A cheap view of a paging structure: building one allocates nothing, so it can be made on the spot for every
+     * operation. What outlives it (the root table and its PCID) belongs to whoever owns the address space.
+     *
+     * PCIDs and SMP: a PCID is allocated once per address space (allocatePcid) and passed to every controller made for
+     * it, and released (releasePcid) once the address space is destroyed and active on no CPU. A released PCID is
+     * flushed from every CPU's TLB before that CPU runs it again, so it can be handed out again on any CPU.
+     */
     class PageTableRootController {
         PageTable_t *rootPageTableAddress;
 
     public:
         typedef std::size_t (*PageFrameAllocator)();
+        /**
+         * Gives back a physical frame obtained from the PageFrameAllocator (a page table that became empty).
+         */
+        typedef void (*PageFrameReleaser)(std::size_t physAddress);
         bool pagingDisabledNow;
 
         /**
@@ -74,11 +145,16 @@ namespace Paginator {
          * themselves.
          * @param pagingDisabledNow True only when the paging structure is not yet running (or at least it's not the one
          * ChihuahuaOS created). This should be false all the time, except in the bootloader.
+         * @param releaser Receives the page tables freed by unmapRange. If nullptr, empty tables are kept.
+         * @param pcid The PCID of the address space, from allocatePcid, or 0 (switching to it then flushes the TLB).
+         * It stays owned by the caller.
          */
         PageTableRootController(
             PageTable_t *rootPageTable,
             PageFrameAllocator allocator,
-            bool pagingDisabledNow = false);
+            bool pagingDisabledNow = false,
+            PageFrameReleaser releaser = nullptr,
+            std::uint16_t pcid = 0);
 
         /**
          * Maps a virtual address to the given physical address if possible.
@@ -96,12 +172,67 @@ namespace Paginator {
             PageFlags flags,
             bool forceWrite = true) const;
 
+        /**
+         * Maps a whole range of virtual addresses to the physical range of the same length starting at physAddress.
+         * The tables are walked once per run of consecutive entries instead of once per page, and 1 GiB/2 MiB huge
+         * pages are used wherever the alignment of both addresses and the remaining length allow it (and no smaller
+         * mapping is already in the way).
+         * @param virtAddress The first virtual address to map; must be 4 KiB-aligned.
+         * @param physAddress The first physical address; must be 4 KiB-aligned.
+         * @param length The length of the range in bytes, rounded up to a multiple of 4 KiB.
+         * @param flags The page flags for the whole range. PageFlags::IsHugePage is decided per entry, so it's
+         * ignored here.
+         * @param allocatedTables [OUT] The number of page tables that had to be allocated; may be nullptr.
+         * @param forceWrite If true, will write the new mappings even if other ones already exist. If false, the
+         * function stops at the first existing mapping, and the part of the range before it stays mapped.
+         * @return PageMapError::NoError if the whole range was mapped, otherwise the reason it wasn't.
+         */
+        [[nodiscard]] PageMapError mapRange(
+            std::size_t virtAddress,
+            std::size_t physAddress,
+            std::size_t length,
+            PageFlags flags,
+            std::size_t *allocatedTables = nullptr,
+            bool forceWrite = true) const;
+
+        /**
+         * A simple wrapper around mapRange that maps the virtual range to the same physical range.
+         * @param address The first identity-mapped address; must be 4 KiB-aligned.
+         * @param length The length of the range in bytes, rounded up to a multiple of 4 KiB.
+         * @param flags The page flags for the whole range.
+         * @param allocatedTables [OUT] The number of page tables that had to be allocated; may be nullptr.
+         * @param forceWrite If true, will write the new mappings even if other ones already exist.
+         * @return PageMapError::NoError if the whole range was mapped, otherwise the reason it wasn't.
+         */
+        [[nodiscard]] PageMapError identityMapRange(
+            std::size_t address,
+            std::size_t length,
+            PageFlags flags,
+            std::size_t *allocatedTables = nullptr,
+            bool forceWrite = true) const;
+
         /**
          * Unmaps the given virtual address from the page tables.
          * @param virtAddress The virtual address to unmap.
          */
         void unmapPage(std::size_t virtAddress) const;
 
+        /**
+         * Unmaps a whole range of virtual addresses. Huge pages only partly inside the range are split first, and the
+         * page tables left empty are given to the releaser (if there is one). Small ranges are invalidated page by page
+         * with invlpg; larger ones (see UNMAP_INVLPG_THRESHOLD) with a single CR3 reload at the end.
+         * @param virtAddress The first virtual address to unmap; must be 4 KiB-aligned.
+         * @param length The length of the range in bytes, rounded up to a multiple of 4 KiB.
+         * @param result [OUT] What was unmapped and released, also when the range is only partly unmapped; may be
+         * nullptr.
+         * @return PageMapError::NoError on success. PageMapError::AllocFailed if a huge page had to be split and no
+         * table could be allocated; the range is then only partly unmapped.
+         */
+        [[nodiscard]] PageMapError unmapRange(
+            std::size_t virtAddress,
+            std::size_t length,
+            UnmapResult *result = nullptr) const;
+
         /**
          * A simple wrapper around mapPage that maps the virtual address to the same physical address.
          * @param address The identity-mapped address.
@@ -120,14 +251,78 @@ namespace Paginator {
          */
         [[nodiscard]] std::size_t translateVirtToPhys(std::size_t virtAddress) const;
 
+        /**
+         * Returns the virtual address through which a page table is reached while paging is enabled, via the
+         * recursive entry of the root table. It's always a canonical address inside the recursive range.
+         * @param level The level of the table: 3 for the L3 table covering virtAddress, 1 for its L1 table.
+         * @param virtAddress Any address inside the range covered by the table.
+         */
+        [[nodiscard]] static std::size_t getRecursiveTableAddress(int level, std::size_t virtAddress);
+
+        /**
+         * Points the recursive entry of the root table to the root table itself. Has to be done once, when the tables
+         * are built (so only with pagingDisabledNow), before they're activated.
+         * @return False if paging is already on with these tables.
+         */
+        [[nodiscard]] bool installRecursiveEntry() const;
+
         /**
          * Activates (or applies) the given root page table, so all the paging rules set are immediately effective.
+         * If the address space has a PCID, the TLB entries it had the last time it was active are kept.
          * @return True if the operation succeeded, false otherwise.
          */
         [[nodiscard]] bool activateRootPageTable() const;
 
+        /**
+         * Enables PCIDs (process-context identifiers) on the current CPU if it supports them. Must be called on every
+         * CPU (or its CR4 copied from one that did) while CR3 holds PCID 0, before the first PCID is allocated.
+         * @return True if PCIDs are enabled.
+         */
+        static bool enablePcid();
+
+        /**
+         * Reserves a PCID for a new address space, to pass to its controllers.
+         * @return The PCID, or 0 if PCIDs are disabled or all of them are in use. 0 is always safe to use, it just
+         * means every switch to the address space flushes the TLB.
+         */
+        [[nodiscard]] static std::uint16_t allocatePcid();
+
+        /**
+         * Gives the PCID of a destroyed address space back, so another one can use it. The address space must not be
+         * active on any CPU anymore. Does nothing for 0.
+         */
+        static void releasePcid(std::uint16_t pcid);
+
+        /**
+         * Returns the PCID tagging the TLB entries of this address space, or 0 if it doesn't have one.
+         */
+        [[nodiscard]] std::uint16_t getPcid() const;
+
+        /**
+         * Enables global pages (CR4.PGE) on the current CPU if it supports them. Must be called on every CPU; without
+         * it, PageFlags::Global is ignored by the CPU.
+         * @return True if global pages are enabled.
+         */
+        static bool enableGlobalPages();
+
+        /**
+         * Turns the kernel-global mapping mode on or off. While it's on, every mapping made through this controller
+         * in the higher half (the kernel's) that isn't user-accessible gets PageFlags::Global, so the kernel's working
+         * set survives every CR3 switch. The kernel half has to be identical in all address spaces for this to be
+         * correct.
+         */
+        void setGlobalKernelMappings(bool isEnabled);
+
     private:
         PageFrameAllocator allocator;
+        PageFrameReleaser releaser;
+        std::uint16_t pcid;
+        bool globalKernelMappings;
+
+        /**
+         * Adds PageFlags::Global to the flags of a kernel mapping if the kernel-global mapping mode is on.
+         */
+        [[nodiscard]] PageFlags applyGlobalMode(std::size_t virtAddress, PageFlags flags) const;
     };
 
 } //namespace Paginator
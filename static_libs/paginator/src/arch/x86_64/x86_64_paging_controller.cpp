@@ -1,15 +1,28 @@
-#include <chihuahua_essentials/mem_essentials.h>
+#include <c_husky/cpu_features.h>
+#include <c_husky/mem_routines.h>
 #include <chihuahua_essentials/binary_utils.h>
 
 #include "x86_64_paging_controller.h"
+#include "x86_64_pcid.h"
 
 namespace Paginator::X86_64 {
     constexpr uint64_t INDEX_MASK = 0x1FF;
-    constexpr uint64_t PAGE_OFFSET_MASK = 0x3FF;
+    constexpr uint64_t PAGE_OFFSET_MASK = 0xFFF;
+    //bits 12-51 of an entry hold the physical address of the frame/next table
+    constexpr uint64_t ENTRY_ADDRESS_MASK = 0x000FFFFFFFFFF000ULL;
 
     constexpr uint64_t PAGE_TABLE_SIZE = 4096;
     constexpr uint64_t PAGE_SIZE = 4096;
-    constexpr uint64_t HUGE_PAGE_SIZE = 1024ULL * 1024ULL * 2ULL;
+    //the sizes of the leaves at each level: L1 (4 KiB), L2 (2 MiB huge page) and L3 (1 GiB huge page)
+    constexpr uint64_t L2_PAGE_SIZE = 1024ULL * 1024ULL * 2ULL;
+    constexpr uint64_t L3_PAGE_SIZE = 1024ULL * 1024ULL * 1024ULL;
+    constexpr uint64_t ENTRIES_PER_TABLE = 512;
+
+    /* UNMAP_INVLPG_THRESHOLD: each invlpg costs hundreds of cycles, while the refill after a full flush is spread over
+     * the next accesses, so the break-even point is in the low tens of pages. */
+
+    constexpr uint64_t CR4_PGE = 1ULL << 7;
+    constexpr uint64_t INVPCID_ALL_CONTEXTS_AND_GLOBAL = 2;
 
     constexpr uint64_t SIGN_EXTENSION = 0xFFFFULL << 48ULL;
     constexpr uint64_t RECURSIVE_INDEX = 0x01;
@@ -19,24 +32,118 @@ namespace Paginator::X86_64 {
     constexpr uint64_t P2_SHIFT = 21;
     constexpr uint64_t P1_SHIFT = 12;
 
+    static_assert(RECURSIVE_RANGE_START == RECURSIVE_INDEX << P4_SHIFT);
+    static_assert(RECURSIVE_RANGE_END == (RECURSIVE_INDEX + 1) << P4_SHIFT);
+
+    /**
+     * The flags of the entries pointing to the next-level tables. They are the most permissive ones (minus user
+     * access, added only on the way to user mappings): the effective permissions are the intersection of all the
+     * levels, so they're decided by the last one.
+     */
+    constexpr PageFlags INTERMEDIATE_TABLE_FLAGS = PageFlags::Present | PageFlags::WriteBit | PageFlags::ExecuteBit;
+
     uint64_t constructTableEntry(uint64_t physicalAddress, PageFlags flags);
 
+    /**
+     * Turns an address built from table indices into a canonical one: bits 48-63 are copies of bit 47.
+     */
+    uint64_t toCanonical(uint64_t address);
+
+    /**
+     * Returns the table the given entry of parentTable points to, allocating (and zeroing) it if the entry is empty.
+     * If the entry is a huge page, it's split into 512 pages of the next level with the same flags, so the rest of its
+     * range stays mapped.
+     * @param level The level of the returned table (see getRecursiveTableAddress).
+     * @param virtAddress Any address inside the range covered by the entry.
+     * @param isUserAccessible If true, the entry gets user access (even if it existed already), so user mappings
+     * below it work.
+     * @param allocatedTables [OUT] Incremented for every table that was allocated; may be nullptr.
+     * @param childTable [OUT] The table.
+     */
+    PageMapError getOrCreateTable(
+        PageTable_t *parentTable,
+        PageTableRootController::PageFrameAllocator allocator,
+        int level,
+        uint64_t virtAddress,
+        bool pagingDisabledNow,
+        bool isUserAccessible,
+        std::size_t *allocatedTables,
+        PageTable_t **childTable);
+
+    /**
+     * Checks that the address is canonical: bits 47-63 need to be all 0 or all 1.
+     */
+    bool isCanonical(uint64_t virtAddress);
+
+    /**
+     * Returns true if the entry maps a 2 MiB/1 GiB page instead of pointing to a table. Only meaningful on L2 and L3.
+     */
+    bool isHugeEntry(uint64_t entry);
+
     /**
      * Calls "invlpg" on the given virtual address to remove any TLB caches associated with the given address.
      * @param virtAddress The virtual address you want to remove from the TLB cache
+     * @param pagingDisabledNow If true, the tables aren't in use, so there's nothing to invalidate.
+     */
+    void invalidatePage(uint64_t virtAddress, bool pagingDisabledNow);
+
+    /**
+     * Flushes the TLB entries of the current address space by reloading CR3.
+     * @param pagingDisabledNow If true, the tables aren't in use, so there's nothing to flush.
+     * @param includeGlobal If true, the global entries (which survive CR3 reloads) are flushed as well.
+     */
+    void flushTlb(bool pagingDisabledNow, bool includeGlobal);
+
+    /**
+     * Computes the number of pages of a range and checks that the whole range is canonical.
+     * @param pageCount [OUT] The length in pages, rounded up.
+     * @return True if the range is valid.
      */
-    void invalidatePage(uint64_t virtAddress);
+    bool checkVirtualRange(uint64_t virtAddress, uint64_t length, uint64_t *pageCount);
+
+    /**
+     * What unmapInTable needs at every level.
+     */
+    struct UnmapState {
+        PageTableRootController::PageFrameAllocator allocator;
+        PageTableRootController::PageFrameReleaser releaser;
+        bool pagingDisabledNow;
+        /**
+         * If true, every cleared leaf is invalidated with invlpg, otherwise the caller flushes the whole TLB.
+         */
+        bool invalidateEachPage;
+        std::size_t clearedLeaves;
+        std::size_t freedTables;
+        /**
+         * True if one of the cleared leaves was global, so a CR3 reload isn't enough to flush it.
+         */
+        bool clearedGlobal;
+    };
+
+    /**
+     * Clears the entries of a table in the given range (lastAddress is the last byte, inclusive), recursing into the tables below, and releases the
+     * tables that become empty.
+     * @param level The level of the table: 4 for the root, 1 for the tables with the 4 KiB leaves.
+     * @param isEmpty [OUT] True if the table has no entries left.
+     */
+    PageMapError unmapInTable(
+        PageTable_t *table,
+        int level,
+        uint64_t firstAddress,
+        uint64_t lastAddress,
+        UnmapState &state,
+        bool *isEmpty);
 
     /**
      * Gets only the physical address of a page entry (uint64_t).
      * @param entry The instance of a page entry (uint64_t).
      */
-#define GET_ADDR_FROM_ENTRY(entry) (((entry) >> 12ULL) & 40ULL)
+#define GET_ADDR_FROM_ENTRY(entry) ((entry) & ENTRY_ADDRESS_MASK)
 
     /**
-     * The actual physical address.
+     * Sets the physical address of a page entry. The address must be 4 KiB-aligned.
      */
-#define SET_PHYSICAL_ADDRESS(entry, val) (entry |= ((val) << 12ULL))
+#define SET_PHYSICAL_ADDRESS(entry, val) ((entry) |= ((val) & ENTRY_ADDRESS_MASK))
 
 
 #pragma region Public implementation
@@ -49,18 +156,10 @@ namespace Paginator::X86_64 {
         const PageFlags flags,
         const bool forceWrite,
         const bool pagingDisabledNow) {
-        const uint64_t l4Idx = (virtAddress >> P4_SHIFT) & INDEX_MASK;
-        const uint64_t l3Idx = (virtAddress >> P3_SHIFT) & INDEX_MASK;
-        const uint64_t l2Idx = (virtAddress >> P2_SHIFT) & INDEX_MASK;
         const uint64_t l1Idx = (virtAddress >> P1_SHIFT) & INDEX_MASK;
+        const bool isUser = (flags & PageFlags::UserModeAccessible) == PageFlags::UserModeAccessible;
 
-        if (l4Idx > INDEX_MASK || l3Idx > INDEX_MASK || l2Idx > INDEX_MASK || l1Idx > INDEX_MASK) {
-            return PageMapError::InvalidVirtAddress;
-        }
-
-        //the address must be canonical: all upper bits need to be all 0 or all 1
-        const uint64_t signExtension = virtAddress >> 48;
-        if (signExtension != 0 && signExtension != 0xFFFF) {
+        if (!isCanonical(virtAddress)) {
             return PageMapError::InvalidVirtAddress;
         }
 
@@ -69,172 +168,234 @@ namespace Paginator::X86_64 {
             return PageMapError::EntryExists;
         }
 
+        PageTable_t *l3Table;
+        PageMapError error = getOrCreateTable(
+            rootPageTable, allocator, 3, virtAddress, pagingDisabledNow, isUser, nullptr, &l3Table);
+        if (error != PageMapError::NoError) {
+            return error;
+        }
 
-        uint64_t entryForL3 = rootPageTable->entries[l4Idx];
-        if (entryForL3 == 0) {
-            const uint64_t physAddr = allocator();
-            if (physAddr == 0) {
-                return PageMapError::AllocFailed;
-            }
+        PageTable_t *l2Table;
+        error = getOrCreateTable(l3Table, allocator, 2, virtAddress, pagingDisabledNow, isUser, nullptr, &l2Table);
+        if (error != PageMapError::NoError) {
+            return error;
+        }
 
-            if (pagingDisabledNow) {
-                memset(reinterpret_cast<void *>(physAddr), 0, PAGE_TABLE_SIZE);
-            } else {
-                //TODO
-            }
+        //the actual L1 entry
+        PageTable_t *l1Table;
+        error = getOrCreateTable(l2Table, allocator, 1, virtAddress, pagingDisabledNow, isUser, nullptr, &l1Table);
+        if (error != PageMapError::NoError) {
+            return error;
+        }
+
+        const bool wasMapped = l1Table->entries[l1Idx] != 0;
+        if (wasMapped && !forceWrite) {
+            return PageMapError::EntryExists;
+        }
 
-            rootPageTable->entries[l4Idx] =
-                    entryForL3 =
-                    constructTableEntry(physAddr, PageFlags::Present | PageFlags::WriteBit);
+        l1Table->entries[l1Idx] = constructTableEntry(physAddress, flags);
 
-            //recursive mapping
-            PageTable_t *l3Table;
-            if (pagingDisabledNow) {
-                l3Table = reinterpret_cast<PageTable_t *>(GET_ADDR_FROM_ENTRY(entryForL3));
-            } else {
-                const uint64_t recursiveAddress =
-                        SIGN_EXTENSION
-                        | RECURSIVE_INDEX << P4_SHIFT
-                        | RECURSIVE_INDEX << P3_SHIFT
-                        | RECURSIVE_INDEX << P2_SHIFT
-                        | l4Idx << P1_SHIFT;
-                l3Table = reinterpret_cast<PageTable_t *>(recursiveAddress);
-            }
+        //the old translation might still be cached, and it has to go only after the entry was replaced
+        if (wasMapped) {
+            invalidatePage(virtAddress, pagingDisabledNow);
+        }
 
-            l3Table->entries[RECURSIVE_INDEX] = entryForL3;
+        return PageMapError::NoError;
+    }
+
+    PageMapError mapRange(
+        PageTable_t *rootPageTable,
+        const PageTableRootController::PageFrameAllocator allocator,
+        std::size_t virtAddress,
+        std::size_t physAddress,
+        const std::size_t length,
+        const PageFlags flags,
+        const bool forceWrite,
+        const bool pagingDisabledNow,
+        std::size_t *allocatedTables) {
+        if (allocatedTables != nullptr) {
+            *allocatedTables = 0;
         }
 
+        if ((virtAddress & PAGE_OFFSET_MASK) != 0 || (physAddress & PAGE_OFFSET_MASK) != 0 || length == 0) {
+            return PageMapError::InvalidRange;
+        }
 
-        PageTable_t *l3Table;
-        if (pagingDisabledNow) {
-            l3Table = reinterpret_cast<PageTable_t *>(GET_ADDR_FROM_ENTRY(entryForL3));
-        } else {
-            const uint64_t recursiveAddress =
-                    SIGN_EXTENSION
-                    | RECURSIVE_INDEX << P4_SHIFT
-                    | RECURSIVE_INDEX << P3_SHIFT
-                    | RECURSIVE_INDEX << P2_SHIFT
-                    | l4Idx << P1_SHIFT;
-            l3Table = reinterpret_cast<PageTable_t *>(recursiveAddress);
+        uint64_t pageCount;
+        if (!checkVirtualRange(virtAddress, length, &pageCount)) {
+            return PageMapError::InvalidVirtAddress;
         }
 
-        uint64_t entryForL2 = l3Table->entries[l3Idx];
-        if (entryForL2 == 0) {
-            const uint64_t physAddr = allocator();
-            if (physAddr == 0) {
-                return PageMapError::AllocFailed;
+        //leaves on L1 must not have the huge page bit, as there it means PAT
+        const PageFlags leafFlags = static_cast<PageFlags>(
+            static_cast<int>(flags) & ~static_cast<int>(PageFlags::IsHugePage));
+        const PageFlags hugeLeafFlags = leafFlags | PageFlags::IsHugePage;
+        const bool isUser = (flags & PageFlags::UserModeAccessible) == PageFlags::UserModeAccessible;
+
+        /* Every iteration walks the tables once, then fills as many consecutive entries of the last table as possible
+         * (up to the end of the table or of the range), so a range costs one walk per 512 leaves instead of one per
+         * page. A leaf is as large as the alignment of both addresses and the remaining length allow. */
+        uint64_t remaining = pageCount * PAGE_SIZE;
+        while (remaining != 0) {
+            PageTable_t *l3Table;
+            PageMapError error = getOrCreateTable(
+                rootPageTable, allocator, 3, virtAddress, pagingDisabledNow, isUser, allocatedTables, &l3Table);
+            if (error != PageMapError::NoError) {
+                return error;
             }
 
-            if (pagingDisabledNow) {
-                memset(reinterpret_cast<void *>(physAddr), 0, PAGE_TABLE_SIZE);
-            } else {
-                //TODO
+            uint64_t l3Idx = (virtAddress >> P3_SHIFT) & INDEX_MASK;
+            const uint64_t l3Entry = l3Table->entries[l3Idx];
+            const bool isL3Replaceable = l3Entry == 0 || isHugeEntry(l3Entry);
+            if (
+                isL3Replaceable
+                && remaining >= L3_PAGE_SIZE
+                && ((virtAddress | physAddress) & (L3_PAGE_SIZE - 1)) == 0
+            ) {
+                //1 GiB leaves, directly in the L3 table
+                for (; l3Idx < ENTRIES_PER_TABLE && remaining >= L3_PAGE_SIZE; l3Idx++) {
+                    const uint64_t oldEntry = l3Table->entries[l3Idx];
+                    if (oldEntry != 0 && !isHugeEntry(oldEntry)) {
+                        break;
+                    }
+                    if (oldEntry != 0 && !forceWrite) {
+                        return PageMapError::EntryExists;
+                    }
+
+                    l3Table->entries[l3Idx] = constructTableEntry(physAddress, hugeLeafFlags);
+                    if (oldEntry != 0) {
+                        invalidatePage(virtAddress, pagingDisabledNow);
+                    }
+
+                    virtAddress += L3_PAGE_SIZE;
+                    physAddress += L3_PAGE_SIZE;
+                    remaining -= L3_PAGE_SIZE;
+                }
+                continue;
             }
 
-            rootPageTable->entries[l3Idx] =
-                    entryForL2 =
-                    constructTableEntry(physAddr, PageFlags::Present | PageFlags::WriteBit);
-
             PageTable_t *l2Table;
-            if (pagingDisabledNow) {
-                l2Table = reinterpret_cast<PageTable_t *>(GET_ADDR_FROM_ENTRY(entryForL2));
-            } else {
-                const uint64_t recursiveAddress =
-                        SIGN_EXTENSION
-                        | RECURSIVE_INDEX << P4_SHIFT
-                        | RECURSIVE_INDEX << P3_SHIFT
-                        | l4Idx << P2_SHIFT
-                        | l3Idx << P1_SHIFT;
-                l2Table = reinterpret_cast<PageTable_t *>(recursiveAddress);
+            error = getOrCreateTable(
+                l3Table, allocator, 2, virtAddress, pagingDisabledNow, isUser, allocatedTables, &l2Table);
+            if (error != PageMapError::NoError) {
+                return error;
             }
 
-            l2Table->entries[RECURSIVE_INDEX] = entryForL2;
-        }
-
-
-        PageTable_t *l2Table;
-        if (pagingDisabledNow) {
-            l2Table = reinterpret_cast<PageTable_t *>(GET_ADDR_FROM_ENTRY(entryForL2));
-        } else {
-            const uint64_t recursiveAddress =
-                    SIGN_EXTENSION
-                    | RECURSIVE_INDEX << P4_SHIFT
-                    | RECURSIVE_INDEX << P3_SHIFT
-                    | l4Idx << P2_SHIFT
-                    | l3Idx << P1_SHIFT;
-            l2Table = reinterpret_cast<PageTable_t *>(recursiveAddress);
-        }
-
-        uint64_t entryForL1 = l2Table->entries[l2Idx];
-        if (entryForL1 == 0) {
-            const uint64_t physAddr = allocator();
-            if (physAddr == 0) {
-                return PageMapError::AllocFailed;
+            uint64_t l2Idx = (virtAddress >> P2_SHIFT) & INDEX_MASK;
+            const uint64_t l2Entry = l2Table->entries[l2Idx];
+            const bool isL2Replaceable = l2Entry == 0 || isHugeEntry(l2Entry);
+            if (
+                isL2Replaceable
+                && remaining >= L2_PAGE_SIZE
+                && ((virtAddress | physAddress) & (L2_PAGE_SIZE - 1)) == 0
+            ) {
+                //2 MiB leaves, until the next 1 GiB boundary at most (where a 1 GiB leaf might fit again)
+                for (; l2Idx < ENTRIES_PER_TABLE && remaining >= L2_PAGE_SIZE; l2Idx++) {
+                    const uint64_t oldEntry = l2Table->entries[l2Idx];
+                    if (oldEntry != 0 && !isHugeEntry(oldEntry)) {
+                        break;
+                    }
+                    if (oldEntry != 0 && !forceWrite) {
+                        return PageMapError::EntryExists;
+                    }
+
+                    l2Table->entries[l2Idx] = constructTableEntry(physAddress, hugeLeafFlags);
+                    if (oldEntry != 0) {
+                        invalidatePage(virtAddress, pagingDisabledNow);
+                    }
+
+                    virtAddress += L2_PAGE_SIZE;
+                    physAddress += L2_PAGE_SIZE;
+                    remaining -= L2_PAGE_SIZE;
+                }
+                continue;
             }
 
-            if (pagingDisabledNow) {
-                memset(reinterpret_cast<void *>(physAddr), 0, PAGE_TABLE_SIZE);
-            } else {
-                //TODO
+            PageTable_t *l1Table;
+            error = getOrCreateTable(
+                l2Table, allocator, 1, virtAddress, pagingDisabledNow, isUser, allocatedTables, &l1Table);
+            if (error != PageMapError::NoError) {
+                return error;
             }
 
-            rootPageTable->entries[l2Idx] =
-                    entryForL1 =
-                    constructTableEntry(physAddr, PageFlags::Present | PageFlags::WriteBit);
-
-            PageTable_t *l1Table;
-            if (pagingDisabledNow) {
-                l1Table = reinterpret_cast<PageTable_t *>(GET_ADDR_FROM_ENTRY(entryForL1));
-            } else {
-                const uint64_t recursiveAddress =
-                        SIGN_EXTENSION
-                        | RECURSIVE_INDEX << P4_SHIFT
-                        | l4Idx << P3_SHIFT
-                        | l3Idx << P2_SHIFT
-                        | l2Idx << P1_SHIFT;
-                l1Table = reinterpret_cast<PageTable_t *>(recursiveAddress);
+            //4 KiB leaves, until the next 2 MiB boundary at most
+            for (uint64_t l1Idx = (virtAddress >> P1_SHIFT) & INDEX_MASK;
+                 l1Idx < ENTRIES_PER_TABLE && remaining != 0;
+                 l1Idx++) {
+                const bool wasMapped = l1Table->entries[l1Idx] != 0;
+                if (wasMapped && !forceWrite) {
+                    return PageMapError::EntryExists;
+                }
+
+                l1Table->entries[l1Idx] = constructTableEntry(physAddress, leafFlags);
+                if (wasMapped) {
+                    invalidatePage(virtAddress, pagingDisabledNow);
+                }
+
+                virtAddress += PAGE_SIZE;
+                physAddress += PAGE_SIZE;
+                remaining -= PAGE_SIZE;
             }
+        }
 
-            l1Table->entries[RECURSIVE_INDEX] = entryForL1;
+        return PageMapError::NoError;
+    }
+
+    PageMapError unmapRange(
+        PageTable_t *rootPageTable,
+        const PageTableRootController::PageFrameAllocator allocator,
+        const PageTableRootController::PageFrameReleaser releaser,
+        const std::size_t virtAddress,
+        const std::size_t length,
+        const bool pagingDisabledNow,
+        UnmapResult *result) {
+        if (result != nullptr) {
+            *result = {0, 0, false};
         }
 
+        if ((virtAddress & PAGE_OFFSET_MASK) != 0 || length == 0) {
+            return PageMapError::InvalidRange;
+        }
 
-        //the actual L1 entry
-        PageTable_t *l1Table;
-        if (pagingDisabledNow) {
-            l1Table = reinterpret_cast<PageTable_t *>(GET_ADDR_FROM_ENTRY(entryForL1));
-        } else {
-            const uint64_t recursiveAddress =
-                    SIGN_EXTENSION
-                    | RECURSIVE_INDEX << P4_SHIFT
-                    | l4Idx << P3_SHIFT
-                    | l3Idx << P2_SHIFT
-                    | l2Idx << P1_SHIFT;
-            l1Table = reinterpret_cast<PageTable_t *>(recursiveAddress);
+        uint64_t pageCount;
+        if (!checkVirtualRange(virtAddress, length, &pageCount)) {
+            return PageMapError::InvalidVirtAddress;
         }
 
-        const uint64_t existingPhysAddress = l1Table->entries[l1Idx];
-        if (existingPhysAddress != 0) {
-            if (forceWrite) {
-                invalidatePage(virtAddress);          
-            }
-            else {
-                return PageMapError::EntryExists;
-            }
+        UnmapState state = {
+            allocator,
+            releaser,
+            pagingDisabledNow,
+            pageCount <= UNMAP_INVLPG_THRESHOLD,
+            0,
+            0,
+            false,
+        };
+
+        bool isRootEmpty;
+        const PageMapError error = unmapInTable(
+            rootPageTable,
+            4,
+            virtAddress,
+            virtAddress + pageCount * PAGE_SIZE - 1,
+            state,
+            &isRootEmpty);
+
+        //past the threshold, a single full flush is cheaper than one invlpg per page
+        if (!state.invalidateEachPage && (state.clearedLeaves != 0 || state.freedTables != 0)) {
+            flushTlb(pagingDisabledNow, state.clearedGlobal);
         }
-        
-        l1Table->entries[l1Idx] = constructTableEntry(physAddress, flags);
-        return PageMapError::NoError;
-    }
 
-    void unmapPage(PageTable_t *rootPageTable, const std::size_t virtAddress, const bool pagingDisabledNow) {
-        //TODO
+        if (result != nullptr) {
+            *result = {state.freedTables, state.clearedLeaves, !state.invalidateEachPage};
+        }
+        return error;
     }
 
     uint64_t translateVirtToPhys(
         const PageTable_t *rootPageTable,
         const std::size_t virtAddress,
-        bool) {
+        const bool pagingDisabledNow) {
         const uint64_t l4Idx = (virtAddress >> P4_SHIFT) & INDEX_MASK;
         const uint64_t l3Idx = (virtAddress >> P3_SHIFT) & INDEX_MASK;
         const uint64_t l2Idx = (virtAddress >> P2_SHIFT) & INDEX_MASK;
@@ -244,49 +405,338 @@ namespace Paginator::X86_64 {
             return 0;
         }
 
+        //with paging enabled, the tables below the root are only reachable through the recursive entry
         const uint64_t l3PhysAddr = GET_ADDR_FROM_ENTRY(rootPageTable->entries[l4Idx]);
         if (l3PhysAddr == 0) {
             return 0;
         }
 
-        const uint64_t l2PhysAddr = GET_ADDR_FROM_ENTRY(reinterpret_cast<PageTable_t *>(l3PhysAddr)->entries[l3Idx]);
+        const auto *l3Table = reinterpret_cast<const PageTable_t *>(
+            pagingDisabledNow ? l3PhysAddr : getRecursiveTableAddress(3, l4Idx, l3Idx, l2Idx));
+        const uint64_t l3Entry = l3Table->entries[l3Idx];
+        if (isHugeEntry(l3Entry)) {
+            return (l3Entry & ENTRY_ADDRESS_MASK & ~(L3_PAGE_SIZE - 1)) | (virtAddress & (L3_PAGE_SIZE - 1));
+        }
+
+        const uint64_t l2PhysAddr = GET_ADDR_FROM_ENTRY(l3Entry);
         if (l2PhysAddr == 0) {
             return 0;
         }
 
-        const uint64_t l1PhysAddr = GET_ADDR_FROM_ENTRY(reinterpret_cast<PageTable_t *>(l2PhysAddr)->entries[l2Idx]);
+        const auto *l2Table = reinterpret_cast<const PageTable_t *>(
+            pagingDisabledNow ? l2PhysAddr : getRecursiveTableAddress(2, l4Idx, l3Idx, l2Idx));
+        const uint64_t l2Entry = l2Table->entries[l2Idx];
+        if (isHugeEntry(l2Entry)) {
+            return (l2Entry & ENTRY_ADDRESS_MASK & ~(L2_PAGE_SIZE - 1)) | (virtAddress & (L2_PAGE_SIZE - 1));
+        }
+
+        const uint64_t l1PhysAddr = GET_ADDR_FROM_ENTRY(l2Entry);
         if (l1PhysAddr == 0) {
             return 0;
         }
 
-        return GET_ADDR_FROM_ENTRY(reinterpret_cast<PageTable_t *>(l1PhysAddr)->entries[l1Idx]);
+        const auto *l1Table = reinterpret_cast<const PageTable_t *>(
+            pagingDisabledNow ? l1PhysAddr : getRecursiveTableAddress(1, l4Idx, l3Idx, l2Idx));
+        const uint64_t framePhysAddr = GET_ADDR_FROM_ENTRY(l1Table->entries[l1Idx]);
+        if (framePhysAddr == 0) {
+            return 0;
+        }
+
+        return framePhysAddr | (virtAddress & PAGE_OFFSET_MASK);
     }
 
     [[nodiscard]]
-    bool activateRootPageTable(PageTable_t *rootPageTable, bool pagingDisabledNow) {
-        //TODO
-
+    bool activateRootPageTable(PageTable_t *rootPageTable, bool pagingDisabledNow, const uint16_t pcid) {
         uint64_t physAddr;
         if (pagingDisabledNow) {
             physAddr = reinterpret_cast<uint64_t>(rootPageTable);
         } else {
-            uint64_t recursiveAddr =
-                    SIGN_EXTENSION
-                    | (RECURSIVE_INDEX << P4_SHIFT)
+            const uint64_t recursiveAddr = toCanonical(
+                    (RECURSIVE_INDEX << P4_SHIFT)
                     | (RECURSIVE_INDEX << P3_SHIFT)
                     | (RECURSIVE_INDEX << P2_SHIFT)
-                    | (RECURSIVE_INDEX << P1_SHIFT);
+                    | (RECURSIVE_INDEX << P1_SHIFT));
 
-            physAddr = reinterpret_cast<PageTable_t *>(recursiveAddr)->entries[RECURSIVE_INDEX];
+            //only the address: the flags of the entry would end up in the PCID bits of CR3
+            physAddr = GET_ADDR_FROM_ENTRY(reinterpret_cast<PageTable_t *>(recursiveAddr)->entries[RECURSIVE_INDEX]);
         }
 
-        asm ("mov %0, %%cr3;"::"r"(physAddr));
-        return false;
+        const uint64_t cr3 = buildCr3(physAddr, pcid);
+        asm volatile("mov %0, %%cr3" :: "r"(cr3) : "memory");
+        return true;
+    }
+
+    void installRecursiveEntry(PageTable_t *rootPageTable) {
+        rootPageTable->entries[RECURSIVE_INDEX] = constructTableEntry(
+            reinterpret_cast<uint64_t>(rootPageTable),
+            INTERMEDIATE_TABLE_FLAGS);
+    }
+
+    bool enableGlobalPages() {
+        if (!CHusky::Cpu::getCpuFeatures().hasPge) {
+            return false;
+        }
+
+#if __x86_64__
+        uint64_t cr4;
+        asm volatile("mov %%cr4, %0" : "=r"(cr4));
+        asm volatile("mov %0, %%cr4" :: "r"(cr4 | CR4_PGE) : "memory");
+#endif
+        return true;
+    }
+
+    void flushGlobalTlb() {
+#if __x86_64__
+        if (CHusky::Cpu::getCpuFeatures().hasInvpcid) {
+            //type 2: every PCID, global entries included
+            const struct {
+                uint64_t pcid;
+                uint64_t address;
+            } descriptor = {0, 0};
+            asm volatile("invpcid %0, %1" :: "m"(descriptor), "r"(INVPCID_ALL_CONTEXTS_AND_GLOBAL) : "memory");
+            return;
+        }
+
+        //toggling CR4.PGE flushes the whole TLB, global entries and all PCIDs included
+        uint64_t cr4;
+        asm volatile("mov %%cr4, %0" : "=r"(cr4));
+        if ((cr4 & CR4_PGE) != 0) {
+            asm volatile("mov %0, %%cr4" :: "r"(cr4 & ~CR4_PGE) : "memory");
+            asm volatile("mov %0, %%cr4" :: "r"(cr4) : "memory");
+        } else {
+            uint64_t cr3;
+            asm volatile("mov %%cr3, %0" : "=r"(cr3));
+            asm volatile("mov %0, %%cr3" :: "r"(cr3) : "memory");
+        }
+#endif
     }
 
 #pragma endregion // Public implementation
 
 
+    uint64_t getRecursiveTableAddress(const int level, const uint64_t l4Idx, const uint64_t l3Idx, const uint64_t l2Idx) {
+        switch (level) {
+            case 3:
+                return toCanonical(
+                    RECURSIVE_INDEX << P4_SHIFT
+                    | RECURSIVE_INDEX << P3_SHIFT
+                    | RECURSIVE_INDEX << P2_SHIFT
+                    | l4Idx << P1_SHIFT);
+            case 2:
+                return toCanonical(
+                    RECURSIVE_INDEX << P4_SHIFT
+                    | RECURSIVE_INDEX << P3_SHIFT
+                    | l4Idx << P2_SHIFT
+                    | l3Idx << P1_SHIFT);
+            default:
+                return toCanonical(
+                    RECURSIVE_INDEX << P4_SHIFT
+                    | l4Idx << P3_SHIFT
+                    | l3Idx << P2_SHIFT
+                    | l2Idx << P1_SHIFT);
+        }
+    }
+
+    uint64_t toCanonical(const uint64_t address) {
+        //the recursive index decides bit 47, so the slot can move to the upper half without touching the callers
+        return (address & (1ULL << 47)) != 0 ? address | SIGN_EXTENSION : address & ~SIGN_EXTENSION;
+    }
+
+    PageMapError getOrCreateTable(
+        PageTable_t *parentTable,
+        const PageTableRootController::PageFrameAllocator allocator,
+        const int level,
+        const uint64_t virtAddress,
+        const bool pagingDisabledNow,
+        const bool isUserAccessible,
+        std::size_t *allocatedTables,
+        PageTable_t **childTable) {
+        const uint64_t l4Idx = (virtAddress >> P4_SHIFT) & INDEX_MASK;
+        const uint64_t l3Idx = (virtAddress >> P3_SHIFT) & INDEX_MASK;
+        const uint64_t l2Idx = (virtAddress >> P2_SHIFT) & INDEX_MASK;
+        //the parent of a level N table is a level N + 1 table, indexed with the level N + 1 bits of the address
+        const uint64_t parentIdx = (virtAddress >> (P1_SHIFT + 9 * level)) & INDEX_MASK;
+
+        const uint64_t recursiveAddress = getRecursiveTableAddress(level, l4Idx, l3Idx, l2Idx);
+        const uint64_t entry = parentTable->entries[parentIdx];
+        const uint64_t userBit = isUserAccessible ? static_cast<uint64_t>(X86_64PageFlags::UserModeAccessible) : 0;
+        if (entry != 0 && (level == 3 || !isHugeEntry(entry))) {
+            //a stale translation without user access only makes the first user access fault and walk again
+            parentTable->entries[parentIdx] = entry | userBit;
+            *childTable = reinterpret_cast<PageTable_t *>(
+                pagingDisabledNow ? GET_ADDR_FROM_ENTRY(entry) : recursiveAddress);
+            return PageMapError::NoError;
+        }
+
+        const uint64_t physAddr = allocator();
+        if (physAddr == 0) {
+            return PageMapError::AllocFailed;
+        }
+        if (allocatedTables != nullptr) {
+            (*allocatedTables)++;
+        }
+
+        auto *table = reinterpret_cast<PageTable_t *>(pagingDisabledNow ? physAddr : recursiveAddress);
+        if (pagingDisabledNow) {
+            CHusky::Mem::zeroPage(table);
+        }
+
+        /* With paging enabled, the new table is only reachable (through the recursive entry) after it's linked, so
+         * it's linked first and filled afterward. */
+        parentTable->entries[parentIdx] = constructTableEntry(physAddr, INTERMEDIATE_TABLE_FLAGS) | userBit;
+        if (!pagingDisabledNow) {
+            invalidatePage(recursiveAddress, false);
+            CHusky::Mem::zeroPage(table);
+        }
+
+        if (entry != 0) {
+            //split the huge page: same flags, 512 pages of the next size (2 MiB pages keep the huge bit, 4 KiB don't)
+            const uint64_t childPageSize = level == 2 ? L2_PAGE_SIZE : PAGE_SIZE;
+            const uint64_t parentPageSize = childPageSize * ENTRIES_PER_TABLE;
+            uint64_t childFlags = entry & ~ENTRY_ADDRESS_MASK;
+            if (level == 1) {
+                childFlags &= ~static_cast<uint64_t>(X86_64PageFlags::HugePage);
+            }
+
+            const uint64_t hugeBase = entry & ENTRY_ADDRESS_MASK & ~(parentPageSize - 1);
+            for (uint64_t i = 0; i < ENTRIES_PER_TABLE; i++) {
+                table->entries[i] = (hugeBase + i * childPageSize) | childFlags;
+            }
+
+            //one invlpg anywhere inside the huge page drops its TLB entry
+            invalidatePage(virtAddress, pagingDisabledNow);
+        }
+
+        *childTable = table;
+        return PageMapError::NoError;
+    }
+
+    bool isCanonical(const uint64_t virtAddress) {
+        const uint64_t signExtension = virtAddress >> 47;
+        return signExtension == 0 || signExtension == 0x1FFFF;
+    }
+
+    bool isHugeEntry(const uint64_t entry) {
+        return (entry & static_cast<uint64_t>(X86_64PageFlags::HugePage)) != 0;
+    }
+
+    bool checkVirtualRange(const uint64_t virtAddress, const uint64_t length, uint64_t *pageCount) {
+        //the whole range has to be canonical, without wrapping around or crossing the non-canonical hole
+        *pageCount = (length + PAGE_OFFSET_MASK) / PAGE_SIZE;
+        const uint64_t lastAddress = virtAddress + (*pageCount - 1) * PAGE_SIZE;
+        return *pageCount <= (UINT64_MAX - virtAddress) / PAGE_SIZE + 1
+               && isCanonical(virtAddress)
+               && isCanonical(lastAddress)
+               && (virtAddress >> 63) == (lastAddress >> 63);
+    }
+
+    PageMapError unmapInTable(
+        PageTable_t *table,
+        const int level,
+        uint64_t firstAddress,
+        const uint64_t lastAddress,
+        UnmapState &state,
+        bool *isEmpty) {
+        //the size of the range covered by one entry of this table
+        const uint64_t entrySize = PAGE_SIZE << (9 * (level - 1));
+
+        PageMapError error = PageMapError::NoError;
+        for (uint64_t idx = (firstAddress >> (P1_SHIFT + 9 * (level - 1))) & INDEX_MASK; ; idx++) {
+            const uint64_t entryFirst = firstAddress & ~(entrySize - 1);
+            const uint64_t entryLast = entryFirst + entrySize - 1;
+            const uint64_t entry = table->entries[idx];
+
+            if (entry != 0) {
+                const bool isCovered = firstAddress == entryFirst && lastAddress >= entryLast;
+                const bool isLeaf = level == 1 || (level <= 3 && isHugeEntry(entry));
+
+                if (isLeaf && isCovered) {
+                    table->entries[idx] = 0;
+                    state.clearedLeaves++;
+                    state.clearedGlobal |= (entry & static_cast<uint64_t>(X86_64PageFlags::Global)) != 0;
+                    if (state.invalidateEachPage) {
+                        //a single invlpg drops the whole huge page, whatever its size
+                        invalidatePage(entryFirst, state.pagingDisabledNow);
+                    }
+                } else {
+                    //either a table, or a huge page that's only partly unmapped and has to be split first
+                    PageTable_t *childTable;
+                    error = getOrCreateTable(
+                        table,
+                        state.allocator,
+                        level - 1,
+                        firstAddress,
+                        state.pagingDisabledNow,
+                        false,
+                        nullptr,
+                        &childTable);
+                    if (error != PageMapError::NoError) {
+                        break;
+                    }
+
+                    bool isChildEmpty;
+                    error = unmapInTable(
+                        childTable,
+                        level - 1,
+                        firstAddress,
+                        lastAddress < entryLast ? lastAddress : entryLast,
+                        state,
+                        &isChildEmpty);
+
+                    if (isChildEmpty && state.releaser != nullptr) {
+                        //re-read, as a split replaced the huge page entry with the new table
+                        const uint64_t childEntry = table->entries[idx];
+                        table->entries[idx] = 0;
+                        if (!state.pagingDisabledNow) {
+                            //the table was reachable through the recursive entry until now
+                            invalidatePage(reinterpret_cast<uint64_t>(childTable), false);
+                        }
+                        state.releaser(GET_ADDR_FROM_ENTRY(childEntry));
+                        state.freedTables++;
+                    }
+
+                    if (error != PageMapError::NoError) {
+                        break;
+                    }
+                }
+            }
+
+            if (entryLast >= lastAddress || idx == INDEX_MASK) {
+                break;
+            }
+            firstAddress = entryLast + 1;
+        }
+
+        *isEmpty = true;
+        for (const uint64_t entry : table->entries) {
+            if (entry != 0) {
+                *isEmpty = false;
+                break;
+            }
+        }
+
+        return error;
+    }
+
+    void flushTlb(const bool pagingDisabledNow, const bool includeGlobal) {
+        if (pagingDisabledNow) {
+            return;
+        }
+
+#if __x86_64__
+        if (includeGlobal) {
+            flushGlobalTlb();
+            return;
+        }
+
+        /* Writing CR3 drops every non-global translation. With PCIDs, the value read back has the current PCID and the
+         * no-flush bit clear, so only the current address space is flushed. */
+        uint64_t cr3;
+        asm volatile("mov %%cr3, %0" : "=r"(cr3));
+        asm volatile("mov %0, %%cr3" :: "r"(cr3) : "memory");
+#endif
+    }
+
     uint64_t constructTableEntry(const uint64_t physicalAddress, const PageFlags flags) {
         uint64_t data = 0;
         auto x86_64PageFlags = static_cast<X86_64PageFlags>(0);
@@ -307,6 +757,10 @@ namespace Paginator::X86_64 {
             x86_64PageFlags = x86_64PageFlags | X86_64PageFlags::HugePage;
         }
 
+        if ((flags & PageFlags::Global) == PageFlags::Global) {
+            x86_64PageFlags = x86_64PageFlags | X86_64PageFlags::Global;
+        }
+
         if ((flags & PageFlags::ExecuteBit) != PageFlags::ExecuteBit) {
             x86_64PageFlags = x86_64PageFlags | X86_64PageFlags::ExecuteDisable;
         }
@@ -316,10 +770,14 @@ namespace Paginator::X86_64 {
         return data;
     }
 
-    void invalidatePage(const uint64_t virtAddress) {
-        // uintptr_t va = virtAddress;
-        // int i = 1;
-        //asm volatile("invlpg [%0]" :: "r"(va+i));
+    void invalidatePage(const uint64_t virtAddress, const bool pagingDisabledNow) {
+        if (pagingDisabledNow) {
+            return;
+        }
+
+#if __x86_64__
+        asm volatile("invlpg (%0)" :: "r"(virtAddress) : "memory");
+#endif
     }
 
     // uint64_t level_4_table_addr =
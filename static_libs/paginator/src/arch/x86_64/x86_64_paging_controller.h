@@ -62,11 +62,53 @@ namespace Paginator::X86_64 {
         bool forceWrite,
         bool pagingDisabledNow = false);
 
-    void unmapPage(PageTable_t *rootPageTable, std::size_t virtAddress, bool pagingDisabledNow = false);
+    PageMapError mapRange(
+        PageTable_t *rootPageTable,
+        PageTableRootController::PageFrameAllocator allocator,
+        std::size_t virtAddress,
+        std::size_t physAddress,
+        std::size_t length,
+        PageFlags flags,
+        bool forceWrite,
+        bool pagingDisabledNow = false,
+        std::size_t *allocatedTables = nullptr);
+
+    PageMapError unmapRange(
+        PageTable_t *rootPageTable,
+        PageTableRootController::PageFrameAllocator allocator,
+        PageTableRootController::PageFrameReleaser releaser,
+        std::size_t virtAddress,
+        std::size_t length,
+        bool pagingDisabledNow = false,
+        UnmapResult *result = nullptr);
 
     uint64_t translateVirtToPhys(const PageTable_t *rootPageTable, std::size_t virtAddress,
                                  bool pagingDisabledNow = false);
 
-    bool activateRootPageTable(PageTable_t *rootPageTable, bool pagingDisabledNow = false);
+    /**
+     * The (virtual) address through which a page table can be accessed while paging is enabled, via the recursive
+     * entry.
+     * @param level The level of the table: 3 for the L3 table of the given l4Idx, 1 for the L1 table of the given
+     * l4Idx/l3Idx/l2Idx and so on.
+     */
+    uint64_t getRecursiveTableAddress(int level, uint64_t l4Idx, uint64_t l3Idx, uint64_t l2Idx);
+
+    bool activateRootPageTable(PageTable_t *rootPageTable, bool pagingDisabledNow = false, uint16_t pcid = 0);
+
+    /**
+     * Writes the recursive entry of a root table that isn't in use yet (accessed by its physical address).
+     */
+    void installRecursiveEntry(PageTable_t *rootPageTable);
+
+    /**
+     * Sets CR4.PGE on the current CPU if the CPU supports global pages.
+     * @return True if global pages are enabled.
+     */
+    bool enableGlobalPages();
+
+    /**
+     * Flushes the whole TLB, global entries included, for every PCID.
+     */
+    void flushGlobalTlb();
 } //namespace Paginator::X86_64
 #endif //PAGINATOR_ARCH_X86_64_PAGING_CONTROLLER_H
\ No newline at end of file
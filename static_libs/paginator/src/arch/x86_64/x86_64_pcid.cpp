@@ -0,0 +1,124 @@
+#include <c_husky/cpu_features.h>
+
+#include "paginator/page_table.h"
+
+#include "x86_64_pcid.h"
+
+namespace Paginator::X86_64 {
+    constexpr uint64_t CR4_PCIDE = 1ULL << 17;
+    //bit 63 of the value written to CR3: keep the TLB entries of the new PCID
+    constexpr uint64_t CR3_NO_FLUSH = 1ULL << 63;
+    //invpcid type 1: every entry of one PCID, except the global ones
+    constexpr uint64_t INVPCID_SINGLE_CONTEXT = 1;
+
+    constexpr uint32_t BITMAP_WORDS = PCID_COUNT / 64;
+
+    static bool pcidEnabled = false;
+    static bool invpcidAvailable = false;
+    static unsigned (*getCpuIndex)() = nullptr;
+
+    /* One bit per PCID. The bitmaps are updated with atomic operations, as address spaces can be created and
+     * destroyed on any CPU. Each CPU has its own bitmap of the PCIDs it still has to flush, since a TLB is per CPU. */
+    static uint64_t pcidsInUse[BITMAP_WORDS] = {1}; //NO_PCID is never handed out
+    static uint64_t pcidsToFlush[MAX_CPUS][BITMAP_WORDS] = {};
+
+    static unsigned getCurrentCpu() {
+        return getCpuIndex != nullptr ? getCpuIndex() : 0;
+    }
+
+    static void invalidatePcid(const uint16_t pcid) {
+#if __x86_64__
+        const struct {
+            uint64_t pcid;
+            uint64_t address;
+        } descriptor = {pcid, 0};
+        asm volatile("invpcid %0, %1" :: "m"(descriptor), "r"(INVPCID_SINGLE_CONTEXT) : "memory");
+#endif
+    }
+
+    void setCpuIndexFunction(unsigned (*cpuIndexFunction)()) {
+        getCpuIndex = cpuIndexFunction;
+    }
+
+    bool enablePcid() {
+        const CHusky::Cpu::CpuFeatures &features = CHusky::Cpu::getCpuFeatures();
+        if (!features.hasPcid) {
+            return false;
+        }
+
+#if __x86_64__
+        //setting CR4.PCIDE faults unless CR3 holds PCID 0 (and PWT/PCD, which become PCID bits, are clear)
+        uint64_t cr3;
+        asm volatile("mov %%cr3, %0" : "=r"(cr3));
+        if ((cr3 & 0xFFF) != 0) {
+            return false;
+        }
+
+        uint64_t cr4;
+        asm volatile("mov %%cr4, %0" : "=r"(cr4));
+        asm volatile("mov %0, %%cr4" :: "r"(cr4 | CR4_PCIDE) : "memory");
+#endif
+
+        invpcidAvailable = features.hasInvpcid;
+        pcidEnabled = true;
+        return true;
+    }
+
+    bool isPcidEnabled() {
+        return pcidEnabled;
+    }
+
+    uint16_t allocatePcid() {
+        if (!pcidEnabled) {
+            return NO_PCID;
+        }
+
+        for (uint32_t word = 0; word < BITMAP_WORDS; word++) {
+            uint64_t used = __atomic_load_n(&pcidsInUse[word], __ATOMIC_RELAXED);
+            while (used != UINT64_MAX) {
+                const uint64_t bit = 1ULL << __builtin_ctzll(~used);
+                //another CPU might take the same bit first, in which case the loop retries with the new value
+                used = __atomic_fetch_or(&pcidsInUse[word], bit, __ATOMIC_ACQUIRE);
+                if ((used & bit) == 0) {
+                    return static_cast<uint16_t>(word * 64 + __builtin_ctzll(bit));
+                }
+            }
+        }
+
+        return NO_PCID;
+    }
+
+    void releasePcid(const uint16_t pcid) {
+        if (pcid == NO_PCID || pcid >= PCID_COUNT) {
+            return;
+        }
+
+        const uint64_t bit = 1ULL << (pcid % 64);
+        const unsigned currentCpu = getCurrentCpu();
+        for (unsigned cpu = 0; cpu < MAX_CPUS; cpu++) {
+            if (cpu == currentCpu && invpcidAvailable) {
+                invalidatePcid(pcid);
+            } else {
+                __atomic_fetch_or(&pcidsToFlush[cpu][pcid / 64], bit, __ATOMIC_RELAXED);
+            }
+        }
+
+        //the marks are visible to whoever gets the PCID next (allocatePcid takes it with acquire)
+        __atomic_fetch_and(&pcidsInUse[pcid / 64], ~bit, __ATOMIC_RELEASE);
+    }
+
+    uint64_t buildCr3(const uint64_t rootPhysAddress, const uint16_t pcid) {
+        if (!pcidEnabled || pcid == NO_PCID) {
+            return rootPhysAddress;
+        }
+
+        //this CPU may still have entries of the PCID's previous owner, so its first switch to it flushes them
+        const uint64_t bit = 1ULL << (pcid % 64);
+        const uint64_t toFlush = __atomic_fetch_and(&pcidsToFlush[getCurrentCpu()][pcid / 64], ~bit, __ATOMIC_RELAXED);
+        if ((toFlush & bit) != 0) {
+            return rootPhysAddress | pcid;
+        }
+
+        return rootPhysAddress | pcid | CR3_NO_FLUSH;
+    }
+} //namespace Paginator::X86_64
@@ -0,0 +1,60 @@
+#ifndef PAGINATOR_ARCH_X86_64_PCID_H
+#define PAGINATOR_ARCH_X86_64_PCID_H
+
+#include <cstdint>
+
+namespace Paginator::X86_64 {
+    /**
+     * The PCID used when PCIDs are disabled or all of them are taken. It's also the one of the boot/kernel tables,
+     * since CR4.PCIDE can only be set while CR3 holds PCID 0.
+     */
+    constexpr uint16_t NO_PCID = 0;
+
+    /**
+     * The number of PCIDs (the low 12 bits of CR3).
+     */
+    constexpr uint32_t PCID_COUNT = 4096;
+
+    /**
+     * Sets the function that returns the index of the current CPU (below MAX_CPUS, see page_table.h). Until then,
+     * every CPU is taken for CPU 0, which is only correct on a single CPU.
+     */
+    void setCpuIndexFunction(unsigned (*cpuIndexFunction)());
+
+    /**
+     * Sets CR4.PCIDE on the current CPU if the CPU supports PCIDs. Has to be called on every CPU, while CR3 holds
+     * PCID 0 (always the case before the first PCID-tagged switch).
+     * @return True if PCIDs are enabled.
+     */
+    bool enablePcid();
+
+    /**
+     * Returns true once enablePcid succeeded.
+     */
+    bool isPcidEnabled();
+
+    /**
+     * Reserves a PCID for a new address space.
+     * @return The PCID, or NO_PCID if PCIDs are disabled or all of them are in use. NO_PCID is always safe to use, it
+     * just means switching to that address space flushes the TLB.
+     */
+    uint16_t allocatePcid();
+
+    /**
+     * Gives a PCID back. The address space must not be active on any CPU anymore. invpcid only reaches the TLB of the
+     * CPU running it, so every other CPU (and this one too without invpcid) is marked to flush the PCID's stale entries
+     * on its next switch to it: whichever CPU the PCID is handed out on next, none of them keeps the previous owner's
+     * translations.
+     */
+    void releasePcid(uint16_t pcid);
+
+    /**
+     * Builds the CR3 value for switching to the given root table. With a PCID, the no-flush bit is set, so the TLB
+     * entries the address space had the last time it ran on this CPU survive the switch; the only exception is the
+     * first switch on this CPU after the PCID was released.
+     * @param rootPhysAddress The physical address of the root table; must be 4 KiB-aligned.
+     */
+    uint64_t buildCr3(uint64_t rootPhysAddress, uint16_t pcid);
+} //namespace Paginator::X86_64
+
+#endif //PAGINATOR_ARCH_X86_64_PCID_H
@@ -2,16 +2,28 @@
 
 #if __x86_64__
 #include "arch/x86_64/x86_64_paging_controller.h"
+#include "arch/x86_64/x86_64_pcid.h"
 #endif
 
 namespace Paginator {
+    void setCpuIndexFunction(const CpuIndexFunction cpuIndexFunction) {
+#if __x86_64__
+        X86_64::setCpuIndexFunction(cpuIndexFunction);
+#endif
+    }
+
     PageTableRootController::PageTableRootController(
         PageTable_t *rootPageTable,
         const PageFrameAllocator allocator,
-        const bool pagingDisabledNow)
+        const bool pagingDisabledNow,
+        const PageFrameReleaser releaser,
+        const std::uint16_t pcid)
         :   rootPageTableAddress(rootPageTable),
             pagingDisabledNow(pagingDisabledNow),
-            allocator(allocator)
+            allocator(allocator),
+            releaser(releaser),
+            pcid(pcid),
+            globalKernelMappings(false)
     {
     }
 
@@ -26,15 +38,60 @@ namespace Paginator {
             this->allocator,
             virtAddress,
             physAddress,
-            flags,
+            applyGlobalMode(virtAddress, flags),
             forceWrite,
             this->pagingDisabledNow);
 #endif
     }
 
+    PageMapError PageTableRootController::mapRange(
+        const std::size_t virtAddress,
+        const std::size_t physAddress,
+        const std::size_t length,
+        const PageFlags flags,
+        std::size_t *allocatedTables,
+        const bool forceWrite) const {
+#if __x86_64__
+        return X86_64::mapRange(
+            this->rootPageTableAddress,
+            this->allocator,
+            virtAddress,
+            physAddress,
+            length,
+            applyGlobalMode(virtAddress, flags),
+            forceWrite,
+            this->pagingDisabledNow,
+            allocatedTables);
+#endif
+    }
+
+    PageMapError PageTableRootController::identityMapRange(
+        const std::size_t address,
+        const std::size_t length,
+        const PageFlags flags,
+        std::size_t *allocatedTables,
+        const bool forceWrite) const {
+        return mapRange(address, address, length, flags, allocatedTables, forceWrite);
+    }
+
     void PageTableRootController::unmapPage(const std::size_t virtAddress) const {
+        //the only possible failure is splitting a huge page, and there's no way to report it here
+        static_cast<void>(unmapRange(virtAddress & ~static_cast<std::size_t>(0xFFF), 0x1000));
+    }
+
+    PageMapError PageTableRootController::unmapRange(
+        const std::size_t virtAddress,
+        const std::size_t length,
+        UnmapResult *result) const {
 #if __x86_64__
-        X86_64::unmapPage(this->rootPageTableAddress, virtAddress, this->pagingDisabledNow);
+        return X86_64::unmapRange(
+            this->rootPageTableAddress,
+            this->allocator,
+            this->releaser,
+            virtAddress,
+            length,
+            this->pagingDisabledNow,
+            result);
 #endif
     }
 
@@ -48,7 +105,7 @@ namespace Paginator {
             this->allocator,
             address,
             address,
-            flags,
+            applyGlobalMode(address, flags),
             forceWrite,
             this->pagingDisabledNow);
 #endif
@@ -60,9 +117,82 @@ namespace Paginator {
 #endif
     }
 
+    std::size_t PageTableRootController::getRecursiveTableAddress(const int level, const std::size_t virtAddress) {
+#if __x86_64__
+        return X86_64::getRecursiveTableAddress(
+            level,
+            (virtAddress >> 39) & 0x1FF,
+            (virtAddress >> 30) & 0x1FF,
+            (virtAddress >> 21) & 0x1FF);
+#endif
+    }
+
+    bool PageTableRootController::installRecursiveEntry() const {
+        if (!this->pagingDisabledNow) {
+            return false;
+        }
+
+#if __x86_64__
+        X86_64::installRecursiveEntry(this->rootPageTableAddress);
+#endif
+        return true;
+    }
+
     bool PageTableRootController::activateRootPageTable() const {
 #if __x86_64__
-        return X86_64::activateRootPageTable(this->rootPageTableAddress, this->pagingDisabledNow);
+        return X86_64::activateRootPageTable(this->rootPageTableAddress, this->pagingDisabledNow, this->pcid);
+#endif
+    }
+
+    bool PageTableRootController::enablePcid() {
+#if __x86_64__
+        return X86_64::enablePcid();
+#else
+        return false;
+#endif
+    }
+
+    bool PageTableRootController::enableGlobalPages() {
+#if __x86_64__
+        return X86_64::enableGlobalPages();
+#else
+        return false;
+#endif
+    }
+
+    void PageTableRootController::setGlobalKernelMappings(const bool isEnabled) {
+        this->globalKernelMappings = isEnabled;
+    }
+
+    PageFlags PageTableRootController::applyGlobalMode(const std::size_t virtAddress, const PageFlags flags) const {
+        //the higher half is the one with the top bit set (a range never crosses halves, so its start is enough)
+        const bool isKernelAddress = (virtAddress >> 63) != 0;
+        if (
+            !this->globalKernelMappings
+            || !isKernelAddress
+            || (flags & PageFlags::UserModeAccessible) == PageFlags::UserModeAccessible
+        ) {
+            return flags;
+        }
+
+        return flags | PageFlags::Global;
+    }
+
+    std::uint16_t PageTableRootController::getPcid() const {
+        return this->pcid;
+    }
+
+    std::uint16_t PageTableRootController::allocatePcid() {
+#if __x86_64__
+        return X86_64::allocatePcid();
+#else
+        return 0;
+#endif
+    }
+
+    void PageTableRootController::releasePcid(const std::uint16_t pcid) {
+#if __x86_64__
+        X86_64::releasePcid(pcid);
 #endif
     }
 } //namespace Paginator
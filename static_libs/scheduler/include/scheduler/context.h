@@ -0,0 +1,34 @@
+#ifndef SCHEDULER_CONTEXT_H
+#define SCHEDULER_CONTEXT_H
+
+#include <cstddef>
+
+namespace Scheduler {
+    /**
+     * What a new context starts in. It must never return: there's nothing to return to.
+     */
+    typedef void (*ContextEntry)(void *argument);
+
+    /**
+     * The bytes prepareContext puts on a new stack.
+     */
+    constexpr std::size_t CONTEXT_FRAME_SIZE = 72;
+
+    /**
+     * Builds the frame switchContext expects at the top of a new stack, so switching to it calls entry(argument) on
+     * that stack.
+     * @param stackTop The end of the stack, 16-byte aligned.
+     * @return The stack pointer to give to switchContext.
+     */
+    void *prepareContext(void *stackTop, ContextEntry entry, void *argument);
+
+    /**
+     * Saves the callee-saved registers (rbx, rbp, r12 to r15) on the current stack, stores the stack pointer in
+     * *savedStackPointer, and switches to the context saved at nextStackPointer. Returns when another switchContext
+     * switches back. Everything else is either caller-saved in the System V ABI or, like the FPU and SSE state, unused
+     * by code built for the kernel.
+     */
+    extern "C" void switchContext(void **savedStackPointer, void *nextStackPointer);
+} //namespace Scheduler
+
+#endif //SCHEDULER_CONTEXT_H
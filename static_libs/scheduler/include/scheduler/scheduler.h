@@ -0,0 +1,256 @@
+#ifndef SCHEDULER_SCHEDULER_H
+#define SCHEDULER_SCHEDULER_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * A preemptive scheduler for kernel threads, with one run queue per CPU and no global lock.
+ *
+ * Every CPU has a Chase-Lev deque of ready threads, which it runs oldest first, and an inbox other CPUs hand woken
+ * threads to (a lock-free list, moved into the deque by the owner). A CPU that runs out of threads steals the oldest
+ * one of another CPU's deque, trying the CPUs from a random one so the thieves spread over the victims. A woken thread
+ * goes back to the CPU it last ran on, where its data is likely still cached, unless that CPU has a longer queue than
+ * the waker's.
+ *
+ * A thread is never in a queue while its stack is in use: the switch away from it finishes on the next thread (in
+ * finishSwitch), and only then is the thread queued again, marked blocked or handed back as exited. So a CPU that
+ * steals or wakes a thread always finds its context fully saved.
+ *
+ * The CPU-specific parts (which CPU this is, interrupts, idling) come from the Hooks given to init, so the same code
+ * runs in the kernel and, with host threads as the CPUs, in the benchmarks.
+ */
+namespace Scheduler {
+    /**
+     * The most CPUs the scheduler knows of; the same as the allocators' per-CPU caches.
+     */
+    constexpr unsigned MAX_CPUS = 64;
+
+    /**
+     * The threads a CPU's deque holds. The ones that don't fit wait in the CPU's inbox.
+     */
+    constexpr std::size_t RUN_QUEUE_CAPACITY = 256;
+
+    /**
+     * A thread that runs for this many ticks while another one is ready gets preempted.
+     */
+    constexpr unsigned TIME_SLICE_TICKS = 4;
+
+    /**
+     * A woken thread goes to its last CPU unless that CPU has at least this many more ready threads than the waker's.
+     */
+    constexpr std::size_t AFFINITY_QUEUE_SLACK = 2;
+
+    typedef void (*ThreadFunction)(void *argument);
+
+    enum class ThreadState : std::uint32_t {
+        /**
+         * In a run queue (or an inbox).
+         */
+        Ready,
+        Running,
+        /**
+         * Between prepareToBlock and the switch away from it. A wake meanwhile puts it back to Running.
+         */
+        Blocking,
+        Blocked,
+        Exited,
+    };
+
+    struct Thread {
+        /**
+         * Where switchContext saved the thread's registers; only meaningful while it isn't running.
+         */
+        void *stackPointer;
+        void *stackBase;
+        std::size_t stackSize;
+        ThreadFunction function;
+        void *argument;
+        const char *name;
+
+        /**
+         * The next thread in an inbox.
+         */
+        Thread *nextInInbox;
+        ThreadState state;
+        /**
+         * The CPU the thread last ran on.
+         */
+        unsigned lastCpu;
+        /**
+         * The ticks the thread has been running for since it was last switched to.
+         */
+        unsigned ticks;
+        /**
+         * The depth of disablePreemption calls, and whether a preemption was held back meanwhile.
+         */
+        unsigned preemptionDisabled;
+        bool isPreemptionPending;
+        bool isIdle;
+    };
+
+    /**
+     * What the scheduler needs from the platform. Every function is called with interrupts disabled, except the
+     * interrupt functions themselves.
+     */
+    struct Hooks {
+        /**
+         * Returns the index of the current CPU, below MAX_CPUS.
+         */
+        unsigned (*getCpuIndex)();
+        /**
+         * Disables the interrupts of the current CPU, and returns whether they were enabled.
+         */
+        bool (*disableInterrupts)();
+        void (*restoreInterrupts)(bool wereEnabled);
+        /**
+         * Waits until an interrupt or a wakeCpu from another CPU (returning early is fine), then returns with the
+         * interrupts disabled again. On x86, that's "sti; hlt; cli".
+         */
+        void (*waitForWork)();
+        /**
+         * Gets another CPU out of waitForWork.
+         */
+        void (*wakeCpu)(unsigned cpuIndex);
+        /**
+         * Called on the next thread once an exited thread is switched away from, so its stack and the Thread itself
+         * can be freed.
+         */
+        void (*threadExited)(Thread *thread);
+        /**
+         * Called right before switching to a thread (e.g. to point the CPU's kernel stack to it). Can be nullptr.
+         */
+        void (*switchingTo)(Thread *thread);
+    };
+
+    struct Statistics {
+        /**
+         * The number of switches from one thread to another (the idle loop counts as a thread).
+         */
+        std::uint64_t switchCount;
+        /**
+         * The number of threads taken from another CPU's deque.
+         */
+        std::uint64_t stealCount;
+        /**
+         * The number of times a thread was preempted at the end of its time slice.
+         */
+        std::uint64_t preemptionCount;
+    };
+
+    /**
+     * Sets up the scheduler, before any other function. Calling it again once every CPU left run starts over, with
+     * the counters cleared (the benchmarks do, between runs).
+     */
+    void init(const Hooks &hooks);
+
+    /**
+     * Sets up a thread that runs function(argument) on the given stack. Returning from the function exits the thread.
+     * The thread isn't started yet.
+     * @param stackBase The lowest address of the stack.
+     * @param stackSize Its size; the top is aligned down to 16 bytes.
+     */
+    void initThread(
+        Thread *thread,
+        void *stackBase,
+        std::size_t stackSize,
+        ThreadFunction function,
+        void *argument,
+        const char *name);
+
+    /**
+     * Makes a thread from initThread ready to run, on the given CPU if it stays there (other CPUs can steal it). Must
+     * be called on a CPU of the scheduler, or before any CPU runs.
+     */
+    void start(Thread *thread, unsigned cpuIndex);
+
+    /**
+     * Turns the caller into the idle loop of the current CPU, and runs threads until stop is called and there's
+     * nothing left to run.
+     */
+    void run();
+
+    /**
+     * Makes every CPU leave run once it has nothing left to run.
+     */
+    void stop();
+
+    /**
+     * Returns the thread running on the current CPU, or nullptr before run.
+     */
+    [[nodiscard]] Thread *getCurrentThread();
+
+    /**
+     * Lets another ready thread run, if there's one. The current thread stays ready.
+     */
+    void yield();
+
+    /**
+     * Marks the current thread as about to block (never the idle loop). The caller then checks what it waits for, and
+     * either calls block or cancelBlock; a wake between this and block makes block return right away, so no wake-up
+     * is lost.
+     */
+    void prepareToBlock();
+
+    /**
+     * Switches away from the current thread until wake is called on it (unless it was already, since
+     * prepareToBlock).
+     */
+    void block();
+
+    /**
+     * Undoes prepareToBlock, when the thread doesn't have to wait after all.
+     */
+    void cancelBlock();
+
+    /**
+     * Makes a blocked (or blocking) thread ready again. Can be called from any CPU, and from interrupt handlers.
+     * @return False if the thread wasn't blocked or blocking.
+     */
+    bool wake(Thread *thread);
+
+    /**
+     * Ends the current thread.
+     */
+    [[noreturn]] void exit();
+
+    /**
+     * To call from the timer interrupt (after its end of interrupt): preempts the current thread once its time slice
+     * is over, if another thread is ready.
+     */
+    void onTick();
+
+    /**
+     * Keeps the current thread on its CPU until enablePreemption, e.g. around per-CPU caches. The calls nest.
+     */
+    void disablePreemption();
+
+    /**
+     * Undoes disablePreemption, and makes the preemption that was held back meanwhile, if any.
+     */
+    void enablePreemption();
+
+    /**
+     * Returns the counters of a CPU, read without synchronization.
+     */
+    [[nodiscard]] Statistics getStatistics(unsigned cpuIndex);
+
+    /**
+     * Disables preemption for its scope.
+     */
+    class PreemptionGuard {
+    public:
+        PreemptionGuard() {
+            disablePreemption();
+        }
+
+        ~PreemptionGuard() {
+            enablePreemption();
+        }
+
+        PreemptionGuard(const PreemptionGuard &) = delete;
+        PreemptionGuard &operator=(const PreemptionGuard &) = delete;
+    };
+} //namespace Scheduler
+
+#endif //SCHEDULER_SCHEDULER_H
@@ -0,0 +1,121 @@
+#ifndef SCHEDULER_WORK_STEALING_DEQUE_H
+#define SCHEDULER_WORK_STEALING_DEQUE_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Scheduler {
+    /**
+     * A Chase-Lev work-stealing deque of pointers: its owner pushes and pops at the bottom, like a stack, and any
+     * number of thieves take from the top. The owner's operations only touch the bottom index with plain stores (pop
+     * needs one full fence, and a compare-and-swap when a single element is left), and a thief takes an element with a
+     * single compare-and-swap on the top index, so nobody ever waits for a lock.
+     *
+     * The memory orderings are the ones proven for the C11 model by Lê, Pop, Cohen and Zappa Nardelli ("Correct and
+     * Efficient Work-Stealing for Weak Memory Models", PPoPP 2013). Unlike the original, the array doesn't grow: there
+     * is no allocator to grow it with in an interrupt handler, so push fails when it's full and the caller finds
+     * another place for the element.
+     * @tparam T The element type, a pointer.
+     * @tparam CAPACITY A power of two.
+     */
+    template<typename T, std::size_t CAPACITY>
+    class WorkStealingDeque {
+        static_assert(CAPACITY != 0 && (CAPACITY & (CAPACITY - 1)) == 0, "the capacity should be a power of two");
+
+        //the thieves hammer top, the owner bottom: they get their own cache lines
+        alignas(64) std::int64_t top = 0;
+        alignas(64) std::int64_t bottom = 0;
+        T elements[CAPACITY] = {};
+
+        [[nodiscard]] T load(const std::int64_t index) const {
+            return __atomic_load_n(&this->elements[static_cast<std::size_t>(index) & (CAPACITY - 1)], __ATOMIC_RELAXED);
+        }
+
+        void store(const std::int64_t index, T element) {
+            __atomic_store_n(&this->elements[static_cast<std::size_t>(index) & (CAPACITY - 1)], element,
+                             __ATOMIC_RELAXED);
+        }
+
+    public:
+        constexpr WorkStealingDeque() = default;
+
+        WorkStealingDeque(const WorkStealingDeque &) = delete;
+        WorkStealingDeque &operator=(const WorkStealingDeque &) = delete;
+
+        /**
+         * Adds an element at the bottom. Only called by the owner.
+         * @return False if the deque is full.
+         */
+        bool push(T element) {
+            const std::int64_t b = __atomic_load_n(&this->bottom, __ATOMIC_RELAXED);
+            const std::int64_t t = __atomic_load_n(&this->top, __ATOMIC_ACQUIRE);
+            if (b - t >= static_cast<std::int64_t>(CAPACITY)) {
+                return false;
+            }
+
+            store(b, element);
+            //a thief that sees the new bottom has to see the element too
+            __atomic_thread_fence(__ATOMIC_RELEASE);
+            __atomic_store_n(&this->bottom, b + 1, __ATOMIC_RELAXED);
+            return true;
+        }
+
+        /**
+         * Takes the element at the bottom (the most recently pushed). Only called by the owner.
+         * @return The element, or nullptr if the deque is empty (or a thief took the last one).
+         */
+        T pop() {
+            const std::int64_t b = __atomic_load_n(&this->bottom, __ATOMIC_RELAXED) - 1;
+            __atomic_store_n(&this->bottom, b, __ATOMIC_RELAXED);
+            //the store to bottom has to be visible before top is read, or the owner and a thief could both take the
+            //last element
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+            std::int64_t t = __atomic_load_n(&this->top, __ATOMIC_RELAXED);
+
+            if (t > b) {
+                __atomic_store_n(&this->bottom, b + 1, __ATOMIC_RELAXED);
+                return nullptr;
+            }
+
+            T element = load(b);
+            if (t == b) {
+                //the last element: race the thieves for it
+                if (!__atomic_compare_exchange_n(&this->top, &t, t + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+                    element = nullptr;
+                }
+                __atomic_store_n(&this->bottom, b + 1, __ATOMIC_RELAXED);
+            }
+            return element;
+        }
+
+        /**
+         * Takes the element at the top (the oldest). Can be called by anyone, the owner included.
+         * @return The element, or nullptr if the deque is empty or another thief got it first.
+         */
+        T steal() {
+            std::int64_t t = __atomic_load_n(&this->top, __ATOMIC_ACQUIRE);
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+            const std::int64_t b = __atomic_load_n(&this->bottom, __ATOMIC_ACQUIRE);
+            if (t >= b) {
+                return nullptr;
+            }
+
+            T element = load(t);
+            if (!__atomic_compare_exchange_n(&this->top, &t, t + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+                return nullptr;
+            }
+            return element;
+        }
+
+        /**
+         * Returns the number of elements; only a hint when other CPUs push or steal at the same time.
+         */
+        [[nodiscard]] std::size_t getSize() const {
+            const std::int64_t b = __atomic_load_n(&this->bottom, __ATOMIC_RELAXED);
+            const std::int64_t t = __atomic_load_n(&this->top, __ATOMIC_RELAXED);
+            return b > t ? static_cast<std::size_t>(b - t) : 0;
+        }
+    };
+} //namespace Scheduler
+
+#endif //SCHEDULER_WORK_STEALING_DEQUE_H
@@ -0,0 +1,55 @@
+#include <cstdint>
+
+#include "scheduler/context.h"
+
+/* The pushes and pops are the same on both sides, so a context is only its stack pointer. A new context starts in
+ * contextStart, which finds the entry and its argument where prepareContext put r13 and r12. */
+asm(R"(
+.pushsection .text
+.global switchContext
+.type switchContext, @function
+switchContext:
+    push %rbp
+    push %rbx
+    push %r12
+    push %r13
+    push %r14
+    push %r15
+    mov %rsp, (%rdi)
+    mov %rsi, %rsp
+    pop %r15
+    pop %r14
+    pop %r13
+    pop %r12
+    pop %rbx
+    pop %rbp
+    ret
+.size switchContext, . - switchContext
+
+.type contextStart, @function
+contextStart:
+    mov %r12, %rdi
+    call *%r13
+    ud2
+.size contextStart, . - contextStart
+.popsection
+)");
+
+extern "C" void contextStart();
+
+namespace Scheduler {
+    void *prepareContext(void *stackTop, const ContextEntry entry, void *argument) {
+        //the ret into contextStart leaves the stack 16-byte aligned, as the ABI wants it before its call
+        auto *frame = reinterpret_cast<std::uint64_t *>(static_cast<char *>(stackTop) - CONTEXT_FRAME_SIZE);
+        frame[0] = 0; //r15
+        frame[1] = 0; //r14
+        frame[2] = reinterpret_cast<std::uint64_t>(entry); //r13
+        frame[3] = reinterpret_cast<std::uint64_t>(argument); //r12
+        frame[4] = 0; //rbx
+        frame[5] = 0; //rbp, so stack traces end here
+        frame[6] = reinterpret_cast<std::uint64_t>(contextStart);
+        frame[7] = 0;
+        frame[8] = 0;
+        return frame;
+    }
+} //namespace Scheduler
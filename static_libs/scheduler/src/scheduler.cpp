@@ -0,0 +1,510 @@
+#include "scheduler/scheduler.h"
+
+#include "scheduler/context.h"
+#include "scheduler/work_stealing_deque.h"
+
+namespace Scheduler {
+    /**
+     * What finishSwitch does with the thread that was switched away from.
+     */
+    enum class SwitchReason : std::uint32_t {
+        /**
+         * Nothing: it's the idle loop, which is never queued.
+         */
+        None,
+        Requeue,
+        Block,
+        Exit,
+    };
+
+    struct alignas(64) Cpu {
+        WorkStealingDeque<Thread *, RUN_QUEUE_CAPACITY> runQueue;
+        /**
+         * The threads other CPUs handed to this one, most recent first, linked through nextInInbox.
+         */
+        alignas(64) Thread *inbox;
+
+        //only touched by the CPU itself
+        alignas(64) Thread *current;
+        Thread *previous;
+        SwitchReason previousReason;
+        std::uint64_t randomState;
+        Statistics statistics;
+        /**
+         * Stands for the context run was called in.
+         */
+        Thread idleThread;
+    };
+
+    static_assert(MAX_CPUS <= 64, "the idle CPUs are a 64-bit mask");
+
+    static constinit Hooks activeHooks = {};
+    static constinit Cpu cpus[MAX_CPUS] = {};
+    /**
+     * One more than the highest CPU index seen, so the thieves only look at CPUs that can have threads.
+     */
+    static constinit unsigned cpuCount = 0;
+    /**
+     * The CPUs in (or about to be in) waitForWork.
+     */
+    static constinit std::uint64_t idleCpus = 0;
+    static constinit bool isStopping = false;
+
+    static void finishSwitch();
+
+    static unsigned getCpuIndex() {
+        return activeHooks.getCpuIndex();
+    }
+
+    static void noteCpu(const unsigned index) {
+        unsigned count = __atomic_load_n(&cpuCount, __ATOMIC_RELAXED);
+        while (count <= index
+               && !__atomic_compare_exchange_n(
+                   &cpuCount, &count, index + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        }
+    }
+
+    static std::uint64_t nextRandom(Cpu &cpu) {
+        //xorshift64: the victims only have to be spread, not unpredictable
+        std::uint64_t x = cpu.randomState;
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        cpu.randomState = x;
+        return x;
+    }
+
+    /**
+     * Gets a CPU out of waitForWork if it's in it, after something was handed to it.
+     */
+    static void notifyCpu(const unsigned index) {
+        //pairs with the fence in run: either this sees the CPU idle, or the CPU sees the new thread
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if ((__atomic_load_n(&idleCpus, __ATOMIC_RELAXED) & (1ULL << index)) != 0) {
+            activeHooks.wakeCpu(index);
+        }
+    }
+
+    /**
+     * Gets one idle CPU other than self out of waitForWork, so it can steal the thread self just queued.
+     */
+    static void notifyThief(const unsigned self) {
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        const std::uint64_t idleMask = __atomic_load_n(&idleCpus, __ATOMIC_RELAXED) & ~(1ULL << self);
+        if (idleMask != 0) {
+            activeHooks.wakeCpu(static_cast<unsigned>(__builtin_ctzll(idleMask)));
+        }
+    }
+
+    static void pushInbox(Cpu &cpu, Thread *thread) {
+        Thread *head = __atomic_load_n(&cpu.inbox, __ATOMIC_RELAXED);
+        do {
+            thread->nextInInbox = head;
+        } while (!__atomic_compare_exchange_n(&cpu.inbox, &head, thread, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    }
+
+    /**
+     * Queues a ready thread on the current CPU.
+     */
+    static void pushLocal(Cpu &cpu, const unsigned self, Thread *thread) {
+        if (!cpu.runQueue.push(thread)) {
+            pushInbox(cpu, thread);
+        }
+        notifyThief(self);
+    }
+
+    /**
+     * Moves the inbox into the deque, oldest first, where the thieves can see it.
+     */
+    static void drainInbox(Cpu &cpu) {
+        Thread *thread = __atomic_exchange_n(&cpu.inbox, nullptr, __ATOMIC_ACQUIRE);
+
+        Thread *oldestFirst = nullptr;
+        while (thread != nullptr) {
+            Thread *next = thread->nextInInbox;
+            thread->nextInInbox = oldestFirst;
+            oldestFirst = thread;
+            thread = next;
+        }
+
+        while (oldestFirst != nullptr) {
+            Thread *next = oldestFirst->nextInInbox;
+            if (!cpu.runQueue.push(oldestFirst)) {
+                pushInbox(cpu, oldestFirst);
+            }
+            oldestFirst = next;
+        }
+    }
+
+    /**
+     * Takes the next thread to run: from the CPU's own queue, oldest first (popping the newest would let a preempted
+     * thread run again right away), else from another CPU's.
+     * @return nullptr if there's no ready thread anywhere.
+     */
+    static Thread *findWork(Cpu &cpu, const unsigned self) {
+        if (__atomic_load_n(&cpu.inbox, __ATOMIC_RELAXED) != nullptr) {
+            drainInbox(cpu);
+        }
+
+        Thread *thread = cpu.runQueue.steal();
+        if (thread != nullptr) {
+            return thread;
+        }
+
+        const unsigned count = __atomic_load_n(&cpuCount, __ATOMIC_RELAXED);
+        if (count < 2) {
+            return nullptr;
+        }
+        const unsigned first = static_cast<unsigned>(nextRandom(cpu) % count);
+        for (unsigned i = 0; i < count; i++) {
+            const unsigned victim = (first + i) % count;
+            if (victim == self) {
+                continue;
+            }
+
+            thread = cpus[victim].runQueue.steal();
+            if (thread != nullptr) {
+                cpu.statistics.stealCount++;
+                return thread;
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * Switches from the current thread to next, and returns once the current thread runs again (maybe on another
+     * CPU). Interrupts must be disabled.
+     */
+    static void switchTo(Cpu &cpu, Thread *current, Thread *next, const SwitchReason reason) {
+        cpu.previous = current;
+        cpu.previousReason = reason;
+        cpu.current = next;
+        cpu.statistics.switchCount++;
+
+        __atomic_store_n(&next->state, ThreadState::Running, __ATOMIC_RELAXED);
+        next->lastCpu = static_cast<unsigned>(&cpu - cpus);
+        next->ticks = 0;
+        if (activeHooks.switchingTo != nullptr) {
+            activeHooks.switchingTo(next);
+        }
+
+        switchContext(&current->stackPointer, next->stackPointer);
+        finishSwitch();
+    }
+
+    /**
+     * Runs on the thread that was just switched to, and deals with the one that was switched away from, whose stack
+     * is no longer in use.
+     */
+    static void finishSwitch() {
+        const unsigned self = getCpuIndex();
+        Cpu &cpu = cpus[self];
+        Thread *previous = cpu.previous;
+        cpu.previous = nullptr;
+
+        switch (cpu.previousReason) {
+            case SwitchReason::None:
+                break;
+            case SwitchReason::Requeue:
+                __atomic_store_n(&previous->state, ThreadState::Ready, __ATOMIC_RELAXED);
+                pushLocal(cpu, self, previous);
+                break;
+            case SwitchReason::Block: {
+                ThreadState expected = ThreadState::Blocking;
+                if (!__atomic_compare_exchange_n(&previous->state, &expected, ThreadState::Blocked, false,
+                                                 __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                    //woken before it got off the CPU: the wake left it to this
+                    __atomic_store_n(&previous->state, ThreadState::Ready, __ATOMIC_RELAXED);
+                    pushLocal(cpu, self, previous);
+                }
+                break;
+            }
+            case SwitchReason::Exit:
+                activeHooks.threadExited(previous);
+                break;
+        }
+    }
+
+    /**
+     * Switches to another ready thread if there's one, keeping the current one ready. Interrupts must be disabled.
+     * @return False if there was nothing else to run.
+     */
+    static bool reschedule() {
+        const unsigned self = getCpuIndex();
+        Cpu &cpu = cpus[self];
+        Thread *next = findWork(cpu, self);
+        if (next == nullptr) {
+            return false;
+        }
+
+        switchTo(cpu, cpu.current, next, SwitchReason::Requeue);
+        return true;
+    }
+
+    [[noreturn]] static void threadEntry(void *argument) {
+        finishSwitch();
+        activeHooks.restoreInterrupts(true);
+
+        const Thread *thread = static_cast<const Thread *>(argument);
+        thread->function(thread->argument);
+        exit();
+    }
+
+    void init(const Hooks &hooks) {
+        activeHooks = hooks;
+        cpuCount = 0;
+        idleCpus = 0;
+        isStopping = false;
+        for (Cpu &cpu : cpus) {
+            cpu.statistics = {};
+        }
+    }
+
+    void initThread(
+        Thread *thread,
+        void *stackBase,
+        const std::size_t stackSize,
+        const ThreadFunction function,
+        void *argument,
+        const char *name) {
+        *thread = {};
+        thread->stackBase = stackBase;
+        thread->stackSize = stackSize;
+        thread->function = function;
+        thread->argument = argument;
+        thread->name = name;
+
+        const std::uintptr_t stackEnd = reinterpret_cast<std::uintptr_t>(stackBase) + stackSize;
+        const std::uintptr_t stackTop = stackEnd & ~static_cast<std::uintptr_t>(15);
+        thread->stackPointer = prepareContext(reinterpret_cast<void *>(stackTop), threadEntry, thread);
+    }
+
+    void start(Thread *thread, const unsigned cpuIndex) {
+        const bool wereEnabled = activeHooks.disableInterrupts();
+        noteCpu(cpuIndex);
+        thread->lastCpu = cpuIndex;
+        __atomic_store_n(&thread->state, ThreadState::Ready, __ATOMIC_RELAXED);
+
+        const unsigned self = getCpuIndex();
+        if (cpuIndex == self) {
+            pushLocal(cpus[self], self, thread);
+        } else {
+            pushInbox(cpus[cpuIndex], thread);
+            notifyCpu(cpuIndex);
+        }
+        activeHooks.restoreInterrupts(wereEnabled);
+    }
+
+    void run() {
+        const bool wereEnabled = activeHooks.disableInterrupts();
+        const unsigned self = getCpuIndex();
+        noteCpu(self);
+
+        Cpu &cpu = cpus[self];
+        Thread &idleThread = cpu.idleThread;
+        idleThread = {};
+        idleThread.name = "idle";
+        idleThread.state = ThreadState::Running;
+        idleThread.lastCpu = self;
+        idleThread.isIdle = true;
+        cpu.current = &idleThread;
+        cpu.randomState = 0x9E3779B97F4A7C15 * (self + 1);
+
+        const std::uint64_t selfBit = 1ULL << self;
+        while (true) {
+            Thread *next = findWork(cpu, self);
+            if (next == nullptr) {
+                if (__atomic_load_n(&isStopping, __ATOMIC_ACQUIRE)) {
+                    break;
+                }
+
+                //announce the CPU idle before looking one last time, so a thread queued meanwhile isn't missed
+                __atomic_fetch_or(&idleCpus, selfBit, __ATOMIC_SEQ_CST);
+                next = findWork(cpu, self);
+                if (next == nullptr && !__atomic_load_n(&isStopping, __ATOMIC_ACQUIRE)) {
+                    activeHooks.waitForWork();
+                }
+                __atomic_fetch_and(&idleCpus, ~selfBit, __ATOMIC_SEQ_CST);
+            }
+
+            if (next != nullptr) {
+                //the idle thread is only ever switched back to by its own CPU
+                switchTo(cpu, &idleThread, next, SwitchReason::None);
+            }
+        }
+
+        cpu.current = nullptr;
+        activeHooks.restoreInterrupts(wereEnabled);
+    }
+
+    void stop() {
+        __atomic_store_n(&isStopping, true, __ATOMIC_RELEASE);
+
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        std::uint64_t idleMask = __atomic_load_n(&idleCpus, __ATOMIC_RELAXED);
+        while (idleMask != 0) {
+            activeHooks.wakeCpu(static_cast<unsigned>(__builtin_ctzll(idleMask)));
+            idleMask &= idleMask - 1;
+        }
+    }
+
+    Thread *getCurrentThread() {
+        if (activeHooks.getCpuIndex == nullptr) {
+            return nullptr;
+        }
+
+        const bool wereEnabled = activeHooks.disableInterrupts();
+        Thread *current = cpus[getCpuIndex()].current;
+        activeHooks.restoreInterrupts(wereEnabled);
+        return current;
+    }
+
+    void yield() {
+        const bool wereEnabled = activeHooks.disableInterrupts();
+        const Thread *current = cpus[getCpuIndex()].current;
+        if (current != nullptr && !current->isIdle) {
+            reschedule();
+        }
+        activeHooks.restoreInterrupts(wereEnabled);
+    }
+
+    void prepareToBlock() {
+        Thread *current = getCurrentThread();
+        __atomic_store_n(&current->state, ThreadState::Blocking, __ATOMIC_RELAXED);
+        //the caller's check of what it waits for must not be done before this is visible to the wakers
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    }
+
+    void block() {
+        const bool wereEnabled = activeHooks.disableInterrupts();
+        const unsigned self = getCpuIndex();
+        Cpu &cpu = cpus[self];
+        Thread *current = cpu.current;
+
+        //a wake since prepareToBlock already put it back to Running
+        if (__atomic_load_n(&current->state, __ATOMIC_ACQUIRE) == ThreadState::Blocking) {
+            Thread *next = findWork(cpu, self);
+            switchTo(cpu, current, next != nullptr ? next : &cpu.idleThread, SwitchReason::Block);
+        }
+        activeHooks.restoreInterrupts(wereEnabled);
+    }
+
+    void cancelBlock() {
+        Thread *current = getCurrentThread();
+        //a wake meanwhile makes the same change
+        __atomic_store_n(&current->state, ThreadState::Running, __ATOMIC_RELAXED);
+    }
+
+    bool wake(Thread *thread) {
+        ThreadState state = __atomic_load_n(&thread->state, __ATOMIC_ACQUIRE);
+        while (true) {
+            if (state == ThreadState::Blocking) {
+                //still on its CPU: block won't switch away, or finishSwitch will queue it
+                if (__atomic_compare_exchange_n(&thread->state, &state, ThreadState::Running, true, __ATOMIC_ACQ_REL,
+                                                __ATOMIC_ACQUIRE)) {
+                    return true;
+                }
+            } else if (state == ThreadState::Blocked) {
+                if (__atomic_compare_exchange_n(&thread->state, &state, ThreadState::Ready, true, __ATOMIC_ACQ_REL,
+                                                __ATOMIC_ACQUIRE)) {
+                    break;
+                }
+            } else {
+                return false;
+            }
+        }
+
+        const bool wereEnabled = activeHooks.disableInterrupts();
+        const unsigned self = getCpuIndex();
+        Cpu &cpu = cpus[self];
+
+        //back to where its data may still be cached, unless that CPU is clearly busier than this one
+        unsigned target = thread->lastCpu;
+        if (target != self
+            && cpus[target].runQueue.getSize() >= cpu.runQueue.getSize() + AFFINITY_QUEUE_SLACK) {
+            target = self;
+        }
+
+        if (target == self) {
+            pushLocal(cpu, self, thread);
+        } else {
+            pushInbox(cpus[target], thread);
+            notifyCpu(target);
+        }
+        activeHooks.restoreInterrupts(wereEnabled);
+        return true;
+    }
+
+    void exit() {
+        activeHooks.disableInterrupts();
+        const unsigned self = getCpuIndex();
+        Cpu &cpu = cpus[self];
+        Thread *current = cpu.current;
+        __atomic_store_n(&current->state, ThreadState::Exited, __ATOMIC_RELAXED);
+
+        Thread *next = findWork(cpu, self);
+        switchTo(cpu, current, next != nullptr ? next : &cpu.idleThread, SwitchReason::Exit);
+        __builtin_unreachable();
+    }
+
+    void onTick() {
+        Cpu &cpu = cpus[getCpuIndex()];
+        Thread *current = cpu.current;
+        //the idle loop looks for threads by itself once the interrupt wakes it up
+        if (current == nullptr || current->isIdle) {
+            return;
+        }
+
+        //the threads handed to this CPU become visible to the thieves, even if the current thread runs on
+        if (__atomic_load_n(&cpu.inbox, __ATOMIC_RELAXED) != nullptr) {
+            drainInbox(cpu);
+        }
+
+        if (++current->ticks < TIME_SLICE_TICKS) {
+            return;
+        }
+        if (current->preemptionDisabled != 0) {
+            current->isPreemptionPending = true;
+            return;
+        }
+
+        if (reschedule()) {
+            //counted on the CPU the thread comes back on, which is the same for the totals
+            cpus[getCpuIndex()].statistics.preemptionCount++;
+        }
+    }
+
+    void disablePreemption() {
+        if (activeHooks.getCpuIndex == nullptr) {
+            return;
+        }
+
+        const bool wereEnabled = activeHooks.disableInterrupts();
+        Thread *current = cpus[getCpuIndex()].current;
+        if (current != nullptr) {
+            current->preemptionDisabled++;
+        }
+        activeHooks.restoreInterrupts(wereEnabled);
+    }
+
+    void enablePreemption() {
+        if (activeHooks.getCpuIndex == nullptr) {
+            return;
+        }
+
+        const bool wereEnabled = activeHooks.disableInterrupts();
+        Thread *current = cpus[getCpuIndex()].current;
+        if (current != nullptr && current->preemptionDisabled != 0 && --current->preemptionDisabled == 0
+            && current->isPreemptionPending) {
+            current->isPreemptionPending = false;
+            if (!current->isIdle) {
+                reschedule();
+            }
+        }
+        activeHooks.restoreInterrupts(wereEnabled);
+    }
+
+    Statistics getStatistics(const unsigned cpuIndex) {
+        return cpus[cpuIndex].statistics;
+    }
+} //namespace Scheduler
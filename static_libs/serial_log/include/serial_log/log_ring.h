@@ -0,0 +1,95 @@
+#ifndef SERIAL_LOG_LOG_RING_H
+#define SERIAL_LOG_LOG_RING_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace SerialLog {
+    /**
+     * Sends bytes somewhere without waiting (e.g. Uart16550::tryTransmit).
+     * @return The number of bytes taken, which may be less than size (or 0 if the output is busy).
+     */
+    typedef std::size_t (*TransmitFunction)(const char *data, std::size_t size, void *context);
+
+    enum class DrainResult {
+        /**
+         * Everything that was appended was transmitted.
+         */
+        Empty,
+        /**
+         * The output stopped taking bytes; the rest stays in the ring for the next drain.
+         */
+        Blocked,
+        /**
+         * The oldest message is still being written by its producer.
+         */
+        Pending,
+        /**
+         * Another CPU is draining the ring.
+         */
+        Busy,
+    };
+
+    /**
+     * A byte ring for log messages, which any number of CPUs append to without locks or waiting, and one drainer at a
+     * time empties. Every message is a record (an 8-byte header, then the bytes), so messages from several CPUs never
+     * get mixed up.
+     *
+     * An appender reserves its record by moving the head with a single compare-and-swap, copies its bytes, then
+     * publishes the header. The drainer only goes as far as the first unpublished header, and zeroes what it consumed
+     * before giving the space back (a zero header means "not published yet"). If the ring is full, the message is
+     * dropped and counted instead of waiting for the output, so logging from a hot path never spins on the UART.
+     */
+    class alignas(64) LogRing {
+        std::uint64_t *storage;
+        std::size_t capacity;
+
+        /**
+         * The end of the reserved records, as a byte count that only grows (the position is head % capacity).
+         */
+        alignas(64) std::uint64_t head;
+        std::uint64_t droppedCount;
+
+        //only touched by the drainer
+        alignas(64) std::uint64_t tail;
+        std::uint64_t readOffset;
+        std::uint32_t drainLock;
+
+        [[nodiscard]] char *bytesAt(std::uint64_t position) const;
+        [[nodiscard]] std::uint64_t *headerAt(std::uint64_t position) const;
+
+    public:
+        static constexpr std::size_t HEADER_SIZE = sizeof(std::uint64_t);
+
+        /**
+         * @param storage At least capacity bytes, 8-byte aligned.
+         * @param capacity The size of the storage in bytes, a power of two (and at least 64). It must start zeroed.
+         */
+        constexpr LogRing(std::uint64_t *storage, const std::size_t capacity)
+            : storage(storage), capacity(capacity), head(0), droppedCount(0), tail(0), readOffset(0), drainLock(0) {}
+
+        /**
+         * Appends a message. Safe to call from any number of CPUs at once (and from an interrupt handler).
+         * @return False if there wasn't enough room, in which case the message was dropped.
+         */
+        bool append(const char *data, std::size_t size);
+
+        /**
+         * Transmits the published messages, oldest first, until the output stops taking bytes. A message can be
+         * transmitted over several drains. Doesn't wait: if another CPU is draining, returns Busy right away.
+         */
+        DrainResult drain(TransmitFunction transmit, void *context);
+
+        /**
+         * Returns whether everything that was reserved was transmitted.
+         */
+        [[nodiscard]] bool isEmpty() const;
+
+        /**
+         * Returns the number of messages dropped because the ring was full.
+         */
+        [[nodiscard]] std::uint64_t getDroppedCount() const;
+    };
+} //namespace SerialLog
+
+#endif //SERIAL_LOG_LOG_RING_H
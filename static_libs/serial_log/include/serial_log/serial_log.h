@@ -0,0 +1,50 @@
+#ifndef SERIAL_LOG_SERIAL_LOG_H
+#define SERIAL_LOG_SERIAL_LOG_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "log_ring.h"
+#include "uart_16550.h"
+
+/**
+ * Logging to a serial port, shared by the bootloader and the kernel. A message goes into a LogRing, then whatever the
+ * UART takes right away is sent: writing never waits for the serial line, and what doesn't fit in the FIFO goes out on
+ * a later write, drain or flush.
+ */
+namespace SerialLog {
+    /**
+     * Initializes the UART and starts logging to it through the ring. Until then, writes are ignored.
+     */
+    void init(LogRing *ring, Uart16550 uart);
+
+    /**
+     * Logs the bytes as one message, which is never mixed up with the messages of other CPUs.
+     * @return False if the message was dropped (the ring is full, or logging isn't initialized).
+     */
+    bool write(const char *data, std::size_t size);
+
+    /**
+     * Logs a null-terminated string as one message.
+     */
+    bool print(const char *string);
+
+    /**
+     * Sends as much of the ring as the UART takes without waiting.
+     */
+    DrainResult drain();
+
+    /**
+     * Sends everything in the ring, waiting for the UART. For the places that can't count on a later drain (a halt or
+     * a panic, or before handing the UART over). Returns once the transmit FIFO is empty too. Gives up on a message
+     * that is still being written, since its producer may be the code that was interrupted.
+     */
+    void flush();
+
+    /**
+     * Returns the number of messages dropped because the ring was full.
+     */
+    std::uint64_t getDroppedCount();
+} //namespace SerialLog
+
+#endif //SERIAL_LOG_SERIAL_LOG_H
@@ -0,0 +1,51 @@
+#ifndef SERIAL_LOG_UART_16550_H
+#define SERIAL_LOG_UART_16550_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace SerialLog {
+    /**
+     * The I/O port of the first serial port. Under QEMU, it's what run_qemu.sh writes to debug.log.
+     */
+    constexpr std::uint16_t COM1_PORT = 0x3F8;
+
+    /**
+     * A 16550 UART, driven by polling (its interrupts stay disabled).
+     */
+    class Uart16550 {
+        std::uint16_t port;
+
+    public:
+        /**
+         * The size of the transmit FIFO: once the UART reports it empty, this many bytes can be written in a row.
+         */
+        static constexpr std::size_t FIFO_SIZE = 16;
+
+        constexpr explicit Uart16550(const std::uint16_t port) : port(port) {}
+
+        /**
+         * Sets the UART to 115200 baud, 8N1, with its FIFOs enabled and cleared.
+         */
+        void init() const;
+
+        /**
+         * Returns whether the transmit FIFO is empty.
+         */
+        [[nodiscard]] bool isTransmitReady() const;
+
+        /**
+         * Writes as much of the data as the transmit FIFO takes without waiting: nothing if it isn't empty yet, up to
+         * FIFO_SIZE bytes otherwise.
+         * @return The number of bytes written.
+         */
+        std::size_t tryTransmit(const char *data, std::size_t size) const;
+
+        /**
+         * Writes all the data, waiting for the transmit FIFO whenever it's full.
+         */
+        void transmit(const char *data, std::size_t size) const;
+    };
+} //namespace SerialLog
+
+#endif //SERIAL_LOG_UART_16550_H
@@ -0,0 +1,105 @@
+#include "serial_log/log_ring.h"
+
+namespace SerialLog {
+    /**
+     * Set in every published header, so that an empty message still has a non-zero one.
+     */
+    static constexpr std::uint64_t HEADER_PUBLISHED = 1ULL << 63;
+
+    /**
+     * Records are padded to the header size, so a header never wraps around the end of the ring.
+     */
+    static constexpr std::size_t getRecordSize(const std::size_t size) {
+        return LogRing::HEADER_SIZE + ((size + LogRing::HEADER_SIZE - 1) & ~(LogRing::HEADER_SIZE - 1));
+    }
+
+    char *LogRing::bytesAt(const std::uint64_t position) const {
+        return reinterpret_cast<char *>(this->storage) + (position & (this->capacity - 1));
+    }
+
+    std::uint64_t *LogRing::headerAt(const std::uint64_t position) const {
+        return this->storage + (position & (this->capacity - 1)) / HEADER_SIZE;
+    }
+
+    bool LogRing::append(const char *data, const std::size_t size) {
+        const std::size_t recordSize = getRecordSize(size);
+        if (recordSize > this->capacity) {
+            __atomic_fetch_add(&this->droppedCount, 1, __ATOMIC_RELAXED);
+            return false;
+        }
+
+        std::uint64_t position = __atomic_load_n(&this->head, __ATOMIC_RELAXED);
+        do {
+            //acquire: the drainer zeroed the space before giving it back
+            const std::uint64_t tail = __atomic_load_n(&this->tail, __ATOMIC_ACQUIRE);
+            if (position + recordSize - tail > this->capacity) {
+                __atomic_fetch_add(&this->droppedCount, 1, __ATOMIC_RELAXED);
+                return false;
+            }
+        } while (!__atomic_compare_exchange_n(
+            &this->head, &position, position + recordSize, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+        for (std::size_t i = 0; i < size; i++) {
+            *bytesAt(position + HEADER_SIZE + i) = data[i];
+        }
+        __atomic_store_n(headerAt(position), size | HEADER_PUBLISHED, __ATOMIC_RELEASE);
+        return true;
+    }
+
+    DrainResult LogRing::drain(const TransmitFunction transmit, void *context) {
+        if (__atomic_exchange_n(&this->drainLock, 1, __ATOMIC_ACQUIRE) != 0) {
+            return DrainResult::Busy;
+        }
+
+        DrainResult result;
+        for (;;) {
+            const std::uint64_t tail = this->tail;
+            const std::uint64_t header = __atomic_load_n(headerAt(tail), __ATOMIC_ACQUIRE);
+            if (header == 0) {
+                const bool isReserved = __atomic_load_n(&this->head, __ATOMIC_RELAXED) != tail;
+                result = isReserved ? DrainResult::Pending : DrainResult::Empty;
+                break;
+            }
+
+            const std::size_t size = header & ~HEADER_PUBLISHED;
+            bool isBlocked = false;
+            while (this->readOffset < size) {
+                //the bytes are sent in pieces that don't wrap around the end of the ring
+                const std::uint64_t position = tail + HEADER_SIZE + this->readOffset;
+                const std::size_t untilEnd = this->capacity - (position & (this->capacity - 1));
+                const std::size_t remaining = size - this->readOffset;
+                const std::size_t pieceSize = remaining < untilEnd ? remaining : untilEnd;
+
+                const std::size_t sent = transmit(bytesAt(position), pieceSize, context);
+                this->readOffset += sent;
+                if (sent < pieceSize) {
+                    isBlocked = true;
+                    break;
+                }
+            }
+            if (isBlocked) {
+                result = DrainResult::Blocked;
+                break;
+            }
+
+            //any word of the record can be the header of a later one, so all of it goes back to zero
+            const std::size_t recordSize = getRecordSize(size);
+            for (std::size_t offset = 0; offset < recordSize; offset += HEADER_SIZE) {
+                __atomic_store_n(headerAt(tail + offset), 0, __ATOMIC_RELAXED);
+            }
+            this->readOffset = 0;
+            __atomic_store_n(&this->tail, tail + recordSize, __ATOMIC_RELEASE);
+        }
+
+        __atomic_store_n(&this->drainLock, 0, __ATOMIC_RELEASE);
+        return result;
+    }
+
+    bool LogRing::isEmpty() const {
+        return __atomic_load_n(&this->tail, __ATOMIC_ACQUIRE) == __atomic_load_n(&this->head, __ATOMIC_ACQUIRE);
+    }
+
+    std::uint64_t LogRing::getDroppedCount() const {
+        return __atomic_load_n(&this->droppedCount, __ATOMIC_RELAXED);
+    }
+} //namespace SerialLog
@@ -0,0 +1,71 @@
+#include "serial_log/serial_log.h"
+
+namespace SerialLog {
+    static LogRing *activeRing = nullptr;
+    static Uart16550 activeUart(COM1_PORT);
+
+    static std::size_t transmitToUart(const char *data, const std::size_t size, void *context) {
+        return static_cast<const Uart16550 *>(context)->tryTransmit(data, size);
+    }
+
+    void init(LogRing *ring, const Uart16550 uart) {
+        uart.init();
+        activeUart = uart;
+        __atomic_store_n(&activeRing, ring, __ATOMIC_RELEASE);
+    }
+
+    bool write(const char *data, const std::size_t size) {
+        LogRing *ring = __atomic_load_n(&activeRing, __ATOMIC_ACQUIRE);
+        if (ring == nullptr) {
+            return false;
+        }
+
+        const bool isAppended = ring->append(data, size);
+        ring->drain(transmitToUart, &activeUart);
+        return isAppended;
+    }
+
+    bool print(const char *string) {
+        std::size_t length = 0;
+        while (string[length] != '\0') {
+            length++;
+        }
+        return write(string, length);
+    }
+
+    DrainResult drain() {
+        LogRing *ring = __atomic_load_n(&activeRing, __ATOMIC_ACQUIRE);
+        if (ring == nullptr) {
+            return DrainResult::Empty;
+        }
+        return ring->drain(transmitToUart, &activeUart);
+    }
+
+    static void pause() {
+#if __x86_64__
+        asm volatile("pause");
+#endif
+    }
+
+    void flush() {
+        if (__atomic_load_n(&activeRing, __ATOMIC_ACQUIRE) == nullptr) {
+            return;
+        }
+
+        DrainResult result = drain();
+        while (result == DrainResult::Blocked || result == DrainResult::Busy) {
+            pause();
+            result = drain();
+        }
+
+        //the last bytes may still be in the FIFO, where setting the UART up again would clear them
+        while (!activeUart.isTransmitReady()) {
+            pause();
+        }
+    }
+
+    std::uint64_t getDroppedCount() {
+        const LogRing *ring = __atomic_load_n(&activeRing, __ATOMIC_ACQUIRE);
+        return ring != nullptr ? ring->getDroppedCount() : 0;
+    }
+} //namespace SerialLog
@@ -0,0 +1,68 @@
+#include "serial_log/uart_16550.h"
+
+namespace SerialLog {
+    //the registers, as offsets from the port
+    static constexpr std::uint16_t DATA = 0;
+    static constexpr std::uint16_t INTERRUPT_ENABLE = 1;
+    static constexpr std::uint16_t FIFO_CONTROL = 2;
+    static constexpr std::uint16_t LINE_CONTROL = 3;
+    static constexpr std::uint16_t MODEM_CONTROL = 4;
+    static constexpr std::uint16_t LINE_STATUS = 5;
+
+    /**
+     * With LINE_CONTROL_DLAB set, the first two registers are the divisor of the 115200 Hz base clock.
+     */
+    static constexpr std::uint8_t LINE_CONTROL_DLAB = 0x80;
+    static constexpr std::uint8_t LINE_CONTROL_8N1 = 0x03;
+    static constexpr std::uint8_t FIFO_ENABLE_AND_CLEAR = 0xC7;
+    static constexpr std::uint8_t MODEM_DTR_RTS_OUT2 = 0x0B;
+    /**
+     * Set when the transmit FIFO (not just its holding register) is empty.
+     */
+    static constexpr std::uint8_t LINE_STATUS_TRANSMIT_EMPTY = 0x20;
+
+    static void outByte(const std::uint16_t port, const std::uint8_t value) {
+        asm volatile("outb %0, %1" : : "a"(value), "Nd"(port));
+    }
+
+    static std::uint8_t inByte(const std::uint16_t port) {
+        std::uint8_t value;
+        asm volatile("inb %1, %0" : "=a"(value) : "Nd"(port));
+        return value;
+    }
+
+    void Uart16550::init() const {
+        outByte(this->port + INTERRUPT_ENABLE, 0);
+        outByte(this->port + LINE_CONTROL, LINE_CONTROL_DLAB);
+        outByte(this->port + DATA, 1);
+        outByte(this->port + INTERRUPT_ENABLE, 0);
+        outByte(this->port + LINE_CONTROL, LINE_CONTROL_8N1);
+        outByte(this->port + FIFO_CONTROL, FIFO_ENABLE_AND_CLEAR);
+        outByte(this->port + MODEM_CONTROL, MODEM_DTR_RTS_OUT2);
+    }
+
+    bool Uart16550::isTransmitReady() const {
+        return (inByte(this->port + LINE_STATUS) & LINE_STATUS_TRANSMIT_EMPTY) != 0;
+    }
+
+    std::size_t Uart16550::tryTransmit(const char *data, const std::size_t size) const {
+        //port reads are slow (a VM exit under QEMU), so the status is read once per FIFO, not once per byte
+        if (!isTransmitReady()) {
+            return 0;
+        }
+
+        const std::size_t count = size < FIFO_SIZE ? size : FIFO_SIZE;
+        for (std::size_t i = 0; i < count; i++) {
+            outByte(this->port + DATA, static_cast<std::uint8_t>(data[i]));
+        }
+        return count;
+    }
+
+    void Uart16550::transmit(const char *data, std::size_t size) const {
+        while (size != 0) {
+            const std::size_t written = tryTransmit(data, size);
+            data += written;
+            size -= written;
+        }
+    }
+} //namespace SerialLog
@@ -0,0 +1,41 @@
+#ifndef SLAB_HEAP_H
+#define SLAB_HEAP_H
+
+#include <cstddef>
+
+#include "object_cache.h"
+
+/**
+ * A general-purpose heap (what operator new and delete use) on top of the object caches: one cache per size class, 4
+ * classes per power of two from 16 B to 2 KiB, so at most 25% of an allocation is wasted. Larger allocations get their
+ * own run of slabs from the page source.
+ */
+namespace Slab {
+    /**
+     * @return Memory aligned to MIN_ALIGNMENT, or nullptr if there's no memory left. A size of 0 gives a unique
+     * pointer, like operator new.
+     */
+    [[nodiscard]] void *allocate(std::size_t size);
+
+    /**
+     * Frees memory from allocate. Does nothing for nullptr.
+     */
+    void free(void *memory);
+
+    /**
+     * Returns the usable size of memory from allocate, which can be more than what was asked for.
+     */
+    [[nodiscard]] std::size_t getAllocationSize(const void *memory);
+
+    /**
+     * Reaps every size-class cache, see ObjectCache::reap.
+     */
+    void reapHeap();
+
+    /**
+     * Drains every size-class cache, see ObjectCache::drain.
+     */
+    void drainHeap();
+} //namespace Slab
+
+#endif //SLAB_HEAP_H
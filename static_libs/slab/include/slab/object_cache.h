@@ -0,0 +1,272 @@
+#ifndef SLAB_OBJECT_CACHE_H
+#define SLAB_OBJECT_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+namespace Slab {
+    /**
+     * Every slab is a block of this size, aligned to its size, so the slab of an object is found by masking its address.
+     */
+    constexpr std::size_t SLAB_SIZE = 16384;
+
+    /**
+     * The space reserved for the header at the start of every slab.
+     */
+    constexpr std::size_t SLAB_HEADER_SIZE = 64;
+
+    /**
+     * Objects are at least aligned to this (like malloc), and their size is rounded up to a multiple of it.
+     */
+    constexpr std::size_t MIN_ALIGNMENT = 16;
+
+    /**
+     * The largest object an ObjectCache can hold: at least 7 of them fit in a slab.
+     */
+    constexpr std::size_t MAX_OBJECT_SIZE = 2048;
+
+    /**
+     * The maximum number of CPUs with their own magazines.
+     */
+    constexpr unsigned MAX_CPUS = 64;
+
+    /**
+     * The number of objects a magazine holds. 14 makes a magazine exactly two cache lines.
+     */
+    constexpr unsigned MAGAZINE_SIZE = 14;
+
+    /**
+     * Returns virtual memory for the slabs.
+     * @param size A multiple of SLAB_SIZE.
+     * @return Memory aligned to SLAB_SIZE (to the power of two above size is fine too, like a buddy allocator gives),
+     * or nullptr.
+     */
+    typedef void *(*PageAllocator)(std::size_t size);
+
+    /**
+     * Gives back memory obtained from the PageAllocator, with the same size.
+     */
+    typedef void (*PageReleaser)(void *pages, std::size_t size);
+
+    /**
+     * Returns the index of the current CPU, below MAX_CPUS.
+     */
+    typedef unsigned (*CpuIndexFunction)();
+
+    /**
+     * Sets where every cache gets its slabs from. Until then, all the allocations fail. Also constructs the caches of
+     * the heap (see heap.h), so it must be called before anything else runs on other CPUs.
+     */
+    void setPageSource(PageAllocator allocator, PageReleaser releaser);
+
+    /**
+     * Sets the function used to find the magazines of the current CPU. Until then, everything uses the ones of CPU 0.
+     */
+    void setCpuIndexFunction(CpuIndexFunction cpuIndexFunction);
+
+    /**
+     * A cache of fixed-size objects, as described by Bonwick ("The Slab Allocator", 1994, and "Magazines and Vmem",
+     * 2001).
+     *
+     * The objects live in slabs of SLAB_SIZE bytes, each one with a free list; the partially used slabs are kept in a
+     * list, and one empty slab is kept around so a cache that oscillates around a slab boundary doesn't keep asking
+     * the page source for memory. The start of the objects is shifted from one slab to the next ("coloring"), so the
+     * same object in different slabs doesn't always land on the same cache sets.
+     *
+     * On top of that, every CPU has two magazines (small stacks of objects): the common allocations and frees only
+     * touch those, so they take no lock and do no atomic operation. Full and empty magazines are exchanged with a
+     * depot when both are exhausted, and only then does the slab layer get involved.
+     *
+     * The constructor is constexpr, so a cache can be a global (in .data) that needs no constructor call at boot. A
+     * default-constructed cache is all zeros (so an array of them is in .bss) and fails every allocation until a real
+     * one is constructed in its place.
+     * allocate and free must not be interrupted by another call on the same CPU (i.e. call them with preemption
+     * disabled, or interrupts for interrupt handlers).
+     */
+    class ObjectCache {
+    public:
+        /**
+         * @param name Shown in the statistics; must stay valid for as long as the cache.
+         * @param objectSize At most MAX_OBJECT_SIZE.
+         * @param alignment A power of two; at least MIN_ALIGNMENT is used.
+         * @param useMagazines False to always go to the slab layer (with its lock). Only for the cache of the
+         * magazines themselves.
+         */
+        constexpr ObjectCache(
+            const char *name,
+            const std::size_t objectSize,
+            const std::size_t alignment = MIN_ALIGNMENT,
+            const bool useMagazines = true)
+            : name(name),
+              alignment(alignment > MIN_ALIGNMENT ? alignment : MIN_ALIGNMENT),
+              objectSize(roundUp(objectSize != 0 ? objectSize : 1, this->alignment)),
+              objectsPerSlab(
+                  (SLAB_SIZE - roundUp(SLAB_HEADER_SIZE, this->alignment)) / this->objectSize),
+              useMagazines(useMagazines) {}
+
+        /**
+         * An unusable cache, to construct a real one over later: it has no magazines and never gets a slab while there
+         * is no page source.
+         */
+        constexpr ObjectCache() : name(nullptr), alignment(0), objectSize(0), objectsPerSlab(0), useMagazines(false) {}
+
+        ObjectCache(const ObjectCache &) = delete;
+        ObjectCache &operator=(const ObjectCache &) = delete;
+
+        /**
+         * @return An uninitialized object, or nullptr if the page source has no memory left.
+         */
+        [[nodiscard]] void *allocate();
+
+        /**
+         * Gives back an object from this cache.
+         */
+        void free(void *object);
+
+        /**
+         * Gives the full magazines of the depot back to the slab layer and releases the empty slabs. To call when
+         * memory gets low.
+         */
+        void reap();
+
+        /**
+         * Gives the objects held by the magazines of every CPU back to the slab layer, then reaps. Only safe when no
+         * other CPU uses this cache at the same time.
+         */
+        void drain();
+
+        [[nodiscard]] const char *getName() const;
+
+        /**
+         * Returns the size of the objects, after rounding.
+         */
+        [[nodiscard]] std::size_t getObjectSize() const;
+
+        /**
+         * Returns the number of slabs currently owned by the cache.
+         */
+        [[nodiscard]] std::size_t getSlabCount() const;
+
+        /**
+         * Returns the number of objects handed out by the slab layer: the ones in use plus the ones in magazines.
+         */
+        [[nodiscard]] std::size_t getAllocatedCount() const;
+
+        /**
+         * Returns the cache an object was allocated from, or nullptr for the large allocations of the heap (see
+         * heap.h).
+         */
+        static ObjectCache *getCacheOf(const void *object);
+
+    private:
+        struct Magazine {
+            Magazine *next;
+            unsigned rounds;
+            void *objects[MAGAZINE_SIZE];
+        };
+
+        //aligned to a cache line, so the magazines of different CPUs never share one
+        struct alignas(64) CpuMagazines {
+            Magazine *loaded = nullptr;
+            Magazine *previous = nullptr;
+        };
+
+        struct SlabHeader;
+
+        const char *name;
+        std::size_t alignment;
+        std::size_t objectSize;
+        std::size_t objectsPerSlab;
+        bool useMagazines;
+
+        std::uint32_t slabLock = 0;
+        SlabHeader *partialSlabs = nullptr;
+        SlabHeader *emptySlab = nullptr;
+        std::size_t slabCount = 0;
+        std::size_t allocatedCount = 0;
+        std::size_t nextColor = 0;
+
+        std::uint32_t depotLock = 0;
+        Magazine *fullMagazines = nullptr;
+        Magazine *emptyMagazines = nullptr;
+
+        bool isRegistered = false;
+        ObjectCache *nextCache = nullptr;
+
+        CpuMagazines cpuMagazines[MAX_CPUS] = {};
+
+        static ObjectCache magazineCache;
+
+        static constexpr std::size_t roundUp(const std::size_t value, const std::size_t alignment) {
+            return (value + alignment - 1) & ~(alignment - 1);
+        }
+
+        /**
+         * The slab layer, under slabLock.
+         */
+        void *allocateFromSlab();
+        void freeToSlab(void *object);
+        SlabHeader *createSlab();
+        static bool isSlabFull(const SlabHeader *slab);
+        void linkPartialSlab(SlabHeader *slab);
+        void unlinkPartialSlab(SlabHeader *slab);
+
+        /**
+         * Gives the objects of a magazine back to the slab layer, then the magazine itself to the magazine cache.
+         */
+        void destroyMagazine(Magazine *magazine);
+
+        /**
+         * Adds the cache to the list walked by visitCaches, the first time it gets a slab.
+         */
+        void registerCache();
+
+        CpuMagazines &getCurrentMagazines();
+
+        friend void visitCaches(void (*visitor)(const ObjectCache &cache, void *context), void *context);
+    };
+
+    /**
+     * Calls visitor for every cache that has allocated at least one slab.
+     */
+    void visitCaches(void (*visitor)(const ObjectCache &cache, void *context), void *context);
+
+    /**
+     * A named cache of objects of type T, constructed and destroyed in place.
+     */
+    template <class T>
+    class TypedCache {
+        static_assert(sizeof(T) <= MAX_OBJECT_SIZE, "the objects of a TypedCache must fit in a slab");
+
+        ObjectCache cache;
+
+    public:
+        constexpr explicit TypedCache(const char *name) : cache(name, sizeof(T), alignof(T)) {}
+
+        /**
+         * @return The new object, or nullptr if there's no memory left.
+         */
+        template <class... Args>
+        [[nodiscard]] T *create(Args &&... args) {
+            void *object = cache.allocate();
+            if (object == nullptr) {
+                return nullptr;
+            }
+            return new(object) T(static_cast<Args &&>(args)...);
+        }
+
+        void destroy(T *object) {
+            if (object != nullptr) {
+                object->~T();
+                cache.free(object);
+            }
+        }
+
+        ObjectCache &getCache() {
+            return cache;
+        }
+    };
+} //namespace Slab
+
+#endif //SLAB_OBJECT_CACHE_H
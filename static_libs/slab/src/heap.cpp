@@ -0,0 +1,125 @@
+#include <cstdint>
+
+#include "slab/heap.h"
+
+#include "slab_internal.h"
+
+namespace Slab {
+    /**
+     * The start of the slabs of a large allocation. Like SlabHeader, the first field is the cache (nullptr here).
+     */
+    struct LargeAllocationHeader {
+        ObjectCache *cache;
+        std::size_t size;
+    };
+
+    //keeps the large allocations aligned to a cache line
+    constexpr std::size_t LARGE_HEADER_SIZE = 64;
+    static_assert(sizeof(LargeAllocationHeader) <= LARGE_HEADER_SIZE);
+
+    constexpr std::size_t SIZE_CLASS_COUNT = 24;
+
+    constexpr std::size_t CLASS_SIZES[SIZE_CLASS_COUNT] = {
+        16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256,
+        320, 384, 448, 512, 640, 768, 896, 1024, 1280, 1536, 1792, 2048,
+    };
+
+    constexpr const char *CLASS_NAMES[SIZE_CLASS_COUNT] = {
+        "heap-16", "heap-32", "heap-48", "heap-64", "heap-80", "heap-96", "heap-112", "heap-128",
+        "heap-160", "heap-192", "heap-224", "heap-256", "heap-320", "heap-384", "heap-448", "heap-512",
+        "heap-640", "heap-768", "heap-896", "heap-1024", "heap-1280", "heap-1536", "heap-1792", "heap-2048",
+    };
+
+    /**
+     * With their per-CPU magazines, the caches are about 100 KiB: they start out zeroed (in .bss rather than in the
+     * image) and are constructed by initHeap.
+     */
+    static constinit ObjectCache sizeClassCaches[SIZE_CLASS_COUNT];
+    static constinit bool isHeapInitialized = false;
+
+    /**
+     * Maps a size in 16-byte units (rounded up) to its size class.
+     */
+    struct SizeClassTable {
+        std::uint8_t classes[MAX_OBJECT_SIZE / MIN_ALIGNMENT + 1];
+
+        constexpr SizeClassTable() : classes() {
+            std::size_t sizeClass = 0;
+            for (std::size_t units = 0; units <= MAX_OBJECT_SIZE / MIN_ALIGNMENT; units++) {
+                while (CLASS_SIZES[sizeClass] < units * MIN_ALIGNMENT) {
+                    sizeClass++;
+                }
+                classes[units] = static_cast<std::uint8_t>(sizeClass);
+            }
+        }
+    };
+
+    static constexpr SizeClassTable SIZE_CLASSES;
+
+    void Internal::initHeap() {
+        if (isHeapInitialized) {
+            return;
+        }
+        for (std::size_t i = 0; i < SIZE_CLASS_COUNT; i++) {
+            new(&sizeClassCaches[i]) ObjectCache(CLASS_NAMES[i], CLASS_SIZES[i]);
+        }
+        isHeapInitialized = true;
+    }
+
+    void *allocate(const std::size_t size) {
+        if (size <= MAX_OBJECT_SIZE) {
+            return sizeClassCaches[SIZE_CLASSES.classes[(size + MIN_ALIGNMENT - 1) / MIN_ALIGNMENT]].allocate();
+        }
+
+        if (size > SIZE_MAX - LARGE_HEADER_SIZE - SLAB_SIZE) {
+            return nullptr;
+        }
+        const std::size_t totalSize = (size + LARGE_HEADER_SIZE + SLAB_SIZE - 1) & ~(SLAB_SIZE - 1);
+        auto *header = static_cast<LargeAllocationHeader *>(Internal::allocatePages(totalSize));
+        if (header == nullptr) {
+            return nullptr;
+        }
+
+        header->cache = nullptr;
+        header->size = totalSize;
+        return reinterpret_cast<std::uint8_t *>(header) + LARGE_HEADER_SIZE;
+    }
+
+    void free(void *memory) {
+        if (memory == nullptr) {
+            return;
+        }
+
+        ObjectCache *cache = ObjectCache::getCacheOf(memory);
+        if (cache != nullptr) {
+            cache->free(memory);
+            return;
+        }
+
+        auto *header = reinterpret_cast<LargeAllocationHeader *>(static_cast<std::uint8_t *>(memory) - LARGE_HEADER_SIZE);
+        Internal::releasePages(header, header->size);
+    }
+
+    std::size_t getAllocationSize(const void *memory) {
+        const ObjectCache *cache = ObjectCache::getCacheOf(memory);
+        if (cache != nullptr) {
+            return cache->getObjectSize();
+        }
+
+        const auto *header = reinterpret_cast<const LargeAllocationHeader *>(
+            static_cast<const std::uint8_t *>(memory) - LARGE_HEADER_SIZE);
+        return header->size - LARGE_HEADER_SIZE;
+    }
+
+    void reapHeap() {
+        for (ObjectCache &cache : sizeClassCaches) {
+            cache.reap();
+        }
+    }
+
+    void drainHeap() {
+        for (ObjectCache &cache : sizeClassCaches) {
+            cache.drain();
+        }
+    }
+} //namespace Slab
@@ -0,0 +1,386 @@
+#include <cstddef>
+
+#include "slab/object_cache.h"
+
+#include "slab_internal.h"
+
+namespace Slab {
+    /**
+     * The start of every slab. The first field has to be the cache, since getCacheOf reads it without knowing whether
+     * the block is a slab or a large allocation.
+     */
+    struct ObjectCache::SlabHeader {
+        ObjectCache *cache;
+        SlabHeader *next;
+        SlabHeader *prev;
+        /**
+         * The objects that were freed, linked through their first word.
+         */
+        void *freeList;
+        /**
+         * The objects from here were never handed out, so the free list doesn't have to be built upfront.
+         */
+        std::uintptr_t unusedStart;
+        std::uintptr_t unusedEnd;
+        std::size_t inUse;
+    };
+
+    static constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+    static PageAllocator pageAllocator = nullptr;
+    static PageReleaser pageReleaser = nullptr;
+    static CpuIndexFunction cpuIndexFunction = nullptr;
+
+    static std::uint32_t registryLock = 0;
+    static ObjectCache *firstCache = nullptr;
+
+    //the magazines themselves come straight from the slab layer (a magazine cache with magazines would recurse)
+    constinit ObjectCache ObjectCache::magazineCache("magazine", sizeof(Magazine), CACHE_LINE_SIZE, false);
+
+    void setPageSource(const PageAllocator allocator, const PageReleaser releaser) {
+        //before the page source, so the heap never gets a slab into a cache that isn't constructed yet
+        Internal::initHeap();
+        pageAllocator = allocator;
+        pageReleaser = releaser;
+    }
+
+    void setCpuIndexFunction(const CpuIndexFunction function) {
+        cpuIndexFunction = function;
+    }
+
+    void *Internal::allocatePages(const std::size_t size) {
+        return pageAllocator != nullptr ? pageAllocator(size) : nullptr;
+    }
+
+    void Internal::releasePages(void *pages, const std::size_t size) {
+        if (pageReleaser != nullptr) {
+            pageReleaser(pages, size);
+        }
+    }
+
+    void *ObjectCache::allocate() {
+        if (!this->useMagazines) {
+            return allocateFromSlab();
+        }
+
+        CpuMagazines &magazines = getCurrentMagazines();
+        for (;;) {
+            if (magazines.loaded != nullptr && magazines.loaded->rounds != 0) {
+                return magazines.loaded->objects[--magazines.loaded->rounds];
+            }
+
+            //the previous magazine is always either full or empty
+            if (magazines.previous != nullptr && magazines.previous->rounds != 0) {
+                Magazine *magazine = magazines.loaded;
+                magazines.loaded = magazines.previous;
+                magazines.previous = magazine;
+                continue;
+            }
+
+            Internal::lock(&this->depotLock);
+            Magazine *full = this->fullMagazines;
+            if (full != nullptr) {
+                this->fullMagazines = full->next;
+                if (magazines.previous != nullptr) {
+                    magazines.previous->next = this->emptyMagazines;
+                    this->emptyMagazines = magazines.previous;
+                }
+                magazines.previous = magazines.loaded;
+                magazines.loaded = full;
+            }
+            Internal::unlock(&this->depotLock);
+
+            if (full == nullptr) {
+                return allocateFromSlab();
+            }
+        }
+    }
+
+    void ObjectCache::free(void *object) {
+        if (object == nullptr) {
+            return;
+        }
+        if (!this->useMagazines) {
+            freeToSlab(object);
+            return;
+        }
+
+        CpuMagazines &magazines = getCurrentMagazines();
+        for (;;) {
+            if (magazines.loaded != nullptr && magazines.loaded->rounds != MAGAZINE_SIZE) {
+                magazines.loaded->objects[magazines.loaded->rounds++] = object;
+                return;
+            }
+
+            if (magazines.previous != nullptr && magazines.previous->rounds == 0) {
+                Magazine *magazine = magazines.loaded;
+                magazines.loaded = magazines.previous;
+                magazines.previous = magazine;
+                continue;
+            }
+
+            Internal::lock(&this->depotLock);
+            Magazine *empty = this->emptyMagazines;
+            if (empty != nullptr) {
+                this->emptyMagazines = empty->next;
+                if (magazines.previous != nullptr) {
+                    magazines.previous->next = this->fullMagazines;
+                    this->fullMagazines = magazines.previous;
+                }
+                magazines.previous = magazines.loaded;
+                magazines.loaded = empty;
+            }
+            Internal::unlock(&this->depotLock);
+
+            if (empty != nullptr) {
+                continue;
+            }
+
+            //the depot has no empty magazine: make one, and fall back to the slab layer if even that fails
+            empty = static_cast<Magazine *>(magazineCache.allocate());
+            if (empty == nullptr) {
+                freeToSlab(object);
+                return;
+            }
+
+            empty->rounds = 0;
+            Internal::lock(&this->depotLock);
+            empty->next = this->emptyMagazines;
+            this->emptyMagazines = empty;
+            Internal::unlock(&this->depotLock);
+        }
+    }
+
+    void ObjectCache::reap() {
+        Internal::lock(&this->depotLock);
+        Magazine *full = this->fullMagazines;
+        Magazine *empty = this->emptyMagazines;
+        this->fullMagazines = nullptr;
+        this->emptyMagazines = nullptr;
+        Internal::unlock(&this->depotLock);
+
+        while (full != nullptr) {
+            Magazine *next = full->next;
+            destroyMagazine(full);
+            full = next;
+        }
+        while (empty != nullptr) {
+            Magazine *next = empty->next;
+            destroyMagazine(empty);
+            empty = next;
+        }
+
+        Internal::lock(&this->slabLock);
+        SlabHeader *slab = this->emptySlab;
+        this->emptySlab = nullptr;
+        if (slab != nullptr) {
+            this->slabCount--;
+        }
+        Internal::unlock(&this->slabLock);
+
+        if (slab != nullptr) {
+            Internal::releasePages(slab, SLAB_SIZE);
+        }
+
+        //the magazines destroyed above may have emptied a slab of the magazine cache
+        if (this != &magazineCache) {
+            magazineCache.reap();
+        }
+    }
+
+    void ObjectCache::drain() {
+        for (CpuMagazines &magazines : this->cpuMagazines) {
+            if (magazines.loaded != nullptr) {
+                destroyMagazine(magazines.loaded);
+            }
+            if (magazines.previous != nullptr) {
+                destroyMagazine(magazines.previous);
+            }
+            magazines.loaded = nullptr;
+            magazines.previous = nullptr;
+        }
+
+        reap();
+    }
+
+    const char *ObjectCache::getName() const {
+        return this->name;
+    }
+
+    std::size_t ObjectCache::getObjectSize() const {
+        return this->objectSize;
+    }
+
+    std::size_t ObjectCache::getSlabCount() const {
+        return this->slabCount;
+    }
+
+    std::size_t ObjectCache::getAllocatedCount() const {
+        return this->allocatedCount;
+    }
+
+    ObjectCache *ObjectCache::getCacheOf(const void *object) {
+        const std::uintptr_t slab = reinterpret_cast<std::uintptr_t>(object) & ~(SLAB_SIZE - 1);
+        return reinterpret_cast<const SlabHeader *>(slab)->cache;
+    }
+
+    void *ObjectCache::allocateFromSlab() {
+        Internal::lock(&this->slabLock);
+        if (this->partialSlabs == nullptr && this->emptySlab != nullptr) {
+            linkPartialSlab(this->emptySlab);
+            this->emptySlab = nullptr;
+        }
+
+        if (this->partialSlabs == nullptr) {
+            //the page source may be slow (or take its own lock), so it's called without holding the slab lock
+            Internal::unlock(&this->slabLock);
+            SlabHeader *newSlab = createSlab();
+            if (newSlab == nullptr) {
+                return nullptr;
+            }
+            registerCache();
+
+            Internal::lock(&this->slabLock);
+            this->slabCount++;
+            linkPartialSlab(newSlab);
+        }
+
+        SlabHeader *slab = this->partialSlabs;
+        void *object;
+        if (slab->freeList != nullptr) {
+            object = slab->freeList;
+            slab->freeList = *static_cast<void **>(object);
+        } else {
+            object = reinterpret_cast<void *>(slab->unusedStart);
+            slab->unusedStart += this->objectSize;
+        }
+
+        slab->inUse++;
+        this->allocatedCount++;
+        if (isSlabFull(slab)) {
+            unlinkPartialSlab(slab);
+        }
+        Internal::unlock(&this->slabLock);
+
+        return object;
+    }
+
+    void ObjectCache::freeToSlab(void *object) {
+        auto *slab = reinterpret_cast<SlabHeader *>(reinterpret_cast<std::uintptr_t>(object) & ~(SLAB_SIZE - 1));
+        SlabHeader *releasedSlab = nullptr;
+
+        Internal::lock(&this->slabLock);
+        const bool wasFull = isSlabFull(slab);
+        *static_cast<void **>(object) = slab->freeList;
+        slab->freeList = object;
+        slab->inUse--;
+        this->allocatedCount--;
+
+        if (wasFull) {
+            linkPartialSlab(slab);
+        }
+
+        if (slab->inUse == 0) {
+            //one empty slab is kept, so the next allocation doesn't have to go to the page source right away
+            unlinkPartialSlab(slab);
+            if (this->emptySlab == nullptr) {
+                this->emptySlab = slab;
+            } else {
+                releasedSlab = slab;
+                this->slabCount--;
+            }
+        }
+        Internal::unlock(&this->slabLock);
+
+        if (releasedSlab != nullptr) {
+            Internal::releasePages(releasedSlab, SLAB_SIZE);
+        }
+    }
+
+    ObjectCache::SlabHeader *ObjectCache::createSlab() {
+        static_assert(sizeof(SlabHeader) <= SLAB_HEADER_SIZE);
+
+        auto *slab = static_cast<SlabHeader *>(Internal::allocatePages(SLAB_SIZE));
+        if (slab == nullptr) {
+            return nullptr;
+        }
+
+        const auto slabAddress = reinterpret_cast<std::uintptr_t>(slab);
+        const std::size_t firstObject = roundUp(SLAB_HEADER_SIZE, this->alignment);
+        const std::size_t unusedSpace = SLAB_SIZE - firstObject - this->objectsPerSlab * this->objectSize;
+
+        //the color shifts the objects by whole cache lines, within the space the objects leave at the end of the slab
+        const std::size_t colorStep = this->alignment > CACHE_LINE_SIZE ? this->alignment : CACHE_LINE_SIZE;
+        const std::size_t colorCount = unusedSpace / colorStep + 1;
+        const std::size_t color = __atomic_fetch_add(&this->nextColor, 1, __ATOMIC_RELAXED) % colorCount;
+
+        slab->cache = this;
+        slab->next = nullptr;
+        slab->prev = nullptr;
+        slab->freeList = nullptr;
+        slab->unusedStart = slabAddress + firstObject + color * colorStep;
+        slab->unusedEnd = slab->unusedStart + this->objectsPerSlab * this->objectSize;
+        slab->inUse = 0;
+        return slab;
+    }
+
+    bool ObjectCache::isSlabFull(const SlabHeader *slab) {
+        return slab->freeList == nullptr && slab->unusedStart == slab->unusedEnd;
+    }
+
+    void ObjectCache::linkPartialSlab(SlabHeader *slab) {
+        slab->prev = nullptr;
+        slab->next = this->partialSlabs;
+        if (slab->next != nullptr) {
+            slab->next->prev = slab;
+        }
+        this->partialSlabs = slab;
+    }
+
+    void ObjectCache::unlinkPartialSlab(SlabHeader *slab) {
+        if (slab->prev != nullptr) {
+            slab->prev->next = slab->next;
+        } else {
+            this->partialSlabs = slab->next;
+        }
+        if (slab->next != nullptr) {
+            slab->next->prev = slab->prev;
+        }
+        slab->next = nullptr;
+        slab->prev = nullptr;
+    }
+
+    void ObjectCache::destroyMagazine(Magazine *magazine) {
+        for (unsigned i = 0; i < magazine->rounds; i++) {
+            freeToSlab(magazine->objects[i]);
+        }
+        magazineCache.free(magazine);
+    }
+
+    void ObjectCache::registerCache() {
+        if (__atomic_load_n(&this->isRegistered, __ATOMIC_ACQUIRE)) {
+            return;
+        }
+
+        Internal::lock(&registryLock);
+        if (!this->isRegistered) {
+            this->nextCache = firstCache;
+            firstCache = this;
+            __atomic_store_n(&this->isRegistered, true, __ATOMIC_RELEASE);
+        }
+        Internal::unlock(&registryLock);
+    }
+
+    ObjectCache::CpuMagazines &ObjectCache::getCurrentMagazines() {
+        const unsigned cpuIndex = cpuIndexFunction != nullptr ? cpuIndexFunction() : 0;
+        return this->cpuMagazines[cpuIndex];
+    }
+
+    void visitCaches(void (*visitor)(const ObjectCache &cache, void *context), void *context) {
+        Internal::lock(&registryLock);
+        for (const ObjectCache *cache = firstCache; cache != nullptr; cache = cache->nextCache) {
+            visitor(*cache, context);
+        }
+        Internal::unlock(&registryLock);
+    }
+} //namespace Slab
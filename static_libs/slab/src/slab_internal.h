@@ -0,0 +1,38 @@
+#ifndef SLAB_SLAB_INTERNAL_H
+#define SLAB_SLAB_INTERNAL_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Helpers shared by the object caches and the heap. Not part of the public interface.
+ */
+namespace Slab::Internal {
+    /**
+     * Calls the page source; returns nullptr if there's none yet.
+     */
+    void *allocatePages(std::size_t size);
+    void releasePages(void *pages, std::size_t size);
+
+    /**
+     * Constructs the size-class caches of the heap, the first time it's called.
+     */
+    void initHeap();
+
+    inline void lock(std::uint32_t *lockWord) {
+        while (__atomic_exchange_n(lockWord, 1, __ATOMIC_ACQUIRE) != 0) {
+            //wait on a plain load, so the cache line isn't bounced between the waiting CPUs
+            while (__atomic_load_n(lockWord, __ATOMIC_RELAXED) != 0) {
+#if __x86_64__
+                asm volatile("pause");
+#endif
+            }
+        }
+    }
+
+    inline void unlock(std::uint32_t *lockWord) {
+        __atomic_store_n(lockWord, 0, __ATOMIC_RELEASE);
+    }
+} //namespace Slab::Internal
+
+#endif //SLAB_SLAB_INTERNAL_H
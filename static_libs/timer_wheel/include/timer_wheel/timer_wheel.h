@@ -0,0 +1,119 @@
+#ifndef TIMER_WHEEL_TIMER_WHEEL_H
+#define TIMER_WHEEL_TIMER_WHEEL_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * A hierarchical timing wheel (Varghese and Lauck, "Hashed and Hierarchical Timing Wheels", SOSP 1987): timers are
+ * kept in slots by their expiry time instead of in a sorted structure, so adding and cancelling one takes constant
+ * time however many are pending.
+ *
+ * The wheel has one level per 6 bits of the time, 64 slots each. A timer goes to the level of the highest 6-bit digit
+ * its expiry differs from the wheel's current time in, at the slot of that digit. When the current time reaches the
+ * start of a slot above level 0, the slot's timers move down to the levels their expiries now differ in (a cascade);
+ * level 0 slots hold the timers that expire at exactly that time. With 11 levels, every 64-bit time fits, so no timer
+ * fires late or early whatever unit the times are in, and a timer is moved at most 10 times over its life.
+ *
+ * Time only moves forward, with advance, and directly to the next slot that has timers rather than one unit at a time,
+ * so a wheel that advances rarely (a CPU idle for a long time) pays nothing for the time in between. getNextExpiry
+ * gives the exact time to advance at next, to program a one-shot timer with.
+ *
+ * A wheel isn't thread-safe: the caller locks around it (the kernel has one per CPU).
+ */
+namespace TimerWheel {
+    constexpr unsigned LEVEL_BITS = 6;
+    constexpr unsigned SLOT_COUNT = 1u << LEVEL_BITS;
+    constexpr unsigned LEVEL_COUNT = (64 + LEVEL_BITS - 1) / LEVEL_BITS;
+
+    struct Timer;
+
+    typedef void (*TimerCallback)(Timer *timer);
+
+    struct Timer {
+        /**
+         * The neighbours in a slot; next also links the list advance returns.
+         */
+        Timer *next;
+        Timer *previous;
+        std::uint64_t expiry;
+        /**
+         * What the owner of the wheel calls for an expired timer; the wheel itself never calls it.
+         */
+        TimerCallback callback;
+        void *context;
+        std::uint8_t level;
+        std::uint8_t slot;
+        /**
+         * Whether the timer is in a wheel: set by insert, cleared by remove and by advance when it expires.
+         */
+        bool isPending;
+    };
+
+    /**
+     * Sets up a timer that isn't pending.
+     */
+    void initTimer(Timer *timer, TimerCallback callback, void *context);
+
+    class Wheel {
+        std::uint64_t currentTime = 0;
+        /**
+         * A bit per slot that has timers.
+         */
+        std::uint64_t occupiedSlots[LEVEL_COUNT] = {};
+        Timer *slots[LEVEL_COUNT][SLOT_COUNT] = {};
+        std::size_t pendingCount = 0;
+
+        void place(Timer *timer);
+        void unlink(Timer *timer);
+        Timer *takeSlot(unsigned level, unsigned slot);
+        [[nodiscard]] bool getNextEvent(std::uint64_t *time) const;
+
+    public:
+        constexpr Wheel() = default;
+
+        Wheel(const Wheel &) = delete;
+        Wheel &operator=(const Wheel &) = delete;
+
+        /**
+         * Empties the wheel (without touching the timers in it) and sets its current time.
+         */
+        void reset(std::uint64_t time);
+
+        /**
+         * Adds a timer that isn't pending. An expiry that isn't after the current time makes it expire on the next
+         * advance.
+         */
+        void insert(Timer *timer, std::uint64_t expiry);
+
+        /**
+         * Takes a timer out of the wheel.
+         * @return False if it wasn't pending (it expired already, or was never inserted).
+         */
+        bool remove(Timer *timer);
+
+        /**
+         * Moves the current time to the given time (never back), and takes out every timer that expires until then.
+         * @return The expired timers, linked by next, or nullptr. They're in the order of their expiries, except that
+         * the ones inserted with an expiry before the current time come first, in any order.
+         */
+        Timer *advance(std::uint64_t time);
+
+        /**
+         * Gets the earliest expiry of the pending timers, which can be before the current time. Goes through the timers
+         * of a single slot, the first one of the lowest level that has timers.
+         * @return False if no timer is pending.
+         */
+        bool getNextExpiry(std::uint64_t *expiry) const;
+
+        [[nodiscard]] std::uint64_t getCurrentTime() const {
+            return this->currentTime;
+        }
+
+        [[nodiscard]] std::size_t getPendingCount() const {
+            return this->pendingCount;
+        }
+    };
+} //namespace TimerWheel
+
+#endif //TIMER_WHEEL_TIMER_WHEEL_H
@@ -0,0 +1,193 @@
+#include "timer_wheel/timer_wheel.h"
+
+namespace TimerWheel {
+    static_assert(LEVEL_COUNT * LEVEL_BITS >= 64, "every 64-bit time should fit in the levels");
+
+    /**
+     * Returns the digit of a time at a level.
+     */
+    static unsigned getDigit(const std::uint64_t time, const unsigned level) {
+        return static_cast<unsigned>(time >> (level * LEVEL_BITS)) & (SLOT_COUNT - 1);
+    }
+
+    /**
+     * Returns the time with the digits of the given level and the ones below it cleared.
+     */
+    static std::uint64_t clearDigitsUpTo(const std::uint64_t time, const unsigned level) {
+        const unsigned bits = (level + 1) * LEVEL_BITS;
+        return bits >= 64 ? 0 : time >> bits << bits;
+    }
+
+    void initTimer(Timer *timer, const TimerCallback callback, void *context) {
+        timer->next = nullptr;
+        timer->previous = nullptr;
+        timer->expiry = 0;
+        timer->callback = callback;
+        timer->context = context;
+        timer->level = 0;
+        timer->slot = 0;
+        timer->isPending = false;
+    }
+
+    void Wheel::reset(const std::uint64_t time) {
+        this->currentTime = time;
+        for (unsigned level = 0; level < LEVEL_COUNT; level++) {
+            this->occupiedSlots[level] = 0;
+            for (unsigned slot = 0; slot < SLOT_COUNT; slot++) {
+                this->slots[level][slot] = nullptr;
+            }
+        }
+        this->pendingCount = 0;
+    }
+
+    /**
+     * Links a timer into the slot its expiry belongs to at the current time.
+     */
+    void Wheel::place(Timer *timer) {
+        unsigned level = 0;
+        unsigned slot = getDigit(this->currentTime, 0);
+        if (timer->expiry > this->currentTime) {
+            const unsigned highestBit = 63 - static_cast<unsigned>(__builtin_clzll(timer->expiry ^ this->currentTime));
+            level = highestBit / LEVEL_BITS;
+            slot = getDigit(timer->expiry, level);
+        }
+
+        Timer *&head = this->slots[level][slot];
+        timer->level = static_cast<std::uint8_t>(level);
+        timer->slot = static_cast<std::uint8_t>(slot);
+        timer->previous = nullptr;
+        timer->next = head;
+        if (head != nullptr) {
+            head->previous = timer;
+        }
+        head = timer;
+        this->occupiedSlots[level] |= 1ull << slot;
+    }
+
+    void Wheel::unlink(Timer *timer) {
+        Timer *&head = this->slots[timer->level][timer->slot];
+        if (timer->previous != nullptr) {
+            timer->previous->next = timer->next;
+        } else {
+            head = timer->next;
+        }
+        if (timer->next != nullptr) {
+            timer->next->previous = timer->previous;
+        }
+        if (head == nullptr) {
+            this->occupiedSlots[timer->level] &= ~(1ull << timer->slot);
+        }
+    }
+
+    /**
+     * Empties a slot, and returns its timers (linked by next).
+     */
+    Timer *Wheel::takeSlot(const unsigned level, const unsigned slot) {
+        Timer *timers = this->slots[level][slot];
+        this->slots[level][slot] = nullptr;
+        this->occupiedSlots[level] &= ~(1ull << slot);
+        return timers;
+    }
+
+    /**
+     * Gets the next time something has to happen: a level 0 slot expires, or a slot above moves down. The lowest level
+     * with timers has it, as a timer is only on a level because its expiry differs from the current time in that
+     * level's digit: the timers of the levels above expire later than any of it.
+     */
+    bool Wheel::getNextEvent(std::uint64_t *time) const {
+        for (unsigned level = 0; level < LEVEL_COUNT; level++) {
+            //the slots before the current time's digit are empty (at level 0, that digit's slot holds the timers that
+            //expire now)
+            const std::uint64_t occupied = this->occupiedSlots[level];
+            if (occupied != 0) {
+                const auto slot = static_cast<std::uint64_t>(__builtin_ctzll(occupied));
+                *time = clearDigitsUpTo(this->currentTime, level) | slot << (level * LEVEL_BITS);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Wheel::insert(Timer *timer, const std::uint64_t expiry) {
+        timer->expiry = expiry;
+        timer->isPending = true;
+        place(timer);
+        this->pendingCount++;
+    }
+
+    bool Wheel::remove(Timer *timer) {
+        if (!timer->isPending) {
+            return false;
+        }
+
+        unlink(timer);
+        timer->isPending = false;
+        timer->next = nullptr;
+        timer->previous = nullptr;
+        this->pendingCount--;
+        return true;
+    }
+
+    Timer *Wheel::advance(const std::uint64_t time) {
+        Timer *expired = nullptr;
+        Timer **expiredTail = &expired;
+
+        std::uint64_t event;
+        while (getNextEvent(&event) && event <= time) {
+            //nothing happens in between, so the slots stay right
+            this->currentTime = event;
+
+            //the slots that start now move down; a timer that expires right now lands in the level 0 slot taken below
+            for (unsigned level = LEVEL_COUNT - 1; level > 0; level--) {
+                if (clearDigitsUpTo(event, level - 1) != event) {
+                    continue;
+                }
+
+                Timer *timer = takeSlot(level, getDigit(event, level));
+                while (timer != nullptr) {
+                    Timer *next = timer->next;
+                    place(timer);
+                    timer = next;
+                }
+            }
+
+            Timer *timer = takeSlot(0, getDigit(event, 0));
+            while (timer != nullptr) {
+                timer->isPending = false;
+                timer->previous = nullptr;
+                *expiredTail = timer;
+                expiredTail = &timer->next;
+                timer = timer->next;
+                this->pendingCount--;
+            }
+            *expiredTail = nullptr;
+        }
+
+        if (time > this->currentTime) {
+            this->currentTime = time;
+        }
+        return expired;
+    }
+
+    bool Wheel::getNextExpiry(std::uint64_t *expiry) const {
+        for (unsigned level = 0; level < LEVEL_COUNT; level++) {
+            const std::uint64_t occupied = this->occupiedSlots[level];
+            if (occupied == 0) {
+                continue;
+            }
+
+            //the first slot of the lowest level with timers has the earliest one, but a slot above level 0 covers a
+            //range of times
+            const Timer *timer = this->slots[level][__builtin_ctzll(occupied)];
+            std::uint64_t earliest = timer->expiry;
+            for (timer = timer->next; timer != nullptr; timer = timer->next) {
+                if (timer->expiry < earliest) {
+                    earliest = timer->expiry;
+                }
+            }
+            *expiry = earliest;
+            return true;
+        }
+        return false;
+    }
+} //namespace TimerWheel
@@ -0,0 +1,107 @@
+#ifndef TRACE_TRACE_H
+#define TRACE_TRACE_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Marks the start of a phase. The name is copied (truncated to MAX_NAME_LENGTH), so it doesn't have to outlive the
+ * call.
+ */
+#define TRACE_BEGIN(name) ::Trace::record(::Trace::Phase::Begin, name)
+
+/**
+ * Marks the end of the phase started with the same name on the same CPU.
+ */
+#define TRACE_END(name) ::Trace::record(::Trace::Phase::End, name)
+
+namespace Trace {
+    constexpr std::size_t MAX_NAME_LENGTH = 21;
+
+    /**
+     * The number of events a buffer holds (128 KiB of them). When it's full, the oldest events are overwritten.
+     */
+    constexpr std::size_t BUFFER_CAPACITY = 4096;
+
+    /**
+     * "TRACEBUF" in little-endian ASCII.
+     */
+    constexpr std::uint64_t BUFFER_MAGIC = 0x4655424543415254;
+
+    /**
+     * The values are the "ph" field of the Chrome trace format.
+     */
+    enum class Phase : char {
+        Begin = 'B',
+        End = 'E',
+    };
+
+    struct Event {
+        /**
+         * The TSC when the event was recorded.
+         */
+        std::uint64_t timestamp;
+        char name[MAX_NAME_LENGTH + 1];
+        Phase phase;
+        std::uint8_t cpu;
+    };
+
+    /**
+     * A ring of events. It has no pointers, so the bootloader can fill one and hand it to the kernel, which keeps
+     * recording into it.
+     */
+    struct alignas(64) Buffer {
+        std::uint64_t magic;
+        /**
+         * The frequency of the TSC in Hz, to turn the timestamps into time; 0 if unknown.
+         */
+        std::uint64_t tscFrequency;
+        /**
+         * The number of events ever recorded; the next one goes to events[nextEvent % BUFFER_CAPACITY].
+         */
+        std::uint64_t nextEvent;
+        alignas(64) Event events[BUFFER_CAPACITY];
+    };
+
+    /**
+     * Returns the index of the current CPU, recorded as the thread of the events.
+     */
+    typedef unsigned (*CpuIndexFunction)();
+
+    /**
+     * Receives the output of writeChromeTrace, piece by piece.
+     */
+    typedef void (*WriteFunction)(const char *data, std::size_t size, void *context);
+
+    /**
+     * Empties a buffer and sets its magic.
+     */
+    void initBuffer(Buffer *buffer, std::uint64_t tscFrequency);
+
+    /**
+     * Sets the buffer TRACE_BEGIN/TRACE_END record into. Until then (or with nullptr), they do nothing.
+     */
+    void setBuffer(Buffer *buffer);
+
+    [[nodiscard]] Buffer *getBuffer();
+
+    /**
+     * Sets the function used to find the current CPU. Until then, every event is recorded as CPU 0.
+     */
+    void setCpuIndexFunction(CpuIndexFunction cpuIndexFunction);
+
+    /**
+     * Records an event in the current buffer. Safe to call from several CPUs at once: the slot is taken with a single
+     * atomic addition. The TSC is read without fences, so an event can be off by a few tens of cycles.
+     */
+    void record(Phase phase, const char *name);
+
+    /**
+     * Writes the events of the buffer, oldest first, as a JSON trace in the Chrome trace event format (which
+     * chrome://tracing and Perfetto load). The timestamps are in microseconds from the oldest event, or in TSC ticks
+     * if the frequency is unknown. Nothing should be recorded into the buffer meanwhile.
+     */
+    void writeChromeTrace(const Buffer &buffer, WriteFunction write, void *context);
+} //namespace Trace
+
+#endif //TRACE_TRACE_H
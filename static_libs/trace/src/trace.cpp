@@ -0,0 +1,150 @@
+#include "trace/trace.h"
+
+namespace Trace {
+    static_assert(sizeof(Event) == 32, "an event should stay half a cache line");
+
+    static Buffer *activeBuffer = nullptr;
+    static CpuIndexFunction cpuIndexFunction = nullptr;
+
+    /**
+     * Room for the longest line writeChromeTrace produces for an event (every name character escaped).
+     */
+    constexpr std::size_t LINE_SIZE = 192;
+
+    static std::uint64_t readTimestamp() {
+#if __x86_64__
+        std::uint32_t low;
+        std::uint32_t high;
+        asm volatile("rdtsc" : "=a"(low), "=d"(high));
+        return static_cast<std::uint64_t>(high) << 32 | low;
+#else
+        return 0;
+#endif
+    }
+
+    void initBuffer(Buffer *buffer, const std::uint64_t tscFrequency) {
+        buffer->magic = BUFFER_MAGIC;
+        buffer->tscFrequency = tscFrequency;
+        buffer->nextEvent = 0;
+    }
+
+    void setBuffer(Buffer *buffer) {
+        activeBuffer = buffer;
+    }
+
+    Buffer *getBuffer() {
+        return activeBuffer;
+    }
+
+    void setCpuIndexFunction(const CpuIndexFunction function) {
+        cpuIndexFunction = function;
+    }
+
+    void record(const Phase phase, const char *name) {
+        Buffer *buffer = activeBuffer;
+        if (buffer == nullptr) {
+            return;
+        }
+
+        const std::uint64_t timestamp = readTimestamp();
+        const std::uint64_t index = __atomic_fetch_add(&buffer->nextEvent, 1, __ATOMIC_RELAXED);
+        Event &event = buffer->events[index % BUFFER_CAPACITY];
+
+        event.timestamp = timestamp;
+        std::size_t length = 0;
+        while (length < MAX_NAME_LENGTH && name[length] != '\0') {
+            event.name[length] = name[length];
+            length++;
+        }
+        event.name[length] = '\0';
+        event.phase = phase;
+        event.cpu = static_cast<std::uint8_t>(cpuIndexFunction != nullptr ? cpuIndexFunction() : 0);
+    }
+
+    /**
+     * Appends the decimal digits of value, with at least minDigits of them.
+     */
+    static std::size_t appendUnsigned(char *line, std::size_t position, std::uint64_t value, const int minDigits = 1) {
+        char digits[20];
+        int count = 0;
+        do {
+            digits[count++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value != 0 || count < minDigits);
+
+        while (count > 0) {
+            line[position++] = digits[--count];
+        }
+        return position;
+    }
+
+    static std::size_t appendString(char *line, std::size_t position, const char *string) {
+        while (*string != '\0') {
+            line[position++] = *string++;
+        }
+        return position;
+    }
+
+    /**
+     * Appends a name as a JSON string body: quotes and backslashes are escaped, control characters replaced.
+     */
+    static std::size_t appendName(char *line, std::size_t position, const char *name) {
+        for (std::size_t i = 0; i < MAX_NAME_LENGTH && name[i] != '\0'; i++) {
+            const char c = name[i];
+            if (c == '"' || c == '\\') {
+                line[position++] = '\\';
+                line[position++] = c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                line[position++] = '?';
+            } else {
+                line[position++] = c;
+            }
+        }
+        return position;
+    }
+
+    void writeChromeTrace(const Buffer &buffer, const WriteFunction write, void *context) {
+        const std::uint64_t recorded = __atomic_load_n(&buffer.nextEvent, __ATOMIC_ACQUIRE);
+        const std::uint64_t first = recorded > BUFFER_CAPACITY ? recorded - BUFFER_CAPACITY : 0;
+
+        static constexpr char HEADER[] = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+        static constexpr char FOOTER[] = "]}\n";
+        write(HEADER, sizeof(HEADER) - 1, context);
+
+        const std::uint64_t origin = recorded != first ? buffer.events[first % BUFFER_CAPACITY].timestamp : 0;
+        for (std::uint64_t i = first; i < recorded; i++) {
+            const Event &event = buffer.events[i % BUFFER_CAPACITY];
+            //the TSC of another CPU can be slightly behind
+            const std::uint64_t ticks = event.timestamp > origin ? event.timestamp - origin : 0;
+
+            char line[LINE_SIZE];
+            std::size_t position = appendString(line, 0, "{\"name\":\"");
+            position = appendName(line, position, event.name);
+            position = appendString(line, position, "\",\"ph\":\"");
+            line[position++] = static_cast<char>(event.phase);
+            position = appendString(line, position, "\",\"ts\":");
+            if (buffer.tscFrequency != 0) {
+                //microseconds with 3 decimals; split so nothing overflows (and no 128-bit division from libgcc)
+                const std::uint64_t seconds = ticks / buffer.tscFrequency;
+                const std::uint64_t nanoseconds =
+                    seconds * 1000000000 + ticks % buffer.tscFrequency * 1000000000 / buffer.tscFrequency;
+                position = appendUnsigned(line, position, nanoseconds / 1000);
+                line[position++] = '.';
+                position = appendUnsigned(line, position, nanoseconds % 1000, 3);
+            } else {
+                position = appendUnsigned(line, position, ticks);
+            }
+            position = appendString(line, position, ",\"pid\":0,\"tid\":");
+            position = appendUnsigned(line, position, event.cpu);
+            line[position++] = '}';
+            if (i + 1 != recorded) {
+                line[position++] = ',';
+            }
+            line[position++] = '\n';
+
+            write(line, position, context);
+        }
+
+        write(FOOTER, sizeof(FOOTER) - 1, context);
+    }
+} //namespace Trace